@@ -1,5 +1,4 @@
 import { spawn, spawnSync } from 'node:child_process';
-import { Transform } from 'stream';
 import ffmpegPath from 'ffmpeg-static';
 import { parseFile } from 'music-metadata';
 import { existsSync } from 'node:fs';
@@ -65,7 +64,6 @@ let ffmpegProc = null;
 let outputStream = null;
 let currentFile = null;
 let isPaused = false;
-let currentGainStream = null;
 let lastOnEnd = null;
 let lastOnError = null;
 let lastOptions = {};
@@ -73,6 +71,41 @@ let currentStartTime = 0;
 let silenceInterval = null;
 let silenceChunk = null;
 let outputFormatInfo = { sampleRate: 44100, channels: 2, bitDepth: 16 };
+// Set while the addon decodes the current file itself (no ffmpeg process)
+let nativeDecodeActive = false;
+let nativeDecodeTimer = null;
+// Next track queued on the native decoder for gapless playback, and the
+// boundary once the render thread has crossed into it
+let gaplessNext = null;
+let gaplessBoundary = null;
+// Stream position (seconds) at which the current track began
+let segmentOffset = 0;
+// Bumped by stop(); a playFile() that was superseded while it awaited
+// the device drops what it opened
+let playGeneration = 0;
+
+// Volume changes ramp over this long in the native gain stage (no zipper noise)
+const VOLUME_RAMP_MS = 30;
+
+// Give up on a device that has not opened by then (it keeps opening on the
+// native worker and is closed again once it does)
+const OPEN_TIMEOUT_MS = 5000;
+
+// Containers the addon decodes in-process; anything else goes through ffmpeg
+const NATIVE_DECODE_EXTS = new Set(['.wav', '.wave', '.flac', '.aif', '.aiff', '.aifc']);
+
+function isNativeDecodable(filePath) {
+  return typeof filePath === 'string' && !/^https?:\/\//i.test(filePath) &&
+    NATIVE_DECODE_EXTS.has(path.extname(filePath).toLowerCase());
+}
+
+// Stream depth that carries a decoder's samples unchanged: 8/12 -> 16,
+// 20 -> 24, 32 stays integer
+function streamBitDepth(fileBits) {
+  if (fileBits <= 16) return 16;
+  if (fileBits <= 24) return 24;
+  return 32;
+}
 
 let eqState = {
   enabled: false,
@@ -82,20 +115,24 @@ let eqState = {
 
 function setEQ(state) {
   console.log('[audioEngine] setEQ:', state);
-  const wasEnabled = eqState.enabled;
-  const oldBands = [...eqState.bands];
-  
   if (state.enabled !== undefined) eqState.enabled = state.enabled;
   if (state.preset !== undefined) eqState.preset = state.preset;
   if (state.bands && Array.isArray(state.bands)) eqState.bands = [...state.bands];
 
-  const bandsChanged = JSON.stringify(oldBands) !== JSON.stringify(eqState.bands);
-  const shouldRestart = (wasEnabled !== eqState.enabled) || (eqState.enabled && bandsChanged);
+  _applyEQ();
+}
 
-  if (ffmpegProc && shouldRestart) {
-    console.log('[audioEngine] EQ changed, restarting playback...');
-    const time = getTime();
-    playFile(currentFile, lastOnEnd, lastOnError, { ...lastOptions, startTime: time });
+// The EQ runs in the addon's render thread, so changes take effect within
+// one device period without restarting playback.
+function _applyEQ() {
+  if (!outputStream || typeof outputStream.setEq !== 'function') return false;
+  try {
+    const bands = eqState.enabled ? eqState.bands.map((g) => Number(g) || 0) : null;
+    outputStream.setEq(bands);
+    return true;
+  } catch (e) {
+    console.warn('[audioEngine] setEq failed:', e?.message ?? e);
+    return false;
   }
 }
 
@@ -103,15 +140,49 @@ function getEQ() {
   return { ...eqState };
 }
 
+// Crossfade between tracks queued with queueNext(); only natively decoded
+// tracks can overlap, anything else still plays back to back
+let crossfadeMs = 0;
+
+function setCrossfade(ms) {
+  crossfadeMs = Math.min(10000, Math.max(0, Number(ms) || 0));
+  _applyCrossfade();
+  return crossfadeMs;
+}
+
+function _applyCrossfade() {
+  if (!outputStream || typeof outputStream.setCrossfade !== 'function') return false;
+  try {
+    outputStream.setCrossfade(crossfadeMs);
+    return true;
+  } catch (e) {
+    console.warn('[audioEngine] setCrossfade failed:', e?.message ?? e);
+    return false;
+  }
+}
+
+function getCrossfade() {
+  return crossfadeMs;
+}
+
 function setVolume(v) {
   const pct = Math.min(100, Math.max(0, Number.isFinite(v) ? Number(v) : 100));
-  if (currentGainStream) {
-    currentGainStream.gain = pct / 100.0;
-    _updateLastOptionsVolume(pct);
+  _updateLastOptionsVolume(pct);
+  return _applyVolume(pct, VOLUME_RAMP_MS);
+}
+
+// Volume is applied by the addon's render thread, after the ring, so it
+// takes effect within one device period on both the ffmpeg and the native
+// decode paths.
+function _applyVolume(pct, rampMs) {
+  if (!outputStream || typeof outputStream.setGain !== 'function') return false;
+  try {
+    outputStream.setGain(pct / 100.0, rampMs);
     return true;
+  } catch (e) {
+    console.warn('[audioEngine] setGain failed:', e?.message ?? e);
+    return false;
   }
-  _updateLastOptionsVolume(pct);
-  return false;
 }
 
 function _updateLastOptionsVolume(v) {
@@ -128,7 +199,9 @@ function _updateLastOptionsVolume(v) {
   }
 }
 
-function createExclusiveStream({ sampleRate, channels, bitDepth, deviceId, mode, bufferMs, bitPerfect, strictBitPerfect }) {
+// Opens off the main thread where the addon supports it, so a track change
+// does not hold up IPC or the UI while the device negotiates its format.
+async function createExclusiveStream({ sampleRate, channels, bitDepth, floatSamples, deviceId, mode, bufferMs, bitPerfect, strictBitPerfect, realtime, cpuAffinity, lockMemory, raiseRealtimeLimits, latencyClass, periodFrames, periods, hwBufferMs, nullSink, backend, bus, trace }) {
   if (!exclusiveAudio || typeof exclusiveAudio.createExclusiveStream !== 'function') {
     throw new Error('exclusiveAudio addon not available');
   }
@@ -137,31 +210,53 @@ function createExclusiveStream({ sampleRate, channels, bitDepth, deviceId, mode,
     sampleRate,
     channels,
     bitDepth,
+    ...(floatSamples !== undefined ? { floatSamples } : {}),
     deviceId: deviceId || null,
     bufferMs: bufferMs || 250,
     bitPerfect: bitPerfect || false,
     strictBitPerfect: strictBitPerfect || false,
+    ...(realtime !== undefined ? { realtime } : {}),
+    ...(Array.isArray(cpuAffinity) ? { cpuAffinity } : {}),
+    ...(lockMemory !== undefined ? { lockMemory: !!lockMemory } : {}),
+    ...(raiseRealtimeLimits !== undefined ? { raiseRealtimeLimits: !!raiseRealtimeLimits } : {}),
+    ...(latencyClass !== undefined ? { latencyClass } : {}),
+    ...(periodFrames !== undefined ? { periodFrames } : {}),
+    ...(periods !== undefined ? { periods } : {}),
+    ...(hwBufferMs !== undefined ? { hwBufferMs } : {}),
+    ...(nullSink ? { nullSink } : {}),
+    ...(backend ? { backend } : {}),
+    ...(bus ? { bus } : {}),
+    ...(trace ? { trace } : {}),
   };
 
+  const open = (opts) => (typeof exclusiveAudio.openExclusiveStream === 'function'
+    ? exclusiveAudio.openExclusiveStream(opts, { timeoutMs: OPEN_TIMEOUT_MS })
+    : exclusiveAudio.createExclusiveStream(opts));
+
+  // No device behind it, so nothing to fall back to
+  if (mode === 'null') {
+    return open({ ...baseOpts, mode: 'null' });
+  }
+
   const firstMode = mode === 'shared' ? 'shared' : 'exclusive';
   const secondMode = firstMode === 'exclusive' ? 'shared' : 'exclusive';
 
   const tryMode = (m) => {
     console.log(`[audioEngine] opening ${m} WASAPI/CoreAudio stream`);
-    return exclusiveAudio.createExclusiveStream({ ...baseOpts, mode: m });
+    return open({ ...baseOpts, mode: m });
   };
 
   let lastErr;
 
   try {
-    return tryMode(firstMode);
+    return await tryMode(firstMode);
   } catch (e1) {
     lastErr = e1;
     console.warn(`[audioEngine] ${firstMode} mode failed:`, e1?.message ?? e1);
   }
 
   try {
-    return tryMode(secondMode);
+    return await tryMode(secondMode);
   } catch (e2) {
     console.warn(`[audioEngine] ${secondMode} mode also failed:`, e2?.message ?? e2);
     lastErr = e2;
@@ -180,7 +275,7 @@ async function playFile(filePath, onEnd, onError, options = {}) {
     const currentTrackPath = lastOptions?.track?.path;
     const sameByTrack = trackPath && currentTrackPath && trackPath === currentTrackPath;
     const sameByFile = currentFile && filePath && currentFile === filePath;
-    const sameFile = ffmpegProc && (sameByTrack || sameByFile);
+    const sameFile = (ffmpegProc || nativeDecodeActive) && (sameByTrack || sameByFile);
     if (sameFile && startAt < 0.05) {
       console.log('[audioEngine] playFile dedup: already playing this file, ignoring duplicate request');
       return;
@@ -188,6 +283,7 @@ async function playFile(filePath, onEnd, onError, options = {}) {
   } catch {}
 
   stop();
+  const generation = playGeneration;
   try {
     console.log('[audioEngine] playFile called for', filePath);
   } catch {}
@@ -205,26 +301,61 @@ async function playFile(filePath, onEnd, onError, options = {}) {
   } catch {
     meta = {};
   }
+  if (generation !== playGeneration) return;
   const fmt = meta?.format || {};
-  const sampleRate = options.sampleRate || fmt.sampleRate || 44100;
-  const channels = fmt.numberOfChannels || 2;
-  const bitDepth = 16; 
-
+  // Files the native decoder will play open at their own depth (32-bit as
+  // integer samples); ffmpeg sources are converted to 16-bit
+  const probe = isNativeDecodable(filePath) ? exclusiveAudio?.probeFile?.(filePath) : null;
+  const sampleRate = options.sampleRate || probe?.sampleRate || fmt.sampleRate || 44100;
+  const channels = probe?.channels || fmt.numberOfChannels || 2;
+  const bitDepth = probe ? streamBitDepth(probe.bitDepth) : 16;
+
+  let stream;
   try {
-    outputStream = createExclusiveStream({
+    stream = await createExclusiveStream({
       sampleRate,
       channels,
       bitDepth,
+      floatSamples: probe ? false : undefined,
       deviceId: options.deviceId,
       mode: options.mode,
       bufferMs: options.bufferMs || 250,
       bitPerfect: !!options.bitPerfect,
       strictBitPerfect: !!options.strictBitPerfect,
+      realtime: options.realtime,
+      cpuAffinity: options.cpuAffinity,
+      lockMemory: options.lockMemory,
+      raiseRealtimeLimits: options.raiseRealtimeLimits,
+      latencyClass: options.latencyClass,
+      periodFrames: options.periodFrames,
+      periods: options.periods,
+      hwBufferMs: options.hwBufferMs,
+      nullSink: options.nullSink,
+      backend: options.backend,
+      bus: options.bus,
+      trace: options.trace,
     });
   } catch (err) {
-    if (onError) onError(err);
+    if (generation === playGeneration && onError) onError(err);
+    return;
+  }
+  if (generation !== playGeneration) {
+    stream.destroy();
     return;
   }
+  outputStream = stream;
+
+  _applyVolume(Number(options?.volume ?? 100), 0);
+  _applyEQ();
+  _applyCrossfade();
+
+  // Render-thread events (end of playback, device loss, position ticks for
+  // gapless boundaries) instead of polling the stream
+  try {
+    outputStream.subscribeEvents?.({ positionIntervalMs: 100 });
+  } catch (e) {
+    console.warn('[audioEngine] native events unavailable:', e?.message ?? e);
+  }
 
   const actualSampleRate = outputStream.actualSampleRate || sampleRate;
   const actualChannels = outputStream.actualChannels || channels;
@@ -244,10 +375,17 @@ async function playFile(filePath, onEnd, onError, options = {}) {
     silenceChunk = null;
   }
 
+  if (startNativeDecode(filePath, onEnd, onError, options)) {
+    return;
+  }
+
   let ffmpegFormat = 's16le';
   let ffmpegCodec = 'pcm_s16le';
 
-  if (actualBitDepth === 32) {
+  if (actualBitDepth === 32 && outputStream.floatSamples === false) {
+    ffmpegFormat = 's32le';
+    ffmpegCodec = 'pcm_s32le';
+  } else if (actualBitDepth === 32) {
     ffmpegFormat = 'f32le';
     ffmpegCodec = 'pcm_f32le';
   } else if (actualBitDepth === 24) {
@@ -286,17 +424,6 @@ async function playFile(filePath, onEnd, onError, options = {}) {
     '-vn'
   );
 
-  if (eqState.enabled) {
-    const freqs = [32, 64, 125, 250, 500, 1000, 2000, 4000, 8000, 16000];
-    let entries = '';
-    for (let i = 0; i < freqs.length; i++) {
-      const gain = eqState.bands[i] || 0;
-      if (i > 0) entries += ';';
-      entries += `entry(${freqs[i]},${gain})`;
-    }
-    args.push('-af', `firequalizer=gain_entry='${entries}'`);
-  }
-
   args.push(
     '-f', ffmpegFormat,
     '-acodec', ffmpegCodec,
@@ -367,75 +494,18 @@ async function playFile(filePath, onEnd, onError, options = {}) {
       console.error('[audioEngine] FFmpeg close error:', exitErr.message);
       if (onError) onError(exitErr);
     } else if (!isPaused && onEnd) {
-      onEnd();
-    }
-  });
-
-  class GainTransform extends Transform {
-    constructor(format, channels, volumePercent) {
-      super();
-      this.format = format;
-      this.channels = channels || 1;
-      this.gain = Math.min(100, Math.max(0, Number.isFinite(volumePercent) ? volumePercent : 100)) / 100.0;
-    }
-
-    _transform(chunk, encoding, callback) {
-      try {
-        if (this.gain >= 0.99 && this.gain <= 1.01) {
-          this.push(chunk);
-          return callback();
-        }
-
-        if (this.format === 's16le') {
-          const out = Buffer.allocUnsafe(chunk.length);
-          for (let i = 0; i + 1 < chunk.length; i += 2) {
-            const s = chunk.readInt16LE(i);
-            let v = Math.round(s * this.gain);
-            if (v > 32767) v = 32767;
-            else if (v < -32768) v = -32768;
-            out.writeInt16LE(v, i);
-          }
-          this.push(out);
-          return callback();
-        }
-
-        if (this.format === 'f32le') {
-          const view = new DataView(chunk.buffer, chunk.byteOffset, chunk.length);
-          const out = Buffer.allocUnsafe(chunk.length);
-          for (let i = 0; i + 3 < chunk.length; i += 4) {
-            const f = view.getFloat32(i, true);
-            let v = f * this.gain;
-            if (v > 1.0) v = 1.0;
-            else if (v < -1.0) v = -1.0;
-            out.writeFloatLE(v, i);
-          }
-          this.push(out);
-          return callback();
-        }
-
-        if (this.format === 's24le') {
-          const out = Buffer.allocUnsafe(chunk.length);
-          for (let i = 0; i + 2 < chunk.length; i += 3) {
-            let s = chunk[i] | (chunk[i + 1] << 8) | (chunk[i + 2] << 16);
-            if (s & 0x800000) s |= 0xff000000;
-            let v = Math.round(s * this.gain);
-            if (v > 0x7fffff) v = 0x7fffff;
-            else if (v < -0x800000) v = -0x800000;
-            out[i] = v & 0xff;
-            out[i + 1] = (v >> 8) & 0xff;
-            out[i + 2] = (v >> 16) & 0xff;
-          }
-          this.push(out);
-          return callback();
-        }
-
-        this.push(chunk);
-        return callback();
-      } catch (err) {
-        return callback(err);
+      // Decoding is done, but the tail is still in the ring and the device;
+      // the stream finishes once its last frame has played
+      const stream = outputStream;
+      if (stream?.eventsSubscribed && !stream.writableFinished) {
+        stream.once('finish', () => {
+          if (outputStream === stream) onEnd();
+        });
+      } else {
+        onEnd();
       }
     }
-  }
+  });
 
   if (ffmpegProc.stdout) {
     ffmpegProc.stdout.on('error', (err) => {
@@ -447,10 +517,7 @@ async function playFile(filePath, onEnd, onError, options = {}) {
       stop();
     });
 
-    const vol = Number(options?.volume ?? 100);
-    const gainStream = new GainTransform(ffmpegFormat, actualChannels, vol);
-    currentGainStream = gainStream;
-    ffmpegProc.stdout.pipe(gainStream).pipe(outputStream);
+    ffmpegProc.stdout.pipe(outputStream);
   }
 
   if (outputStream && typeof outputStream.on === 'function') {
@@ -462,8 +529,166 @@ async function playFile(filePath, onEnd, onError, options = {}) {
   }
 }
 
+// Tries to play filePath through the addon's in-process decoder. Returns
+// false (leaving outputStream untouched) when the file has to go through
+// ffmpeg: remote sources or other codecs. A device rate that differs from
+// the file's is resampled natively (options.resampleQuality).
+function startNativeDecode(filePath, onEnd, onError, options) {
+  if (!isNativeDecodable(filePath)) return false;
+  if (!outputStream || typeof outputStream.openFile !== 'function') return false;
+
+  let info;
+  try {
+    info = outputStream.openFile(filePath, {
+      startTime: Number(options.startTime || 0),
+      ...(options.resampleQuality ? { resampleQuality: options.resampleQuality } : {}),
+    });
+  } catch (e) {
+    console.warn('[audioEngine] native decode unavailable, using FFmpeg:', e?.message ?? e);
+    return false;
+  }
+  console.log(`[audioEngine] Native decode: ${info.codec} ${info.sampleRate} Hz, ${info.channels} ch, ${info.bitDepth}-bit`);
+  if (info.resample) {
+    console.log(`[audioEngine] Resampling to ${info.resample.outputRate} Hz (${info.resample.quality}, ${info.resample.taps} taps, ${info.resample.kernel})`);
+  }
+
+  nativeDecodeActive = true;
+  const handle = outputStream.handle;
+
+  // The decoder thread owns the ring. Track boundaries, end of playback and
+  // errors come from render-thread events when the stream has them.
+  // Callbacks are read from lastOnEnd / lastOnError because a gapless
+  // transition swaps them.
+  if (outputStream.eventsSubscribed) {
+    const stream = outputStream;
+    const finish = (err) => {
+      if (outputStream !== stream || !nativeDecodeActive) return;
+      nativeDecodeActive = false;
+      if (err) {
+        console.error('[audioEngine] native decode error:', err.message);
+        if (lastOnError) lastOnError(err);
+      } else if (lastOnEnd) {
+        lastOnEnd();
+      }
+    };
+    stream.on('position', () => _checkGaplessBoundary());
+    stream.on('played-out', () => {
+      _checkGaplessBoundary();
+      let dec = null;
+      try {
+        dec = exclusiveAudio.getStats(handle)?.decoder;
+      } catch {}
+      finish(dec?.error ? new Error(dec.error) : null);
+    });
+    stream.on('device-lost', () => finish(new Error('Output device lost')));
+  } else {
+    nativeDecodeTimer = setInterval(() => {
+      _checkGaplessBoundary();
+
+      let stats = null;
+      try {
+        stats = exclusiveAudio.getStats(handle);
+      } catch {}
+      const dec = stats?.decoder;
+      if (!dec) return;
+
+      if (dec.error) {
+        clearInterval(nativeDecodeTimer);
+        nativeDecodeTimer = null;
+        nativeDecodeActive = false;
+        console.error('[audioEngine] native decode error:', dec.error);
+        if (lastOnError) lastOnError(new Error(dec.error));
+        return;
+      }
+      if (dec.finished && stats.buffered < stats.bytesPerFrame && !isPaused && !gaplessBoundary) {
+        clearInterval(nativeDecodeTimer);
+        nativeDecodeTimer = null;
+        nativeDecodeActive = false;
+        if (lastOnEnd) lastOnEnd();
+      }
+    }, 100);
+  }
+
+  if (typeof outputStream.on === 'function') {
+    outputStream.on('error', (err) => {
+      console.error('[audioEngine] output stream error:', err);
+      if (onError) onError(err);
+      stop();
+    });
+  }
+  return true;
+}
+
+// Queues filePath to start the moment the current native-decoded track
+// ends, on the same device stream. Returns false when that isn't possible
+// (ffmpeg playback, another codec, or a track already queued); the caller
+// then just plays it with playFile() on end. A track at another sample rate
+// is resampled to the open stream's rate.
+// options.onStart is called when the queued track becomes audible.
+function queueNext(filePath, onEnd, onError, options = {}) {
+  if (!nativeDecodeActive || !outputStream || gaplessNext) return false;
+  if (!isNativeDecodable(filePath)) return false;
+  if (typeof outputStream.queueFile !== 'function') return false;
+
+  let info;
+  try {
+    info = outputStream.queueFile(filePath, {
+      trimStartFrames: Number(options.trimStartFrames || 0),
+      trimEndFrames: Number(options.trimEndFrames || 0),
+      ...(options.resampleQuality ? { resampleQuality: options.resampleQuality } : {}),
+    });
+  } catch (e) {
+    console.log('[audioEngine] gapless queue declined:', e?.message ?? e);
+    return false;
+  }
+  console.log(`[audioEngine] Gapless: queued ${filePath} as segment ${info.segment}`);
+  gaplessNext = { segment: info.segment, filePath, onEnd, onError, options };
+  return true;
+}
+
+// Switches the engine's notion of the current track once the queued one is
+// actually audible (position past the boundary frame).
+function _checkGaplessBoundary() {
+  if (!outputStream || (!gaplessNext && !gaplessBoundary)) return;
+  try {
+    if (!gaplessBoundary) {
+      const crossed = outputStream.pollSegments();
+      const hit = crossed.find((c) => c.segment === gaplessNext.segment);
+      if (!hit) return;
+      gaplessBoundary = { frame: hit.frame, next: gaplessNext };
+      gaplessNext = null;
+    }
+    const pos = outputStream.getPosition();
+    if (!pos || pos.frames < gaplessBoundary.frame) return;
+
+    const { next, frame } = gaplessBoundary;
+    gaplessBoundary = null;
+    const prevOnEnd = lastOnEnd;
+    currentFile = next.filePath;
+    lastOnEnd = next.onEnd;
+    lastOnError = next.onError;
+    lastOptions = { ...lastOptions, ...next.options, startTime: 0 };
+    currentStartTime = 0;
+    segmentOffset = frame / (outputStream.actualSampleRate || outputFormatInfo.sampleRate);
+
+    if (prevOnEnd) prevOnEnd();
+    if (typeof next.options.onStart === 'function') next.options.onStart();
+  } catch (e) {
+    console.warn('[audioEngine] gapless boundary check failed:', e?.message ?? e);
+  }
+}
+
 function stop() {
+  playGeneration++;
   currentStartTime = 0;
+  segmentOffset = 0;
+  gaplessNext = null;
+  gaplessBoundary = null;
+  if (nativeDecodeTimer) {
+    clearInterval(nativeDecodeTimer);
+    nativeDecodeTimer = null;
+  }
+  nativeDecodeActive = false;
   // stop any silence filler
   if (silenceInterval) {
     clearInterval(silenceInterval);
@@ -491,7 +716,7 @@ function stop() {
 
 function pause() {
   console.log('[audioEngine] pause called');
-  if (!ffmpegProc || isPaused) return;
+  if ((!ffmpegProc && !nativeDecodeActive) || isPaused) return;
 
   try {
     // 1) pause output first so it stops consuming ring
@@ -499,8 +724,9 @@ function pause() {
       outputStream.pause(); // calls native.pause(handle)
     }
 
-    // 2) then pause ffmpeg stdout so decoding blocks naturally
-    if (ffmpegProc.stdout) ffmpegProc.stdout.pause();
+    // 2) then pause ffmpeg stdout so decoding blocks naturally (the native
+    //    decoder blocks on the full ring by itself)
+    if (ffmpegProc?.stdout) ffmpegProc.stdout.pause();
   } catch (e) {
     console.error('[audioEngine] pause error:', e);
   }
@@ -511,7 +737,7 @@ function pause() {
 function resume() {
  console.log('[audioEngine] native stats after resume:', exclusiveAudio.getStats(outputStream.handle));
 
-  if (!ffmpegProc || !isPaused) return;
+  if ((!ffmpegProc && !nativeDecodeActive) || !isPaused) return;
 
   try {
     // IMPORTANT ORDER:
@@ -521,7 +747,7 @@ function resume() {
     }
 
     // 2) then resume ffmpeg stdout
-    if (ffmpegProc.stdout) ffmpegProc.stdout.resume();
+    if (ffmpegProc?.stdout) ffmpegProc.stdout.resume();
   } catch (e) {
     console.error('[audioEngine] resume error:', e);
   }
@@ -534,7 +760,7 @@ function getStatus() {
   return {
     exclusiveAvailable: !!exclusiveAudio,
     exclusiveLoadError,
-    playing: !!ffmpegProc,
+    playing: !!ffmpegProc || nativeDecodeActive,
     paused: !!isPaused,
     currentFile: currentFile || null,
     currentTime: getTime(),
@@ -553,9 +779,12 @@ function getDevices() {
   }
 }
 
+// Both the ffmpeg and the native decode paths start the stream at
+// currentStartTime, so the stream's audible position maps straight onto the
+// track; after a gapless transition the track began segmentOffset into it.
 function getTime() {
   if (outputStream && typeof outputStream.getElapsedTime === 'function') {
-    return currentStartTime + outputStream.getElapsedTime();
+    return Math.max(0, currentStartTime + outputStream.getElapsedTime() - segmentOffset);
   }
   return currentStartTime;
 }
@@ -566,6 +795,13 @@ function seek(time) {
   playFile(currentFile, lastOnEnd, lastOnError, { ...lastOptions, startTime: time });
 }
 
+// Saves the current stream's render trace (played with options.trace) for a
+// dropout report. Returns the number of events written, or 0 without one.
+function dumpTrace(filePath) {
+  if (!outputStream || typeof outputStream.dumpTrace !== 'function') return 0;
+  return outputStream.dumpTrace(filePath);
+}
+
 const audioEngineApi = {
   playFile,
   stop,
@@ -574,10 +810,14 @@ const audioEngineApi = {
   getStatus,
   getDevices,
   getTime,
+  queueNext,
   setVolume,
   seek,
   setEQ,
   getEQ,
+  setCrossfade,
+  getCrossfade,
+  dumpTrace,
 };
 
 export default audioEngineApi;
\ No newline at end of file
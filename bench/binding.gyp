@@ -0,0 +1,287 @@
+{
+  # Native benchmarks, kept out of the root binding.gyp so electron-rebuild
+  # never builds (or rebuilds the addon for) them:
+  #   npm run bench:native   (npx node-gyp rebuild --directory bench)
+  #   bench/build/Release/kernel_bench --json
+  #   bench/build/Release/ring_bench, gain_bench, resampler_bench,
+  #     handle_table_bench (arguments as in each file's header)
+  #   bench/build/Release/engine_load --streams 8 --churn 5
+  #   bench/build/Release/decoder_check
+  "targets": [
+    {
+      "target_name": "kernel_bench",
+      "type": "executable",
+      "sources": [
+        "kernel_bench.cc"
+      ],
+      "include_dirs": [
+        "../src"
+      ],
+      "cflags_cc": [
+        "-std=c++17",
+        "-O2"
+      ],
+      "conditions": [
+        [ "OS=='win'", {
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "AdditionalOptions": [ "/std:c++17" ]
+            }
+          }
+        }],
+        [ "OS=='mac'", {
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+            "GCC_OPTIMIZATION_LEVEL": "2"
+          }
+        }],
+        [ "OS=='linux'", {
+          "libraries": [
+            "-pthread"
+          ]
+        }]
+      ]
+    },
+    {
+      # RingBuffer against the previous modulo-indexed ring
+      "target_name": "ring_bench",
+      "type": "executable",
+      "sources": [
+        "ring_bench.cc"
+      ],
+      "include_dirs": [
+        "../src"
+      ],
+      "cflags_cc": [
+        "-std=c++17",
+        "-O2"
+      ],
+      "conditions": [
+        [ "OS=='win'", {
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "AdditionalOptions": [ "/std:c++17" ]
+            }
+          }
+        }],
+        [ "OS=='mac'", {
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+            "GCC_OPTIMIZATION_LEVEL": "2"
+          }
+        }],
+        [ "OS=='linux'", {
+          "libraries": [
+            "-pthread"
+          ]
+        }]
+      ]
+    },
+    {
+      # Gain kernels and the ramping GainStage per sample format
+      "target_name": "gain_bench",
+      "type": "executable",
+      "sources": [
+        "gain_bench.cc"
+      ],
+      "include_dirs": [
+        "../src"
+      ],
+      "cflags_cc": [
+        "-std=c++17",
+        "-O2"
+      ],
+      "conditions": [
+        [ "OS=='win'", {
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "AdditionalOptions": [ "/std:c++17" ]
+            }
+          }
+        }],
+        [ "OS=='mac'", {
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+            "GCC_OPTIMIZATION_LEVEL": "2"
+          }
+        }],
+        [ "OS=='linux'", {
+          "libraries": [
+            "-pthread"
+          ]
+        }]
+      ]
+    },
+    {
+      # Polyphase resampler speed and stopband per quality tier
+      "target_name": "resampler_bench",
+      "type": "executable",
+      "sources": [
+        "resampler_bench.cc"
+      ],
+      "include_dirs": [
+        "../src"
+      ],
+      "cflags_cc": [
+        "-std=c++17",
+        "-O2"
+      ],
+      "conditions": [
+        [ "OS=='win'", {
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "AdditionalOptions": [ "/std:c++17" ]
+            }
+          }
+        }],
+        [ "OS=='mac'", {
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+            "GCC_OPTIMIZATION_LEVEL": "2"
+          }
+        }],
+        [ "OS=='linux'", {
+          "libraries": [
+            "-pthread"
+          ]
+        }]
+      ]
+    },
+    {
+      # HandleTable lookups under contention against a mutex + map
+      "target_name": "handle_table_bench",
+      "type": "executable",
+      "sources": [
+        "handle_table_bench.cc"
+      ],
+      "include_dirs": [
+        "../src"
+      ],
+      "cflags_cc": [
+        "-std=c++17",
+        "-O2"
+      ],
+      "conditions": [
+        [ "OS=='win'", {
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "AdditionalOptions": [ "/std:c++17" ]
+            }
+          }
+        }],
+        [ "OS=='mac'", {
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+            "GCC_OPTIMIZATION_LEVEL": "2"
+          }
+        }],
+        [ "OS=='linux'", {
+          "libraries": [
+            "-pthread"
+          ]
+        }]
+      ]
+    },
+    {
+      # Native WAV / AIFF / FLAC decoders against generated reference files
+      "target_name": "decoder_check",
+      "type": "executable",
+      "sources": [
+        "../src/file_decoder.cc",
+        "decoder_check.cc"
+      ],
+      "include_dirs": [
+        "../src"
+      ],
+      "cflags_cc": [
+        "-std=c++17",
+        "-O2"
+      ],
+      "conditions": [
+        [ "OS=='win'", {
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "AdditionalOptions": [ "/std:c++17" ]
+            }
+          }
+        }],
+        [ "OS=='mac'", {
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+            "GCC_OPTIMIZATION_LEVEL": "2",
+            "MACOSX_DEPLOYMENT_TARGET": "10.15"
+          }
+        }]
+      ]
+    },
+    {
+      # The engine itself, headless (src/headless_engine.h), under a load driver
+      "target_name": "engine_load",
+      "type": "executable",
+      "variables": {
+        "pipewire%": "<!(node -e \"try{require('child_process').execSync('pkg-config --exists libpipewire-0.3',{stdio:'ignore'});console.log(1)}catch(e){console.log(0)}\")"
+      },
+      "sources": [
+        "../src/exclusive_audio.cc",
+        "../src/file_decoder.cc",
+        "engine_load.cc"
+      ],
+      "include_dirs": [
+        "../src"
+      ],
+      "cflags_cc": [
+        "-std=c++17",
+        "-O2",
+        "-g"
+      ],
+      "defines": [
+        "EXCLUSIVE_HEADLESS"
+      ],
+      "conditions": [
+        [ "OS=='win'", {
+          "defines": [ "EXCLUSIVE_WIN32" ],
+          "libraries": [
+            "ole32.lib",
+            "avrt.lib",
+            "synchronization.lib"
+          ],
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "AdditionalOptions": [ "/std:c++17" ]
+            }
+          }
+        }],
+        [ "OS=='mac'", {
+          "defines": [ "EXCLUSIVE_MACOS" ],
+          "xcode_settings": {
+            "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+            "GCC_OPTIMIZATION_LEVEL": "2",
+            "OTHER_LDFLAGS": [
+              "-framework", "CoreAudio",
+              "-framework", "AudioUnit",
+              "-framework", "AudioToolbox",
+              "-framework", "CoreFoundation",
+              "-framework", "CoreServices"
+            ]
+          }
+        }],
+        [ "OS=='linux'", {
+          "defines": [ "EXCLUSIVE_LINUX" ],
+          "libraries": [
+            "-lasound",
+            "-pthread"
+          ]
+        }],
+        [ "OS=='linux' and pipewire==1", {
+          "defines": [ "EXCLUSIVE_PIPEWIRE" ],
+          "cflags_cc": [
+            "<!@(pkg-config --cflags libpipewire-0.3)"
+          ],
+          "libraries": [
+            "<!@(pkg-config --libs libpipewire-0.3)"
+          ]
+        }]
+      ]
+    }
+  ]
+}
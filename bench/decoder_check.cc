@@ -0,0 +1,868 @@
+// bench/decoder_check.cc
+//
+// Reference check for the native decoders (src/file_decoder.cc). Writes WAV,
+// AIFF / AIFF-C and FLAC files whose PCM is known, decodes them through
+// FileDecoder::Open and compares every sample, then seeks into each file and
+// compares again. The FLAC files come from a small encoder below that covers
+// every subframe type (constant, verbatim, fixed 0-4, LPC), all stereo
+// decorrelation modes, wasted bits, both rice parameter widths and escaped
+// partitions. Corrupted copies check that a frame failing its CRC-8 or
+// CRC-16 is dropped and decoding resyncs on the next frame, and a 32-bit
+// decorrelated stream checks that it is refused with an error.
+//
+// Extra arguments are pairs of files that must decode to identical PCM, e.g.
+// the same recording as WAV and AIFF from another tool.
+//
+//   g++ -O2 -std=c++17 -Isrc bench/decoder_check.cc src/file_decoder.cc -o decoder_check
+//   ./decoder_check [a.wav a.aiff ...]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "file_decoder.h"
+
+static int g_failures = 0;
+
+static void Report(bool ok, const std::string &name, const std::string &detail = "")
+{
+    std::printf("%s  %s%s%s\n", ok ? "ok  " : "FAIL", name.c_str(), detail.empty() ? "" : ": ", detail.c_str());
+    if (!ok)
+        ++g_failures;
+}
+
+// ----------------------------------------------------------------------------
+// Known PCM
+// ----------------------------------------------------------------------------
+
+// Interleaved samples at `bits` (right-justified). A sine per channel plus
+// noise, with full-scale extremes sprinkled in, a silent stretch (constant
+// subframes) and a stretch with the low bits cleared (wasted bits).
+static std::vector<int32_t> MakePcm(size_t frames, unsigned channels, unsigned bits)
+{
+    const int64_t maxV = (int64_t(1) << (bits - 1)) - 1;
+    const int64_t minV = -(int64_t(1) << (bits - 1));
+    std::vector<int32_t> pcm(frames * channels);
+    uint32_t seed = 0x2545F491u * bits + channels;
+    for (size_t i = 0; i < frames; ++i)
+    {
+        for (unsigned c = 0; c < channels; ++c)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            double noise = (static_cast<double>(seed >> 8) / 16777216.0 - 0.5) * 0.1;
+            double v = 0.8 * std::sin(0.002 * (c + 1) * static_cast<double>(i) * (1.0 + 0.3 * c)) + noise;
+            int64_t s = static_cast<int64_t>(std::llround(v * static_cast<double>(maxV)));
+            if (i % 997 == 13)
+                s = (i / 997) & 1 ? maxV : minV;
+            if (i >= 8192 && i < 12288)
+                s = 0;
+            else if (i >= 16384 && i < 20480 && bits > 8)
+                s &= ~int64_t(7);
+            pcm[i * channels + c] = static_cast<int32_t>(std::min(maxV, std::max(minV, s)));
+        }
+    }
+    return pcm;
+}
+
+// What the decoder hands back: left-justified int32
+static std::vector<int32_t> LeftJustify(const std::vector<int32_t> &pcm, unsigned bits)
+{
+    std::vector<int32_t> out(pcm.size());
+    for (size_t i = 0; i < pcm.size(); ++i)
+        out[i] = static_cast<int32_t>(static_cast<uint32_t>(pcm[i]) << (32 - bits));
+    return out;
+}
+
+static bool WriteFile(const std::string &path, const std::vector<uint8_t> &bytes)
+{
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+static void PutLE(std::vector<uint8_t> &b, uint64_t v, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+        b.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+static void PutBE(std::vector<uint8_t> &b, uint64_t v, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; --i)
+        b.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+static void PutTag(std::vector<uint8_t> &b, const char *tag)
+{
+    b.insert(b.end(), tag, tag + 4);
+}
+
+// ----------------------------------------------------------------------------
+// WAV / AIFF writers
+// ----------------------------------------------------------------------------
+
+// Integer PCM, or IEEE float when `isFloat` (samples are then 24-bit values
+// stored as s / 2^23, which float holds exactly)
+static std::vector<uint8_t> MakeWav(const std::vector<int32_t> &pcm, unsigned channels, unsigned bits,
+                                    unsigned rate, bool extensible, bool isFloat)
+{
+    unsigned bytesPerSample = isFloat ? 4 : (bits + 7) / 8;
+    unsigned blockAlign = bytesPerSample * channels;
+    uint32_t dataBytes = static_cast<uint32_t>(pcm.size() * bytesPerSample);
+    uint32_t fmtBytes = extensible ? 40 : 16;
+
+    std::vector<uint8_t> b;
+    PutTag(b, "RIFF");
+    PutLE(b, 4 + 8 + fmtBytes + 12 + 8 + dataBytes, 4);
+    PutTag(b, "WAVE");
+    PutTag(b, "fmt ");
+    PutLE(b, fmtBytes, 4);
+    PutLE(b, extensible ? 0xFFFE : (isFloat ? 3 : 1), 2);
+    PutLE(b, channels, 2);
+    PutLE(b, rate, 4);
+    PutLE(b, rate * blockAlign, 4);
+    PutLE(b, blockAlign, 2);
+    PutLE(b, isFloat ? 32 : bytesPerSample * 8, 2);
+    if (extensible)
+    {
+        PutLE(b, 22, 2);
+        PutLE(b, bits, 2);                    // valid bits
+        PutLE(b, 0, 4);                       // channel mask
+        PutLE(b, isFloat ? 3 : 1, 2);         // SubFormat GUID, first word
+        PutLE(b, 0x00100000, 4);
+        PutLE(b, 0xAA000080, 4);
+        PutLE(b, 0x719B3800, 4);
+        PutLE(b, 0, 2);
+    }
+    // A chunk the reader has to skip, with an odd size
+    PutTag(b, "LIST");
+    PutLE(b, 3, 4);
+    b.insert(b.end(), {'a', 'b', 'c', 0});
+
+    PutTag(b, "data");
+    PutLE(b, dataBytes, 4);
+    for (int32_t s : pcm)
+    {
+        if (isFloat)
+        {
+            float f = static_cast<float>(s) / 8388608.0f;
+            uint32_t u;
+            std::memcpy(&u, &f, 4);
+            PutLE(b, u, 4);
+        }
+        else if (bytesPerSample == 1)
+        {
+            PutLE(b, static_cast<uint8_t>(s + 128), 1);
+        }
+        else
+        {
+            uint32_t u = static_cast<uint32_t>(s) << (bytesPerSample * 8 - bits);
+            PutLE(b, u, static_cast<int>(bytesPerSample));
+        }
+    }
+    return b;
+}
+
+static void PutExtended80(std::vector<uint8_t> &b, double v)
+{
+    int exponent;
+    double m = std::frexp(v, &exponent); // v = m * 2^exponent, 0.5 <= m < 1
+    uint64_t mantissa = static_cast<uint64_t>(std::ldexp(m, 64));
+    PutBE(b, static_cast<uint64_t>(exponent - 1 + 16383), 2);
+    PutBE(b, mantissa, 8);
+}
+
+// compression: nullptr for AIFF, else the AIFF-C type ("NONE", "sowt", "fl32")
+static std::vector<uint8_t> MakeAiff(const std::vector<int32_t> &pcm, unsigned channels, unsigned bits,
+                                     unsigned rate, const char *compression)
+{
+    bool isFloat = compression && std::strcmp(compression, "fl32") == 0;
+    bool little = compression && std::strcmp(compression, "sowt") == 0;
+    unsigned bytesPerSample = isFloat ? 4 : (bits + 7) / 8;
+    uint32_t dataBytes = static_cast<uint32_t>(pcm.size() * bytesPerSample);
+    uint32_t commBytes = compression ? 24 : 18;
+
+    std::vector<uint8_t> b;
+    PutTag(b, "FORM");
+    PutBE(b, 4 + 8 + commBytes + 8 + 8 + dataBytes, 4);
+    PutTag(b, compression ? "AIFC" : "AIFF");
+    PutTag(b, "COMM");
+    PutBE(b, commBytes, 4);
+    PutBE(b, channels, 2);
+    PutBE(b, pcm.size() / channels, 4);
+    PutBE(b, isFloat ? 32 : bits, 2);
+    PutExtended80(b, rate);
+    if (compression)
+    {
+        PutTag(b, compression);
+        PutBE(b, 0, 2); // empty pstring name, padded
+    }
+    PutTag(b, "SSND");
+    PutBE(b, 8 + dataBytes, 4);
+    PutBE(b, 0, 4); // offset
+    PutBE(b, 0, 4); // block size
+    for (int32_t s : pcm)
+    {
+        if (isFloat)
+        {
+            float f = static_cast<float>(s) / 8388608.0f;
+            uint32_t u;
+            std::memcpy(&u, &f, 4);
+            PutBE(b, u, 4);
+            continue;
+        }
+        uint32_t u = static_cast<uint32_t>(s) << (bytesPerSample * 8 - bits);
+        if (little)
+            PutLE(b, u, static_cast<int>(bytesPerSample));
+        else
+            PutBE(b, u, static_cast<int>(bytesPerSample));
+    }
+    return b;
+}
+
+// ----------------------------------------------------------------------------
+// FLAC encoder (just enough of the format to exercise the decoder)
+// ----------------------------------------------------------------------------
+
+class BitWriter
+{
+public:
+    std::vector<uint8_t> bytes;
+
+    void put(uint64_t v, int n) // n <= 64
+    {
+        for (int i = n - 1; i >= 0; --i)
+            putBit(static_cast<unsigned>(v >> i) & 1);
+    }
+
+    void putSigned(int64_t v, int n) { put(static_cast<uint64_t>(v) & (n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1), n); }
+
+    void putUnary(uint64_t zeros)
+    {
+        for (uint64_t i = 0; i < zeros; ++i)
+            putBit(0);
+        putBit(1);
+    }
+
+    void align()
+    {
+        while (used)
+            putBit(0);
+    }
+
+private:
+    int used{0};
+
+    void putBit(unsigned bit)
+    {
+        if (used == 0)
+            bytes.push_back(0);
+        bytes.back() |= static_cast<uint8_t>(bit << (7 - used));
+        used = (used + 1) & 7;
+    }
+};
+
+// Bitwise, written independently of the decoder's table-driven CRC-16
+static unsigned Crc(const uint8_t *p, size_t len, unsigned width, unsigned poly)
+{
+    unsigned top = 1u << (width - 1), mask = (top << 1) - 1, crc = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= static_cast<unsigned>(p[i]) << (width - 8);
+        for (int b = 0; b < 8; ++b)
+            crc = ((crc & top) ? (crc << 1) ^ poly : (crc << 1)) & mask;
+    }
+    return crc;
+}
+
+enum class Sub
+{
+    Verbatim,
+    Fixed,
+    Lpc
+};
+
+struct FlacOptions
+{
+    unsigned blockSize{4096};
+    bool id3{false};
+    bool forceDecorrelate{false}; // also at 32 bits, where the decoder must refuse it
+};
+
+// Bits needed to hold v as a signed value
+static int SignedBits(int64_t v)
+{
+    int n = 1;
+    while (v < -(int64_t(1) << (n - 1)) || v > (int64_t(1) << (n - 1)) - 1)
+        ++n;
+    return n;
+}
+
+static bool EncodeResidual(BitWriter &w, const std::vector<int64_t> &res, unsigned order, unsigned blockSize,
+                           unsigned variant)
+{
+    for (int64_t r : res)
+    {
+        if (r < INT32_MIN || r > INT32_MAX)
+            return false;
+    }
+
+    unsigned partitionOrder = variant % 5;
+    while (partitionOrder && ((blockSize & ((1u << partitionOrder) - 1)) || (blockSize >> partitionOrder) < order))
+        --partitionOrder;
+    unsigned partitions = 1u << partitionOrder;
+    unsigned per = blockSize >> partitionOrder;
+
+    // Rice parameter per partition, large enough to keep quotients short
+    std::vector<unsigned> ks(partitions);
+    bool wide = false;
+    for (unsigned p = 0, idx = order; p < partitions; ++p)
+    {
+        unsigned count = p == 0 ? per - order : per;
+        uint64_t maxU = 0, sum = 0;
+        for (unsigned i = 0; i < count; ++i, ++idx)
+        {
+            uint64_t u = res[idx] >= 0 ? uint64_t(res[idx]) << 1 : (uint64_t(-res[idx]) << 1) - 1;
+            maxU = std::max(maxU, u);
+            sum += u;
+        }
+        unsigned k = 0;
+        while (count && (uint64_t(1) << (k + 1)) <= sum / count)
+            ++k;
+        while ((maxU >> k) > 256)
+            ++k;
+        ks[p] = k;
+        wide |= k >= 15;
+    }
+
+    w.put(wide ? 1 : 0, 2);
+    w.put(partitionOrder, 4);
+    for (unsigned p = 0, idx = order; p < partitions; ++p)
+    {
+        unsigned count = p == 0 ? per - order : per;
+        unsigned escape = wide ? 31 : 15;
+        int rawBits = 0;
+        for (unsigned i = 0; i < count; ++i)
+            rawBits = std::max(rawBits, res[idx + i] ? SignedBits(res[idx + i]) : 0);
+
+        if ((variant + p) % 7 == 3 && rawBits <= 31)
+        {
+            // Escaped partition: raw signed values
+            w.put(escape, wide ? 5 : 4);
+            w.put(static_cast<uint64_t>(rawBits), 5);
+            for (unsigned i = 0; i < count; ++i, ++idx)
+                w.putSigned(res[idx], rawBits);
+            continue;
+        }
+
+        unsigned k = ks[p];
+        if (k >= escape)
+            return false;
+        w.put(k, wide ? 5 : 4);
+        for (unsigned i = 0; i < count; ++i, ++idx)
+        {
+            uint64_t u = res[idx] >= 0 ? uint64_t(res[idx]) << 1 : (uint64_t(-res[idx]) << 1) - 1;
+            w.putUnary(u >> k);
+            w.put(u & ((uint64_t(1) << k) - 1), static_cast<int>(k));
+        }
+    }
+    return true;
+}
+
+// Quantised LPC coefficients from the autocorrelation (Levinson-Durbin)
+static void DesignLpc(const std::vector<int64_t> &x, unsigned order, unsigned precision, std::vector<int32_t> &coefs,
+                      int &shift)
+{
+    std::vector<double> r(order + 1, 0.0), a(order + 1, 0.0), tmp(order + 1);
+    for (unsigned lag = 0; lag <= order; ++lag)
+        for (size_t i = lag; i < x.size(); ++i)
+            r[lag] += static_cast<double>(x[i]) * static_cast<double>(x[i - lag]);
+    r[0] *= 1.0 + 1e-9;
+    r[0] += 1.0;
+    double err = r[0];
+    for (unsigned i = 1; i <= order; ++i)
+    {
+        double acc = r[i];
+        for (unsigned j = 1; j < i; ++j)
+            acc -= a[j] * r[i - j];
+        double k = acc / err;
+        tmp = a;
+        a[i] = k;
+        for (unsigned j = 1; j < i; ++j)
+            a[j] = tmp[j] - k * tmp[i - j];
+        err *= 1.0 - k * k;
+    }
+
+    double maxAbs = 1e-9;
+    for (unsigned i = 1; i <= order; ++i)
+        maxAbs = std::max(maxAbs, std::fabs(a[i]));
+    int log2Max = static_cast<int>(std::ceil(std::log2(maxAbs)));
+    shift = std::min(15, std::max(0, static_cast<int>(precision) - 1 - log2Max));
+    int32_t limit = (1 << (precision - 1)) - 1;
+    coefs.assign(order, 0);
+    for (unsigned i = 0; i < order; ++i)
+    {
+        long q = std::lround(std::ldexp(a[i + 1], shift));
+        coefs[i] = static_cast<int32_t>(std::min<long>(limit, std::max<long>(-limit - 1, q)));
+    }
+}
+
+// Encodes one channel of one frame; falls back to verbatim when a predictor's
+// residual would not fit the format
+static void EncodeSubframe(BitWriter &w, const std::vector<int64_t> &x, unsigned bps, unsigned variant)
+{
+    const unsigned n = static_cast<unsigned>(x.size());
+    bool constant = std::all_of(x.begin(), x.end(), [&](int64_t v) { return v == x[0]; });
+    if (constant)
+    {
+        w.put(0, 1);
+        w.put(0, 6);
+        w.put(0, 1);
+        w.putSigned(x[0], static_cast<int>(bps));
+        return;
+    }
+
+    uint64_t all = 0;
+    for (int64_t v : x)
+        all |= static_cast<uint64_t>(v);
+    unsigned wasted = 0;
+    while (!(all & 1) && wasted + 1 < bps)
+    {
+        all >>= 1;
+        ++wasted;
+    }
+    std::vector<int64_t> s(n);
+    for (unsigned i = 0; i < n; ++i)
+        s[i] = x[i] >> wasted;
+    const unsigned sbps = bps - wasted;
+
+    auto header = [&](unsigned type) {
+        w.put(0, 1);
+        w.put(type, 6);
+        if (wasted)
+        {
+            w.put(1, 1);
+            w.putUnary(wasted - 1);
+        }
+        else
+        {
+            w.put(0, 1);
+        }
+    };
+
+    Sub kind = static_cast<Sub>(variant % 3);
+    if (kind == Sub::Fixed || kind == Sub::Lpc)
+    {
+        std::vector<int64_t> res(n, 0);
+        unsigned order;
+        unsigned type;
+        std::vector<int32_t> coefs;
+        int shift = 0;
+        unsigned precision = 12 + variant % 4;
+        if (kind == Sub::Fixed)
+        {
+            order = std::min(n, variant / 3 % 5);
+            type = 8 + order;
+            static const int64_t kFixed[5][4] = {{0, 0, 0, 0}, {1, 0, 0, 0}, {2, -1, 0, 0}, {3, -3, 1, 0}, {4, -6, 4, -1}};
+            for (unsigned i = order; i < n; ++i)
+            {
+                int64_t pred = 0;
+                for (unsigned j = 0; j < order; ++j)
+                    pred += kFixed[order][j] * s[i - 1 - j];
+                res[i] = s[i] - pred;
+            }
+        }
+        else
+        {
+            order = std::min(n, 1 + (variant * 5) % 12);
+            type = 32 + order - 1;
+            DesignLpc(s, order, precision, coefs, shift);
+            for (unsigned i = order; i < n; ++i)
+            {
+                int64_t sum = 0;
+                for (unsigned j = 0; j < order; ++j)
+                    sum += static_cast<int64_t>(coefs[j]) * s[i - 1 - j];
+                res[i] = s[i] - (sum >> shift);
+            }
+        }
+
+        // Try the residual in a scratch writer first; it may not fit
+        BitWriter scratch;
+        if (sbps <= 32 && EncodeResidual(scratch, res, order, n, variant))
+        {
+            header(type);
+            for (unsigned i = 0; i < order; ++i)
+                w.putSigned(s[i], static_cast<int>(sbps));
+            if (kind == Sub::Lpc)
+            {
+                w.put(precision - 1, 4);
+                w.putSigned(shift, 5);
+                for (int32_t c : coefs)
+                    w.putSigned(c, static_cast<int>(precision));
+            }
+            EncodeResidual(w, res, order, n, variant);
+            return;
+        }
+    }
+
+    header(1);
+    for (unsigned i = 0; i < n; ++i)
+        w.putSigned(s[i], static_cast<int>(sbps));
+}
+
+static void PutUtf8Number(BitWriter &w, uint64_t v)
+{
+    if (v < 0x80)
+    {
+        w.put(v, 8);
+        return;
+    }
+    int extra = 1;
+    while (extra < 6 && v >= (uint64_t(1) << (5 * extra + 6)))
+        ++extra;
+    unsigned lead = (0xFF00u >> (extra + 1)) & 0xFF;
+    w.put(lead | (v >> (6 * extra)), 8);
+    for (int i = extra - 1; i >= 0; --i)
+        w.put(0x80 | ((v >> (6 * i)) & 0x3F), 8);
+}
+
+struct FlacFile
+{
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> frameOffsets; // into bytes
+};
+
+static FlacFile MakeFlac(const std::vector<int32_t> &pcm, unsigned channels, unsigned bits, unsigned rate,
+                         const FlacOptions &o)
+{
+    const size_t frames = pcm.size() / channels;
+    FlacFile out;
+    std::vector<uint8_t> &b = out.bytes;
+    if (o.id3)
+    {
+        b.insert(b.end(), {'I', 'D', '3', 4, 0, 0, 0, 0, 0, 20});
+        b.insert(b.end(), 20, 0);
+    }
+    PutTag(b, "fLaC");
+
+    // STREAMINFO, then a PADDING block the decoder has to skip
+    b.push_back(0);
+    PutBE(b, 34, 3);
+    PutBE(b, o.blockSize, 2);
+    PutBE(b, o.blockSize, 2);
+    PutBE(b, 0, 3); // min / max frame size unknown
+    PutBE(b, 0, 3);
+    uint64_t packed = (uint64_t(rate) << 44) | (uint64_t(channels - 1) << 41) | (uint64_t(bits - 1) << 36) | frames;
+    PutBE(b, packed, 8);
+    b.insert(b.end(), 16, 0); // MD5 unset
+    b.push_back(0x80 | 1);
+    PutBE(b, 37, 3);
+    b.insert(b.end(), 37, 0);
+
+    static const unsigned kSizeCodes[33] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 4,
+                                            0, 0, 0, 5, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 7};
+    const bool stereo = channels == 2;
+    for (size_t first = 0, index = 0; first < frames; first += o.blockSize, ++index)
+    {
+        unsigned n = static_cast<unsigned>(std::min<size_t>(o.blockSize, frames - first));
+        unsigned assignment = channels - 1;
+        if (stereo && (bits < 32 || o.forceDecorrelate))
+            assignment = o.forceDecorrelate ? 8 : (index % 4 == 0 ? 1 : 7 + index % 4);
+
+        BitWriter w;
+        w.put(0xFFF8, 16); // sync, fixed block size
+        unsigned bsCode = n == 4096 ? 12 : (n <= 256 ? 6 : 7);
+        w.put(bsCode, 4);
+        w.put(rate == 44100 ? 9 : 0, 4);
+        w.put(assignment, 4);
+        w.put(kSizeCodes[bits], 3);
+        w.put(0, 1);
+        PutUtf8Number(w, index);
+        if (bsCode == 6)
+            w.put(n - 1, 8);
+        else if (bsCode == 7)
+            w.put(n - 1, 16);
+        w.put(Crc(w.bytes.data(), w.bytes.size(), 8, 0x07), 8);
+
+        std::vector<std::vector<int64_t>> ch(channels, std::vector<int64_t>(n));
+        for (unsigned c = 0; c < channels; ++c)
+            for (unsigned i = 0; i < n; ++i)
+                ch[c][i] = pcm[(first + i) * channels + c];
+        if (assignment >= 8)
+        {
+            for (unsigned i = 0; i < n; ++i)
+            {
+                int64_t l = ch[0][i], r = ch[1][i];
+                if (assignment == 8)
+                    ch[1][i] = l - r;
+                else if (assignment == 9)
+                    ch[0][i] = l - r;
+                else
+                {
+                    ch[0][i] = (l + r) >> 1;
+                    ch[1][i] = l - r;
+                }
+            }
+        }
+
+        for (unsigned c = 0; c < channels; ++c)
+        {
+            bool side = (assignment == 8 && c == 1) || (assignment == 9 && c == 0) || (assignment == 10 && c == 1);
+            EncodeSubframe(w, ch[c], bits + (side ? 1 : 0), static_cast<unsigned>(index * channels + c));
+        }
+        w.align();
+        w.put(Crc(w.bytes.data(), w.bytes.size(), 16, 0x8005), 16);
+
+        out.frameOffsets.push_back(b.size());
+        b.insert(b.end(), w.bytes.begin(), w.bytes.end());
+    }
+    return out;
+}
+
+// ----------------------------------------------------------------------------
+// Checks
+// ----------------------------------------------------------------------------
+
+static std::vector<int32_t> DecodeAll(FileDecoder &dec)
+{
+    std::vector<int32_t> out;
+    std::vector<int32_t> chunk(1000 * dec.info.channels);
+    size_t n;
+    while ((n = dec.read(chunk.data(), 1000)) != 0)
+        out.insert(out.end(), chunk.begin(), chunk.begin() + n * dec.info.channels);
+    return out;
+}
+
+static std::string FirstMismatch(const std::vector<int32_t> &got, const std::vector<int32_t> &want, unsigned channels)
+{
+    if (got.size() != want.size())
+        return "decoded " + std::to_string(got.size() / channels) + " frames, expected " +
+               std::to_string(want.size() / channels);
+    for (size_t i = 0; i < got.size(); ++i)
+    {
+        if (got[i] != want[i])
+        {
+            char buf[96];
+            std::snprintf(buf, sizeof(buf), "frame %zu channel %zu: 0x%08x, expected 0x%08x", i / channels,
+                          i % channels, static_cast<unsigned>(got[i]), static_cast<unsigned>(want[i]));
+            return buf;
+        }
+    }
+    return "";
+}
+
+// Decodes `path` start to finish and at a few seek targets against `want`
+static void CheckFile(const std::string &name, const std::string &path, const std::vector<int32_t> &want,
+                      unsigned channels, unsigned bits, unsigned rate, bool seeks = true)
+{
+    std::string err;
+    auto dec = FileDecoder::Open(path, err);
+    if (!dec)
+    {
+        Report(false, name, err);
+        return;
+    }
+    const size_t frames = want.size() / channels;
+    if (dec->info.channels != channels || dec->info.sampleRate != rate || dec->info.bitsPerSample != bits ||
+        dec->info.totalFrames != frames)
+    {
+        Report(false, name, "header: " + std::to_string(dec->info.channels) + " ch, " +
+                                std::to_string(dec->info.sampleRate) + " Hz, " +
+                                std::to_string(dec->info.bitsPerSample) + " bits, " +
+                                std::to_string(dec->info.totalFrames) + " frames");
+        return;
+    }
+
+    std::string mismatch = FirstMismatch(DecodeAll(*dec), want, channels);
+    if (mismatch.empty() && !dec->error.empty())
+        mismatch = dec->error;
+    Report(mismatch.empty(), name, mismatch);
+    if (!seeks)
+        return;
+
+    const size_t targets[] = {0, 4095, 4096, 13001, frames / 2, frames - 7, frames};
+    for (size_t target : targets)
+    {
+        std::vector<int32_t> got(777 * channels);
+        size_t n = dec->seek(target) ? dec->read(got.data(), 777) : 0;
+        got.resize(n * channels);
+        size_t end = std::min(frames, target + 777);
+        std::vector<int32_t> expect(want.begin() + target * channels, want.begin() + end * channels);
+        std::string m = FirstMismatch(got, expect, channels);
+        if (!m.empty())
+        {
+            Report(false, name + " seek " + std::to_string(target), m);
+            return;
+        }
+    }
+    Report(true, name + " seeks");
+}
+
+// Flips one byte of frame `frame` and expects exactly that frame to go missing
+static void CheckCorrupt(const std::string &name, const std::string &path, FlacFile file, size_t frame,
+                         size_t offsetInFrame, const std::vector<int32_t> &want, unsigned channels, unsigned blockSize)
+{
+    file.bytes[file.frameOffsets[frame] + offsetInFrame] ^= 0x10;
+    if (!WriteFile(path, file.bytes))
+    {
+        Report(false, name, "cannot write " + path);
+        return;
+    }
+    std::string err;
+    auto dec = FileDecoder::Open(path, err);
+    if (!dec)
+    {
+        Report(false, name, err);
+        return;
+    }
+    std::vector<int32_t> expect(want.begin(), want.begin() + frame * blockSize * channels);
+    expect.insert(expect.end(), want.begin() + std::min(want.size(), (frame + 1) * blockSize * channels), want.end());
+    std::string m = FirstMismatch(DecodeAll(*dec), expect, channels);
+    if (m.empty() && !dec->error.empty())
+        m = dec->error;
+    Report(m.empty(), name, m);
+}
+
+static void CheckPair(const std::string &a, const std::string &b)
+{
+    std::string errA, errB;
+    auto da = FileDecoder::Open(a, errA);
+    auto db = FileDecoder::Open(b, errB);
+    if (!da || !db)
+    {
+        Report(false, a + " = " + b, da ? errB : errA);
+        return;
+    }
+    // Compare at the shallower of the two depths
+    unsigned bits = std::min(da->info.bitsPerSample, db->info.bitsPerSample);
+    uint32_t mask = bits >= 32 ? ~0u : ~((1u << (32 - bits)) - 1);
+    std::vector<int32_t> pa = DecodeAll(*da), pb = DecodeAll(*db);
+    for (auto *v : {&pa, &pb})
+        for (int32_t &s : *v)
+            s = static_cast<int32_t>(static_cast<uint32_t>(s) & mask);
+    std::string m = da->info.channels == db->info.channels ? FirstMismatch(pa, pb, da->info.channels)
+                                                           : "channel counts differ";
+    Report(m.empty(), a + " = " + b, m);
+}
+
+int main(int argc, char **argv)
+{
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("decoder_check_" + std::to_string(std::rand()));
+    fs::create_directories(dir);
+    auto at = [&](const char *file) { return (dir / file).string(); };
+
+    const size_t frames = 10 * 4096 + 1000; // a short last frame
+    struct PcmCase
+    {
+        const char *file;
+        unsigned channels, bits, rate;
+        bool wav;
+        bool extensible;
+        const char *aiff; // AIFF-C compression, or nullptr for plain AIFF
+    };
+    const PcmCase pcmCases[] = {
+        {"u8.wav", 2, 8, 22050, true, false, nullptr},
+        {"s16.wav", 2, 16, 44100, true, false, nullptr},
+        {"s24.wav", 2, 24, 48000, true, false, nullptr},
+        {"s32.wav", 1, 32, 96000, true, false, nullptr},
+        {"s20x.wav", 6, 20, 48000, true, true, nullptr},
+        {"s8.aiff", 1, 8, 8000, false, false, nullptr},
+        {"s16.aiff", 2, 16, 44100, false, false, nullptr},
+        {"s24.aiff", 2, 24, 88200, false, false, nullptr},
+        {"s32.aiff", 2, 32, 192000, false, false, nullptr},
+        {"sowt16.aifc", 2, 16, 44100, false, false, "sowt"},
+        {"none24.aifc", 2, 24, 48000, false, false, "NONE"},
+    };
+    for (const auto &c : pcmCases)
+    {
+        auto pcm = MakePcm(frames, c.channels, c.bits);
+        auto bytes = c.wav ? MakeWav(pcm, c.channels, c.bits, c.rate, c.extensible, false)
+                           : MakeAiff(pcm, c.channels, c.bits, c.rate, c.aiff);
+        if (!WriteFile(at(c.file), bytes))
+        {
+            Report(false, c.file, "cannot write");
+            continue;
+        }
+        // WAV reports the container depth, AIFF the sample size
+        unsigned reported = c.wav ? (c.bits + 7) / 8 * 8 : c.bits;
+        CheckFile(c.file, at(c.file), LeftJustify(pcm, c.bits), c.channels, reported, c.rate);
+    }
+
+    // IEEE float: 24-bit values / 2^23, exact in float
+    {
+        auto pcm = MakePcm(frames, 2, 24);
+        WriteFile(at("f32.wav"), MakeWav(pcm, 2, 24, 48000, false, true));
+        WriteFile(at("f32x.wav"), MakeWav(pcm, 2, 24, 48000, true, true));
+        WriteFile(at("fl32.aifc"), MakeAiff(pcm, 2, 24, 48000, "fl32"));
+        CheckFile("f32.wav", at("f32.wav"), LeftJustify(pcm, 24), 2, 32, 48000);
+        CheckFile("f32x.wav", at("f32x.wav"), LeftJustify(pcm, 24), 2, 32, 48000);
+        CheckFile("fl32.aifc", at("fl32.aifc"), LeftJustify(pcm, 24), 2, 32, 48000);
+    }
+
+    struct FlacCase
+    {
+        const char *file;
+        unsigned channels, bits, rate;
+        FlacOptions o;
+    };
+    const FlacCase flacCases[] = {
+        {"s8.flac", 1, 8, 8000, {}},
+        {"s12.flac", 2, 12, 22050, {}},
+        {"s16.flac", 2, 16, 44100, {}},
+        {"s16id3.flac", 2, 16, 44100, {4096, true, false}},
+        {"s16b1152.flac", 2, 16, 44100, {1152, false, false}},
+        {"s20.flac", 2, 20, 48000, {}},
+        {"s24.flac", 2, 24, 96000, {}},
+        {"s24x6.flac", 6, 24, 48000, {}},
+        {"s32.flac", 2, 32, 192000, {}},
+    };
+    for (const auto &c : flacCases)
+    {
+        auto pcm = MakePcm(frames, c.channels, c.bits);
+        if (!WriteFile(at(c.file), MakeFlac(pcm, c.channels, c.bits, c.rate, c.o).bytes))
+        {
+            Report(false, c.file, "cannot write");
+            continue;
+        }
+        CheckFile(c.file, at(c.file), LeftJustify(pcm, c.bits), c.channels, c.bits, c.rate);
+    }
+
+    // Corrupt frames are dropped (CRC-8 catches the header, CRC-16 the body)
+    {
+        auto pcm = MakePcm(frames, 2, 16);
+        FlacFile flac = MakeFlac(pcm, 2, 16, 44100, {});
+        auto want = LeftJustify(pcm, 16);
+        CheckCorrupt("s16.flac bad header", at("bad_header.flac"), flac, 2, 3, want, 2, 4096);
+        size_t mid = (flac.frameOffsets[6] - flac.frameOffsets[5]) / 2;
+        CheckCorrupt("s16.flac bad body", at("bad_body.flac"), flac, 5, mid, want, 2, 4096);
+        CheckCorrupt("s16.flac bad crc-16", at("bad_crc.flac"), flac, 7,
+                     flac.frameOffsets[8] - flac.frameOffsets[7] - 1, want, 2, 4096);
+    }
+
+    // 32-bit stereo decorrelation: the side channel needs 33 bits
+    {
+        auto pcm = MakePcm(frames, 2, 32);
+        FlacOptions o;
+        o.forceDecorrelate = true;
+        WriteFile(at("s32side.flac"), MakeFlac(pcm, 2, 32, 48000, o).bytes);
+        std::string err;
+        auto dec = FileDecoder::Open(at("s32side.flac"), err);
+        std::vector<int32_t> got = dec ? DecodeAll(*dec) : std::vector<int32_t>();
+        Report(dec && got.empty() && !dec->error.empty(), "s32side.flac refused", dec ? dec->error : err);
+    }
+
+    for (int i = 1; i + 1 < argc; i += 2)
+        CheckPair(argv[i], argv[i + 1]);
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    std::printf("%s\n", g_failures ? "FAILED" : "all ok");
+    return g_failures ? 1 : 0;
+}
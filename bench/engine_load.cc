@@ -0,0 +1,673 @@
+// bench/engine_load.cc
+//
+// Headless load / soak driver for the real engine: src/exclusive_audio.cc
+// built with EXCLUSIVE_HEADLESS (src/headless_engine.h), no Node or Electron.
+// Opens N streams on the null sink or a device and feeds each from its own
+// writer thread, either a synthetic signal through write() or a file through
+// the engine's decoder. While that runs it churns close/reopen, pause/resume
+// and drain at the given rates. At the end (or on Ctrl-C) it reports xruns,
+// CPU time and latency percentiles for write, open, close, drain and the
+// render periods; --json prints the same as one document.
+//
+// Churn closes a stream while its writer may be parked in write(), which is
+// the path where close() waits out writes still in flight.
+//
+//   g++ -O2 -g -std=c++17 -pthread -DEXCLUSIVE_HEADLESS -Isrc src/exclusive_audio.cc src/file_decoder.cc bench/engine_load.cc -lasound -o engine_load
+//   (add -fsanitize=thread for TSan; or: npm run bench:native, which builds it too)
+//   ./engine_load [--streams N] [--seconds S] [--mode null|exclusive|shared] [--device id]
+//                 [--backend alsa|pipewire|auto] [--clock realtime|fast] [--rate Hz]
+//                 [--channels C] [--bits 16|24|32] [--buffer-ms MS] [--chunk-ms MS]
+//                 [--signal sine|noise|silence] [--file path] [--bus name]
+//                 [--churn HZ] [--pause HZ] [--drain HZ] [--xrun-every N] [--jitter-ms MS]
+//                 [--latency-class name] [--realtime] [--trace dir] [--report S] [--seed N] [--json]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "format_converter.h"
+#include "headless_engine.h"
+#include "render_trace.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    unsigned streams{4};
+    double seconds{10.0};
+    double chunkMs{10.0};
+    std::string signal{"sine"};
+    std::string file;
+    double churnHz{0.0};
+    double pauseHz{0.0};
+    double drainHz{0.0};
+    std::string traceDir;
+    double reportSeconds{0.0};
+    uint32_t seed{1};
+    bool json{false};
+    headless::OpenOptions open;
+};
+
+static std::atomic<bool> g_stop{false};
+
+static void OnSignal(int)
+{
+    g_stop.store(true);
+}
+
+static double Seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+static uint32_t NextRandom(uint32_t &state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state;
+}
+
+// Process CPU time (user, system) in seconds
+static void CpuTimes(double &user, double &system)
+{
+#if defined(_WIN32)
+    FILETIME created, exited, kernel, usr;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &usr);
+    auto toSeconds = [](const FILETIME &t)
+    { return ((static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 1e7; };
+    user = toSeconds(usr);
+    system = toSeconds(kernel);
+#else
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+    system = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+// Latency samples in nanoseconds, appended by one thread, merged at the end
+struct Latencies
+{
+    std::vector<uint32_t> ns;
+
+    void add(Clock::duration d)
+    {
+        int64_t v = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        ns.push_back(static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(v, 0), UINT32_MAX)));
+    }
+
+    void merge(const Latencies &o) { ns.insert(ns.end(), o.ns.begin(), o.ns.end()); }
+
+    // Percentile in microseconds (0 with no samples); sorts in place
+    double percentileUs(double p)
+    {
+        if (ns.empty())
+            return 0.0;
+        std::sort(ns.begin(), ns.end());
+        size_t i = std::min(ns.size() - 1, static_cast<size_t>(p * ns.size()));
+        return ns[i] / 1000.0;
+    }
+
+    double maxUs() const { return ns.empty() ? 0.0 : *std::max_element(ns.begin(), ns.end()) / 1000.0; }
+};
+
+// Render-loop telemetry summed over every stream ever opened
+struct Totals
+{
+    uint64_t periods{0};
+    uint64_t ringUnderruns{0};
+    uint64_t underrunFrames{0};
+    uint64_t deviceXruns{0};
+    uint64_t shortWrites{0};
+    uint64_t writerParks{0};
+    uint64_t maxJitterNs{0};
+    uint64_t maxRenderNs{0};
+    uint64_t render[RenderTelemetry::kTimeBuckets]{};
+    uint64_t jitter[RenderTelemetry::kTimeBuckets]{};
+
+    void add(const headless::StreamStats &st)
+    {
+        const RenderTelemetry::Snapshot &t = st.telemetry;
+        periods += t.periods;
+        ringUnderruns += t.ringUnderruns;
+        underrunFrames += t.underrunFrames;
+        deviceXruns += t.deviceXruns;
+        shortWrites += t.shortWrites;
+        writerParks += st.writerParks;
+        maxJitterNs = std::max(maxJitterNs, t.maxJitterNs);
+        maxRenderNs = std::max(maxRenderNs, t.maxRenderNs);
+        for (size_t i = 0; i < RenderTelemetry::kTimeBuckets; ++i)
+        {
+            render[i] += t.render[i];
+            jitter[i] += t.jitter[i];
+        }
+    }
+
+    // Upper bound (us) of the histogram bucket holding percentile p; the
+    // open last bucket reports the observed maximum
+    static double BucketPercentileUs(const uint64_t *hist, double p, uint64_t maxNs)
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < RenderTelemetry::kTimeBuckets; ++i)
+            total += hist[i];
+        if (total == 0)
+            return 0.0;
+        uint64_t want = static_cast<uint64_t>(std::ceil(p * total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < RenderTelemetry::kTimeBuckets; ++i)
+        {
+            seen += hist[i];
+            if (seen >= want)
+            {
+                uint64_t limit = RenderTelemetry::BucketLimitUs(i);
+                return limit ? static_cast<double>(limit) : maxNs / 1000.0;
+            }
+        }
+        return maxNs / 1000.0;
+    }
+};
+
+// One logical stream: a writer thread and whichever handle it has now
+struct Slot
+{
+    unsigned index{0};
+    std::atomic<uint32_t> handle{0};
+    std::atomic<bool> paused{false};
+    std::atomic<bool> drainRequested{false};
+    // playFile() and close() on one handle are serialized, as on the JS thread
+    std::mutex lifecycle;
+    headless::StreamInfo info;
+    std::thread writer;
+
+    // Writer thread only until joined
+    Latencies writes;
+    Latencies drains;
+    uint64_t bytesWritten{0};
+    uint64_t filePlays{0};
+    uint64_t fileErrors{0};
+};
+
+struct Run
+{
+    Options opt;
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::mutex totalsMutex;
+    Totals totals;
+    Latencies opens;
+    Latencies closes;
+    uint64_t openFailures{0};
+    uint64_t churns{0};
+    uint64_t pauses{0};
+    uint64_t drains{0};
+    std::string firstError;
+};
+
+static SampleFormat StreamFormat(const headless::OpenOptions &o)
+{
+    if (o.bitDepth == 16)
+        return SampleFormat::S16;
+    if (o.bitDepth == 24)
+        return SampleFormat::S24;
+    return o.floatSamples ? SampleFormat::F32 : SampleFormat::S32;
+}
+
+static uint32_t OpenSlot(Run &run, Slot &slot)
+{
+    auto t0 = Clock::now();
+    headless::StreamInfo info;
+    uint32_t h = headless::Open(run.opt.open, &info);
+    run.opens.add(Clock::now() - t0);
+    if (!h)
+    {
+        ++run.openFailures;
+        if (run.firstError.empty())
+            run.firstError = headless::LastError();
+        return 0;
+    }
+    slot.info = info;
+    slot.paused.store(false);
+    return h;
+}
+
+static void CloseHandle(Run &run, uint32_t h)
+{
+    headless::StreamStats st;
+    if (headless::ReadStats(h, st))
+    {
+        std::lock_guard<std::mutex> lock(run.totalsMutex);
+        run.totals.add(st);
+    }
+    auto t0 = Clock::now();
+    headless::Close(h);
+    run.closes.add(Clock::now() - t0);
+}
+
+// Synthetic input: a chunk at a time in the stream's format, phase
+// continuous across chunks (and across reopened handles)
+static void WriterLoop(Run &run, Slot &slot)
+{
+    const Options &o = run.opt;
+    const unsigned channels = o.open.channels;
+    const size_t frames = std::max<size_t>(1, static_cast<size_t>(o.chunkMs * o.open.sampleRate / 1000.0));
+    const SampleFormat fmt = StreamFormat(o.open);
+    convert::ConvertFn toStream = convert::Resolve(SampleFormat::F32, fmt);
+
+    std::vector<float> pcm(frames * channels);
+    std::vector<uint8_t> chunk(frames * channels * SampleFormatBytes(fmt));
+    const double step = 2.0 * 3.14159265358979 * 440.0 * (1.0 + 0.01 * slot.index) / o.open.sampleRate;
+    double phase = 0.0;
+    uint32_t noise = o.seed + slot.index;
+
+    while (!g_stop.load())
+    {
+        uint32_t h = slot.handle.load();
+        if (!h)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        if (slot.drainRequested.exchange(false))
+        {
+            auto t0 = Clock::now();
+            headless::Drain(h);
+            slot.drains.add(Clock::now() - t0);
+        }
+
+        for (size_t f = 0; f < frames; ++f)
+        {
+            float v = 0.0f;
+            if (o.signal == "sine")
+            {
+                v = static_cast<float>(0.25 * std::sin(phase));
+                phase += step;
+                if (phase > 6.28318530717959)
+                    phase -= 6.28318530717959;
+            }
+            else if (o.signal == "noise")
+            {
+                v = static_cast<int32_t>(NextRandom(noise)) / 2147483648.0f * 0.1f;
+            }
+            for (unsigned c = 0; c < channels; ++c)
+                pcm[f * channels + c] = v;
+        }
+        const uint8_t *src = reinterpret_cast<const uint8_t *>(pcm.data());
+        if (toStream)
+        {
+            toStream(src, chunk.data(), pcm.size());
+            src = chunk.data();
+        }
+
+        auto t0 = Clock::now();
+        int written = headless::Write(h, src, chunk.size(), true);
+        slot.writes.add(Clock::now() - t0);
+        if (written > 0)
+            slot.bytesWritten += static_cast<uint64_t>(written);
+        else if (written < 0)
+            std::this_thread::yield(); // closed under us; pick up the new handle
+    }
+}
+
+// File input: the engine's decoder feeds the ring; replay once played out
+static void FileLoop(Run &run, Slot &slot)
+{
+    uint32_t playing = 0;
+    while (!g_stop.load())
+    {
+        uint32_t h = slot.handle.load();
+        if (h && slot.drainRequested.exchange(false))
+        {
+            auto t0 = Clock::now();
+            headless::Drain(h);
+            slot.drains.add(Clock::now() - t0);
+        }
+        if (h && (h != playing || headless::FilePlayedOut(h)))
+        {
+            std::lock_guard<std::mutex> lock(slot.lifecycle);
+            if (slot.handle.load() != h)
+                continue;
+            if (headless::PlayFile(h, run.opt.file))
+                ++slot.filePlays;
+            else
+                ++slot.fileErrors;
+            playing = h;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+static void PrintProgress(Run &run, double elapsed)
+{
+    headless::StreamStats st;
+    Totals live;
+    for (auto &slot : run.slots)
+    {
+        uint32_t h = slot->handle.load();
+        if (h && headless::ReadStats(h, st))
+            live.add(st);
+    }
+    std::lock_guard<std::mutex> lock(run.totalsMutex);
+    std::fprintf(stderr, "[%8.1fs] periods %llu  underruns %llu  xruns %llu  short %llu  churns %llu  open failures %llu\n",
+                 elapsed, static_cast<unsigned long long>(run.totals.periods + live.periods),
+                 static_cast<unsigned long long>(run.totals.ringUnderruns + live.ringUnderruns),
+                 static_cast<unsigned long long>(run.totals.deviceXruns + live.deviceXruns),
+                 static_cast<unsigned long long>(run.totals.shortWrites + live.shortWrites),
+                 static_cast<unsigned long long>(run.churns), static_cast<unsigned long long>(run.openFailures));
+}
+
+static void Report(Run &run, double wall, double cpuUser, double cpuSystem)
+{
+    Latencies writes, drains;
+    uint64_t bytes = 0, filePlays = 0, fileErrors = 0;
+    for (auto &slot : run.slots)
+    {
+        writes.merge(slot->writes);
+        drains.merge(slot->drains);
+        bytes += slot->bytesWritten;
+        filePlays += slot->filePlays;
+        fileErrors += slot->fileErrors;
+    }
+    const Totals &t = run.totals;
+    double renderP50 = Totals::BucketPercentileUs(t.render, 0.50, t.maxRenderNs);
+    double renderP99 = Totals::BucketPercentileUs(t.render, 0.99, t.maxRenderNs);
+    double jitterP99 = Totals::BucketPercentileUs(t.jitter, 0.99, t.maxJitterNs);
+    double cpuPercent = wall > 0 ? (cpuUser + cpuSystem) * 100.0 / wall : 0.0;
+
+    struct Row
+    {
+        const char *name;
+        Latencies *l;
+    } rows[] = {{"write", &writes}, {"open", &run.opens}, {"close", &run.closes}, {"drain", &drains}};
+
+    if (run.opt.json)
+    {
+        std::printf("{\n  \"config\": {\"streams\": %u, \"seconds\": %.3f, \"mode\": \"%s\", \"sampleRate\": %u,"
+                    " \"channels\": %u, \"bitDepth\": %u, \"chunkMs\": %.3f, \"input\": \"%s\","
+                    " \"churnHz\": %.3f, \"pauseHz\": %.3f, \"drainHz\": %.3f},\n",
+                    run.opt.streams, wall, run.opt.open.mode.c_str(), run.opt.open.sampleRate,
+                    run.opt.open.channels, run.opt.open.bitDepth, run.opt.chunkMs,
+                    run.opt.file.empty() ? run.opt.signal.c_str() : "file", run.opt.churnHz, run.opt.pauseHz,
+                    run.opt.drainHz);
+        std::printf("  \"render\": {\"periods\": %llu, \"ringUnderruns\": %llu, \"underrunFrames\": %llu,"
+                    " \"deviceXruns\": %llu, \"shortWrites\": %llu, \"writerParks\": %llu,"
+                    " \"periodP50Us\": %.0f, \"periodP99Us\": %.0f, \"periodMaxUs\": %.1f,"
+                    " \"jitterP99Us\": %.0f, \"jitterMaxUs\": %.1f},\n",
+                    static_cast<unsigned long long>(t.periods), static_cast<unsigned long long>(t.ringUnderruns),
+                    static_cast<unsigned long long>(t.underrunFrames), static_cast<unsigned long long>(t.deviceXruns),
+                    static_cast<unsigned long long>(t.shortWrites), static_cast<unsigned long long>(t.writerParks),
+                    renderP50, renderP99, t.maxRenderNs / 1000.0, jitterP99, t.maxJitterNs / 1000.0);
+        std::printf("  \"cpu\": {\"userSeconds\": %.3f, \"systemSeconds\": %.3f, \"percent\": %.1f},\n",
+                    cpuUser, cpuSystem, cpuPercent);
+        std::printf("  \"ops\": {\"bytesWritten\": %llu, \"churns\": %llu, \"pauses\": %llu, \"drains\": %llu,"
+                    " \"openFailures\": %llu, \"filePlays\": %llu, \"fileErrors\": %llu},\n",
+                    static_cast<unsigned long long>(bytes), static_cast<unsigned long long>(run.churns),
+                    static_cast<unsigned long long>(run.pauses), static_cast<unsigned long long>(run.drains),
+                    static_cast<unsigned long long>(run.openFailures), static_cast<unsigned long long>(filePlays),
+                    static_cast<unsigned long long>(fileErrors));
+        std::printf("  \"latencyUs\": {");
+        for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); ++i)
+        {
+            Latencies &l = *rows[i].l;
+            std::printf("%s\n    \"%s\": {\"count\": %zu, \"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}",
+                        i ? "," : "", rows[i].name, l.ns.size(), l.percentileUs(0.50), l.percentileUs(0.99),
+                        l.percentileUs(0.999), l.maxUs());
+        }
+        std::printf("\n  }\n}\n");
+        return;
+    }
+
+    std::printf("%u streams, %.1fs, mode %s, %u Hz x %u ch, %u-bit, input %s\n", run.opt.streams, wall,
+                run.opt.open.mode.c_str(), run.opt.open.sampleRate, run.opt.open.channels, run.opt.open.bitDepth,
+                run.opt.file.empty() ? run.opt.signal.c_str() : run.opt.file.c_str());
+    std::printf("render   periods %llu  ring underruns %llu (%llu frames)  device xruns %llu  short writes %llu\n",
+                static_cast<unsigned long long>(t.periods), static_cast<unsigned long long>(t.ringUnderruns),
+                static_cast<unsigned long long>(t.underrunFrames), static_cast<unsigned long long>(t.deviceXruns),
+                static_cast<unsigned long long>(t.shortWrites));
+    std::printf("         period p50 <= %.0f us  p99 <= %.0f us  max %.1f us  jitter p99 <= %.0f us  max %.1f us\n",
+                renderP50, renderP99, t.maxRenderNs / 1000.0, jitterP99, t.maxJitterNs / 1000.0);
+    std::printf("cpu      user %.2fs  system %.2fs  (%.1f%% of one core)\n", cpuUser, cpuSystem, cpuPercent);
+    std::printf("ops      %.1f MiB written  writer parks %llu  churns %llu  pauses %llu  drains %llu  open failures %llu",
+                bytes / 1048576.0, static_cast<unsigned long long>(t.writerParks),
+                static_cast<unsigned long long>(run.churns), static_cast<unsigned long long>(run.pauses),
+                static_cast<unsigned long long>(run.drains), static_cast<unsigned long long>(run.openFailures));
+    if (!run.opt.file.empty())
+        std::printf("  file plays %llu (errors %llu)", static_cast<unsigned long long>(filePlays),
+                    static_cast<unsigned long long>(fileErrors));
+    std::printf("\n");
+    for (auto &row : rows)
+    {
+        Latencies &l = *row.l;
+        if (l.ns.empty())
+            continue;
+        std::printf("%-8s %8zu calls  p50 %9.1f us  p99 %9.1f us  p99.9 %9.1f us  max %9.1f us\n", row.name,
+                    l.ns.size(), l.percentileUs(0.50), l.percentileUs(0.99), l.percentileUs(0.999),
+                    l.maxUs());
+    }
+    if (!run.firstError.empty())
+        std::printf("first open error: %s\n", run.firstError.c_str());
+}
+
+static bool ParseArgs(int argc, char **argv, Options &o)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto num = [&](double &out)
+        {
+            if (!v)
+                return false;
+            out = std::atof(v);
+            ++i;
+            return true;
+        };
+        auto str = [&](std::string &out)
+        {
+            if (!v)
+                return false;
+            out = v;
+            ++i;
+            return true;
+        };
+        double d = 0.0;
+        bool ok = true;
+        if (a == "--json")
+            o.json = true;
+        else if (a == "--realtime")
+            o.open.realtime = true;
+        else if (a == "--streams")
+            ok = num(d) && (o.streams = static_cast<unsigned>(d)) > 0;
+        else if (a == "--seconds")
+            ok = num(o.seconds);
+        else if (a == "--chunk-ms")
+            ok = num(o.chunkMs) && o.chunkMs > 0;
+        else if (a == "--signal")
+            ok = str(o.signal) && (o.signal == "sine" || o.signal == "noise" || o.signal == "silence");
+        else if (a == "--file")
+            ok = str(o.file);
+        else if (a == "--churn")
+            ok = num(o.churnHz);
+        else if (a == "--pause")
+            ok = num(o.pauseHz);
+        else if (a == "--drain")
+            ok = num(o.drainHz);
+        else if (a == "--trace")
+            ok = str(o.traceDir);
+        else if (a == "--report")
+            ok = num(o.reportSeconds);
+        else if (a == "--seed")
+            ok = num(d) && ((o.seed = static_cast<uint32_t>(d)), true);
+        else if (a == "--mode")
+            ok = str(o.open.mode);
+        else if (a == "--device")
+            ok = str(o.open.deviceId);
+        else if (a == "--backend")
+            ok = str(o.open.backend);
+        else if (a == "--bus")
+            ok = str(o.open.bus);
+        else if (a == "--latency-class")
+            ok = str(o.open.latencyClass);
+        else if (a == "--rate")
+            ok = num(d) && (o.open.sampleRate = static_cast<unsigned>(d)) > 0;
+        else if (a == "--channels")
+            ok = num(d) && (o.open.channels = static_cast<unsigned>(d)) > 0;
+        else if (a == "--bits")
+            ok = num(d) && ((o.open.bitDepth = static_cast<unsigned>(d)), true);
+        else if (a == "--buffer-ms")
+            ok = num(o.open.bufferMs);
+        else if (a == "--clock")
+        {
+            std::string clock;
+            ok = str(clock) && (clock == "realtime" || clock == "fast");
+            o.open.nullSink.realtime = clock == "realtime";
+        }
+        else if (a == "--xrun-every")
+            ok = num(d) && ((o.open.nullSink.xrunEveryPeriods = static_cast<uint32_t>(d)), true);
+        else if (a == "--jitter-ms")
+            ok = num(o.open.nullSink.jitterMs);
+        else
+            ok = false;
+        if (!ok)
+            return false;
+    }
+    if (!o.traceDir.empty())
+        o.open.traceRecords = RenderTrace::kDefaultRecords;
+    return o.seconds > 0;
+}
+
+int main(int argc, char **argv)
+{
+    Run run;
+    if (!ParseArgs(argc, argv, run.opt))
+    {
+        std::fprintf(stderr, "usage: see the header of bench/engine_load.cc\n");
+        return 2;
+    }
+    const Options &o = run.opt;
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    double cpuUser0 = 0, cpuSystem0 = 0;
+    CpuTimes(cpuUser0, cpuSystem0);
+    auto start = Clock::now();
+
+    for (unsigned i = 0; i < o.streams; ++i)
+    {
+        auto slot = std::make_unique<Slot>();
+        slot->index = i;
+        slot->handle.store(OpenSlot(run, *slot));
+        run.slots.push_back(std::move(slot));
+    }
+    if (run.openFailures == o.streams)
+    {
+        std::fprintf(stderr, "no stream could be opened: %s\n", run.firstError.c_str());
+        return 1;
+    }
+    for (auto &slot : run.slots)
+    {
+        Slot *sp = slot.get();
+        sp->writer = o.file.empty() ? std::thread(WriterLoop, std::ref(run), std::ref(*sp))
+                                    : std::thread(FileLoop, std::ref(run), std::ref(*sp));
+    }
+
+    // Churn on this thread: each operation fires at its own rate on a
+    // stream picked at random
+    uint32_t rng = o.seed;
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(o.seconds));
+    auto every = [](double hz)
+    { return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz)); };
+    auto nextChurn = o.churnHz > 0 ? start + every(o.churnHz) : Clock::time_point::max();
+    auto nextPause = o.pauseHz > 0 ? start + every(o.pauseHz) : Clock::time_point::max();
+    auto nextDrain = o.drainHz > 0 ? start + every(o.drainHz) : Clock::time_point::max();
+    auto nextReport = o.reportSeconds > 0 ? start + every(1.0 / o.reportSeconds) : Clock::time_point::max();
+
+    while (!g_stop.load())
+    {
+        auto now = Clock::now();
+        if (now >= deadline)
+            break;
+        Slot &slot = *run.slots[NextRandom(rng) % run.slots.size()];
+
+        if (now >= nextChurn)
+        {
+            nextChurn += every(o.churnHz);
+            {
+                std::lock_guard<std::mutex> lock(slot.lifecycle);
+                uint32_t h = slot.handle.exchange(0);
+                if (h)
+                    CloseHandle(run, h);
+            }
+            slot.handle.store(OpenSlot(run, slot));
+            ++run.churns;
+        }
+        if (now >= nextPause)
+        {
+            nextPause += every(o.pauseHz);
+            uint32_t h = slot.handle.load();
+            bool paused = !slot.paused.load();
+            slot.paused.store(paused);
+            headless::Pause(h, paused);
+            ++run.pauses;
+        }
+        if (now >= nextDrain)
+        {
+            nextDrain += every(o.drainHz);
+            slot.drainRequested.store(true);
+            ++run.drains;
+        }
+        if (now >= nextReport)
+        {
+            nextReport += every(1.0 / o.reportSeconds);
+            PrintProgress(run, Seconds(now - start));
+        }
+
+        auto wake = std::min({deadline, nextChurn, nextPause, nextDrain, nextReport});
+        std::this_thread::sleep_until(std::min(wake, Clock::now() + std::chrono::milliseconds(100)));
+    }
+
+    // Writers see the stop flag once their current write returns; close()
+    // wakes any still parked on a full ring
+    g_stop.store(true);
+    for (auto &slot : run.slots)
+    {
+        uint32_t h = slot->handle.load();
+        if (h)
+            headless::Pause(h, false);
+    }
+    for (auto &slot : run.slots)
+    {
+        std::unique_lock<std::mutex> lock(slot->lifecycle);
+        uint32_t h = slot->handle.exchange(0);
+        if (h && !o.traceDir.empty())
+        {
+            std::string path = o.traceDir + "/stream-" + std::to_string(slot->index) + ".json";
+            if (headless::DumpTrace(h, path) < 0)
+                std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        }
+        if (h)
+            CloseHandle(run, h);
+        lock.unlock();
+        slot->writer.join();
+    }
+
+    double wall = Seconds(Clock::now() - start);
+    double cpuUser = 0, cpuSystem = 0;
+    CpuTimes(cpuUser, cpuSystem);
+    Report(run, wall, cpuUser - cpuUser0, cpuSystem - cpuSystem0);
+    return 0;
+}
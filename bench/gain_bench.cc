@@ -0,0 +1,111 @@
+// bench/gain_bench.cc
+//
+// Constant-gain and per-sample (ramp) kernels from src/gain_stage.h (scalar /
+// SSE2 / AVX2 / NEON) per device sample format, plus a ramping GainStage
+// block. Reports
+// Msamples/s; compare with bench/gain_bench.mjs, which runs the JS
+// GainTransform loop audioEngine.js used before volume moved native.
+//
+//   g++ -O2 -std=c++17 -Isrc bench/gain_bench.cc -o gain_bench
+//   (or npm run bench:native -> bench/build/Release/gain_bench)
+//   ./gain_bench [seconds] [blockFrames] [channels]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "gain_stage.h"
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn>
+static double Measure(double seconds, size_t samplesPerCall, Fn &&fn)
+{
+    size_t calls = 0;
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration<double>(seconds);
+    while (Clock::now() < end)
+    {
+        for (int i = 0; i < 64; ++i)
+            fn();
+        calls += 64;
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(calls * samplesPerCall) / elapsed / 1e6;
+}
+
+static void Row(const char *fmt, const char *kernel, double msps)
+{
+    std::printf("%-4s %-8s %10.1f Msamples/s\n", fmt, kernel, msps);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+    size_t frames = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4096;
+    unsigned channels = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 2;
+    size_t n = frames * channels;
+
+    // Gains alternate so the data never settles at 0 or saturation
+    float gains[2] = {0.7f, 1.0f / 0.7f};
+    int flip = 0;
+
+    std::vector<int16_t> s16(n, 1000);
+    std::vector<int32_t> s32(n, 1 << 24);
+    std::vector<float> f32(n, 0.25f);
+    std::vector<uint8_t> s24(n * 3, 0x11);
+
+    std::vector<gain::Kernels> sets;
+    sets.push_back(gain::ScalarKernels());
+#if defined(GAIN_X86)
+    sets.push_back({gain::ScaleF32Sse2, gain::ScaleS16Sse2, gain::ScaleS32Sse2,
+                    gain::RampF32Sse2, gain::RampS16Sse2, gain::RampS32Sse2, "sse2"});
+    if (gain::CpuHasAvx2())
+        sets.push_back({gain::ScaleF32Avx2, gain::ScaleS16Avx2, gain::ScaleS32Avx2,
+                        gain::RampF32Avx2, gain::RampS16Avx2, gain::RampS32Avx2, "avx2"});
+#elif defined(GAIN_NEON)
+    sets.push_back({gain::ScaleF32Neon, gain::ScaleS16Neon, gain::ScaleS32Neon,
+                    gain::RampF32Neon, gain::RampS16Neon, gain::RampS32Neon, "neon"});
+#endif
+
+    // A ramp's per-sample gains, alternating direction like the constants
+    std::vector<float> ramp[2] = {std::vector<float>(n), std::vector<float>(n)};
+    for (size_t i = 0; i < n; ++i)
+    {
+        float t = static_cast<float>(i / channels) / static_cast<float>(frames);
+        ramp[0][i] = gains[0] + (gains[1] - gains[0]) * t;
+        ramp[1][i] = gains[1] + (gains[0] - gains[1]) * t;
+    }
+
+    std::printf("%zu frames x %u ch per block, best kernel: %s\n", frames, channels, gain::Best().name);
+    for (const auto &k : sets)
+    {
+        Row("s16", k.name, Measure(seconds, n, [&]
+                                   { k.s16(s16.data(), n, gains[flip ^= 1]); }));
+        Row("s24", k.name, Measure(seconds, n, [&]
+                                   { gain::ScaleS24(s24.data(), n, gains[flip ^= 1], k); }));
+        Row("s32", k.name, Measure(seconds, n, [&]
+                                   { k.s32(s32.data(), n, gains[flip ^= 1]); }));
+        Row("f32", k.name, Measure(seconds, n, [&]
+                                   { k.f32(f32.data(), n, gains[flip ^= 1]); }));
+        Row("s16r", k.name, Measure(seconds, n, [&]
+                                    { k.s16Ramp(s16.data(), n, ramp[flip ^= 1].data()); }));
+        Row("s32r", k.name, Measure(seconds, n, [&]
+                                    { k.s32Ramp(s32.data(), n, ramp[flip ^= 1].data()); }));
+        Row("f32r", k.name, Measure(seconds, n, [&]
+                                    { k.f32Ramp(f32.data(), n, ramp[flip ^= 1].data()); }));
+    }
+
+    // Worst case for the stage: every block is a ramp
+    GainStage stage;
+    Row("s16", "ramp", Measure(seconds, n, [&]
+                               {
+        stage.set(gains[flip ^= 1], static_cast<uint32_t>(frames), GainStage::Curve::Linear);
+        stage.process(reinterpret_cast<uint8_t *>(s16.data()), frames, channels, SampleFormat::S16); }));
+    Row("f32", "ramp", Measure(seconds, n, [&]
+                               {
+        stage.set(gains[flip ^= 1], static_cast<uint32_t>(frames), GainStage::Curve::Exponential);
+        stage.process(reinterpret_cast<uint8_t *>(f32.data()), frames, channels, SampleFormat::F32); }));
+    return 0;
+}
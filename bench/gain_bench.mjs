@@ -0,0 +1,73 @@
+// bench/gain_bench.mjs
+//
+// The per-sample JS volume loop audioEngine.js ran as GainTransform before
+// volume moved into the native render path, measured the same way as
+// bench/gain_bench.cc (Msamples/s over fixed-size blocks, one new Buffer per
+// block as the Transform allocated).
+//
+//   node bench/gain_bench.mjs [seconds] [blockFrames] [channels]
+import { performance } from 'node:perf_hooks';
+
+const seconds = Number(process.argv[2] || 0.5);
+const frames = Number(process.argv[3] || 4096);
+const channels = Number(process.argv[4] || 2);
+
+function gainS16(chunk, gain) {
+  const out = Buffer.allocUnsafe(chunk.length);
+  for (let i = 0; i + 1 < chunk.length; i += 2) {
+    const s = chunk.readInt16LE(i);
+    let v = Math.round(s * gain);
+    if (v > 32767) v = 32767;
+    else if (v < -32768) v = -32768;
+    out.writeInt16LE(v, i);
+  }
+  return out;
+}
+
+function gainS24(chunk, gain) {
+  const out = Buffer.allocUnsafe(chunk.length);
+  for (let i = 0; i + 2 < chunk.length; i += 3) {
+    let s = chunk[i] | (chunk[i + 1] << 8) | (chunk[i + 2] << 16);
+    if (s & 0x800000) s |= 0xff000000;
+    let v = Math.round(s * gain);
+    if (v > 0x7fffff) v = 0x7fffff;
+    else if (v < -0x800000) v = -0x800000;
+    out[i] = v & 0xff;
+    out[i + 1] = (v >> 8) & 0xff;
+    out[i + 2] = (v >> 16) & 0xff;
+  }
+  return out;
+}
+
+function gainF32(chunk, gain) {
+  const view = new DataView(chunk.buffer, chunk.byteOffset, chunk.length);
+  const out = Buffer.allocUnsafe(chunk.length);
+  for (let i = 0; i + 3 < chunk.length; i += 4) {
+    const f = view.getFloat32(i, true);
+    let v = f * gain;
+    if (v > 1.0) v = 1.0;
+    else if (v < -1.0) v = -1.0;
+    out.writeFloatLE(v, i);
+  }
+  return out;
+}
+
+function measure(name, bytesPerSample, fn) {
+  const samples = frames * channels;
+  let chunk = Buffer.alloc(samples * bytesPerSample, 0x11);
+  const gains = [0.7, 1 / 0.7];
+  let calls = 0;
+  const start = performance.now();
+  const end = start + seconds * 1000;
+  while (performance.now() < end) {
+    for (let i = 0; i < 16; i++) chunk = fn(chunk, gains[(calls + i) & 1]);
+    calls += 16;
+  }
+  const elapsed = (performance.now() - start) / 1000;
+  console.log(`${name.padEnd(4)} ${'js'.padEnd(8)} ${((calls * samples) / elapsed / 1e6).toFixed(1).padStart(10)} Msamples/s`);
+}
+
+console.log(`${frames} frames x ${channels} ch per block`);
+measure('s16', 2, gainS16);
+measure('s24', 3, gainS24);
+measure('f32', 4, gainF32);
@@ -0,0 +1,206 @@
+// bench/handle_table_bench.cc
+//
+// Stream lookup under contention: HandleTable (src/stream_table.h) against
+// the previous mutex + std::map. Writer threads look up their own stream in a
+// tight loop (write / writeAsync), while a poller sweeps every stream at a
+// fixed rate the way a UI polling getStats() does. Reports writer lookups
+// per second and per-lookup latency for both sides.
+//
+//   g++ -O2 -std=c++17 -pthread -Isrc bench/handle_table_bench.cc -o handle_table_bench
+//   (or npm run bench:native -> bench/build/Release/handle_table_bench)
+//   ./handle_table_bench [seconds] [writers] [streams] [pollHz]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "stream_table.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Stream
+{
+    std::atomic<uint64_t> touched{0};
+};
+
+// What the addon did before src/stream_table.h
+struct LegacyTable
+{
+    std::map<uint32_t, Stream *> streams;
+    std::mutex mutex;
+    uint32_t nextId{1};
+
+    uint32_t insert(Stream *s)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t h = nextId++;
+        streams[h] = s;
+        return h;
+    }
+
+    template <typename F>
+    bool with(uint32_t h, F &&f)
+    {
+        Stream *s = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = streams.find(h);
+            if (it == streams.end())
+                return false;
+            s = it->second;
+        }
+        f(s);
+        return true;
+    }
+};
+
+struct LockFreeTable
+{
+    HandleTable<Stream> table;
+
+    uint32_t insert(Stream *s) { return table.insert(s); }
+
+    template <typename F>
+    bool with(uint32_t h, F &&f)
+    {
+        auto ref = table.acquire(h);
+        if (!ref)
+            return false;
+        f(ref.get());
+        return true;
+    }
+};
+
+struct Result
+{
+    double lookupsPerSec{0};
+    double writerP50{0}, writerP99{0}, writerMax{0};
+    double pollP50{0}, pollP99{0}, pollMax{0};
+};
+
+static double Percentile(std::vector<uint32_t> &v, double p)
+{
+    if (v.empty())
+        return 0.0;
+    size_t idx = static_cast<size_t>(p * static_cast<double>(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + idx, v.end());
+    return static_cast<double>(v[idx]);
+}
+
+static uint32_t ElapsedNs(Clock::time_point t0, Clock::time_point t1)
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+}
+
+template <typename Table>
+static Result Run(double seconds, unsigned writers, unsigned streamCount, unsigned pollHz)
+{
+    Table table;
+    std::vector<Stream> streams(streamCount);
+    std::vector<uint32_t> handles;
+    for (auto &s : streams)
+        handles.push_back(table.insert(&s));
+
+    std::atomic<bool> go{false}, stop{false};
+    std::vector<uint64_t> counts(writers, 0);
+    // Every 64th writer lookup is timed; the clock read costs more than the
+    // lock-free lookup itself
+    std::vector<std::vector<uint32_t>> writerNs(writers);
+    std::vector<uint32_t> pollNs;
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < writers; ++w)
+    {
+        threads.emplace_back([&, w]
+                             {
+            uint32_t h = handles[w % handles.size()];
+            auto &lat = writerNs[w];
+            lat.reserve(1 << 20);
+            while (!go.load()) {}
+            uint64_t n = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                if ((n & 63) == 0 && lat.size() < lat.capacity())
+                {
+                    auto t0 = Clock::now();
+                    table.with(h, [](Stream *s) { s->touched.fetch_add(1, std::memory_order_relaxed); });
+                    lat.push_back(ElapsedNs(t0, Clock::now()));
+                }
+                else
+                {
+                    table.with(h, [](Stream *s) { s->touched.fetch_add(1, std::memory_order_relaxed); });
+                }
+                ++n;
+            }
+            counts[w] = n; });
+    }
+
+    threads.emplace_back([&]
+                         {
+        auto period = std::chrono::nanoseconds(1000000000ull / std::max(1u, pollHz));
+        while (!go.load()) {}
+        auto next = Clock::now();
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            for (uint32_t h : handles)
+            {
+                auto t0 = Clock::now();
+                table.with(h, [](Stream *s) { (void)s->touched.load(std::memory_order_relaxed); });
+                pollNs.push_back(ElapsedNs(t0, Clock::now()));
+            }
+            next += period;
+            std::this_thread::sleep_until(next);
+        } });
+
+    auto start = Clock::now();
+    go.store(true);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    for (auto &t : threads)
+        t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Result r;
+    uint64_t total = 0;
+    std::vector<uint32_t> all;
+    for (unsigned w = 0; w < writers; ++w)
+    {
+        total += counts[w];
+        all.insert(all.end(), writerNs[w].begin(), writerNs[w].end());
+    }
+    r.lookupsPerSec = static_cast<double>(total) / elapsed;
+    r.writerMax = all.empty() ? 0.0 : *std::max_element(all.begin(), all.end());
+    r.writerP50 = Percentile(all, 0.50);
+    r.writerP99 = Percentile(all, 0.99);
+    r.pollMax = pollNs.empty() ? 0.0 : *std::max_element(pollNs.begin(), pollNs.end());
+    r.pollP50 = Percentile(pollNs, 0.50);
+    r.pollP99 = Percentile(pollNs, 0.99);
+    return r;
+}
+
+static void Print(const char *name, const Result &r)
+{
+    std::printf("%-8s %8.1f M lookups/s   writer p50 %5.0f ns p99 %6.0f ns max %8.0f ns   poll p50 %5.0f ns p99 %6.0f ns max %8.0f ns\n",
+                name, r.lookupsPerSec / 1e6, r.writerP50, r.writerP99, r.writerMax, r.pollP50, r.pollP99, r.pollMax);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3.0;
+    unsigned writers = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 4;
+    unsigned streams = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 4;
+    // A stats panel redrawing every frame
+    unsigned pollHz = argc > 4 ? static_cast<unsigned>(std::strtoul(argv[4], nullptr, 10)) : 60;
+    if (writers == 0 || streams == 0)
+        return 1;
+
+    std::printf("%.1f s, %u writers, %u streams, poller at %u Hz\n", seconds, writers, streams, pollHz);
+    Print("legacy", Run<LegacyTable>(seconds, writers, streams, pollHz));
+    Print("table", Run<LockFreeTable>(seconds, writers, streams, pollHz));
+    return 0;
+}
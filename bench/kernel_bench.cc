@@ -0,0 +1,571 @@
+// bench/kernel_bench.cc
+//
+// Regression suite for the hot paths of the render and writer threads, built
+// without N-API: the ring (single thread and producer/consumer), the blocking
+// writer path (src/ring_writer.h, what write() runs), format conversion, gain,
+// the bus and crossfade mixers and the EQ. For each case it reports
+// throughput (GB/s of the bytes the kernel touches, Mframes/s), p50/p99 time
+// per call and cycles per sample (TSC ticks on x86, 0 elsewhere). --json
+// prints one JSON document instead of the table, for comparing releases.
+//
+//   g++ -O2 -std=c++17 -pthread -Isrc bench/kernel_bench.cc -o kernel_bench
+//   (or: npm run bench:native, which builds bench/binding.gyp)
+//   ./kernel_bench [--seconds S] [--frames N] [--channels C] [--filter text] [--json]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define BENCH_TSC 1
+#endif
+
+#include "biquad_eq.h"
+#include "crossfade_mixer.h"
+#include "format_converter.h"
+#include "gain_stage.h"
+#include "mix_bus.h"
+#include "ring_buffer.h"
+#include "ring_writer.h"
+
+using Clock = std::chrono::steady_clock;
+
+static inline uint64_t Ticks()
+{
+#if defined(BENCH_TSC)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static inline uint64_t NowNs()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+struct Options
+{
+    double seconds{0.5};
+    size_t frames{512};
+    unsigned channels{2};
+    std::string filter;
+    bool json{false};
+};
+
+struct Result
+{
+    std::string name;
+    std::string kernel; // which implementation ran (scalar/sse2/avx2/neon/...)
+    uint64_t calls{0};
+    double seconds{0};
+    double gbPerSec{0};
+    double mframesPerSec{0};
+    double p50Ns{0};
+    double p99Ns{0};
+    double cyclesPerSample{0};
+};
+
+// Per-call latency samples and totals for one case
+struct Meter
+{
+    std::vector<uint32_t> samples;
+    uint64_t calls{0};
+    uint64_t bytes{0};
+    uint64_t frames{0};
+    uint64_t ticks{0};
+    double elapsed{0};
+
+    void record(uint64_t ns)
+    {
+        samples.push_back(static_cast<uint32_t>(std::min<uint64_t>(ns, UINT32_MAX)));
+    }
+
+    Result finish(const std::string &name, const char *kernel, unsigned channels)
+    {
+        Result r;
+        r.name = name;
+        r.kernel = kernel;
+        r.calls = calls;
+        r.seconds = elapsed;
+        if (elapsed > 0)
+        {
+            r.gbPerSec = bytes / elapsed / 1e9;
+            r.mframesPerSec = frames / elapsed / 1e6;
+        }
+        if (!samples.empty())
+        {
+            std::sort(samples.begin(), samples.end());
+            r.p50Ns = samples[samples.size() / 2];
+            r.p99Ns = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+        }
+        uint64_t totalSamples = frames * channels;
+        r.cyclesPerSample = totalSamples ? static_cast<double>(ticks) / totalSamples : 0;
+        return r;
+    }
+};
+
+// Single-thread case: fn() processes framesPerCall frames touching
+// bytesPerCall bytes. Every 16th call is timed on its own for the latency
+// percentiles; the rest run back to back so the clock doesn't dominate the
+// throughput of small blocks.
+template <typename Fn>
+static Meter MeasureKernel(double seconds, size_t bytesPerCall, size_t framesPerCall, Fn &&fn)
+{
+    for (int i = 0; i < 64; ++i)
+        fn();
+
+    Meter m;
+    m.samples.reserve(1 << 16);
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration<double>(seconds);
+    uint64_t t0 = Ticks();
+    while (Clock::now() < end)
+    {
+        uint64_t a = NowNs();
+        fn();
+        m.record(NowNs() - a);
+        for (int i = 0; i < 15; ++i)
+            fn();
+        m.calls += 16;
+    }
+    m.ticks = Ticks() - t0;
+    m.elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    m.bytes = m.calls * bytesPerCall;
+    m.frames = m.calls * framesPerCall;
+    return m;
+}
+
+class Suite
+{
+public:
+    explicit Suite(const Options &o) : opt(o) {}
+
+    bool wants(const std::string &name) const
+    {
+        return opt.filter.empty() || name.find(opt.filter) != std::string::npos;
+    }
+
+    void add(Result r)
+    {
+        if (!opt.json)
+            std::printf("%-26s %-7s %8.2f GB/s %9.1f Mframes/s %9.0f ns p50 %9.0f ns p99 %7.2f cyc/sample\n",
+                        r.name.c_str(), r.kernel.c_str(), r.gbPerSec, r.mframesPerSec, r.p50Ns, r.p99Ns,
+                        r.cyclesPerSample);
+        results.push_back(std::move(r));
+    }
+
+    void printJson() const
+    {
+        std::printf("{\n  \"config\": {\"seconds\": %.3f, \"frames\": %zu, \"channels\": %u, \"tsc\": %s,"
+                    " \"gain\": \"%s\", \"compiler\": \"%s\"},\n  \"results\": [",
+                    opt.seconds, opt.frames, opt.channels,
+#if defined(BENCH_TSC)
+                    "true",
+#else
+                    "false",
+#endif
+                    gain::Best().name, Compiler());
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+            std::printf("%s\n    {\"name\": \"%s\", \"kernel\": \"%s\", \"calls\": %llu, \"seconds\": %.4f,"
+                        " \"gbPerSec\": %.4f, \"mframesPerSec\": %.3f, \"p50Ns\": %.0f, \"p99Ns\": %.0f,"
+                        " \"cyclesPerSample\": %.4f}",
+                        i ? "," : "", r.name.c_str(), r.kernel.c_str(),
+                        static_cast<unsigned long long>(r.calls), r.seconds, r.gbPerSec, r.mframesPerSec,
+                        r.p50Ns, r.p99Ns, r.cyclesPerSample);
+        }
+        std::printf("\n  ]\n}\n");
+    }
+
+    const Options &opt;
+
+private:
+    static const char *Compiler()
+    {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc";
+#else
+        return "unknown";
+#endif
+    }
+
+    std::vector<Result> results;
+};
+
+// ---------------------------------------------------------------------------
+// Ring and writer path (f32 frames of opt.channels samples)
+
+static void BenchRingCopy(Suite &suite)
+{
+    const Options &o = suite.opt;
+    const std::string name = "ring/copy";
+    if (!suite.wants(name))
+        return;
+
+    size_t frameBytes = o.channels * 4;
+    size_t block = o.frames * frameBytes;
+    RingBuffer ring;
+    ring.init(block * 8);
+    std::vector<uint8_t> in(block, 0x5a), out(block);
+
+    // One write and one read of a block: the cost of the index protocol plus
+    // two copies, without cross-core traffic
+    Meter m = MeasureKernel(o.seconds, block * 2, o.frames, [&]
+                            {
+        ring.write(in.data(), block);
+        ring.read(out.data(), block); });
+    suite.add(m.finish(name, "-", o.channels));
+}
+
+// Producer writes blocks as fast as the ring takes them while a consumer
+// thread drains device-period sized reads. Latency is per producer write().
+static void BenchRingSpsc(Suite &suite)
+{
+    const Options &o = suite.opt;
+    const std::string name = "ring/spsc";
+    if (!suite.wants(name))
+        return;
+
+    size_t frameBytes = o.channels * 4;
+    size_t block = o.frames * frameBytes;
+    size_t period = 256 * frameBytes;
+    RingBuffer ring;
+    ring.init(block * 16);
+
+    std::atomic<bool> stop{false};
+    std::thread consumer([&]
+                         {
+        std::vector<uint8_t> out(period);
+        while (!stop.load(std::memory_order_relaxed))
+            if (ring.read(out.data(), period) == 0)
+                std::this_thread::yield(); });
+
+    std::vector<uint8_t> in(block, 0x5a);
+    Meter m;
+    m.samples.reserve(1 << 16);
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration<double>(o.seconds);
+    uint64_t t0 = Ticks();
+    while (Clock::now() < end)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            uint64_t a = NowNs();
+            size_t n = ring.write(in.data(), block);
+            m.record(NowNs() - a);
+            m.bytes += n;
+            ++m.calls;
+            if (n == 0)
+                std::this_thread::yield();
+        }
+    }
+    m.ticks = Ticks() - t0;
+    m.elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    m.frames = m.bytes / frameBytes;
+    stop.store(true);
+    consumer.join();
+    suite.add(m.finish(name, "-", o.channels));
+}
+
+// write() as the writer thread runs it: RingWriter parks on a full ring and
+// the consumer wakes it the way SignalWriters() does, once a quarter of the
+// ring is free. Latency is per blocking write, parks included.
+static void BenchWriterBlocking(Suite &suite)
+{
+    const Options &o = suite.opt;
+    const std::string name = "writer/blocking";
+    if (!suite.wants(name))
+        return;
+
+    size_t frameBytes = o.channels * 4;
+    size_t block = o.frames * frameBytes;
+    size_t period = 256 * frameBytes;
+    RingBuffer ring;
+    ring.init(block * 4);
+    WriterWakeup wake;
+    std::atomic<uint64_t> parks{0}, spurious{0};
+    RenderTrace trace;
+    RingWriter writer{ring, wake, parks, spurious, trace};
+    size_t threshold = ring.size() / 4;
+
+    std::atomic<bool> stop{false};
+    std::thread consumer([&]
+                         {
+        std::vector<uint8_t> out(period);
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (ring.read(out.data(), period) == 0)
+                std::this_thread::yield();
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (wake.hasWaiters() && ring.availableToWrite() >= threshold)
+                wake.wakeAll();
+        }
+        wake.wakeAll(); });
+
+    std::vector<uint8_t> in(block, 0x5a);
+    auto live = [&]
+    { return !stop.load(std::memory_order_relaxed); };
+    Meter m;
+    m.samples.reserve(1 << 16);
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration<double>(o.seconds);
+    uint64_t t0 = Ticks();
+    while (Clock::now() < end)
+    {
+        uint64_t a = NowNs();
+        size_t n = writer.write(in.data(), block, 100, live);
+        m.record(NowNs() - a);
+        m.bytes += n;
+        ++m.calls;
+    }
+    m.ticks = Ticks() - t0;
+    m.elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    m.frames = m.bytes / frameBytes;
+    stop.store(true);
+    consumer.join();
+
+    suite.add(m.finish(name, "futex", o.channels));
+}
+
+// ---------------------------------------------------------------------------
+// DSP and format kernels, one block of opt.frames x opt.channels per call
+
+static const char *FormatName(SampleFormat f)
+{
+    switch (f)
+    {
+    case SampleFormat::S16:
+        return "s16";
+    case SampleFormat::S24:
+        return "s24";
+    case SampleFormat::S32:
+        return "s32";
+    case SampleFormat::F32:
+        return "f32";
+    case SampleFormat::S24In32:
+        return "s24in32";
+    }
+    return "?";
+}
+
+static void BenchConvert(Suite &suite)
+{
+    const Options &o = suite.opt;
+    static const SampleFormat pairs[][2] = {
+        {SampleFormat::F32, SampleFormat::S16},
+        {SampleFormat::F32, SampleFormat::S24},
+        {SampleFormat::F32, SampleFormat::S32},
+        {SampleFormat::S16, SampleFormat::F32},
+        {SampleFormat::S16, SampleFormat::S32},
+        {SampleFormat::S24, SampleFormat::S32},
+        {SampleFormat::S32, SampleFormat::S16},
+    };
+
+    size_t samples = o.frames * o.channels;
+    for (const auto &p : pairs)
+    {
+        std::string name = std::string("convert/") + FormatName(p[0]) + "-" + FormatName(p[1]);
+        if (!suite.wants(name))
+            continue;
+        convert::ConvertFn fn = convert::Resolve(p[0], p[1]);
+        if (!fn)
+            continue;
+        std::vector<uint8_t> in(samples * SampleFormatBytes(p[0]), 0x21);
+        std::vector<uint8_t> out(samples * SampleFormatBytes(p[1]));
+        size_t bytes = in.size() + out.size();
+        Meter m = MeasureKernel(o.seconds, bytes, o.frames, [&]
+                                { fn(in.data(), out.data(), samples); });
+        suite.add(m.finish(name, "-", o.channels));
+    }
+}
+
+static void BenchGain(Suite &suite)
+{
+    const Options &o = suite.opt;
+    static const SampleFormat formats[] = {SampleFormat::S16, SampleFormat::S24, SampleFormat::S32,
+                                           SampleFormat::F32};
+
+    size_t samples = o.frames * o.channels;
+    // Gains alternate so the data never settles at 0 or saturation
+    float gains[2] = {0.7f, 1.0f / 0.7f};
+    int flip = 0;
+    std::vector<gain::Kernels> sets{gain::ScalarKernels()};
+    if (std::strcmp(gain::Best().name, "scalar") != 0)
+        sets.push_back(gain::Best());
+    for (const gain::Kernels &k : sets)
+    {
+        for (SampleFormat f : formats)
+        {
+            std::string name = std::string("gain/") + FormatName(f);
+            if (!suite.wants(name))
+                continue;
+            std::vector<uint8_t> buf(samples * SampleFormatBytes(f), 0x11);
+            if (f == SampleFormat::F32)
+                std::fill(reinterpret_cast<float *>(buf.data()), reinterpret_cast<float *>(buf.data()) + samples, 0.25f);
+            Meter m = MeasureKernel(o.seconds, buf.size() * 2, o.frames, [&]
+                                    { gain::Scale(buf.data(), samples, f, gains[flip ^= 1], k); });
+            suite.add(m.finish(name, k.name, o.channels));
+        }
+    }
+}
+
+static const char *MixKernelName()
+{
+#if defined(GAIN_X86)
+    return gain::CpuHasAvx2() ? "avx2" : "sse2";
+#elif defined(GAIN_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+static void BenchMix(Suite &suite)
+{
+    const Options &o = suite.opt;
+    size_t samples = o.frames * o.channels;
+    std::vector<float> acc(samples, 0.1f), in(samples, 0.2f);
+
+    if (suite.wants("mix/bus-add"))
+    {
+        mix::AddFn add = mix::BestAdd();
+        // acc is reset now and then so the sum stays finite
+        int n = 0;
+        Meter m = MeasureKernel(o.seconds, samples * 4 * 3, o.frames, [&]
+                                {
+            add(acc.data(), in.data(), samples);
+            if (++n == 1024)
+            {
+                n = 0;
+                std::fill(acc.begin(), acc.end(), 0.1f);
+            } });
+        suite.add(m.finish("mix/bus-add", MixKernelName(), o.channels));
+    }
+
+    if (suite.wants("mix/crossfade"))
+    {
+        mix::MixFn fn = mix::Best();
+        Meter m = MeasureKernel(o.seconds, samples * 4 * 3, o.frames, [&]
+                                { fn(acc.data(), in.data(), samples, 0.6f, 0.4f); });
+        suite.add(m.finish("mix/crossfade", MixKernelName(), o.channels));
+    }
+}
+
+static void BenchEq(Suite &suite)
+{
+    const Options &o = suite.opt;
+    if (o.channels > EqStage::kMaxChannels)
+        return;
+
+    // A typical 10-band graphic EQ with every band active
+    std::vector<BiquadBand> bands;
+    static const double freqs[] = {31, 62, 125, 250, 500, 1000, 2000, 4000, 8000, 16000};
+    for (size_t i = 0; i < 10; ++i)
+    {
+        BiquadBand b;
+        b.type = i == 0 ? BiquadBand::Type::LowShelf : i == 9 ? BiquadBand::Type::HighShelf
+                                                              : BiquadBand::Type::Peaking;
+        b.freq = freqs[i];
+        b.gainDb = (i & 1) ? 3.0 : -2.0;
+        bands.push_back(b);
+    }
+
+    size_t samples = o.frames * o.channels;
+    for (SampleFormat f : {SampleFormat::F32, SampleFormat::S16, SampleFormat::S32})
+    {
+        std::string name = std::string("eq10/") + FormatName(f);
+        if (!suite.wants(name))
+            continue;
+        EqStage eq;
+        eq.set(bands, 48000.0);
+        std::vector<uint8_t> buf(samples * SampleFormatBytes(f), 0);
+        // Low-level noise keeps the filters out of denormals
+        uint32_t seed = 1;
+        for (size_t i = 0; i < samples; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            int32_t v = static_cast<int32_t>(seed) >> 20;
+            if (f == SampleFormat::F32)
+                reinterpret_cast<float *>(buf.data())[i] = v / 4096.0f;
+            else if (f == SampleFormat::S16)
+                reinterpret_cast<int16_t *>(buf.data())[i] = static_cast<int16_t>(v);
+            else
+                reinterpret_cast<int32_t *>(buf.data())[i] = v << 16;
+        }
+        Meter m = MeasureKernel(o.seconds, buf.size() * 2, o.frames, [&]
+                                { eq.process(buf.data(), o.frames, o.channels, f); });
+        suite.add(m.finish(name, "-", o.channels));
+    }
+}
+
+static bool ParseArgs(int argc, char **argv, Options &o)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--json")
+            o.json = true;
+        else if (a == "--seconds" && hasValue)
+            o.seconds = std::atof(argv[++i]);
+        else if (a == "--frames" && hasValue)
+            o.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "--channels" && hasValue)
+            o.channels = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (a == "--filter" && hasValue)
+            o.filter = argv[++i];
+        else
+            return false;
+    }
+    return o.seconds > 0 && o.frames > 0 && o.channels > 0;
+}
+
+int main(int argc, char **argv)
+{
+    Options o;
+    if (!ParseArgs(argc, argv, o))
+    {
+        std::fprintf(stderr, "usage: %s [--seconds S] [--frames N] [--channels C] [--filter text] [--json]\n", argv[0]);
+        return 2;
+    }
+
+    Suite suite(o);
+    if (!o.json)
+        std::printf("%zu frames x %u ch per call, %.2fs per case, gain kernels: %s%s\n", o.frames, o.channels,
+                    o.seconds, gain::Best().name,
+#if defined(BENCH_TSC)
+                    ""
+#else
+                    " (no TSC: cycles not measured)"
+#endif
+        );
+
+    BenchRingCopy(suite);
+    BenchRingSpsc(suite);
+    BenchWriterBlocking(suite);
+    BenchConvert(suite);
+    BenchGain(suite);
+    BenchMix(suite);
+    BenchEq(suite);
+
+    if (o.json)
+        suite.printJson();
+    return 0;
+}
@@ -0,0 +1,172 @@
+// bench/ring_bench.cc
+//
+// Throughput / latency microbenchmark: RingBuffer (src/ring_buffer.h) against
+// the previous modulo-indexed implementation, with a producer thread writing
+// chunks and a consumer thread reading device-period sized blocks.
+//
+//   g++ -O2 -std=c++17 -pthread -Isrc bench/ring_bench.cc -o ring_bench
+//   (or npm run bench:native -> bench/build/Release/ring_bench)
+//   ./ring_bench [totalMiB] [chunkBytes] [periodBytes]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "ring_buffer.h"
+
+// The ring as it was before src/ring_buffer.h: adjacent indices, '%' wrap,
+// both atomics re-loaded on every call.
+struct LegacyRingBuffer
+{
+    std::vector<uint8_t> data;
+    size_t capacity{0};
+    std::atomic<size_t> readPos{0};
+    std::atomic<size_t> writePos{0};
+
+    void init(size_t size)
+    {
+        capacity = size ? size : 1;
+        data.assign(capacity, 0);
+        readPos.store(0);
+        writePos.store(0);
+    }
+
+    size_t write(const uint8_t *src, size_t len)
+    {
+        size_t r = readPos.load(std::memory_order_acquire);
+        size_t t = writePos.load(std::memory_order_relaxed);
+        size_t avail = (t >= r) ? (capacity - (t - r) - 1) : (r - t - 1);
+        if (avail == 0)
+            return 0;
+        if (len > avail)
+            len = avail;
+        size_t first = std::min(len, capacity - t);
+        std::memcpy(&data[t], src, first);
+        if (len > first)
+            std::memcpy(&data[0], src + first, len - first);
+        writePos.store((t + len) % capacity, std::memory_order_release);
+        return len;
+    }
+
+    size_t read(uint8_t *dst, size_t len)
+    {
+        size_t r = readPos.load(std::memory_order_relaxed);
+        size_t t = writePos.load(std::memory_order_acquire);
+        size_t avail = (t + capacity - r) % capacity;
+        if (avail == 0)
+            return 0;
+        if (len > avail)
+            len = avail;
+        size_t first = std::min(len, capacity - r);
+        std::memcpy(dst, &data[r], first);
+        if (len > first)
+            std::memcpy(dst + first, &data[0], len - first);
+        readPos.store((r + len) % capacity, std::memory_order_release);
+        return len;
+    }
+};
+
+struct Result
+{
+    double seconds{0};
+    double gbPerSec{0};
+    double writeP50{0}, writeP99{0};
+    double readP50{0}, readP99{0};
+};
+
+static double Percentile(std::vector<uint32_t> &v, double p)
+{
+    if (v.empty())
+        return 0.0;
+    size_t idx = static_cast<size_t>(p * static_cast<double>(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + idx, v.end());
+    return static_cast<double>(v[idx]);
+}
+
+template <typename Ring>
+static Result Run(size_t ringBytes, size_t totalBytes, size_t chunkBytes, size_t periodBytes)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Ring ring;
+    ring.init(ringBytes);
+
+    std::vector<uint8_t> src(chunkBytes, 0x5a);
+    std::vector<uint8_t> dst(periodBytes);
+    std::vector<uint32_t> writeNs, readNs;
+    writeNs.reserve(totalBytes / chunkBytes + 1);
+    readNs.reserve(totalBytes / periodBytes + 1);
+
+    std::atomic<bool> go{false};
+
+    std::thread consumer([&]
+                         {
+        while (!go.load()) {}
+        size_t got = 0;
+        while (got < totalBytes)
+        {
+            auto t0 = Clock::now();
+            size_t n = ring.read(dst.data(), std::min(periodBytes, totalBytes - got));
+            auto t1 = Clock::now();
+            if (n == 0)
+                continue;
+            readNs.push_back(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+            got += n;
+        } });
+
+    auto start = Clock::now();
+    go.store(true);
+
+    size_t sent = 0;
+    while (sent < totalBytes)
+    {
+        size_t want = std::min(chunkBytes, totalBytes - sent);
+        auto t0 = Clock::now();
+        size_t n = ring.write(src.data(), want);
+        auto t1 = Clock::now();
+        if (n == 0)
+            continue;
+        writeNs.push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+        sent += n;
+    }
+    consumer.join();
+
+    Result r;
+    r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    r.gbPerSec = static_cast<double>(totalBytes) / r.seconds / 1e9;
+    r.writeP50 = Percentile(writeNs, 0.50);
+    r.writeP99 = Percentile(writeNs, 0.99);
+    r.readP50 = Percentile(readNs, 0.50);
+    r.readP99 = Percentile(readNs, 0.99);
+    return r;
+}
+
+static void Print(const char *name, const Result &r)
+{
+    std::printf("%-8s %8.3f s %8.2f GB/s   write p50 %6.0f ns p99 %7.0f ns   read p50 %6.0f ns p99 %7.0f ns\n",
+                name, r.seconds, r.gbPerSec, r.writeP50, r.writeP99, r.readP50, r.readP99);
+}
+
+int main(int argc, char **argv)
+{
+    size_t totalMiB = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048;
+    size_t chunkBytes = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16384;
+    // 480 frames of 8ch/32-bit: a 2.5 ms period at 192 kHz
+    size_t periodBytes = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 480 * 32;
+    // 250 ms at 192 kHz/8ch/32-bit, the addon's default ring duration
+    size_t ringBytes = 192000 / 4 * 32;
+
+    size_t totalBytes = totalMiB << 20;
+    std::printf("ring %zu bytes, total %zu MiB, chunk %zu, period %zu\n",
+                ringBytes, totalMiB, chunkBytes, periodBytes);
+
+    Print("legacy", Run<LegacyRingBuffer>(ringBytes, totalBytes, chunkBytes, periodBytes));
+    Print("ring", Run<RingBuffer>(ringBytes, totalBytes, chunkBytes, periodBytes));
+    return 0;
+}
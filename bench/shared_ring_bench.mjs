@@ -0,0 +1,89 @@
+// bench/shared_ring_bench.mjs
+//
+// Chunks/second a producer can push into a native stream:
+//   - "write":  main thread calling native.write() per chunk (N-API + g_streams
+//               lookup + copy per chunk)
+//   - "shared": a worker_thread writing into the sharedRing SharedArrayBuffer
+//               with SharedRingProducer (no N-API call per chunk)
+//
+// Only time spent inside the write calls is counted, so the device draining
+// at real-time speed does not cap the result.
+//
+//   node bench/shared_ring_bench.mjs [chunkBytes] [seconds] [deviceId] [mode]
+import { Worker, isMainThread, workerData, parentPort } from 'node:worker_threads';
+import { performance } from 'node:perf_hooks';
+import { fileURLToPath } from 'node:url';
+
+const sleepCell = new Int32Array(new SharedArrayBuffer(4));
+const sleep = (ms) => Atomics.wait(sleepCell, 0, 0, ms);
+
+if (!isMainThread) {
+  const { SharedRingProducer } = await import('../sharedRing.js');
+  const { buffer, chunkBytes, seconds } = workerData;
+  const ring = new SharedRingProducer(buffer);
+  const chunk = new Uint8Array(chunkBytes);
+  let chunks = 0;
+  let busy = 0;
+  const end = performance.now() + seconds * 1000;
+  while (performance.now() < end) {
+    if (ring.free() < chunkBytes) {
+      sleep(1);
+      continue;
+    }
+    const t0 = performance.now();
+    ring.write(chunk);
+    busy += performance.now() - t0;
+    chunks++;
+  }
+  parentPort.postMessage({ chunks, busyMs: busy });
+} else {
+  const { default: exclusive } = await import('../exclusiveAudio.js');
+  const chunkBytes = Number(process.argv[2] || 4096);
+  const seconds = Number(process.argv[3] || 5);
+  const deviceId = process.argv[4] || null;
+  const mode = process.argv[5] || 'shared';
+  const base = { deviceId, mode, sampleRate: 48000, channels: 2, bitDepth: 16, bufferMs: 2000 };
+
+  const report = (name, chunks, busyMs) => {
+    const perSec = busyMs > 0 ? (chunks * 1000) / busyMs : 0;
+    console.log(`${name.padEnd(7)} ${String(chunks).padStart(9)} chunks  ${busyMs.toFixed(1).padStart(9)} ms in calls  ${perSec.toFixed(0).padStart(12)} chunks/s  ${((busyMs * 1e6) / Math.max(1, chunks)).toFixed(0).padStart(7)} ns/chunk`);
+  };
+
+  console.log(`chunk ${chunkBytes} bytes, ${seconds} s per run`);
+
+  // N-API write() from the main thread
+  {
+    const out = exclusive.openOutput(base);
+    const chunk = Buffer.alloc(chunkBytes);
+    let chunks = 0;
+    let busy = 0;
+    const end = performance.now() + seconds * 1000;
+    while (performance.now() < end) {
+      const t0 = performance.now();
+      const n = exclusive.write(out.handle, chunk, false);
+      const dt = performance.now() - t0;
+      if (n < chunkBytes) {
+        sleep(1);
+        continue;
+      }
+      busy += dt;
+      chunks++;
+    }
+    exclusive.close(out.handle);
+    report('write', chunks, busy);
+  }
+
+  // SharedArrayBuffer ring from a worker
+  {
+    const out = exclusive.openOutput({ ...base, sharedRing: true });
+    const result = await new Promise((resolve, reject) => {
+      const w = new Worker(fileURLToPath(import.meta.url), {
+        workerData: { buffer: out.sharedRing.buffer, chunkBytes, seconds },
+      });
+      w.once('message', resolve);
+      w.once('error', reject);
+    });
+    exclusive.close(out.handle);
+    report('shared', result.chunks, result.busyMs);
+  }
+}
@@ -2,8 +2,13 @@
   "targets": [
     {
       "target_name": "exclusive_audio",
+      "variables": {
+        # Native PipeWire backend alongside ALSA when libpipewire is installed
+        "pipewire%": "<!(node -e \"try{require('child_process').execSync('pkg-config --exists libpipewire-0.3',{stdio:'ignore'});console.log(1)}catch(e){console.log(0)}\")"
+      },
       "sources": [
-        "src/exclusive_audio.cc"
+        "src/exclusive_audio.cc",
+        "src/file_decoder.cc"
       ],
       "include_dirs": [
         "<!(node -e \"console.log(require('node-addon-api').include_dir)\")"
@@ -22,7 +27,8 @@
           "defines": [ "EXCLUSIVE_WIN32" ],
           "libraries": [
             "ole32.lib",
-            "avrt.lib"
+            "avrt.lib",
+            "synchronization.lib"
           ]
         }],
         [ "OS=='mac'", {
@@ -42,6 +48,15 @@
           "libraries": [
             "-lasound"
           ]
+        }],
+        [ "OS=='linux' and pipewire==1", {
+          "defines": [ "EXCLUSIVE_PIPEWIRE" ],
+          "cflags_cc": [
+            "<!@(pkg-config --cflags libpipewire-0.3)"
+          ],
+          "libraries": [
+            "<!@(pkg-config --libs libpipewire-0.3)"
+          ]
         }]
       ]
     }
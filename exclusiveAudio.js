@@ -65,11 +65,59 @@ if (!native) {
     write: () => { throw new Error('native addon not loaded'); },
     drain: () => {},
     close: () => {},
+    openOutputAsync: () => Promise.reject(new Error('native addon not loaded')),
+    drainAsync: () => Promise.resolve('stopped'),
+    closeAsync: () => Promise.resolve(false),
+    cancelAsync: () => false,
+  };
+}
+
+// Fills in defaults and builds the options object native.openOutput() and
+// native.openOutputAsync() take.
+function nativeOpenOptions(opts) {
+  const bitDepth = opts.bitDepth || 32;
+  return {
+    deviceId: opts.deviceId || null,
+    sampleRate: opts.sampleRate || 44100,
+    channels: opts.channels || 2,
+    bitDepth,
+    mode: opts.mode || 'shared',
+    bufferMs: opts.bufferMs || 250,
+    bitPerfect: !!opts.bitPerfect,
+    strictBitPerfect: !!opts.strictBitPerfect,
+    // 32-bit writes are f32le unless floatSamples is false (s32le)
+    floatSamples: opts.floatSamples ?? bitDepth === 32,
+    // Render thread scheduling (Linux): realtime true | 'fifo' | 'rr',
+    // realtimePriority, cpuAffinity [cpu, ...], lockMemory; raiseRealtimeLimits
+    // lets it raise the process-wide RLIMIT_RTPRIO/RTTIME
+    ...(opts.realtime !== undefined ? { realtime: opts.realtime } : {}),
+    ...(opts.realtimePriority !== undefined ? { realtimePriority: opts.realtimePriority } : {}),
+    ...(Array.isArray(opts.cpuAffinity) ? { cpuAffinity: opts.cpuAffinity } : {}),
+    ...(opts.lockMemory !== undefined ? { lockMemory: !!opts.lockMemory } : {}),
+    ...(opts.raiseRealtimeLimits !== undefined ? { raiseRealtimeLimits: !!opts.raiseRealtimeLimits } : {}),
+    // Hardware buffer: latencyClass 'ultra-low' | 'low' | 'balanced' |
+    // 'power-save', refined by periodFrames, periods and hwBufferMs
+    ...(opts.latencyClass !== undefined ? { latencyClass: opts.latencyClass } : {}),
+    ...(opts.periodFrames !== undefined ? { periodFrames: opts.periodFrames } : {}),
+    ...(opts.periods !== undefined ? { periods: opts.periods } : {}),
+    ...(opts.hwBufferMs !== undefined ? { hwBufferMs: opts.hwBufferMs } : {}),
+    // mode 'null' (no device): clock 'realtime' | 'fast', wavPath,
+    // xrunEveryPeriods, jitterMs, seed
+    ...(opts.nullSink ? { nullSink: opts.nullSink } : {}),
+    // Linux output path: 'alsa' (default), 'pipewire' or 'auto'
+    ...(opts.backend ? { backend: opts.backend } : {}),
+    // Mixing bus: streams opened with the same bus name share one device
+    // (opened with the first member's options) and are mixed natively
+    ...(opts.bus ? { bus: String(opts.bus) } : {}),
+    // Render-loop trace for dumpTrace(): true or a record count
+    ...(opts.trace ? { trace: opts.trace } : {}),
   };
 }
 
 class ExclusiveStream extends Writable {
-  constructor(handleOrOptions) {
+  // `opened` is an openOutputAsync() result for ExclusiveStream.open();
+  // without it the device is opened here, on the calling thread.
+  constructor(handleOrOptions, opened = null) {
     super({ highWaterMark: 0 }); // We handle backpressure manually via native.write
     this._handle = 0;
     this._closed = false;
@@ -80,36 +128,99 @@ class ExclusiveStream extends Writable {
       opts = handleOrOptions || {};
     }
 
-    this.deviceId = opts.deviceId || null;
-      this.sampleRate = opts.sampleRate || 44100;
-    this.channels = opts.channels || 2;
-    this.bitDepth = opts.bitDepth || 32;
-    this.mode = opts.mode || 'shared';
-    this.bufferMs = opts.bufferMs || 250;
-    this.bitPerfect = !!opts.bitPerfect;
-    this.strictBitPerfect = !!opts.strictBitPerfect;
-
-    const result = native.openOutput({
-      deviceId: this.deviceId,
-      sampleRate: this.sampleRate,
-      channels: this.channels,
-      bitDepth: this.bitDepth,
-      mode: this.mode,
-      bufferMs: this.bufferMs,
-      bitPerfect: this.bitPerfect,
-      strictBitPerfect: this.strictBitPerfect,
-    });
+    const openOptions = nativeOpenOptions(opts);
+    this.deviceId = openOptions.deviceId;
+    this.sampleRate = openOptions.sampleRate;
+    this.channels = openOptions.channels;
+    this.bitDepth = openOptions.bitDepth;
+    this.mode = openOptions.mode;
+    this.bufferMs = openOptions.bufferMs;
+    this.bitPerfect = openOptions.bitPerfect;
+    this.strictBitPerfect = openOptions.strictBitPerfect;
+    this.floatSamples = openOptions.floatSamples;
+
+    const result = opened || native.openOutput(openOptions);
 
     this.handle = result.handle;
     this.actualSampleRate = result.sampleRate;
     this.actualChannels = result.channels;
     this.actualBitDepth = result.bitDepth;
+    // What the device runs at; the addon converts from actualBitDepth
+    this.deviceFormat = result.deviceFormat;
+    this.backend = result.backend;
+    this.bus = result.bus || null;
+    // Audio the ring holds when full
+    this.ringDurationMs = result.ringDurationMs || this.bufferMs;
+    // Negotiated hardware buffer (Linux); may differ from what was asked for
+    this.latencyClass = result.latencyClass;
+    this.periodFrames = result.periodFrames;
+    this.periods = result.periods;
+    this.hwBufferMs = result.hwBufferMs;
     this.totalBytesWritten = 0;
     
-    console.log(`[ExclusiveStream] Opened: handle=${this.handle}, rate=${this.actualSampleRate}, ch=${this.actualChannels}, depth=${this.actualBitDepth}`);
+    console.log(`[ExclusiveStream] Opened: handle=${this.handle}, rate=${this.actualSampleRate}, ch=${this.actualChannels}, depth=${this.actualBitDepth}, device=${this.deviceFormat}`);
+  }
+
+  // As new ExclusiveStream(options), with the device opened on a native
+  // worker (see openOutputAsync for signal and timeoutMs).
+  static async open(options = {}, control = {}) {
+    if (typeof native.openOutputAsync !== 'function') return new ExclusiveStream(options);
+    const result = await openOutputAsync(nativeOpenOptions(options || {}), control);
+    return new ExclusiveStream(options, result);
+  }
+
+  // Audible position: frames that have reached the DAC, published by the
+  // render thread each period. timestampNs is on the process.hrtime.bigint()
+  // clock, so callers can interpolate between periods:
+  //   seconds + (Number(process.hrtime.bigint()) - timestampNs) / 1e9
+  getPosition() {
+    if (this._closed || typeof native.getPosition !== 'function') return null;
+    return native.getPosition(this.handle);
+  }
+
+  // Native playback events, emitted on this stream under their own names:
+  // 'low-watermark', 'underrun', 'played-out', 'device-lost',
+  // 'format-changed' and 'position', each with the event object
+  // ({ type, frames, timestampNs, ... }). Delivered in batches from the
+  // render thread, in place of polling getStats(). Options: lowWatermarkMs,
+  // positionIntervalMs. Once subscribed, end() finishes when the last frame
+  // has played instead of blocking on drain().
+  subscribeEvents(options = {}) {
+    if (this._closed || typeof native.subscribe !== 'function') return false;
+    native.subscribe(this.handle, (events, dropped) => {
+      for (const e of events) this.emit(e.type, e);
+      if (dropped) console.warn(`[ExclusiveStream] ${dropped} native events dropped`);
+    }, options);
+    this.eventsSubscribed = true;
+    return true;
+  }
+
+  unsubscribeEvents() {
+    if (!this.eventsSubscribed) return;
+    this.eventsSubscribed = false;
+    if (!this._closed) native.unsubscribe(this.handle);
+  }
+
+  // Writes the render trace (stream opened with trace) as Chrome trace
+  // JSON for chrome://tracing or ui.perfetto.dev. Returns the event count.
+  dumpTrace(filePath) {
+    if (this._closed) return 0;
+    if (typeof native.dumpTrace !== 'function') throw new Error('native dumpTrace not available');
+    return native.dumpTrace(this.handle, filePath);
+  }
+
+  // Render-loop telemetry as a Float64Array laid out per telemetryLayout
+  // (underruns, xruns, short writes, fill/jitter/render histograms). The
+  // array is reused across calls; copy out anything you keep.
+  readTelemetry() {
+    if (this._closed || typeof native.readTelemetry !== 'function') return null;
+    if (!this._telemetry) this._telemetry = new Float64Array(native.telemetryLayout.size);
+    return native.readTelemetry(this.handle, this._telemetry) ? this._telemetry : null;
   }
 
   getElapsedTime() {
+    const pos = this.getPosition();
+    if (pos) return pos.seconds;
     if (!this.actualSampleRate || !this.actualChannels || !this.actualBitDepth) return 0;
     const bytesPerSample = this.actualBitDepth / 8;
     const bytesPerFrame = this.actualChannels * bytesPerSample;
@@ -153,10 +264,154 @@ _write(chunk, encoding, callback) {
   }
 }
 
+  // Batched chunks queued while a write was in flight go down in one native
+  // call; the addon pins the Buffers instead of copying them.
+  _writev(chunks, callback) {
+    if (this._closed) return callback();
+    if (typeof native.writev !== 'function') {
+      return this._write(Buffer.concat(chunks.map((c) => c.chunk)), null, callback);
+    }
+
+    let doneCalled = false;
+    const done = (err) => {
+      if (doneCalled) return;
+      doneCalled = true;
+      callback(err);
+    };
+
+    try {
+      native.writev(this.handle, chunks.map((c) => c.chunk), (err, written) => {
+        if (this._closed) return done();
+
+        if (err) {
+          this._closeNative();
+          return done(new Error(err));
+        }
+
+        if (written < 0) {
+          this._closeNative();
+          return done(new Error("exclusive audio write failed (device lost?)"));
+        }
+
+        this.totalBytesWritten += written;
+        return done();
+      }, true);
+    } catch (e) {
+      try { this._closeNative(); } catch {}
+      return done(e instanceof Error ? e : new Error(String(e)));
+    }
+  }
+
+  // Decodes a local WAV/AIFF/FLAC file on a native thread straight into this
+  // stream's ring. Throws if the file is unsupported; the stream then refuses
+  // write() until closed. A file at another sample rate is resampled to the
+  // stream's at options.resampleQuality ('fast' | 'good' | 'high' |
+  // 'mastering', default 'high').
+  openFile(filePath, options = {}) {
+    if (this._closed) throw new Error('stream is closed');
+    if (typeof native.openFile !== 'function') throw new Error('native openFile not available');
+    return native.openFile(this.handle, filePath, options);
+  }
+
+  // Appends a file behind the one openFile() is decoding; the decoder moves
+  // straight on to it so there is no gap at the boundary. options:
+  // { trimStartFrames, trimEndFrames } to drop encoder delay / padding.
+  // Returns the same info as openFile(), including its `segment` id.
+  queueFile(filePath, options = {}) {
+    if (this._closed) throw new Error('stream is closed');
+    if (typeof native.queueFile !== 'function') throw new Error('native queueFile not available');
+    return native.queueFile(this.handle, filePath, options);
+  }
+
+  // For PCM written through write(): the next byte written starts a new
+  // segment. Call it after the previous track's writes have completed.
+  markSegment() {
+    if (this._closed) throw new Error('stream is closed');
+    if (typeof native.markSegment !== 'function') throw new Error('native markSegment not available');
+    return native.markSegment(this.handle);
+  }
+
+  // Collects the segment boundaries the render thread has crossed and emits
+  // 'segment' ({segment, frame, timestampNs}) for each. The boundary is
+  // audible once getPosition().frames >= frame.
+  pollSegments() {
+    if (this._closed || typeof native.pollSegments !== 'function') return [];
+    const crossed = native.pollSegments(this.handle);
+    for (const c of crossed) this.emit('segment', c);
+    return crossed;
+  }
+
+  // Sets the render-thread volume (1.0 = unity, bit-perfect). The change is
+  // ramped over rampMs ('linear' or 'exponential') to avoid zipper noise.
+  setGain(value, rampMs = 0, curve = 'linear') {
+    if (this._closed) return;
+    if (typeof native.setGain !== 'function') throw new Error('native setGain not available');
+    return native.setGain(this.handle, value, rampMs, curve);
+  }
+
+  // Sets the render-thread parametric EQ: either 10 gains in dB (graphic EQ
+  // at 32 Hz .. 16 kHz) or up to 32 {freq, gain, q, type} bands. null or []
+  // turns it off. Applies within one device period; returns the active band
+  // count (0 when flat).
+  setEq(bands) {
+    if (this._closed) return 0;
+    if (typeof native.setEq !== 'function') throw new Error('native setEq not available');
+    return native.setEq(this.handle, bands ?? null);
+  }
+
+  // Crossfades files queued with queueFile() over `ms` milliseconds
+  // (equal-power, up to 10 s) instead of joining them gaplessly. 0 turns it
+  // off. Returns the length in effect.
+  setCrossfade(ms) {
+    if (this._closed) return 0;
+    if (typeof native.setCrossfade !== 'function') throw new Error('native setCrossfade not available');
+    return native.setCrossfade(this.handle, Number(ms) || 0);
+  }
+
   _final(callback) {
     console.log('[ExclusiveStream] _final called');
     if (this._closed) return callback();
 
+    if (this.eventsSubscribed) {
+      // Close once the device has played the tail, without blocking the
+      // main thread in drain()
+      let finished = false;
+      let timer = null;
+      const done = () => {
+        if (finished) return;
+        finished = true;
+        clearTimeout(timer);
+        this.off('played-out', done);
+        this.off('device-lost', done);
+        this._closeNative();
+        callback();
+      };
+      this.on('played-out', done);
+      this.on('device-lost', done);
+      native.markEnd(this.handle);
+      // Fallback for a stream that never plays out (paused, render thread
+      // stalled): once the ring has drained or the bound passed, give the
+      // device buffer its time to play, then close anyway
+      if (typeof native.drainAsync === 'function') {
+        drainAsync(this.handle, { timeoutMs: this._drainTimeoutMs() })
+          .catch(() => {})
+          .then(() => {
+            if (!finished) timer = setTimeout(done, Math.ceil((this.hwBufferMs || 0) + 500));
+          });
+      }
+      return;
+    }
+
+    if (typeof native.drainAsync === 'function') {
+      drainAsync(this.handle, { timeoutMs: this._drainTimeoutMs() })
+        .catch((e) => console.error('[ExclusiveStream] drain error:', e))
+        .then(() => {
+          this._closeNative();
+          callback();
+        });
+      return;
+    }
+
     try {
       native.drain(this.handle);
     } catch (e) {
@@ -166,14 +421,29 @@ _write(chunk, encoding, callback) {
     callback();
   }
 
+  // Longest a full ring can take to play out, with slack for the device
+  // buffer and scheduling. A paused stream or a stalled render thread is
+  // closed after this rather than holding a worker thread.
+  _drainTimeoutMs() {
+    return Math.ceil(this.ringDurationMs + (this.hwBufferMs || 0) + 1000);
+  }
+
+  // The handle is dead as soon as this returns; the device itself is
+  // stopped on a native worker where the addon supports it, and the next
+  // openOutputAsync() waits for that.
   _closeNative() {
     if (this._closed) return;
+    this._closed = true;
+    if (!this.handle) return;
+    if (typeof native.closeAsync === 'function') {
+      closeAsync(this.handle).catch((e) => console.error('[ExclusiveStream] close error:', e));
+      return;
+    }
     try {
-      if (this.handle) native.close(this.handle);
+      native.close(this.handle);
     } catch (_) {
       // ignore
     }
-    this._closed = true;
   }
 
   pause() {
@@ -239,6 +509,53 @@ function write(handle, buffer, blocking = false) {
   return native.write(handle, buffer, blocking);
 }
 
+function writev(handle, buffers, callback, blocking = true) {
+  return native.writev(handle, buffers, callback, blocking);
+}
+
+// Format of a file the native decoder can play ({ codec, sampleRate,
+// channels, bitDepth, totalFrames }), or null if it cannot
+function probeFile(filePath) {
+  if (typeof native.probeFile !== 'function') return null;
+  try {
+    return native.probeFile(filePath);
+  } catch {
+    return null;
+  }
+}
+
+function openFile(handle, filePath, options = {}) {
+  return native.openFile(handle, filePath, options);
+}
+
+function queueFile(handle, filePath, options = {}) {
+  return native.queueFile(handle, filePath, options);
+}
+
+function markSegment(handle) {
+  return native.markSegment(handle);
+}
+
+function pollSegments(handle) {
+  return native.pollSegments(handle);
+}
+
+function setGain(handle, value, rampMs = 0, curve = 'linear') {
+  return native.setGain(handle, value, rampMs, curve);
+}
+
+function setEq(handle, bands) {
+  return native.setEq(handle, bands ?? null);
+}
+
+function setCrossfade(handle, ms) {
+  return native.setCrossfade(handle, ms);
+}
+
+function getPosition(handle) {
+  return native.getPosition(handle);
+}
+
 function drain(handle) {
   return native.drain(handle);
 }
@@ -246,16 +563,157 @@ function drain(handle) {
 function close(handle) {
   return native.close(handle);
 }
+
+// Promise-returning lifecycle calls: the device open, the wait for the ring
+// to play out and the device stop run on a native worker, not on this
+// thread. signal (an AbortSignal) and timeoutMs reject with an AbortError
+// or TimeoutError.
+
+let lastOperationId = 0;
+// Device releases still under way: closeAsync() calls, and opens the
+// caller gave up on (closed again once they come up)
+const pendingCloses = new Set();
+
+function nextOperationId() {
+  lastOperationId = (lastOperationId % 0xffffffff) + 1;
+  return lastOperationId;
+}
+
+function abortError(signal) {
+  if (signal?.reason !== undefined) return signal.reason;
+  return Object.assign(new Error('The operation was aborted'), { name: 'AbortError', code: 'ABORT_ERR' });
+}
+
+// Settles once every close started so far has let go of its device
+function trackRelease(promise) {
+  const settled = promise.then(() => undefined, () => undefined);
+  pendingCloses.add(settled);
+  settled.then(() => pendingCloses.delete(settled));
+  return promise;
+}
+
+function whenClosed() {
+  return Promise.allSettled([...pendingCloses]).then(() => undefined);
+}
+
+// Resolves with the openOutput() result. Waits for pending closeAsync()
+// calls first so an exclusive device is free again. On abort or timeout the
+// promise rejects at once; the native open cannot be interrupted, so the
+// stream it brings up is closed again as soon as it is done, and until
+// then later opens wait for it as for a close.
+async function openOutputAsync(options, { signal, timeoutMs = 0 } = {}) {
+  if (signal?.aborted) throw abortError(signal);
+  await whenClosed();
+  if (signal?.aborted) throw abortError(signal);
+
+  const id = nextOperationId();
+  const pending = native.openOutputAsync(options, { id });
+  let gaveUp = false;
+  let timer = null;
+  let onAbort = null;
+  const stopped = new Promise((_, reject) => {
+    const giveUp = (err) => {
+      if (gaveUp) return;
+      gaveUp = true;
+      native.cancelAsync(id);
+      trackRelease(pending.then((result) => native.closeAsync(result.handle)));
+      reject(err);
+    };
+    if (timeoutMs > 0) {
+      timer = setTimeout(() => giveUp(Object.assign(
+        new Error(`openOutputAsync timed out after ${timeoutMs} ms`), { name: 'TimeoutError' })), timeoutMs);
+    }
+    if (signal) {
+      onAbort = () => giveUp(abortError(signal));
+      signal.addEventListener('abort', onAbort, { once: true });
+    }
+  });
+  try {
+    return await Promise.race([pending, stopped]);
+  } finally {
+    clearTimeout(timer);
+    if (onAbort) signal.removeEventListener('abort', onAbort);
+  }
+}
+
+// Resolves 'drained' once the ring has played out, 'stopped' if the stream
+// stopped (or was closed) first, or 'timeout' after timeoutMs.
+async function drainAsync(handle, { signal, timeoutMs = 0 } = {}) {
+  if (signal?.aborted) throw abortError(signal);
+  const id = nextOperationId();
+  const onAbort = () => native.cancelAsync(id);
+  signal?.addEventListener('abort', onAbort, { once: true });
+  try {
+    const result = await native.drainAsync(handle, { id, timeoutMs });
+    if (result === 'cancelled') throw abortError(signal);
+    return result;
+  } finally {
+    signal?.removeEventListener('abort', onAbort);
+  }
+}
+
+// The handle is invalid from the moment this is called. Resolves true once
+// the render thread and device are stopped, false if the handle was not open.
+function closeAsync(handle) {
+  return trackRelease(native.closeAsync(handle));
+}
+
+function openExclusiveStream(options, control) {
+  return ExclusiveStream.open(options, control);
+}
 function getStats(handle) {
   return native.getStats(handle);
 }
+
+function subscribe(handle, callback, options) {
+  return native.subscribe(handle, callback, options);
+}
+
+function unsubscribe(handle) {
+  return native.unsubscribe(handle);
+}
+
+function markEnd(handle) {
+  return native.markEnd(handle);
+}
+
+function dumpTrace(handle, filePath) {
+  return native.dumpTrace(handle, filePath);
+}
+
+function readTelemetry(handle, out) {
+  return native.readTelemetry(handle, out);
+}
+
+const telemetryLayout = native.telemetryLayout ?? null;
 export default {
   createExclusiveStream,
+  openExclusiveStream,
   getDevices,
   isSupported,
   openOutput,
   write,
+  writev,
+  probeFile,
+  openFile,
+  queueFile,
+  markSegment,
+  pollSegments,
+  setGain,
+  setEq,
+  setCrossfade,
+  getPosition,
   drain,
   close,
+  openOutputAsync,
+  drainAsync,
+  closeAsync,
+  whenClosed,
   getStats,
+  subscribe,
+  unsubscribe,
+  markEnd,
+  dumpTrace,
+  readTelemetry,
+  telemetryLayout,
 };
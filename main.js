@@ -124,6 +124,9 @@ function loadAppSettings() {
       if (appSettings.eq) {
         audioEngine.setEQ(appSettings.eq);
       }
+      if (appSettings.crossfadeMs) {
+        audioEngine.setCrossfade(appSettings.crossfadeMs);
+      }
     } else {
       console.log('[settings] No app settings found, using defaults');
     }
@@ -771,6 +774,37 @@ const handlers = {
         });
     }
   },
+  // The renderer's upcoming track, so the engine can start it gaplessly on
+  // the open stream. false means it will arrive through audio:play instead.
+  'audio:queue-next': async (filePath, options = {}) => {
+    try {
+      const playPath = await resolveTrackPath(filePath);
+      const track = options.track || db.getTrackByPath(filePath) || { path: filePath, title: path.basename(filePath) };
+      return audioEngine.queueNext(playPath, () => {
+        emitPluginEvent('track-stopped', track);
+        broadcast('audio:ended');
+        broadcastState();
+      }, (err) => {
+        console.error('Playback error:', err);
+        broadcast('audio:error', {
+          message: String(err && err.message ? err.message : err),
+          filePath: playPath,
+          track
+        });
+        broadcastState();
+      }, {
+        track,
+        onStart: () => {
+          currentTrackMetadata = track;
+          emitPluginEvent('track-started', track);
+          broadcastState();
+        }
+      });
+    } catch (e) {
+      console.warn('[main] audio:queue-next failed:', e);
+      return false;
+    }
+  },
   'audio:get-devices': () => audioEngine.getDevices(),
   'audio:get-status': () => {
     try {
@@ -805,6 +839,13 @@ const handlers = {
     appSettings.eq = audioEngine.getEQ();
     saveAppSettings();
   },
+  // Crossfade between queued tracks (ms, 0 = gapless)
+  'audio:get-crossfade': () => audioEngine.getCrossfade(),
+  'audio:set-crossfade': (ms) => {
+    appSettings.crossfadeMs = audioEngine.setCrossfade(ms);
+    saveAppSettings();
+    return appSettings.crossfadeMs;
+  },
   // Playlists
   'playlists:create': (name) => db.createPlaylist(name),
   'playlists:list': () => db.getAllPlaylists(),
@@ -26,6 +26,9 @@ contextBridge.exposeInMainWorld('electron', {
   showTrackContextMenu: (tracks) => ipcRenderer.invoke('context-menu:show-track', tracks),
   showAlbumContextMenu: (albumInfo) => ipcRenderer.invoke('context-menu:show-album', albumInfo),
   playTrack: (path, options) => ipcRenderer.invoke('audio:play', path, options),
+  queueNextTrack: (path, options) => ipcRenderer.invoke('audio:queue-next', path, options),
+  getCrossfade: () => ipcRenderer.invoke('audio:get-crossfade'),
+  setCrossfade: (ms) => ipcRenderer.invoke('audio:set-crossfade', ms),
   pause: () => ipcRenderer.invoke('audio:pause'),
   resume: () => ipcRenderer.invoke('audio:resume'),
   getAudioStatus: () => ipcRenderer.invoke('audio:get-status'),
@@ -2065,6 +2065,8 @@ const playTrack = async (track, opts = {}) => {
     await electron.resume();
   } else {
     await electron.playTrack(track.path, playbackOptions);
+    gaplessQueuedFor = null;
+    pendingNextTrack = null;
   }
 
   isPlaying = true;
@@ -2072,6 +2074,7 @@ const playTrack = async (track, opts = {}) => {
   updateNowPlaying();
   renderLibrary(); // Update active state
   updatePlayButton();
+  void queueGaplessNext();
 };
 
 // Show a simple playback error notification with option to relink file
@@ -2681,6 +2684,11 @@ const syncState = (state) => {
       updateNowPlaying();
       showNowPlaying();
       renderLibrary();
+      // A gapless transition moved us onto the queued track; queue the next
+      if (isPlaying) {
+        pendingNextTrack = null;
+        void queueGaplessNext();
+      }
   } else if (state.track && currentTrack) {
       // Even if same track, ensure the now playing bar is visible
       showNowPlaying();
@@ -2694,14 +2702,11 @@ const syncState = (state) => {
   }
 };
 
-// Advance playback to the next track based on current context (playlist vs library)
-async function advanceToNext() {
-  if (!currentTrack) return;
-  // If repeat one, restart same track
-  if (repeatMode === 'one') {
-    try { await playTrack(currentTrack); } catch (e) { console.warn('advanceToNext replay failed', e); }
-    return;
-  }
+// Pick the track that follows currentTrack in the current context (playlist
+// vs library). Shuffle picks at random; null at the end without repeat.
+function pickNextTrack() {
+  if (!currentTrack) return null;
+  if (repeatMode === 'one') return currentTrack;
 
   // Determine source list
   let sourceList = [];
@@ -2713,34 +2718,57 @@ async function advanceToNext() {
     sourceList = libraryCache;
   }
 
-  if (!sourceList || sourceList.length === 0) return;
-
-  // Find current index in sourceList
-  let idx = sourceList.findIndex(t => (t.id && currentTrack.id && t.id === currentTrack.id) || (t.path && currentTrack.path && t.path === currentTrack.path));
+  if (!sourceList || sourceList.length === 0) return null;
 
   // Shuffle handling
   if (shuffleEnabled) {
     const randIdx = Math.floor(Math.random() * sourceList.length);
-    const next = sourceList[randIdx];
-    if (next) await playTrack(next);
-    return;
+    return sourceList[randIdx] || null;
   }
 
+  // Find current index in sourceList
+  let idx = sourceList.findIndex(t => (t.id && currentTrack.id && t.id === currentTrack.id) || (t.path && currentTrack.path && t.path === currentTrack.path));
+
   // Next index
   if (idx === -1) idx = 0;
   const nextIdx = idx + 1;
-  if (nextIdx < sourceList.length) {
-    await playTrack(sourceList[nextIdx]);
+  if (nextIdx < sourceList.length) return sourceList[nextIdx];
+  // End of list
+  return repeatMode === 'all' ? sourceList[0] : null;
+}
+
+// The track handed to the engine for gapless playback, so a shuffle pick
+// stays the same if the engine declines and we advance the usual way
+let pendingNextTrack = null;
+let gaplessQueuedFor = null;
+
+// Offer the upcoming track to the engine so it can start on the open stream
+// without a gap. If it declines, advanceToNext() plays it when this one ends.
+async function queueGaplessNext() {
+  if (!currentTrack || typeof electron.queueNextTrack !== 'function') return;
+  if (gaplessQueuedFor === currentTrack.id) return;
+  gaplessQueuedFor = currentTrack.id;
+  pendingNextTrack = pickNextTrack();
+  if (!pendingNextTrack || !pendingNextTrack.path) return;
+  try {
+    await electron.queueNextTrack(pendingNextTrack.path, { track: pendingNextTrack });
+  } catch (e) {
+    console.warn('queueNextTrack failed', e);
+  }
+}
+
+// Advance playback to the next track
+async function advanceToNext() {
+  if (!currentTrack) return;
+  const next = pendingNextTrack || pickNextTrack();
+  pendingNextTrack = null;
+  if (next) {
+    try { await playTrack(next); } catch (e) { console.warn('advanceToNext failed', e); }
   } else {
-    // End of list
-    if (repeatMode === 'all') {
-      await playTrack(sourceList[0]);
-    } else {
-      // stop playback
-      try { await electron.pause(); } catch {}
-      isPlaying = false;
-      updatePlayButton();
-    }
+    // stop playback
+    try { await electron.pause(); } catch {}
+    isPlaying = false;
+    updatePlayButton();
   }
 }
 
@@ -266,6 +266,9 @@ globalThis.electron = {
   // Audio playback is handled by the server (main process), not the browser.
   // The browser sends a command to the server to play the audio on the host machine.
   playTrack: (path, options) => invoke('audio:play', path, options),
+  queueNextTrack: (path, options) => invoke('audio:queue-next', path, options),
+  getCrossfade: () => invoke('audio:get-crossfade'),
+  setCrossfade: (ms) => invoke('audio:set-crossfade', ms),
   pause: () => invoke('audio:pause'),
   resume: () => invoke('audio:resume'),
   getAudioStatus: () => invoke('audio:get-status'),
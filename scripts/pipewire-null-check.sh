@@ -0,0 +1,94 @@
+#!/usr/bin/env bash
+# Runs the PipeWire backend against a private PipeWire daemon with a null
+# sink, so it can be checked on a machine (or CI runner) with no sound card.
+#
+# Starts pipewire and wireplumber on a throwaway XDG_RUNTIME_DIR, creates a
+# null sink node, then drives it with bench/engine_load (the headless engine)
+# in exclusive and shared mode. Fails if a stream cannot open, the graph
+# never calls the render thread, or the device reports xruns.
+#
+#   bash scripts/pipewire-null-check.sh [seconds]
+#
+# Needs pipewire, wireplumber, pw-cli and the libpipewire-0.3 / libasound
+# development files. ENGINE_LOAD=path skips building engine_load.
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+SECONDS_PER_RUN="${1:-5}"
+SINK=spectra-null
+
+for tool in pipewire wireplumber pw-cli pkg-config node; do
+  command -v "$tool" >/dev/null || { echo "[pipewire-null-check] $tool not found" >&2; exit 2; }
+done
+
+WORK="$(mktemp -d)"
+PIDS=()
+cleanup() {
+  for pid in "${PIDS[@]}"; do kill "$pid" 2>/dev/null || true; done
+  wait 2>/dev/null || true
+  rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+ENGINE_LOAD="${ENGINE_LOAD:-}"
+if [ -z "$ENGINE_LOAD" ]; then
+  echo "[pipewire-null-check] building engine_load"
+  ENGINE_LOAD="$WORK/engine_load"
+  # shellcheck disable=SC2046
+  g++ -O2 -g -std=c++17 -pthread -DEXCLUSIVE_HEADLESS -DEXCLUSIVE_PIPEWIRE -Isrc \
+    $(pkg-config --cflags libpipewire-0.3) \
+    src/exclusive_audio.cc src/file_decoder.cc bench/engine_load.cc \
+    $(pkg-config --libs libpipewire-0.3) -lasound -o "$ENGINE_LOAD"
+fi
+
+# A daemon of our own: nothing from the user's session leaks in
+export XDG_RUNTIME_DIR="$WORK/run"
+mkdir -m 700 "$XDG_RUNTIME_DIR"
+unset PIPEWIRE_REMOTE
+
+pipewire >"$WORK/pipewire.log" 2>&1 &
+PIDS+=($!)
+for _ in $(seq 50); do
+  [ -S "$XDG_RUNTIME_DIR/pipewire-0" ] && break
+  sleep 0.1
+done
+[ -S "$XDG_RUNTIME_DIR/pipewire-0" ] || { cat "$WORK/pipewire.log" >&2; echo "[pipewire-null-check] pipewire did not start" >&2; exit 1; }
+
+# The session manager links our stream to its target.object
+wireplumber >"$WORK/wireplumber.log" 2>&1 &
+PIDS+=($!)
+
+pw-cli create-node adapter "{ factory.name=support.null-audio-sink node.name=$SINK
+  media.class=Audio/Sink object.linger=1 audio.position=[FL FR] }" >/dev/null
+for _ in $(seq 50); do
+  pw-cli ls Node 2>/dev/null | grep -q "node.name = \"$SINK\"" && break
+  sleep 0.1
+done
+pw-cli ls Node 2>/dev/null | grep -q "node.name = \"$SINK\"" || { echo "[pipewire-null-check] null sink did not appear" >&2; exit 1; }
+
+status=0
+for mode in exclusive shared; do
+  out="$WORK/$mode.json"
+  echo "[pipewire-null-check] $mode, ${SECONDS_PER_RUN}s"
+  if ! "$ENGINE_LOAD" --backend pipewire --mode "$mode" --device "$SINK" \
+      --streams 1 --seconds "$SECONDS_PER_RUN" --json >"$out"; then
+    echo "[pipewire-null-check] engine_load failed in $mode mode" >&2
+    status=1
+    continue
+  fi
+  node -e '
+    const r = JSON.parse(require("fs").readFileSync(process.argv[1], "utf8"));
+    const problems = [];
+    if (r.ops.openFailures > 0) problems.push(`${r.ops.openFailures} open failures`);
+    if (r.render.periods === 0) problems.push("the render thread never ran");
+    if (r.render.deviceXruns > 0) problems.push(`${r.render.deviceXruns} device xruns`);
+    console.log(`  periods ${r.render.periods}  ring underruns ${r.render.ringUnderruns}  xruns ${r.render.deviceXruns}`);
+    if (problems.length) { console.error("  " + problems.join(", ")); process.exit(1); }
+  ' "$out" || status=1
+done
+
+if [ "$status" -ne 0 ]; then
+  echo "--- pipewire.log" >&2; tail -n 50 "$WORK/pipewire.log" >&2
+  echo "--- wireplumber.log" >&2; tail -n 50 "$WORK/wireplumber.log" >&2
+fi
+exit "$status"
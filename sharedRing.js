@@ -0,0 +1,130 @@
+// sharedRing.js
+// Reference producer for native streams opened with { sharedRing: true }.
+//
+// openOutput() then returns `sharedRing: { buffer, control, data, ... }`.
+// `buffer` is a SharedArrayBuffer that holds the stream's ring; PCM written
+// here is played by the native render thread without any N-API call per
+// chunk. The SharedArrayBuffer can be posted to a worker_thread, which is
+// the intended producer:
+//
+//   const out = exclusive.openOutput({ ..., sharedRing: true });
+//   const worker = new Worker('./decoder.js', { workerData: out.sharedRing.buffer });
+//   // in the worker:
+//   const ring = new SharedRingProducer(workerData);
+//   ring.writeAll(pcmChunk);
+//
+// Layout (int32 words, see AttachSharedRing in src/exclusive_audio.cc):
+//
+//   bytes   0..63   header
+//                   word 0  magic 0x53505242 ('SPRB')
+//                   word 1  layout version (1)
+//                   word 2  capacity in bytes (power of two)
+//                   word 3  bytesPerFrame
+//                   word 4  sampleRate
+//                   word 5  channels
+//                   word 6  bitDepth
+//                   word 7  state: 0 = open, 1 = closed by the native side
+//                   word 8  limit: most bytes the ring may hold (whole
+//                           frames, <= capacity)
+//   bytes  64..127  word 16 writePos, free-running uint32, owned by JS
+//   bytes 128..191  word 32 readPos,  free-running uint32, owned by native
+//   bytes 192..     PCM data, `capacity` bytes; stream byte i lives at
+//                   data[i & (capacity - 1)]
+//
+// Rules: only one producer may write. Fill the data bytes first, then
+// publish them with Atomics.store on writePos. Fill level is
+// (writePos - readPos) >>> 0 and must stay within limit. The native side
+// cannot wake Atomics.wait, so a producer facing a full ring sleeps for a
+// short interval and re-checks.
+
+export const SHARED_RING = Object.freeze({
+  MAGIC: 0x53505242,
+  VERSION: 1,
+  HEADER_BYTES: 192,
+  WORD_MAGIC: 0,
+  WORD_VERSION: 1,
+  WORD_CAPACITY: 2,
+  WORD_BYTES_PER_FRAME: 3,
+  WORD_SAMPLE_RATE: 4,
+  WORD_CHANNELS: 5,
+  WORD_BIT_DEPTH: 6,
+  WORD_STATE: 7,
+  WORD_LIMIT: 8,
+  WORD_WRITE_POS: 16,
+  WORD_READ_POS: 32,
+});
+
+export class SharedRingProducer {
+  constructor(buffer) {
+    if (!(buffer instanceof SharedArrayBuffer)) {
+      throw new TypeError('SharedRingProducer requires the SharedArrayBuffer from openOutput().sharedRing.buffer');
+    }
+    this.control = new Int32Array(buffer, 0, SHARED_RING.HEADER_BYTES / 4);
+    if (Atomics.load(this.control, SHARED_RING.WORD_MAGIC) !== SHARED_RING.MAGIC) {
+      throw new Error('not a shared ring buffer (bad magic)');
+    }
+    if (Atomics.load(this.control, SHARED_RING.WORD_VERSION) !== SHARED_RING.VERSION) {
+      throw new Error('unsupported shared ring layout version');
+    }
+    this.capacity = Atomics.load(this.control, SHARED_RING.WORD_CAPACITY);
+    this.mask = this.capacity - 1;
+    this.limit = Atomics.load(this.control, SHARED_RING.WORD_LIMIT) || this.capacity;
+    this.bytesPerFrame = Atomics.load(this.control, SHARED_RING.WORD_BYTES_PER_FRAME);
+    this.sampleRate = Atomics.load(this.control, SHARED_RING.WORD_SAMPLE_RATE);
+    this.channels = Atomics.load(this.control, SHARED_RING.WORD_CHANNELS);
+    this.bitDepth = Atomics.load(this.control, SHARED_RING.WORD_BIT_DEPTH);
+    this.data = new Uint8Array(buffer, SHARED_RING.HEADER_BYTES, this.capacity);
+    // Private word used only to sleep with Atomics.wait
+    this._sleepCell = new Int32Array(new SharedArrayBuffer(4));
+  }
+
+  get closed() {
+    return Atomics.load(this.control, SHARED_RING.WORD_STATE) !== 0;
+  }
+
+  buffered() {
+    const w = Atomics.load(this.control, SHARED_RING.WORD_WRITE_POS);
+    const r = Atomics.load(this.control, SHARED_RING.WORD_READ_POS);
+    return (w - r) >>> 0;
+  }
+
+  free() {
+    return Math.max(0, this.limit - this.buffered());
+  }
+
+  // Copies as much of `chunk` (Uint8Array/Buffer) as fits and returns the
+  // number of bytes written. Never blocks.
+  write(chunk) {
+    if (this.closed) return -1;
+    const n = Math.min(chunk.length, this.free());
+    if (n <= 0) return 0;
+
+    const w = Atomics.load(this.control, SHARED_RING.WORD_WRITE_POS) >>> 0;
+    const off = w & this.mask;
+    const first = Math.min(n, this.capacity - off);
+    this.data.set(first === chunk.length ? chunk : chunk.subarray(0, first), off);
+    if (n > first) this.data.set(chunk.subarray(first, n), 0);
+
+    Atomics.store(this.control, SHARED_RING.WORD_WRITE_POS, (w + n) | 0);
+    return n;
+  }
+
+  // Writes the whole chunk, sleeping `pollMs` whenever the ring is full.
+  // Returns bytes written (short only on timeout or close). Atomics.wait
+  // blocks the calling thread, so use this from a worker.
+  writeAll(chunk, { timeoutMs = 2000, pollMs = 2 } = {}) {
+    let off = 0;
+    const deadline = Date.now() + timeoutMs;
+    while (off < chunk.length) {
+      const n = this.write(off === 0 ? chunk : chunk.subarray(off));
+      if (n < 0) break;
+      off += n;
+      if (off >= chunk.length) break;
+      if (Date.now() >= deadline) break;
+      Atomics.wait(this._sleepCell, 0, 0, pollMs);
+    }
+    return off;
+  }
+}
+
+export default { SharedRingProducer, SHARED_RING };
@@ -0,0 +1,302 @@
+// src/biquad_eq.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "sample_format.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EQ_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EQ_NEON 1
+#include <arm_neon.h>
+#endif
+
+struct BiquadBand
+{
+    enum class Type
+    {
+        Peaking,
+        LowShelf,
+        HighShelf,
+        LowPass,
+        HighPass
+    };
+
+    Type type{Type::Peaking};
+    double freq{1000.0};
+    double gainDb{0.0};
+    double q{1.41};
+};
+
+// Normalized (a0 = 1) biquad coefficients
+struct BiquadCoefs
+{
+    double b0{1.0}, b1{0.0}, b2{0.0}, a1{0.0}, a2{0.0};
+};
+
+// RBJ "Audio EQ Cookbook" designs
+static inline BiquadCoefs DesignBiquad(const BiquadBand &band, double sampleRate)
+{
+    const double kPi = 3.14159265358979323846;
+    double freq = std::min(std::max(band.freq, 1.0), sampleRate * 0.49);
+    double q = std::max(band.q, 0.05);
+    double A = std::pow(10.0, band.gainDb / 40.0);
+    double w0 = 2.0 * kPi * freq / sampleRate;
+    double cw = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * q);
+    double sqA = 2.0 * std::sqrt(A) * alpha;
+
+    double b0, b1, b2, a0, a1, a2;
+    switch (band.type)
+    {
+    case BiquadBand::Type::LowShelf:
+        b0 = A * ((A + 1) - (A - 1) * cw + sqA);
+        b1 = 2 * A * ((A - 1) - (A + 1) * cw);
+        b2 = A * ((A + 1) - (A - 1) * cw - sqA);
+        a0 = (A + 1) + (A - 1) * cw + sqA;
+        a1 = -2 * ((A - 1) + (A + 1) * cw);
+        a2 = (A + 1) + (A - 1) * cw - sqA;
+        break;
+    case BiquadBand::Type::HighShelf:
+        b0 = A * ((A + 1) + (A - 1) * cw + sqA);
+        b1 = -2 * A * ((A - 1) + (A + 1) * cw);
+        b2 = A * ((A + 1) + (A - 1) * cw - sqA);
+        a0 = (A + 1) - (A - 1) * cw + sqA;
+        a1 = 2 * ((A - 1) - (A + 1) * cw);
+        a2 = (A + 1) - (A - 1) * cw - sqA;
+        break;
+    case BiquadBand::Type::LowPass:
+        b0 = (1 - cw) / 2;
+        b1 = 1 - cw;
+        b2 = (1 - cw) / 2;
+        a0 = 1 + alpha;
+        a1 = -2 * cw;
+        a2 = 1 - alpha;
+        break;
+    case BiquadBand::Type::HighPass:
+        b0 = (1 + cw) / 2;
+        b1 = -(1 + cw);
+        b2 = (1 + cw) / 2;
+        a0 = 1 + alpha;
+        a1 = -2 * cw;
+        a2 = 1 - alpha;
+        break;
+    case BiquadBand::Type::Peaking:
+    default:
+        b0 = 1 + alpha * A;
+        b1 = -2 * cw;
+        b2 = 1 - alpha * A;
+        a0 = 1 + alpha / A;
+        a1 = -2 * cw;
+        a2 = 1 - alpha / A;
+        break;
+    }
+
+    BiquadCoefs c;
+    c.b0 = b0 / a0;
+    c.b1 = b1 / a0;
+    c.b2 = b2 / a0;
+    c.a1 = a1 / a0;
+    c.a2 = a2 / a0;
+    return c;
+}
+
+//
+// N-band biquad cascade run by the render thread on each block.
+//
+// Filters are transposed direct form II with double-precision state, which
+// stays well behaved for low-frequency bands at high sample rates where
+// float state would add audible noise. The inner loop runs across the
+// channels of a frame, so channel pairs share one SSE2/NEON register.
+//
+// set() is called from the JS thread and never blocks the render thread:
+// programs are exchanged through a triple buffer, and the render thread
+// picks up the newest one at the start of its next block. A flat program
+// (no bands, or only 0 dB peaking/shelf bands) bypasses the stage entirely.
+//
+class EqStage
+{
+public:
+    static constexpr unsigned kMaxBands = 32;
+    static constexpr unsigned kMaxChannels = 8;
+
+    EqStage()
+    {
+        std::memset(z1, 0, sizeof(z1));
+        std::memset(z2, 0, sizeof(z2));
+    }
+
+    EqStage(const EqStage &) = delete;
+    EqStage &operator=(const EqStage &) = delete;
+
+    // JS thread only. Returns false if there are too many bands.
+    bool set(const std::vector<BiquadBand> &bands, double sampleRate)
+    {
+        if (bands.size() > kMaxBands)
+            return false;
+
+        Program &p = slots[back];
+        p.count = static_cast<unsigned>(bands.size());
+        p.bypass = true;
+        for (unsigned i = 0; i < p.count; ++i)
+        {
+            p.coefs[i] = DesignBiquad(bands[i], sampleRate);
+            bool shapesGain = bands[i].type == BiquadBand::Type::Peaking ||
+                              bands[i].type == BiquadBand::Type::LowShelf ||
+                              bands[i].type == BiquadBand::Type::HighShelf;
+            if (!shapesGain || std::fabs(bands[i].gainDb) >= 0.01)
+                p.bypass = false;
+        }
+
+        uint32_t prev = middle.exchange(back | kFresh, std::memory_order_acq_rel);
+        back = prev & kIndexMask;
+        activeBands.store(p.bypass ? 0 : p.count, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Bands currently in effect (0 when bypassed)
+    unsigned bands() const { return activeBands.load(std::memory_order_relaxed); }
+
+    // Render thread: filters `frames` frames in place.
+    void process(uint8_t *data, size_t frames, unsigned channels, SampleFormat fmt)
+    {
+        if (middle.load(std::memory_order_relaxed) & kFresh)
+        {
+            uint32_t prev = middle.exchange(front, std::memory_order_acq_rel);
+            front = prev & kIndexMask;
+            const Program &p = slots[front];
+            // A different band layout would ring from stale state
+            if (p.count != stateBands)
+            {
+                std::memset(z1, 0, sizeof(z1));
+                std::memset(z2, 0, sizeof(z2));
+                stateBands = p.count;
+            }
+        }
+
+        const Program &p = slots[front];
+        if (p.bypass || p.count == 0 || channels == 0 || channels > kMaxChannels)
+            return;
+
+        const size_t sampleBytes = SampleFormatBytes(fmt);
+        while (frames)
+        {
+            size_t n = frames < kBlockFrames ? frames : kBlockFrames;
+            size_t samples = n * channels;
+            UnpackToDouble(data, work, samples, fmt);
+            for (unsigned b = 0; b < p.count; ++b)
+                runBand(p.coefs[b], z1[b], z2[b], work, n, channels);
+            PackFromDouble(work, data, samples, fmt);
+            data += samples * sampleBytes;
+            frames -= n;
+        }
+        flushDenormals(p.count, channels);
+    }
+
+private:
+    static constexpr uint32_t kFresh = 4;
+    static constexpr uint32_t kIndexMask = 3;
+    static constexpr size_t kBlockFrames = 256;
+
+    struct Program
+    {
+        unsigned count{0};
+        bool bypass{true};
+        BiquadCoefs coefs[kMaxBands];
+    };
+
+    static void runBand(const BiquadCoefs &c, double *s1, double *s2, double *x, size_t frames, unsigned channels)
+    {
+        unsigned ch = 0;
+#if defined(EQ_SSE2)
+        const __m128d b0 = _mm_set1_pd(c.b0), b1 = _mm_set1_pd(c.b1), b2 = _mm_set1_pd(c.b2);
+        const __m128d a1 = _mm_set1_pd(c.a1), a2 = _mm_set1_pd(c.a2);
+        for (; ch + 2 <= channels; ch += 2)
+        {
+            __m128d v1 = _mm_load_pd(s1 + ch), v2 = _mm_load_pd(s2 + ch);
+            double *p = x + ch;
+            for (size_t f = 0; f < frames; ++f, p += channels)
+            {
+                __m128d in = _mm_loadu_pd(p);
+                __m128d out = _mm_add_pd(_mm_mul_pd(b0, in), v1);
+                v1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, in), _mm_mul_pd(a1, out)), v2);
+                v2 = _mm_sub_pd(_mm_mul_pd(b2, in), _mm_mul_pd(a2, out));
+                _mm_storeu_pd(p, out);
+            }
+            _mm_store_pd(s1 + ch, v1);
+            _mm_store_pd(s2 + ch, v2);
+        }
+#elif defined(EQ_NEON)
+        const float64x2_t b0 = vdupq_n_f64(c.b0), b1 = vdupq_n_f64(c.b1), b2 = vdupq_n_f64(c.b2);
+        const float64x2_t a1 = vdupq_n_f64(c.a1), a2 = vdupq_n_f64(c.a2);
+        for (; ch + 2 <= channels; ch += 2)
+        {
+            float64x2_t v1 = vld1q_f64(s1 + ch), v2 = vld1q_f64(s2 + ch);
+            double *p = x + ch;
+            for (size_t f = 0; f < frames; ++f, p += channels)
+            {
+                float64x2_t in = vld1q_f64(p);
+                float64x2_t out = vfmaq_f64(v1, b0, in);
+                v1 = vfmsq_f64(vfmaq_f64(v2, b1, in), a1, out);
+                v2 = vfmsq_f64(vmulq_f64(b2, in), a2, out);
+                vst1q_f64(p, out);
+            }
+            vst1q_f64(s1 + ch, v1);
+            vst1q_f64(s2 + ch, v2);
+        }
+#endif
+        for (; ch < channels; ++ch)
+        {
+            double v1 = s1[ch], v2 = s2[ch];
+            double *p = x + ch;
+            for (size_t f = 0; f < frames; ++f, p += channels)
+            {
+                double in = *p;
+                double out = c.b0 * in + v1;
+                v1 = c.b1 * in - c.a1 * out + v2;
+                v2 = c.b2 * in - c.a2 * out;
+                *p = out;
+            }
+            s1[ch] = v1;
+            s2[ch] = v2;
+        }
+    }
+
+    // Long silences decay the state into subnormals, which are very slow on
+    // x86; they are far below anything audible, so snap them to zero.
+    void flushDenormals(unsigned bands, unsigned channels)
+    {
+        for (unsigned b = 0; b < bands; ++b)
+        {
+            for (unsigned c = 0; c < channels; ++c)
+            {
+                if (std::fabs(z1[b][c]) < 1e-200)
+                    z1[b][c] = 0.0;
+                if (std::fabs(z2[b][c]) < 1e-200)
+                    z2[b][c] = 0.0;
+            }
+        }
+    }
+
+    // Triple buffer: JS thread owns slots[back], render thread owns
+    // slots[front], `middle` holds the third index plus a fresh flag.
+    Program slots[3];
+    std::atomic<uint32_t> middle{1};
+    uint32_t back{2};
+    uint32_t front{0};
+    std::atomic<unsigned> activeBands{0};
+
+    // Render thread state
+    unsigned stateBands{0};
+    alignas(16) double z1[kMaxBands][kMaxChannels];
+    alignas(16) double z2[kMaxBands][kMaxChannels];
+    alignas(16) double work[kBlockFrames * kMaxChannels];
+};
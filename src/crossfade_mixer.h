@@ -0,0 +1,151 @@
+// src/crossfade_mixer.h
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "gain_stage.h"
+#include "sample_format.h"
+
+//
+// Two-input mix kernels: a[i] = clamp(a[i] * ga + b[i] * gb) over float
+// samples. Gains are constant per call; CrossfadeMixer steps them every few
+// frames, well below anything audible as zipper noise.
+//
+namespace mix
+{
+    static inline void MixScalar(float *a, const float *b, size_t n, float ga, float gb)
+    {
+        for (size_t i = 0; i < n; ++i)
+            a[i] = std::min(1.0f, std::max(-1.0f, a[i] * ga + b[i] * gb));
+    }
+
+#if defined(GAIN_X86)
+    static inline void MixSse2(float *a, const float *b, size_t n, float ga, float gb)
+    {
+        const __m128 vga = _mm_set1_ps(ga), vgb = _mm_set1_ps(gb);
+        const __m128 hi = _mm_set1_ps(1.0f), lo = _mm_set1_ps(-1.0f);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), vga), _mm_mul_ps(_mm_loadu_ps(b + i), vgb));
+            _mm_storeu_ps(a + i, _mm_max_ps(lo, _mm_min_ps(hi, v)));
+        }
+        MixScalar(a + i, b + i, n - i, ga, gb);
+    }
+
+    GAIN_TARGET_AVX2 static inline void MixAvx2(float *a, const float *b, size_t n, float ga, float gb)
+    {
+        const __m256 vga = _mm256_set1_ps(ga), vgb = _mm256_set1_ps(gb);
+        const __m256 hi = _mm256_set1_ps(1.0f), lo = _mm256_set1_ps(-1.0f);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a + i), vga), _mm256_mul_ps(_mm256_loadu_ps(b + i), vgb));
+            _mm256_storeu_ps(a + i, _mm256_max_ps(lo, _mm256_min_ps(hi, v)));
+        }
+        MixScalar(a + i, b + i, n - i, ga, gb);
+    }
+#endif
+
+#if defined(GAIN_NEON)
+    static inline void MixNeon(float *a, const float *b, size_t n, float ga, float gb)
+    {
+        const float32x4_t hi = vdupq_n_f32(1.0f), lo = vdupq_n_f32(-1.0f);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            float32x4_t v = vmlaq_n_f32(vmulq_n_f32(vld1q_f32(a + i), ga), vld1q_f32(b + i), gb);
+            vst1q_f32(a + i, vmaxq_f32(lo, vminq_f32(hi, v)));
+        }
+        MixScalar(a + i, b + i, n - i, ga, gb);
+    }
+#endif
+
+    using MixFn = void (*)(float *, const float *, size_t, float, float);
+
+    // Best kernel for this CPU, resolved once.
+    static inline MixFn Best()
+    {
+        static const MixFn fn = []
+        {
+#if defined(GAIN_X86)
+            return gain::CpuHasAvx2() ? MixFn(MixAvx2) : MixFn(MixSse2);
+#elif defined(GAIN_NEON)
+            return MixFn(MixNeon);
+#else
+            return MixFn(MixScalar);
+#endif
+        }();
+        return fn;
+    }
+}
+
+//
+// Equal-power crossfade from an outgoing block (mixed in place) to an
+// incoming one of the same format. The caller owns timing: start() sets the
+// fade length, then mix() is fed consecutive frames until active() drops.
+// Render thread only.
+//
+class CrossfadeMixer
+{
+public:
+    static constexpr size_t kBlockFrames = 256;
+    static constexpr unsigned kMaxChannels = 8;
+
+    void start(uint64_t frames)
+    {
+        total = frames;
+        done = 0;
+    }
+
+    bool active() const { return done < total; }
+
+    // Staging area for up to kBlockFrames frames of the incoming signal.
+    uint8_t *incoming() { return incomingBytes; }
+
+    // Mixes `frames` frames (at most kBlockFrames) of incoming() into out.
+    // Frames past the end of the fade are left untouched.
+    void mix(uint8_t *out, size_t frames, unsigned channels, SampleFormat fmt)
+    {
+        if (channels == 0 || channels > kMaxChannels)
+        {
+            done = total;
+            return;
+        }
+        frames = static_cast<size_t>(std::min<uint64_t>({frames, kBlockFrames, total - done}));
+        const size_t samples = frames * channels;
+
+        float *a = outFloats;
+        float *b = inFloats;
+        UnpackToFloat(out, a, samples, fmt);
+        UnpackToFloat(incomingBytes, b, samples, fmt);
+
+        const MixFn kernel = mix::Best();
+        const double halfPi = 1.57079632679489661923;
+        for (size_t f = 0; f < frames; f += kStepFrames)
+        {
+            size_t n = std::min(kStepFrames, frames - f);
+            // Gains at the middle of the step
+            double t = (static_cast<double>(done + f) + 0.5 * n) / static_cast<double>(total);
+            float gOut = static_cast<float>(std::cos(t * halfPi));
+            float gIn = static_cast<float>(std::sin(t * halfPi));
+            kernel(a + f * channels, b + f * channels, n * channels, gOut, gIn);
+        }
+
+        PackFromFloat(a, out, samples, fmt);
+        done += frames;
+    }
+
+private:
+    using MixFn = mix::MixFn;
+    static constexpr size_t kStepFrames = 32;
+
+    uint64_t total{0};
+    uint64_t done{0};
+    alignas(32) float outFloats[kBlockFrames * kMaxChannels];
+    alignas(32) float inFloats[kBlockFrames * kMaxChannels];
+    alignas(32) uint8_t incomingBytes[kBlockFrames * kMaxChannels * 4];
+};
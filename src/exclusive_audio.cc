@@ -1,10 +1,22 @@
 // src/exclusive_audio.cc
+//
+// Built as the Node addon, or with EXCLUSIVE_HEADLESS as a plain C++ engine
+// with no N-API (see headless_engine.h): the JS exports, device listing and
+// event delivery drop out; everything else is the same code.
+//
+#if !defined(EXCLUSIVE_HEADLESS)
 #include <napi.h>
+#endif
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <thread>
 #include <vector>
@@ -23,7 +35,7 @@
 
 #if defined(EXCLUSIVE_WIN32)
 #ifndef _WIN32_WINNT
-#define _WIN32_WINNT 0x0601
+#define _WIN32_WINNT 0x0602 // CoIncrementMTAUsage
 #endif
 #ifndef NOMINMAX
 #define NOMINMAX
@@ -59,8 +71,16 @@
 #if defined(EXCLUSIVE_LINUX)
 #include <alsa/asoundlib.h>
 #include <poll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <fcntl.h>
+#if defined(EXCLUSIVE_PIPEWIRE)
+#include <pipewire/pipewire.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/param/latency-utils.h>
+#endif
+#else
+#undef EXCLUSIVE_PIPEWIRE
 #endif
 
 // Provide a lightweight debug macro on non-Windows platforms
@@ -74,17 +94,52 @@
     } while (0)
 #endif
 
+#include "biquad_eq.h"
+#include "crossfade_mixer.h"
+#include "format_converter.h"
+#include "file_decoder.h"
+#include "gain_stage.h"
+#if defined(EXCLUSIVE_HEADLESS)
+#include "headless_engine.h"
+#endif
+#include "mix_bus.h"
+#include "null_sink.h"
+#include "playback_clock.h"
+#include "realtime_policy.h"
+#include "render_telemetry.h"
+#include "render_trace.h"
+#include "resampler.h"
+#include "ring_buffer.h"
+#include "ring_writer.h"
+#include "sample_format.h"
+#include "segment_markers.h"
+#include "stream_events.h"
+#include "stream_table.h"
+#include "writer_wakeup.h"
+
 struct OutputStreamState;
+struct MixBus;
+struct EventChannel;
+
+// Open streams by handle. Lookups never lock; close retires the handle and
+// waits out the references still held (async writes, polls) before freeing.
+static HandleTable<OutputStreamState> g_streams;
+using StreamRef = HandleTable<OutputStreamState>::Ref;
 
-static std::map<uint32_t, OutputStreamState *> g_streams;
-static std::mutex g_streamsMutex;
-static uint32_t g_nextId = 1;
+// Mixing buses by name (openOutput({ bus })); a bus lives as long as it has
+// members
+static std::map<std::string, MixBus *> g_buses;
+static std::mutex g_busesMutex;
 
 
+// Written by whichever thread hit the error: the JS thread, or a worker
+// running openOutputAsync/closeAsync
 static std::string g_lastError;
+static std::mutex g_lastErrorMutex;
 
 static void SetLastError(const std::string &msg)
 {
+    std::lock_guard<std::mutex> lock(g_lastErrorMutex);
     g_lastError = msg;
 }
 
@@ -92,7 +147,7 @@ static void SetLastErrorHr(const char *msg, long hr)
 {
     char buf[256];
     std::snprintf(buf, sizeof(buf), "%s (HRESULT=0x%08lx)", msg, hr);
-    g_lastError = buf;
+    SetLastError(buf);
 }
 
 #if defined(EXCLUSIVE_LINUX)
@@ -100,108 +155,113 @@ static void SetLastErrorAlsa(const char *msg, int err)
 {
     char buf[256];
     std::snprintf(buf, sizeof(buf), "%s (ALSA error: %s)", msg, snd_strerror(err));
-    g_lastError = buf;
+    SetLastError(buf);
 }
 #else
 static void SetLastErrorAlsa(const char *msg, int err)
 {
     char buf[256];
     std::snprintf(buf, sizeof(buf), "%s (error: %d)", msg, err);
-    g_lastError = buf;
+    SetLastError(buf);
 }
 #endif
 
-static inline void ThrowTypeError(const Napi::Env &env, const std::string &msg)
+static std::string LastErrorText()
+{
+    std::lock_guard<std::mutex> lock(g_lastErrorMutex);
+    return g_lastError;
+}
+
+// msg with the last backend error appended, as reported to the caller
+static std::string WithLastError(const std::string &msg)
 {
     std::string full = msg;
-    if (!g_lastError.empty())
+    std::string last = LastErrorText();
+    if (!last.empty())
     {
-        full.append(" - ").append(g_lastError);
+        full.append(" - ").append(last);
     }
-    Napi::TypeError::New(env, full).ThrowAsJavaScriptException();
+    return full;
 }
 
-// Single-Producer Single-Consumer lock-free ring buffer.
-// Writer: JS / Node thread (producer). Reader: audio render thread (consumer).
-struct RingBuffer
+#if !defined(EXCLUSIVE_HEADLESS)
+static inline void ThrowTypeError(const Napi::Env &env, const std::string &msg)
 {
-    std::vector<uint8_t> data;
-    size_t capacity{0};
-    std::atomic<size_t> readPos{0};  // head (consumer)
-    std::atomic<size_t> writePos{0}; // tail (producer)
-
-    void init(size_t size)
-    {
-        // Ensure at least 2 to distinguish full/empty
-        capacity = size ? size : 1;
-        data.assign(capacity, 0);
-        readPos.store(0);
-        writePos.store(0);
-    }
+    Napi::TypeError::New(env, WithLastError(msg)).ThrowAsJavaScriptException();
+}
+#endif
 
-    size_t size() const { return capacity; }
+// A file waiting for the decoder thread (openFile / queueFile)
+struct DecodeJob
+{
+    std::unique_ptr<FileDecoder> decoder;
+    std::unique_ptr<Resampler> resampler; // file rate != stream rate
+    uint32_t segment{0};
+    uint64_t startFrame{0};         // first frame decoded (startTime, trimmed delay)
+    uint64_t endFrame{UINT64_MAX}; // decoding stops here (trimmed padding)
+    uint64_t inputFrame{0};         // decoder position, in file frames
+    uint64_t outputFrames{UINT64_MAX}; // stream frames the job produces
+    uint64_t outputDone{0};         // stream frames produced so far
+    bool started{false};            // head already decoded into a crossfade
+    std::vector<float> resampled;
+};
 
-    // Number of bytes available to read (consumer)
-    size_t availableToRead() const
-    {
-        size_t r = readPos.load(std::memory_order_acquire);
-        size_t w = writePos.load(std::memory_order_acquire);
-        return (w + capacity - r) % capacity;
-    }
+// Hardware buffer to ask the device for (openOutput latencyClass /
+// periodFrames / periods / hwBufferMs). The backend negotiates the nearest
+// sizes the device supports and reports what it got.
+struct HwBufferRequest
+{
+    std::string latencyClass{"balanced"};
+    double periodMs{25.0};
+    unsigned periods{4};
+    uint32_t periodFrames{0}; // explicit size; overrides periodMs
+};
 
-    // Number of bytes available to write (producer)
-    size_t availableToWrite() const
+// Period length and count per latencyClass preset
+static bool LatencyClassPreset(const std::string &name, HwBufferRequest &req)
+{
+    static const struct
     {
-        return capacity - availableToRead() - 1;
-    }
-
-    // Producer writes up to len bytes. Returns actual written.
-    size_t write(const uint8_t *src, size_t len)
+        const char *name;
+        double periodMs;
+        unsigned periods;
+    } presets[] = {
+        {"ultra-low", 1.0, 2},    // ~2 ms: live monitoring
+        {"low", 2.5, 2},          // ~5 ms round trips
+        {"balanced", 25.0, 4},    // 100 ms, the long-standing default
+        {"power-save", 125.0, 4}, // 500 ms: few wakeups on battery
+    };
+    for (const auto &p : presets)
     {
-        if (!src || len == 0)
-            return 0;
-
-        size_t r = readPos.load(std::memory_order_acquire);
-        size_t t = writePos.load(std::memory_order_relaxed);
-
-        size_t avail = (t >= r) ? (capacity - (t - r) - 1) : (r - t - 1);
-        if (avail == 0)
-            return 0;
-        if (len > avail)
-            len = avail;
-
-        size_t first = std::min(len, capacity - t);
-        std::memcpy(&data[t], src, first);
-        if (len > first)
-            std::memcpy(&data[0], src + first, len - first);
-
-        writePos.store((t + len) % capacity, std::memory_order_release);
-        return len;
+        if (name == p.name)
+        {
+            req.latencyClass = p.name;
+            req.periodMs = p.periodMs;
+            req.periods = p.periods;
+            return true;
+        }
     }
+    return false;
+}
 
-    // Consumer reads up to len bytes. Returns actual read.
-    size_t read(uint8_t *dst, size_t len)
-    {
-        if (!dst || len == 0)
-            return 0;
-
-        size_t r = readPos.load(std::memory_order_relaxed);
-        size_t t = writePos.load(std::memory_order_acquire);
-
-        size_t avail = (t + capacity - r) % capacity;
-        if (avail == 0)
-            return 0;
-        if (len > avail)
-            len = avail;
-
-        size_t first = std::min(len, capacity - r);
-        std::memcpy(dst, &data[r], first);
-        if (len > first)
-            std::memcpy(dst + first, &data[0], len - first);
+// Period (or quantum) length in frames for a request at sampleRate
+static uint32_t RequestedPeriodFrames(const HwBufferRequest &req, unsigned int sampleRate)
+{
+    uint32_t frames = req.periodFrames
+                          ? req.periodFrames
+                          : static_cast<uint32_t>(req.periodMs * sampleRate / 1000.0 + 0.5);
+    return std::max<uint32_t>(frames, 16);
+}
 
-        readPos.store((r + len) % capacity, std::memory_order_release);
-        return len;
-    }
+// Crossfade hand-off between the decoder thread and the render thread. Only
+// the render thread leaves kFadeMixing.
+enum FadeState : int
+{
+    kFadeIdle,     // fadeRing free; setCrossfade() may resize it
+    kFadeWriting,  // decoder is filling fadeRing with the next file's head
+    kFadeResizing, // setCrossfade() is reallocating fadeRing
+    kFadeArmed,    // render thread starts mixing at fadeStartPos
+    kFadeMixing    // render thread is mixing fadeRing over the ring
 };
 
 struct OutputStreamState
@@ -209,32 +269,147 @@ struct OutputStreamState
     unsigned int sampleRate{44100};
     unsigned int channels{2};
     unsigned int bitDepth{16};
+    // 32-bit streams may be IEEE float or integer; chosen at open
+    bool floatSamples{false};
 
     // Cached:
     unsigned int bytesPerFrame{(16 / 8) * 2};
     double ringDurationMs{0.0};
 
+    // What the device actually takes. The ring and everything before the
+    // device (writers, decoder, DSP) stay in the stream format above; the
+    // render thread converts on the way out when the two differ.
+    SampleFormat deviceFormat{SampleFormat::S16};
+    unsigned int deviceBytesPerFrame{(16 / 8) * 2};
+    FormatConverter converter;
+    std::vector<uint8_t> convertScratch; // render thread only
+
     std::atomic<bool> open{false};
     std::atomic<bool> running{false};
     std::atomic<bool> paused{false};
     std::atomic<bool> cancelled{false};
-    std::atomic<int> inFlightWrites{0};
-    std::atomic<bool> closing{false};
     RingBuffer ring;
-    // Writers (JS) may wait on this mutex/cv; audio thread never locks the ring.
-    std::mutex ringMutex;
-    std::condition_variable ringCv;
+    // Serializes producers for the whole of a write so concurrent workers
+    // cannot interleave chunks; the audio thread never locks it.
+    std::mutex writerMutex;
+    // Writers park here when the ring is full. The render thread only wakes
+    // them once free space reaches wakeThresholdBytes.
+    WriterWakeup writerWake;
+    std::atomic<size_t> wakeThresholdBytes{0};
+    std::atomic<uint64_t> writerParks{0};
+    std::atomic<uint64_t> writerWakeups{0};
+    std::atomic<uint64_t> writerSpuriousWakeups{0};
+
+    // Ring storage and indices live in a JS SharedArrayBuffer; JS is the
+    // only producer, so the native write paths refuse this stream.
+    bool sharedRing{false};
+    int32_t *sharedControl{nullptr};
+
+    // Native file decoder (openFile) feeding the ring. While one is attached
+    // it is the only producer, so the JS write paths refuse this stream.
+    std::thread decodeThread;
+    std::atomic<bool> fileDecoding{false};
+    std::atomic<bool> decodeStop{false};
+    std::atomic<bool> decodeFinished{false};
+    std::atomic<uint64_t> decodedFrames{0};
+    uint64_t decodeStartFrame{0};
+    std::mutex decodeErrorMutex;
+    std::string decodeError;
+    // Files queued behind the current one (queueFile); the decoder thread
+    // moves on to the next without a gap in the ring
+    std::mutex decodeQueueMutex;
+    std::deque<DecodeJob> decodeQueue;
+
+    // Track boundaries in the ring, crossed by the render thread
+    SegmentMarkers segments;
+    uint32_t nextSegmentId{1}; // JS thread only
+
+    // Crossfade between queued files (setCrossfade): the decoder writes the
+    // next file's head into fadeRing, and the render thread mixes it over the
+    // last crossfadeFrames of the outgoing file, equal-power
+    std::atomic<uint32_t> crossfadeFrames{0};
+    RingBuffer fadeRing;
+    std::atomic<int> fadeState{kFadeIdle};
+    uint32_t fadeStartPos{0}; // ring position; published by fadeState
+    uint64_t fadeFrames{0};
+    CrossfadeMixer fadeMixer; // render thread only
+
+    // Parametric EQ applied by the render thread ahead of the gain (setEq)
+    EqStage eq;
+
+    // Volume applied by the render thread (setGain)
+    GainStage gain;
 
     // Last observed hardware buffer padding (frames) for latency calc
     std::atomic<uint32_t> lastHardwarePaddingFrames{0};
 
+    // Audible position, fed by the render thread (getPosition)
+    PlaybackClock clock;
+
+    // Underruns, xruns, ring fill, wakeup jitter and render time per period
+    // (getStats / readTelemetry)
+    RenderTelemetry telemetry;
+
+    // Per-stage timestamps of the render loop and ring writes; off unless
+    // openOutput({ trace }) sized it (dumpTrace)
+    RenderTrace trace;
+
+    // Event subscription (subscribe). Producers bracket their use of the
+    // channel with eventUsers, so unsubscribe knows when it may release it.
+    std::atomic<EventChannel *> events{nullptr};
+    std::atomic<uint32_t> eventUsers{0};
+    std::atomic<size_t> lowWatermarkBytes{0};
+    std::atomic<uint64_t> positionIntervalFrames{0};
+    // No more input is coming (markEnd); arms played-out, as the end of a
+    // native decode does
+    std::atomic<bool> inputEnded{false};
+    // Event edge state, render thread only
+    bool belowWatermark{false};
+    bool playedOutSent{false};
+    uint64_t eventUnderruns{0};
+    uint64_t nextPositionFrame{0};
+
+    // Scheduling / pinning / mlock asked for at open, and what the render
+    // thread got (getStats)
+    RealtimeRequest realtime;
+    std::mutex realtimeMutex;
+    RealtimeReport realtimeReport;
+    bool realtimeApplied{false};
+    // Declared after the buffers it covers, so it unlocks before they go
+    LockedMemory lockedMemory;
+
+    // Hardware buffer asked for at open
+    HwBufferRequest hwRequest;
+
+    // Null sink (mode 'null'), available on every platform in place of the
+    // device backend below
+    bool nullSink{false};
+    NullSinkOptions nullOptions;
+    std::thread nullThread;
+    std::mutex nullWakeMutex;
+    std::condition_variable nullWakeCv; // close interrupts the period sleep
+    uint32_t nullPeriodFrames{0};
+    uint32_t nullBufferFrames{0};
+    WavWriter nullWav; // render thread only until close
+    std::atomic<uint64_t> nullFramesRendered{0};
+
+    // Mixing bus. A member (bus) has no backend of its own: the bus device
+    // renders its ring into the mix. The device (busDevice) is the hidden
+    // stream that owns the physical output.
+    MixBus *bus{nullptr};
+    MixBus *busDevice{nullptr};
+    // Frames this member has rendered into the mix since its clock was last
+    // published; render thread of the bus device only
+    uint64_t busContent{0};
+    uint64_t busFrames{0};
+    uint64_t busPeriodContent{0}; // this period only, for telemetry
+
 #if defined(EXCLUSIVE_WIN32)
     IMMDevice *device{nullptr};
     IAudioClient *audioClient{nullptr};
     IAudioRenderClient *renderClient{nullptr};
     HANDLE hEvent{nullptr};
     UINT32 bufferFrames{0};
-    bool coInitialized{false};
     std::thread renderThread;
 #elif defined(EXCLUSIVE_MACOS)
     AudioComponentInstance audioUnit{nullptr};
@@ -243,61 +418,544 @@ struct OutputStreamState
     std::thread renderThread;
     snd_pcm_uframes_t bufferSize{0};
     snd_pcm_uframes_t periodSize{0};
+    // Render straight into the DMA area (mmap) or through writei
+    bool alsaMmap{false};
+    // Wakes the render thread out of poll() (close)
+    int wakeFd{-1};
+#if defined(EXCLUSIVE_PIPEWIRE)
+    // Native PipeWire stream in place of the PCM (backend 'pipewire')
+    bool pipewire{false};
+    pw_thread_loop *pwLoop{nullptr};
+    pw_stream *pwStream{nullptr};
+    uint32_t pwQuantumRequest{0};
+    // Guarded by the loop lock; set by the loop's own callbacks
+    pw_stream_state pwState{PW_STREAM_STATE_UNCONNECTED};
+    std::string pwError;
+    spa_latency_info pwLatency{};
+    bool pwHaveLatency{false};
+    // Published by process(): frames the graph asked for last cycle and the
+    // rate it runs at
+    std::atomic<uint32_t> pwQuantum{0};
+    std::atomic<uint32_t> pwGraphRate{0};
+#endif
 #endif
 };
 
+static void PublishBusMembers(OutputStreamState *device);
+static size_t RenderMixBus(OutputStreamState *device, uint8_t *out, size_t frames);
+static void ProcessStreamEvents(OutputStreamState *s);
+
 //
-// Shared helper for blocking ring writes
+// Render-thread side of the writer wakeup: called once per period after the
+// ring has been consumed. Costs a relaxed load unless a writer is parked.
+// On a bus device this is also where the members' clocks catch up.
 //
-static size_t WriteToRingBlocking(OutputStreamState *s,
-                                  const uint8_t *src,
-                                  size_t len,
-                                  uint32_t timeoutMs)
+static inline void SignalWriters(OutputStreamState *s)
 {
-    // CRITICAL FIX: Check running state. If the render thread died, we must stop writing.
-    if (!s || !s->open.load() || !s->running.load() || !src || len == 0)
-        return 0;
+    if (s->busDevice)
+        PublishBusMembers(s);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!s->writerWake.hasWaiters())
+        return;
+    if (s->ring.availableToWrite() < s->wakeThresholdBytes.load(std::memory_order_relaxed))
+        return;
+    s->writerWakeups.fetch_add(1, std::memory_order_relaxed);
+    s->writerWake.wakeAll();
+}
+
+static inline SampleFormat StreamSampleFormat(const OutputStreamState *s)
+{
+    return SampleFormatFor(s->bitDepth, s->floatSamples);
+}
 
-    size_t totalWritten = 0;
-    auto deadline = std::chrono::steady_clock::now() +
-                    std::chrono::milliseconds(timeoutMs);
+// Frames converted per pass when the device format differs from the ring's
+static constexpr size_t kConvertChunkFrames = 1024;
 
-    while (totalWritten < len && s->running.load() && s->open.load())
+// Records the format the backend negotiated and picks the conversion from
+// the stream format. Call before the render thread starts.
+static void SetDeviceFormat(OutputStreamState *s, SampleFormat device)
+{
+    s->deviceFormat = device;
+    s->deviceBytesPerFrame = SampleFormatBytes(device) * s->channels;
+    s->converter.configure(StreamSampleFormat(s), device);
+    if (s->converter.identity())
+        std::vector<uint8_t>().swap(s->convertScratch);
+    else
+        s->convertScratch.assign(kConvertChunkFrames * s->bytesPerFrame, 0);
+}
+
+//
+// Mixes the incoming file's head from fadeRing over a block just read from
+// the ring, once the read position has passed the armed fade start. readEnd
+// is the ring position just past the block.
+//
+static inline void MixCrossfade(OutputStreamState *s, uint8_t *data, size_t bytes, SampleFormat fmt, uint32_t readEnd)
+{
+    int state = s->fadeState.load(std::memory_order_acquire);
+    if (state != kFadeArmed && state != kFadeMixing)
+        return;
+
+    const size_t bpf = s->bytesPerFrame;
+    size_t offset = 0;
+    if (state == kFadeArmed)
+    {
+        if (static_cast<int32_t>(readEnd - s->fadeStartPos) <= 0)
+            return;
+        // StopFileDecoder() may disarm it meanwhile
+        if (!s->fadeState.compare_exchange_strong(state, kFadeMixing, std::memory_order_acq_rel))
+            return;
+        uint32_t into = s->fadeStartPos - (readEnd - static_cast<uint32_t>(bytes));
+        offset = static_cast<int32_t>(into) > 0 ? into / bpf : 0;
+        s->fadeMixer.start(s->fadeFrames);
+    }
+
+    size_t frames = bytes / bpf - std::min(bytes / bpf, offset);
+    uint8_t *out = data + offset * bpf;
+    while (frames && s->fadeMixer.active())
+    {
+        size_t n = std::min(frames, CrossfadeMixer::kBlockFrames);
+        size_t want = n * bpf;
+        size_t got = s->fadeRing.read(s->fadeMixer.incoming(), want);
+        if (got < want)
+            std::memset(s->fadeMixer.incoming() + got, 0, want - got);
+        s->fadeMixer.mix(out, n, s->channels, fmt);
+        out += want;
+        frames -= n;
+    }
+
+    if (!s->fadeMixer.active())
+        s->fadeState.store(kFadeIdle, std::memory_order_release);
+}
+
+//
+// Render-thread processing of a block just taken from the ring, before it is
+// handed to the device. `bytes` may end in a partial frame; only whole frames
+// are processed. readEnd is the ring position just past the block (the block
+// may still sit in the ring, not yet released with commitRead()).
+//
+static inline void ProcessRenderBlock(OutputStreamState *s, uint8_t *data, size_t bytes, uint32_t readEnd)
+{
+    s->segments.onConsumed(readEnd, bytes, s->bytesPerFrame);
+
+    size_t frames = bytes / s->bytesPerFrame;
+    if (frames == 0)
+        return;
+    SampleFormat fmt = StreamSampleFormat(s);
+    MixCrossfade(s, data, bytes, fmt, readEnd);
+    s->eq.process(data, frames, s->channels, fmt);
+    s->gain.process(data, frames, s->channels, fmt);
+}
+
+//
+// Fills `frames` device frames at out from the ring: render stages run in
+// the stream format, then the block is converted to the device format if
+// they differ. Whatever the ring cannot supply is silence. Returns the
+// number of frames that came from the ring.
+//
+static size_t RenderFromRing(OutputStreamState *s, uint8_t *out, size_t frames)
+{
+    if (s->busDevice)
+        return RenderMixBus(s, out, frames);
+
+    const size_t bpf = s->bytesPerFrame;
+    if (s->converter.identity())
     {
-        std::unique_lock<std::mutex> lock(s->ringMutex);
+        size_t want = frames * bpf;
+        size_t bytes = s->ring.read(out, want);
+        ProcessRenderBlock(s, out, bytes, s->ring.readPos->load(std::memory_order_relaxed));
+        if (bytes < want)
+            std::memset(out + bytes, 0, want - bytes);
+        return bytes / bpf;
+    }
 
-        size_t avail = s->ring.availableToWrite();
-        if (avail == 0)
+    // Whole frames only, so the device never sees half a converted frame.
+    // Frames are processed and converted where they sit in the ring; only a
+    // frame split by the wrap goes through convertScratch.
+    const size_t dbpf = s->deviceBytesPerFrame;
+    size_t done = 0;
+    while (done < frames)
+    {
+        RingBuffer::Region reg = s->ring.peekRead(std::min(frames - done, kConvertChunkFrames) * bpf);
+        size_t n = reg.size() / bpf;
+        if (n == 0)
+            break;
+        uint32_t pos = s->ring.readPos->load(std::memory_order_relaxed);
+        size_t head = std::min(n, reg.firstLen / bpf);
+        if (head)
+        {
+            pos += static_cast<uint32_t>(head * bpf);
+            ProcessRenderBlock(s, reg.first, head * bpf, pos);
+            s->converter.run(reg.first, out + done * dbpf, head * s->channels);
+        }
+        if (n > head)
         {
-            if (timeoutMs == 0)
+            size_t split = reg.firstLen - head * bpf;
+            size_t tail = (n - head) * bpf;
+            uint8_t *src = reg.second;
+            if (split)
             {
-                // Non-blocking: nothing to do
-                break;
+                src = s->convertScratch.data();
+                std::memcpy(src, reg.first + head * bpf, split);
+                std::memcpy(src + split, reg.second, tail - split);
             }
-            // Wait for space or until stream stops/closes
-            if (s->ringCv.wait_until(lock, deadline) == std::cv_status::timeout)
+            pos += static_cast<uint32_t>(tail);
+            ProcessRenderBlock(s, src, tail, pos);
+            s->converter.run(src, out + (done + head) * dbpf, (n - head) * s->channels);
+        }
+        s->ring.commitRead(n * bpf);
+        done += n;
+    }
+    if (done < frames)
+        std::memset(out + done * dbpf, 0, (frames - done) * dbpf);
+    return done;
+}
+
+//
+// Mixing bus (openOutput({ bus })): logical streams sharing one physical
+// output. Each member keeps its own ring, render stages, clock and stats and
+// renders to float through its converter; the bus device's render thread
+// sums the members and hands the mix to the device like any other block.
+//
+static constexpr size_t kBusChunkFrames = 1024;
+
+struct MixBus
+{
+    std::string name;
+    OutputStreamState *device{nullptr};
+    // Read by the device's render thread every cycle
+    SnapshotList<OutputStreamState> members;
+    std::vector<OutputStreamState *> attached; // guarded by g_busesMutex
+    // Render thread scratch: kBusChunkFrames frames of float each
+    std::vector<float> mixed;
+    std::vector<float> block;
+};
+
+// Render thread of the bus device: RenderFromRing() for the mix.
+static size_t RenderMixBus(OutputStreamState *device, uint8_t *out, size_t frames)
+{
+    MixBus *bus = device->busDevice;
+    const auto &members = bus->members.enter();
+    if (members.empty())
+    {
+        bus->members.exit();
+        std::memset(out, 0, frames * device->deviceBytesPerFrame);
+        return 0;
+    }
+
+    // Members get a period of their own in telemetry, timed across the mix
+    for (OutputStreamState *m : members)
+    {
+        m->telemetry.begin(MonotonicNowNs(), m->ring.availableToRead(), m->ring.size(), m->sampleRate);
+        m->busPeriodContent = 0;
+    }
+
+    const mix::AddFn add = mix::BestAdd();
+    const size_t ch = device->channels;
+    const size_t dbpf = device->deviceBytesPerFrame;
+    // A float device takes the sum in place; anything else is converted
+    const bool direct = device->converter.identity();
+    size_t content = 0;
+    for (size_t done = 0; done < frames;)
+    {
+        size_t n = std::min(frames - done, kBusChunkFrames);
+        float *acc = direct ? reinterpret_cast<float *>(out + done * dbpf) : bus->mixed.data();
+        std::memset(acc, 0, n * ch * sizeof(float));
+
+        size_t chunkContent = 0;
+        for (OutputStreamState *m : members)
+        {
+            size_t got = 0;
+            if (!m->paused.load(std::memory_order_relaxed))
             {
-                break;
+                got = RenderFromRing(m, reinterpret_cast<uint8_t *>(bus->block.data()), n);
+                add(acc, bus->block.data(), got * ch);
             }
+            m->busContent += got;
+            m->busFrames += n;
+            m->busPeriodContent += got;
+            chunkContent = std::max(chunkContent, got);
+        }
+
+        // A float device takes the sum unclamped; conversion to an integer
+        // device saturates
+        if (!direct)
+            device->converter.run(reinterpret_cast<const uint8_t *>(acc), out + done * dbpf, n * ch);
+        content += chunkContent;
+        done += n;
+    }
+
+    const uint64_t nowNs = MonotonicNowNs();
+    for (OutputStreamState *m : members)
+        m->telemetry.end(nowNs, frames, m->busPeriodContent, m->paused.load(std::memory_order_relaxed));
+    bus->members.exit();
+    return content;
+}
+
+// Render thread of the bus device, once the device has published its delay:
+// advances each member's clock by what it rendered since the last cycle and
+// wakes its writers.
+static void PublishBusMembers(OutputStreamState *device)
+{
+    MixBus *bus = device->busDevice;
+    const uint64_t delay = device->clock.lastDelayFrames();
+    const uint64_t timestampNs = device->clock.lastTimestampNs();
+    for (OutputStreamState *m : bus->members.enter())
+    {
+        if (m->busFrames == 0)
             continue;
+        m->clock.advance(m->busContent, m->busFrames);
+        m->clock.publish(static_cast<int64_t>(delay), timestampNs);
+        m->lastHardwarePaddingFrames.store(static_cast<uint32_t>(delay), std::memory_order_relaxed);
+        m->busContent = 0;
+        m->busFrames = 0;
+        SignalWriters(m);
+        ProcessStreamEvents(m);
+    }
+    bus->members.exit();
+}
+
+//
+// Delivery side of the event subscription. The channel is owned by its
+// thread-safe function and freed by its finalizer, after the last queued
+// delivery has run, so a late delivery never touches a closed stream.
+//
+#if defined(EXCLUSIVE_HEADLESS)
+// No JS thread to deliver to (and nothing subscribes)
+struct EventTsfn
+{
+    void NonBlockingCall() {}
+};
+#else
+static void DeliverEvents(Napi::Env env, Napi::Function callback, EventChannel *ch, void *);
+using EventTsfn = Napi::TypedThreadSafeFunction<EventChannel, void, DeliverEvents>;
+#endif
+
+struct EventChannel
+{
+    StreamEventQueue queue;
+    // A delivery is queued on the JS thread; later events ride along with it
+    std::atomic<bool> pending{false};
+    std::atomic<uint64_t> dropped{0};
+    // played-out and device-lost are never dropped (end() waits for them):
+    // one that finds the queue full is kept here, latest wins, and
+    // delivered after what the queue holds. Bit i is kStickyEvents[i].
+    std::atomic<uint32_t> stickyPending{0};
+    std::atomic<uint64_t> stickyFrames[2]{};
+    std::atomic<uint64_t> stickyTimestampNs[2]{};
+    EventTsfn tsfn;
+};
+
+static constexpr StreamEventType kStickyEvents[2] = {StreamEventType::PlayedOut, StreamEventType::DeviceLost};
+
+// Any producer thread. Queues the event and, unless a delivery is already
+// pending, schedules one. Never blocks; drops the event if the queue is full
+// (but for played-out and device-lost, which take their reserved slot).
+static void PostStreamEvent(OutputStreamState *s, StreamEventType type, uint64_t frames, uint32_t value = 0)
+{
+    s->eventUsers.fetch_add(1);
+    EventChannel *ch = s->events.load();
+    if (ch)
+    {
+        StreamEvent e;
+        e.type = type;
+        e.value = value;
+        e.frames = frames;
+        e.timestampNs = MonotonicNowNs();
+        bool queued = ch->queue.push(e);
+        if (!queued)
+        {
+            for (size_t i = 0; i < 2; ++i)
+            {
+                if (kStickyEvents[i] != type)
+                    continue;
+                ch->stickyFrames[i].store(e.frames, std::memory_order_relaxed);
+                ch->stickyTimestampNs[i].store(e.timestampNs, std::memory_order_relaxed);
+                ch->stickyPending.fetch_or(1u << i, std::memory_order_release);
+                queued = true;
+            }
+            if (!queued)
+                ch->dropped.fetch_add(1, std::memory_order_relaxed);
         }
+        if (queued && !ch->pending.exchange(true))
+            ch->tsfn.NonBlockingCall();
+    }
+    s->eventUsers.fetch_sub(1);
+}
+
+// Render thread, once the period's clock is published: raises the edge
+// triggered events. A relaxed load when nobody is subscribed.
+static void ProcessStreamEvents(OutputStreamState *s)
+{
+    if (!s->events.load(std::memory_order_relaxed))
+        return;
 
-        size_t chunk = std::min(avail, len - totalWritten);
-        size_t wrote = s->ring.write(src + totalWritten, chunk);
-        totalWritten += wrote;
+    const uint64_t audible = s->clock.audibleFrames();
+    uint64_t underruns = s->telemetry.underrunEpisodes();
+    if (underruns != s->eventUnderruns)
+    {
+        s->eventUnderruns = underruns;
+        PostStreamEvent(s, StreamEventType::Underrun, audible);
+    }
 
-        if (timeoutMs == 0)
+    const bool ended = s->inputEnded.load(std::memory_order_relaxed) || s->decodeFinished.load(std::memory_order_relaxed);
+    const size_t buffered = s->ring.availableToRead();
+    const size_t watermark = s->lowWatermarkBytes.load(std::memory_order_relaxed);
+    if (watermark && !ended && buffered < watermark)
+    {
+        if (!s->belowWatermark && !s->paused.load(std::memory_order_relaxed))
         {
-            // Non-blocking write: write whatever fits and exit
-            break;
+            s->belowWatermark = true;
+            PostStreamEvent(s, StreamEventType::LowWatermark, audible, static_cast<uint32_t>(buffered));
         }
     }
+    else
+    {
+        s->belowWatermark = false;
+    }
+
+    if (!ended)
+    {
+        s->playedOutSent = false;
+    }
+    else if (!s->playedOutSent && buffered < s->bytesPerFrame && s->clock.allAudible())
+    {
+        s->playedOutSent = true;
+        PostStreamEvent(s, StreamEventType::PlayedOut, audible);
+    }
+
+    const uint64_t interval = s->positionIntervalFrames.load(std::memory_order_relaxed);
+    if (interval && (audible >= s->nextPositionFrame || s->nextPositionFrame > audible + interval))
+    {
+        s->nextPositionFrame = audible + interval;
+        PostStreamEvent(s, StreamEventType::Position, audible);
+    }
+}
+
+// Render thread, on its way out after a device error. The members of a bus
+// lose their output with it.
+static void PostDeviceLost(OutputStreamState *s)
+{
+    PostStreamEvent(s, StreamEventType::DeviceLost, s->clock.read().frames);
+    if (!s->busDevice)
+        return;
+    for (OutputStreamState *m : s->busDevice->members.enter())
+        PostStreamEvent(m, StreamEventType::DeviceLost, m->clock.read().frames);
+    s->busDevice->members.exit();
+}
+
+// Render thread: top of a device period, before the ring is read. Pairs with
+// EndRenderCycle(); a period that is retried (xrun recovery, partial write)
+// stays open until it finally completes.
+static inline void BeginRenderCycle(OutputStreamState *s)
+{
+    s->telemetry.begin(MonotonicNowNs(), s->ring.availableToRead(), s->ring.size(), s->sampleRate);
+}
+
+// Render thread: `frames` handed to the device, `content` of them from the
+// ring.
+static inline void EndRenderCycle(OutputStreamState *s, size_t frames, size_t content)
+{
+    uint64_t now = MonotonicNowNs();
+    s->trace.span(RenderTrace::kStagePeriod, s->telemetry.periodStartNs(), now, static_cast<int64_t>(frames));
+    s->telemetry.end(now, frames, content, s->paused.load(std::memory_order_relaxed));
+    ProcessStreamEvents(s);
+}
+
+// Allocates the ring for bufferMs of audio (1..2000 ms), but never less than
+// minFrames, and records the duration it actually got.
+static void InitStreamRing(OutputStreamState *s, double bufferMs, size_t minFrames)
+{
+    if (bufferMs < 1.0)
+        bufferMs = 1.0;
+    if (bufferMs > 2000.0)
+        bufferMs = 2000.0;
+
+    double ringFramesD = (static_cast<double>(s->sampleRate) * bufferMs) / 1000.0;
+    if (ringFramesD < static_cast<double>(minFrames))
+    {
+        ringFramesD = static_cast<double>(minFrames);
+    }
+
+    size_t ringFrames = static_cast<size_t>(ringFramesD);
+    size_t ringBytes = ringFrames * s->bytesPerFrame;
+
+    s->ring.init(ringBytes);
+    // The ring holds exactly ringFrames (its storage is rounded up to a power of two)
+    s->ringDurationMs = static_cast<double>(s->ring.size() / s->bytesPerFrame) * 1000.0 /
+                        static_cast<double>(s->sampleRate);
+}
+
+// Converts the wakeThresholdMs option to bytes once the format is final.
+static void ConfigureWriterWakeup(OutputStreamState *s, double wakeThresholdMs)
+{
+    if (wakeThresholdMs < 0.0)
+        wakeThresholdMs = 0.0;
+    size_t frames = static_cast<size_t>((static_cast<double>(s->sampleRate) * wakeThresholdMs) / 1000.0);
+    size_t bytes = frames * s->bytesPerFrame;
+    if (bytes < s->bytesPerFrame)
+        bytes = s->bytesPerFrame;
+    // Never demand more than half the ring or a parked writer could sleep
+    // until its timeout.
+    if (bytes > s->ring.size() / 2)
+        bytes = s->ring.size() / 2;
+    s->wakeThresholdBytes.store(bytes, std::memory_order_relaxed);
+}
+
+//
+// Shared helper for blocking ring writes
+//
+static size_t WriteToRingBlocking(OutputStreamState *s,
+                                  const uint8_t *src,
+                                  size_t len,
+                                  uint32_t timeoutMs)
+{
+    // CRITICAL FIX: Check running state. If the render thread died, we must stop writing.
+    if (!s || !s->open.load() || !s->running.load() || !src || len == 0)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(s->writerMutex);
 
-    return totalWritten;
+    RingWriter writer{s->ring, s->writerWake, s->writerParks, s->writerSpuriousWakeups, s->trace};
+    return writer.write(src, len, timeoutMs, [s]
+                        { return s->running.load() && s->open.load(); });
 }
 
 #if defined(EXCLUSIVE_WIN32)
 
+// COM apartments are per thread, and a stream is opened, rendered and closed
+// on different ones (JS thread, libuv workers, its render thread). The
+// addon keeps the process MTA up for good, so the stream's objects outlive
+// whichever thread made them, and each call below joins the MTA for its own
+// duration only: CoInitializeEx and CoUninitialize always pair on one thread.
+static void KeepProcessMta()
+{
+    static std::once_flag once;
+    std::call_once(once, []
+                   {
+        CO_MTA_USAGE_COOKIE cookie = nullptr;
+        CoIncrementMTAUsage(&cookie); });
+}
+
+class ComScope
+{
+public:
+    ComScope() : hr(CoInitializeEx(nullptr, COINIT_MULTITHREADED)) {}
+    ~ComScope()
+    {
+        if (SUCCEEDED(hr))
+            CoUninitialize();
+    }
+    ComScope(const ComScope &) = delete;
+    ComScope &operator=(const ComScope &) = delete;
+
+    // An STA thread (RPC_E_CHANGED_MODE) can still use the objects
+    bool ok() const { return SUCCEEDED(hr) || hr == RPC_E_CHANGED_MODE; }
+    HRESULT result() const { return hr; }
+
+private:
+    HRESULT hr;
+};
+
 static HRESULT GetDefaultRenderDevice(IMMDevice **out)
 {
     IMMDeviceEnumerator *enumerator = nullptr;
@@ -411,7 +1069,7 @@ static void WasapiRenderThread(OutputStreamState *s)
         return;
     }
 
-    const UINT32 frameBytes = s->bytesPerFrame;
+    const UINT32 frameBytes = s->deviceBytesPerFrame;
     s->running.store(true);
 
     // Register with MMCSS for high-priority audio processing
@@ -430,8 +1088,6 @@ static void WasapiRenderThread(OutputStreamState *s)
         return;
     }
 
-    std::vector<uint8_t> temp;
-
     while (s->running.load() && s->open.load())
     {
         // Wait for WASAPI to signal that it needs more data
@@ -461,6 +1117,8 @@ static void WasapiRenderThread(OutputStreamState *s)
         if (framesToWrite == 0)
             continue;
 
+        BeginRenderCycle(s);
+
         BYTE *data = nullptr;
         hr = s->renderClient->GetBuffer(framesToWrite, &data);
         if (FAILED(hr) || !data)
@@ -470,6 +1128,7 @@ static void WasapiRenderThread(OutputStreamState *s)
         }
 
         size_t bytesRequested = static_cast<size_t>(framesToWrite) * frameBytes;
+        size_t framesRead = 0;
 
         if (s->paused.load())
         {
@@ -478,23 +1137,9 @@ static void WasapiRenderThread(OutputStreamState *s)
         }
         else
         {
-            temp.resize(bytesRequested);
-            size_t bytesRead = s->ring.read(temp.data(), bytesRequested);
-
-            if (bytesRead > 0)
-            {
-                std::memcpy(data, temp.data(), bytesRead);
-                // If the ring buffer had less than requested, fill the remainder with silence
-                if (bytesRead < bytesRequested)
-                {
-                    std::memset(data + bytesRead, 0, bytesRequested - bytesRead);
-                }
-            }
-            else
-            {
-                // Ring buffer is empty (underrun)
-                std::memset(data, 0, bytesRequested);
-            }
+            // Straight from the ring into the device buffer (converting if the
+            // formats differ), silence-padded if the ring runs short
+            framesRead = RenderFromRing(s, data, framesToWrite);
         }
 
         // Release the buffer to the hardware
@@ -505,15 +1150,23 @@ static void WasapiRenderThread(OutputStreamState *s)
             break;
         }
 
-        // Notify blocking writers (writeAsync workers) that space is now available
-        s->ringCv.notify_all();
+        // Everything queued, including what we just released, plays first
+        s->clock.advance(framesRead, framesToWrite);
+        s->clock.publish(static_cast<int64_t>(padding) + framesToWrite, MonotonicNowNs());
+
+        // Wake a parked writer (writeAsync worker) once enough space is free
+        SignalWriters(s);
+        EndRenderCycle(s, framesToWrite, framesRead);
     }
 
     DBG("WasapiRenderThread: stopping");
+    // Left the loop on an error rather than on close
+    if (s->running.load() && s->open.load())
+        PostDeviceLost(s);
     s->audioClient->Stop();
     s->running.store(false);
     s->open.store(false);
-    s->ringCv.notify_all();
+    s->writerWake.wakeAll();
     if (mmcssHandle)
         AvRevertMmThreadCharacteristics(mmcssHandle);
 }
@@ -530,13 +1183,14 @@ static bool InitWasapi(OutputStreamState *s,
     DBG("InitWasapi: starting");
     DBG(exclusive ? "InitWasapi: exclusive mode" : "InitWasapi: shared mode");
 
-    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-    if (FAILED(hr) && hr != RPC_E_CHANGED_MODE)
+    KeepProcessMta();
+    ComScope com;
+    if (!com.ok())
     {
-        SetLastErrorHr("CoInitializeEx failed", hr);
+        SetLastErrorHr("CoInitializeEx failed", com.result());
         return false;
     }
-    s->coInitialized = SUCCEEDED(hr);
+    HRESULT hr = S_OK;
 
     IMMDevice *device = nullptr;
     if (!deviceId.empty())
@@ -602,49 +1256,24 @@ static bool InitWasapi(OutputStreamState *s,
 
     if (exclusive)
     {
-        // If bitPerfect is true, require exact requested format. If false,
-        // try negotiating down to commonly supported formats (float32 -> int32 -> 24 -> 16).
+        // The ring keeps the stream format; try device formats cheapest
+        // conversion first. With bitPerfect only lossless ones are tried.
         bool found = false;
 
-        std::vector<std::pair<unsigned int, bool>> candidates;
-        if (s->bitDepth == 32)
-        {
-            // try float32 first, then int32, then 24, then 16
-            candidates.push_back({32, true});
-            candidates.push_back({32, false});
-            candidates.push_back({24, false});
-            candidates.push_back({16, false});
-        }
-        else if (s->bitDepth == 24)
-        {
-            candidates.push_back({24, false});
-            candidates.push_back({16, false});
-        }
-        else
-        {
-            candidates.push_back({s->bitDepth, false});
-            if (s->bitDepth != 16)
-                candidates.push_back({16, false});
-        }
-
-        // If bitPerfect requested, narrow candidates to only exact match
-        if (bitPerfect)
-        {
-            candidates.clear();
-            bool isFloat = (s->bitDepth == 32); // prefer float for 32-bit if requested
-            candidates.push_back({s->bitDepth, isFloat});
-        }
-
-        for (const auto &c : candidates)
+        SampleFormat candidates[5];
+        size_t candidateCount = DeviceFormatCandidates(StreamSampleFormat(s), bitPerfect, candidates);
+        for (size_t i = 0; i < candidateCount; ++i)
         {
-            BuildFormat(s->sampleRate, s->channels, c.first, c.second, reqExt);
+            // WAVEFORMATEXTENSIBLE 24-in-32 is left-justified, i.e. S32
+            if (candidates[i] == SampleFormat::S24In32)
+                continue;
+            bool isFloat = candidates[i] == SampleFormat::F32;
+            BuildFormat(s->sampleRate, s->channels, SampleFormatBytes(candidates[i]) * 8, isFloat, reqExt);
             hr = client->IsFormatSupported(
                 AUDCLNT_SHAREMODE_EXCLUSIVE, &reqExt.Format, nullptr);
             if (hr == S_OK)
             {
-                // adopt negotiated format
-                s->bitDepth = c.first;
-                s->bytesPerFrame = (s->bitDepth / 8) * s->channels;
+                SetDeviceFormat(s, candidates[i]);
                 formatToUse = &reqExt.Format;
                 found = true;
                 break;
@@ -680,12 +1309,16 @@ static bool InitWasapi(OutputStreamState *s,
 
         s->sampleRate = mixFormat->nSamplesPerSec;
         s->channels = mixFormat->nChannels;
-        s->bitDepth = mixFormat->wBitsPerSample;
+        s->bytesPerFrame = (s->bitDepth / 8) * s->channels;
+        bool mixFloat = mixFormat->wFormatTag == WAVE_FORMAT_IEEE_FLOAT ||
+                        (mixFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE &&
+                         reinterpret_cast<WAVEFORMATEXTENSIBLE *>(mixFormat)->SubFormat == KSDATAFORMAT_SUBTYPE_IEEE_FLOAT);
+        // The mix format is almost always float32; the ring keeps the stream
+        // format and the render thread converts
+        SetDeviceFormat(s, SampleFormatFor(mixFormat->wBitsPerSample, mixFloat));
         formatToUse = mixFormat;
     }
 
-    s->bytesPerFrame = (s->bitDepth / 8) * s->channels;
-
     REFERENCE_TIME hnsBuffer = 1000000; // 100ms
     HRESULT initHr;
     if (exclusive)
@@ -782,7 +1415,9 @@ static bool InitWasapi(OutputStreamState *s,
     size_t ringBytes = ringFrames * s->bytesPerFrame;
 
     s->ring.init(ringBytes);
-    s->ringDurationMs = static_cast<double>(ringFrames) * 1000.0 / static_cast<double>(s->sampleRate);
+    // The ring holds exactly ringFrames (its storage is rounded up to a power of two)
+    s->ringDurationMs = static_cast<double>(s->ring.size() / s->bytesPerFrame) * 1000.0 /
+                        static_cast<double>(s->sampleRate);
 
     s->open.store(true);
     s->running.store(false);
@@ -795,6 +1430,7 @@ static void CloseWasapi(OutputStreamState *s)
 {
     if (!s)
         return;
+    ComScope com;
 
     // Order matters:
     // 1. Mark open/running false to stop new writes and loop conditions
@@ -806,7 +1442,7 @@ static void CloseWasapi(OutputStreamState *s)
         SetEvent(s->hEvent);
     }
 
-    s->ringCv.notify_all();
+    s->writerWake.wakeAll();
 
     if (s->renderThread.joinable())
     {
@@ -837,12 +1473,6 @@ static void CloseWasapi(OutputStreamState *s)
         CloseHandle(s->hEvent);
         s->hEvent = nullptr;
     }
-
-    if (s->coInitialized)
-    {
-        CoUninitialize();
-        s->coInitialized = false;
-    }
 }
 
 static int WriteWasapi(OutputStreamState *s, const uint8_t *data, size_t len, bool blocking)
@@ -860,6 +1490,7 @@ static int WriteWasapi(OutputStreamState *s, const uint8_t *data, size_t len, bo
     return static_cast<int>(written);
 }
 
+#if !defined(EXCLUSIVE_HEADLESS)
 static Napi::Array GetWasapiDevices(const Napi::Env &env)
 {
     Napi::Array arr = Napi::Array::New(env);
@@ -983,6 +1614,7 @@ static Napi::Array GetWasapiDevices(const Napi::Env &env)
         CoUninitialize();
     return arr;
 }
+#endif
 
 #endif // EXCLUSIVE_WIN32
 
@@ -1009,6 +1641,7 @@ static std::string CFStringToStdString(CFStringRef cfStr)
     return "";
 }
 
+#if !defined(EXCLUSIVE_HEADLESS)
 // Get all audio devices on macOS
 static Napi::Array GetCoreAudioDevices(const Napi::Env &env)
 {
@@ -1182,9 +1815,24 @@ static Napi::Array GetCoreAudioDevices(const Napi::Env &env)
 
     return arr;
 }
+#endif
 
-// Try to set the requested format on macOS
-static bool TrySetFormat(AudioUnit audioUnit,
+// Sample format of an ASBD the output unit reports (first buffer's layout)
+static SampleFormat SampleFormatFromAsbd(const AudioStreamBasicDescription &asbd)
+{
+    bool nonInterleaved = (asbd.mFormatFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+    UInt32 sampleBytes = nonInterleaved || asbd.mChannelsPerFrame == 0
+                             ? asbd.mBytesPerFrame
+                             : asbd.mBytesPerFrame / asbd.mChannelsPerFrame;
+    if (asbd.mFormatFlags & kAudioFormatFlagIsFloat)
+        return SampleFormat::F32;
+    if (asbd.mBitsPerChannel == 24 && sampleBytes == 4)
+        return (asbd.mFormatFlags & kAudioFormatFlagIsAlignedHigh) ? SampleFormat::S32 : SampleFormat::S24In32;
+    return SampleFormatFor(asbd.mBitsPerChannel, false);
+}
+
+// Try to set the requested format on macOS
+static bool TrySetFormat(AudioUnit audioUnit,
                          unsigned int sampleRate,
                          unsigned int channels,
                          unsigned int bitDepth,
@@ -1233,7 +1881,6 @@ static OSStatus CoreAudioRenderCallback(void *inRefCon,
                                         AudioBufferList *ioData)
 {
     (void)ioActionFlags;
-    (void)inTimeStamp;
     (void)inBusNumber;
 
     OutputStreamState *s = static_cast<OutputStreamState *>(inRefCon);
@@ -1247,10 +1894,17 @@ static OSStatus CoreAudioRenderCallback(void *inRefCon,
         return noErr;
     }
 
-    const size_t requestedBytes = static_cast<size_t>(inNumberFrames) * s->bytesPerFrame;
+    const size_t requestedBytes = static_cast<size_t>(inNumberFrames) * s->deviceBytesPerFrame;
     // Track recent hardware callback size for approximate latency reporting
     s->lastHardwarePaddingFrames.store(inNumberFrames);
 
+    // mHostTime is when the first frame of this buffer reaches the output,
+    // so at that instant nothing from this block has been heard yet
+    uint64_t blockTimeNs = (inTimeStamp && (inTimeStamp->mFlags & kAudioTimeStampHostTimeValid))
+                               ? HostTimeToNs(inTimeStamp->mHostTime)
+                               : MonotonicNowNs();
+    BeginRenderCycle(s);
+
     if (s->paused.load())
     {
         // Fill with silence when paused
@@ -1258,22 +1912,20 @@ static OSStatus CoreAudioRenderCallback(void *inRefCon,
         {
             std::memset(ioData->mBuffers[i].mData, 0, ioData->mBuffers[i].mDataByteSize);
         }
-        s->ringCv.notify_all();
+        s->clock.advance(0, inNumberFrames);
+        s->clock.publish(inNumberFrames, blockTimeNs);
+        EndRenderCycle(s, inNumberFrames, 0);
         return noErr;
     }
 
+    size_t framesFromRing = 0;
+
     // For interleaved audio (most common on macOS)
     if (ioData->mNumberBuffers == 1)
     {
         uint8_t *outputBuffer = static_cast<uint8_t *>(ioData->mBuffers[0].mData);
-        size_t bytesFromRing = 0;
-        // Lock-free SPSC read by audio thread
-        bytesFromRing = s->ring.read(outputBuffer, requestedBytes);
-
-        if (bytesFromRing < requestedBytes)
-        {
-            std::memset(outputBuffer + bytesFromRing, 0, requestedBytes - bytesFromRing);
-        }
+        // Lock-free SPSC read by audio thread, converted and silence-padded
+        framesFromRing = RenderFromRing(s, outputBuffer, inNumberFrames);
 
         ioData->mBuffers[0].mDataByteSize = static_cast<UInt32>(requestedBytes);
     }
@@ -1281,17 +1933,12 @@ static OSStatus CoreAudioRenderCallback(void *inRefCon,
     else
     {
         std::vector<uint8_t> interleaved(requestedBytes);
-        size_t bytesFromRing = 0;
 
         // Lock-free SPSC read
-        bytesFromRing = s->ring.read(interleaved.data(), requestedBytes);
-
-        if (bytesFromRing < requestedBytes)
-        {
-            std::memset(interleaved.data() + bytesFromRing, 0, requestedBytes - bytesFromRing);
-        }
+        framesFromRing = RenderFromRing(s, interleaved.data(), inNumberFrames);
 
         // Deinterleave if needed
+        const size_t sampleBytes = SampleFormatBytes(s->deviceFormat);
         UInt32 bytesPerChannel = requestedBytes / ioData->mNumberBuffers;
         for (UInt32 i = 0; i < ioData->mNumberBuffers; ++i)
         {
@@ -1300,18 +1947,18 @@ static OSStatus CoreAudioRenderCallback(void *inRefCon,
             // Extract channel i from interleaved data
             for (UInt32 frame = 0; frame < inNumberFrames; ++frame)
             {
-                size_t srcOffset = frame * s->bytesPerFrame + i * (s->bitDepth / 8);
-                size_t dstOffset = frame * (s->bitDepth / 8);
+                size_t srcOffset = frame * s->deviceBytesPerFrame + i * sampleBytes;
+                size_t dstOffset = frame * sampleBytes;
 
-                if (srcOffset + (s->bitDepth / 8) <= interleaved.size())
+                if (srcOffset + sampleBytes <= interleaved.size())
                 {
                     std::memcpy(channelBuffer + dstOffset,
                                 interleaved.data() + srcOffset,
-                                s->bitDepth / 8);
+                                sampleBytes);
                 }
                 else
                 {
-                    std::memset(channelBuffer + dstOffset, 0, s->bitDepth / 8);
+                    std::memset(channelBuffer + dstOffset, 0, sampleBytes);
                 }
             }
 
@@ -1319,7 +1966,10 @@ static OSStatus CoreAudioRenderCallback(void *inRefCon,
         }
     }
 
-    s->ringCv.notify_all();
+    s->clock.advance(framesFromRing, inNumberFrames);
+    s->clock.publish(inNumberFrames, blockTimeNs);
+    SignalWriters(s);
+    EndRenderCycle(s, inNumberFrames, framesFromRing);
     return noErr;
 }
 
@@ -1490,63 +2140,23 @@ static bool InitCoreAudio(OutputStreamState *s,
         }
     }
 
-    // Try to set the requested format
+    // Try to set the requested format. The ring keeps the stream format;
+    // device formats are tried cheapest conversion first.
     bool formatSet = false;
 
     if (exclusive)
     {
-        // Try different formats in order of preference
-        std::vector<std::pair<unsigned int, bool>> candidates;
-
-        if (s->bitDepth == 32)
-        {
-            if (bitPerfect)
-            {
-                candidates.push_back({32, true});  // Float32
-                candidates.push_back({32, false}); // Int32
-            }
-            else
-            {
-                candidates.push_back({32, true});  // Float32
-                candidates.push_back({32, false}); // Int32
-                candidates.push_back({24, false}); // Int24
-                candidates.push_back({16, false}); // Int16
-            }
-        }
-        else if (s->bitDepth == 24)
-        {
-            if (bitPerfect)
-            {
-                candidates.push_back({24, false}); // Int24
-            }
-            else
-            {
-                candidates.push_back({24, false}); // Int24
-                candidates.push_back({32, true});  // Float32
-                candidates.push_back({32, false}); // Int32
-                candidates.push_back({16, false}); // Int16
-            }
-        }
-        else if (s->bitDepth == 16)
-        {
-            if (bitPerfect)
-            {
-                candidates.push_back({16, false}); // Int16
-            }
-            else
-            {
-                candidates.push_back({16, false}); // Int16
-                candidates.push_back({32, true});  // Float32
-                candidates.push_back({24, false}); // Int24
-            }
-        }
-
-        for (const auto &candidate : candidates)
+        SampleFormat candidates[5];
+        size_t candidateCount = DeviceFormatCandidates(StreamSampleFormat(s), bitPerfect, candidates);
+        for (size_t i = 0; i < candidateCount; ++i)
         {
+            // TrySetFormat only describes packed layouts
+            if (candidates[i] == SampleFormat::S24In32)
+                continue;
             if (TrySetFormat(audioUnit, s->sampleRate, s->channels,
-                             candidate.first, candidate.second))
+                             SampleFormatBytes(candidates[i]) * 8, candidates[i] == SampleFormat::F32))
             {
-                s->bitDepth = candidate.first;
+                SetDeviceFormat(s, candidates[i]);
                 formatSet = true;
                 break;
             }
@@ -1571,7 +2181,7 @@ static bool InitCoreAudio(OutputStreamState *s,
         {
             s->sampleRate = currentASBD.mSampleRate;
             s->channels = currentASBD.mChannelsPerFrame;
-            s->bitDepth = currentASBD.mBitsPerChannel;
+            s->deviceFormat = SampleFormatFromAsbd(currentASBD);
 
             // Try to match requested sample rate if possible
             if (currentASBD.mSampleRate != s->sampleRate)
@@ -1603,7 +2213,9 @@ static bool InitCoreAudio(OutputStreamState *s,
         }
     }
 
+    // Channels may have changed above
     s->bytesPerFrame = (s->bitDepth / 8) * s->channels;
+    SetDeviceFormat(s, s->deviceFormat);
 
     // Set up render callback
     AURenderCallbackStruct renderCallback = {0};
@@ -1650,7 +2262,9 @@ static bool InitCoreAudio(OutputStreamState *s,
     size_t ringBytes = ringFrames * s->bytesPerFrame;
 
     s->ring.init(ringBytes);
-    s->ringDurationMs = static_cast<double>(ringFrames) * 1000.0 / static_cast<double>(s->sampleRate);
+    // The ring holds exactly ringFrames (its storage is rounded up to a power of two)
+    s->ringDurationMs = static_cast<double>(s->ring.size() / s->bytesPerFrame) * 1000.0 /
+                        static_cast<double>(s->sampleRate);
 
     // Start audio unit
     err = AudioOutputUnitStart(audioUnit);
@@ -1691,7 +2305,7 @@ static void CloseCoreAudio(OutputStreamState *s)
 
     s->running.store(false);
     s->open.store(false);
-    s->ringCv.notify_all();
+    s->writerWake.wakeAll();
 
     if (s->audioUnit)
     {
@@ -1706,49 +2320,24 @@ static void CloseCoreAudio(OutputStreamState *s)
 
 #if defined(EXCLUSIVE_LINUX)
 
-// Convert ALSA sample format to bit depth
-static unsigned int AlsaFormatToBitDepth(snd_pcm_format_t format)
-{
-    switch (format)
-    {
-    case SND_PCM_FORMAT_S16_LE:
-    case SND_PCM_FORMAT_S16_BE:
-        return 16;
-    case SND_PCM_FORMAT_S24_LE:
-    case SND_PCM_FORMAT_S24_BE:
-    case SND_PCM_FORMAT_S24_3LE:
-    case SND_PCM_FORMAT_S24_3BE:
-        return 24;
-    case SND_PCM_FORMAT_S32_LE:
-    case SND_PCM_FORMAT_S32_BE:
-        return 32;
-    case SND_PCM_FORMAT_FLOAT_LE:
-    case SND_PCM_FORMAT_FLOAT_BE:
-        return 32; // Float32
-    default:
-        return 16;
-    }
-}
-
-// Convert bit depth to ALSA sample format
-static snd_pcm_format_t BitDepthToAlsaFormat(unsigned int bitDepth, bool isFloat)
+// Little-endian ALSA format for a sample format. Note that ALSA's S24_LE is
+// the 4-byte container; packed 3-byte samples are S24_3LE.
+static snd_pcm_format_t ToAlsaFormat(SampleFormat f)
 {
-    if (isFloat && bitDepth == 32)
-    {
-        return SND_PCM_FORMAT_FLOAT_LE;
-    }
-
-    switch (bitDepth)
+    switch (f)
     {
-    case 16:
+    case SampleFormat::S16:
         return SND_PCM_FORMAT_S16_LE;
-    case 24:
+    case SampleFormat::S24:
+        return SND_PCM_FORMAT_S24_3LE;
+    case SampleFormat::S24In32:
         return SND_PCM_FORMAT_S24_LE;
-    case 32:
+    case SampleFormat::S32:
         return SND_PCM_FORMAT_S32_LE;
-    default:
-        return SND_PCM_FORMAT_S16_LE;
+    case SampleFormat::F32:
+        return SND_PCM_FORMAT_FLOAT_LE;
     }
+    return SND_PCM_FORMAT_S16_LE;
 }
 
 // Try to set hardware parameters
@@ -1771,114 +2360,37 @@ static bool TrySetAlsaParams(snd_pcm_t *pcm,
         return false;
     }
 
-    // Set access type (exclusive or shared)
-    snd_pcm_access_t access = exclusive ? SND_PCM_ACCESS_RW_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED;
-    err = snd_pcm_hw_params_set_access(pcm, hwParams, access);
-    if (err < 0)
+    // Prefer mmap, so the render thread writes the ring straight into the
+    // DMA area; plugins without it fall back to writei
+    s->alsaMmap = snd_pcm_hw_params_set_access(pcm, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED) >= 0;
+    if (!s->alsaMmap)
     {
-        if (exclusive)
-        {
-            // Try shared mode if exclusive fails
-            access = SND_PCM_ACCESS_RW_INTERLEAVED;
-            err = snd_pcm_hw_params_set_access(pcm, hwParams, access);
-            if (err < 0)
-            {
-                SetLastErrorAlsa("Cannot set access type", err);
-                return false;
-            }
-        }
-        else
+        err = snd_pcm_hw_params_set_access(pcm, hwParams, SND_PCM_ACCESS_RW_INTERLEAVED);
+        if (err < 0)
         {
             SetLastErrorAlsa("Cannot set access type", err);
             return false;
         }
     }
 
-    // Try different formats
+    // The ring keeps the stream format; pick the device format that needs
+    // the cheapest conversion from it (none, ideally). The "default" plug
+    // device accepts anything, so shared mode normally gets an exact match.
+    SampleFormat candidates[5];
+    size_t candidateCount = DeviceFormatCandidates(StreamSampleFormat(s), exclusive && bitPerfect, candidates);
     bool formatSet = false;
-
-    if (exclusive)
+    for (size_t i = 0; i < candidateCount && !formatSet; ++i)
     {
-        // Try different formats in order of preference
-        std::vector<std::pair<unsigned int, bool>> candidates;
-
-        if (s->bitDepth == 32)
-        {
-            if (bitPerfect)
-            {
-                candidates.push_back({32, true});  // Float32
-                candidates.push_back({32, false}); // Int32
-            }
-            else
-            {
-                candidates.push_back({32, true});  // Float32
-                candidates.push_back({32, false}); // Int32
-                candidates.push_back({24, false}); // Int24
-                candidates.push_back({16, false}); // Int16
-            }
-        }
-        else if (s->bitDepth == 24)
-        {
-            if (bitPerfect)
-            {
-                candidates.push_back({24, false}); // Int24
-            }
-            else
-            {
-                candidates.push_back({24, false}); // Int24
-                candidates.push_back({32, true});  // Float32
-                candidates.push_back({32, false}); // Int32
-                candidates.push_back({16, false}); // Int16
-            }
-        }
-        else if (s->bitDepth == 16)
-        {
-            if (bitPerfect)
-            {
-                candidates.push_back({16, false}); // Int16
-            }
-            else
-            {
-                candidates.push_back({16, false}); // Int16
-                candidates.push_back({32, true});  // Float32
-                candidates.push_back({24, false}); // Int24
-            }
-        }
-
-        for (const auto &candidate : candidates)
+        if (snd_pcm_hw_params_set_format(pcm, hwParams, ToAlsaFormat(candidates[i])) >= 0)
         {
-            snd_pcm_format_t format = BitDepthToAlsaFormat(candidate.first, candidate.second);
-            err = snd_pcm_hw_params_set_format(pcm, hwParams, format);
-            if (err >= 0)
-            {
-                s->bitDepth = candidate.first;
-                formatSet = true;
-                break;
-            }
+            SetDeviceFormat(s, candidates[i]);
+            formatSet = true;
         }
     }
-
-    // If exclusive mode failed or not requested, try to get a supported format
     if (!formatSet)
     {
-        // Get first supported format
-        snd_pcm_format_t format;
-        err = snd_pcm_hw_params_get_format(hwParams, &format);
-        if (err >= 0)
-        {
-            s->bitDepth = AlsaFormatToBitDepth(format);
-        }
-        else
-        {
-            // Default to S16_LE
-            err = snd_pcm_hw_params_set_format(pcm, hwParams, SND_PCM_FORMAT_S16_LE);
-            if (err < 0)
-            {
-                SetLastErrorAlsa("Cannot set sample format", err);
-                return false;
-            }
-            s->bitDepth = 16;
-        }
+        SetLastErrorAlsa("No usable sample format", -EINVAL);
+        return false;
     }
 
     // Set channels
@@ -1920,22 +2432,30 @@ static bool TrySetAlsaParams(snd_pcm_t *pcm,
     }
     s->sampleRate = actualRate;
 
-    // Set buffer size based on latency
-    snd_pcm_uframes_t bufferSize = (s->sampleRate * 100) / 1000; // 100ms default
-    snd_pcm_uframes_t periodSize = bufferSize / 4;               // 4 periods per buffer
+    // Hardware buffer. The period is the wakeup interval, so it goes first;
+    // then the period count, or failing that the nearest total size. Each
+    // call moves to the closest value the device allows.
+    const HwBufferRequest &req = s->hwRequest;
+    snd_pcm_uframes_t periodSize = RequestedPeriodFrames(req, s->sampleRate);
 
-    err = snd_pcm_hw_params_set_buffer_size_near(pcm, hwParams, &bufferSize);
+    err = snd_pcm_hw_params_set_period_size_near(pcm, hwParams, &periodSize, 0);
     if (err < 0)
     {
-        SetLastErrorAlsa("Cannot set buffer size", err);
+        SetLastErrorAlsa("Cannot set period size", err);
         return false;
     }
 
-    err = snd_pcm_hw_params_set_period_size_near(pcm, hwParams, &periodSize, 0);
+    unsigned int periods = req.periods;
+    err = snd_pcm_hw_params_set_periods_near(pcm, hwParams, &periods, 0);
     if (err < 0)
     {
-        SetLastErrorAlsa("Cannot set period size", err);
-        return false;
+        snd_pcm_uframes_t bufferSize = periodSize * req.periods;
+        err = snd_pcm_hw_params_set_buffer_size_near(pcm, hwParams, &bufferSize);
+        if (err < 0)
+        {
+            SetLastErrorAlsa("Cannot set buffer size", err);
+            return false;
+        }
     }
 
     // Apply hardware parameters
@@ -1950,12 +2470,151 @@ static bool TrySetAlsaParams(snd_pcm_t *pcm,
     snd_pcm_hw_params_get_buffer_size(hwParams, &s->bufferSize);
     snd_pcm_hw_params_get_period_size(hwParams, &s->periodSize, 0);
 
+    // poll() wakes once a period is free; the render thread starts the
+    // device itself once the buffer is full. Timestamp status reports on
+    // the monotonic clock (getPosition). Not every plugin supports that;
+    // AlsaPublishPosition falls back to our own clock.
+    snd_pcm_sw_params_t *swParams;
+    snd_pcm_sw_params_alloca(&swParams);
+    if (snd_pcm_sw_params_current(pcm, swParams) == 0)
+    {
+        snd_pcm_sw_params_set_avail_min(pcm, swParams, s->periodSize);
+        snd_pcm_sw_params_set_start_threshold(pcm, swParams, s->bufferSize);
+        snd_pcm_sw_params_set_tstamp_mode(pcm, swParams, SND_PCM_TSTAMP_ENABLE);
+        snd_pcm_sw_params_set_tstamp_type(pcm, swParams, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+        snd_pcm_sw_params(pcm, swParams);
+    }
+
+    // Channels may have changed above
     s->bytesPerFrame = (s->bitDepth / 8) * s->channels;
+    SetDeviceFormat(s, s->deviceFormat);
+
+    return true;
+}
 
+// Reads delay and its timestamp in one snd_pcm_status() call, so the pair
+// is consistent, and publishes the audible position.
+static void AlsaPublishPosition(OutputStreamState *s, snd_pcm_status_t *status)
+{
+    if (snd_pcm_status(s->pcmHandle, status) < 0)
+        return;
+
+    snd_pcm_sframes_t delayFrames = snd_pcm_status_get_delay(status);
+    snd_htimestamp_t ts;
+    snd_pcm_status_get_htstamp(status, &ts);
+    uint64_t timestampNs = (ts.tv_sec || ts.tv_nsec)
+                               ? static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec)
+                               : MonotonicNowNs();
+
+    if (delayFrames >= 0)
+        s->lastHardwarePaddingFrames.store(static_cast<uint32_t>(delayFrames));
+    s->clock.publish(delayFrames, timestampNs);
+    s->trace.mark(RenderTrace::kStageHwDelay, delayFrames);
+}
+
+// Brings the PCM back after an xrun or a suspend. Returns false if it
+// can't be recovered.
+static bool AlsaRecover(OutputStreamState *s, int err)
+{
+    if (err == -EPIPE || err == -ESTRPIPE)
+        s->telemetry.deviceXrun();
+    s->trace.mark(RenderTrace::kStageXrun, err);
+    err = snd_pcm_recover(s->pcmHandle, err, 1);
+    if (err < 0)
+    {
+        SetLastErrorAlsa("Cannot recover from underrun", err);
+        return false;
+    }
     return true;
 }
 
-// ALSA render thread
+// Fills `frames` device frames at dst: the ring's content, or silence while
+// paused. Returns the frames that came from the ring.
+static size_t AlsaRender(OutputStreamState *s, uint8_t *dst, size_t frames)
+{
+    if (s->paused.load(std::memory_order_relaxed))
+    {
+        std::memset(dst, 0, frames * s->deviceBytesPerFrame);
+        return 0;
+    }
+    uint64_t start = s->trace.stamp();
+    size_t content = RenderFromRing(s, dst, frames);
+    s->trace.span(RenderTrace::kStageRingRead, start, s->trace.stamp(), static_cast<int64_t>(content));
+    return content;
+}
+
+// Sleeps until the device has room for a period, the PCM reports an error
+// or the wake eventfd fires. Starts the device first if it is still waiting
+// for data (everything we could write is in). Returns a negative ALSA error
+// for the caller to recover from, 0 otherwise.
+static int AlsaWait(OutputStreamState *s, std::vector<pollfd> &fds)
+{
+    if (snd_pcm_state(s->pcmHandle) == SND_PCM_STATE_PREPARED)
+    {
+        int err = snd_pcm_start(s->pcmHandle);
+        if (err < 0)
+            return err;
+    }
+
+    int n = poll(fds.data(), static_cast<nfds_t>(fds.size()), 1000);
+    if (n <= 0)
+        return 0;
+
+    pollfd &wake = fds.back();
+    if (wake.revents & POLLIN)
+    {
+        uint64_t value;
+        ssize_t r = read(wake.fd, &value, sizeof(value));
+        (void)r;
+    }
+
+    unsigned short revents = 0;
+    snd_pcm_poll_descriptors_revents(s->pcmHandle, fds.data(), static_cast<unsigned int>(fds.size() - 1), &revents);
+    if (revents & POLLERR)
+    {
+        snd_pcm_state_t state = snd_pcm_state(s->pcmHandle);
+        if (state == SND_PCM_STATE_XRUN)
+            return -EPIPE;
+        if (state == SND_PCM_STATE_SUSPENDED)
+            return -ESTRPIPE;
+    }
+    return 0;
+}
+
+// Render thread, at start: scheduling class and CPU pinning for itself,
+// and with lockMemory the pages the render loop touches - the stream
+// state, ring, conversion scratch, staging block and its own stack.
+// fadeRing is locked by setCrossfade, which allocates it.
+static void ApplyRenderThreadPolicy(OutputStreamState *s, const std::vector<uint8_t> &staging)
+{
+    RealtimeReport report;
+    realtime::ApplyToCurrentThread(s->realtime, report);
+
+    if (s->realtime.lockMemory)
+    {
+        LockedMemory &locked = s->lockedMemory;
+        bool ok = locked.lock(s, sizeof(*s)) && locked.lock(s->convertScratch.data(), s->convertScratch.size()) &&
+                  locked.lock(staging.data(), staging.size()) && realtime::LockStack(locked);
+        // A shared ring's storage is the JS SharedArrayBuffer, attached later
+        if (ok && !s->sharedRing)
+            ok = locked.lock(s->ring.data, s->ring.capacity);
+        if (!ok)
+            realtime::AppendNote(report, "mlock failed (RLIMIT_MEMLOCK)");
+        report.memoryLocked = ok;
+        report.lockedBytes = locked.bytes();
+    }
+
+    std::lock_guard<std::mutex> lock(s->realtimeMutex);
+    s->realtimeReport = report;
+    s->realtimeApplied = true;
+}
+
+// ALSA render thread. Non-blocking: poll() on the PCM's descriptors plus
+// the wake eventfd paces it, so CloseAlsa never waits on the device.
+//
+// mmap renders each chunk straight into the DMA area (one pass, converting
+// on the way if the device format differs). writei renders into a staging
+// block first and keeps whatever a short write left over for the next pass.
 static void AlsaRenderThread(OutputStreamState *s)
 {
     if (!s || !s->pcmHandle)
@@ -1965,77 +2624,154 @@ static void AlsaRenderThread(OutputStreamState *s)
 
     s->running.store(true);
 
-    std::vector<uint8_t> tempBuffer(s->periodSize * s->bytesPerFrame);
+    snd_pcm_t *pcm = s->pcmHandle;
+    const size_t bpf = s->deviceBytesPerFrame;
+    snd_pcm_status_t *status;
+    snd_pcm_status_alloca(&status);
+
+    int pcmFds = std::max(0, snd_pcm_poll_descriptors_count(pcm));
+    std::vector<pollfd> fds(static_cast<size_t>(pcmFds) + 1);
+    snd_pcm_poll_descriptors(pcm, fds.data(), static_cast<unsigned int>(pcmFds));
+    fds.back().fd = s->wakeFd;
+    fds.back().events = POLLIN;
+
+    // writei staging: [stagedOffset, stagedFrames) not yet accepted
+    std::vector<uint8_t> staging(s->alsaMmap ? 0 : s->periodSize * bpf);
+    snd_pcm_uframes_t stagedFrames = 0;
+    snd_pcm_uframes_t stagedOffset = 0;
+    size_t stagedContent = 0;
+
+    ApplyRenderThreadPolicy(s, staging);
 
     while (s->running.load())
     {
-        if (s->paused.load())
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+        if (avail < 0)
         {
-            // Fill buffer with silence when paused
-            std::memset(tempBuffer.data(), 0, tempBuffer.size());
-
-            int err = snd_pcm_writei(s->pcmHandle, tempBuffer.data(), s->periodSize);
-            if (err == -EPIPE)
-            {
-                // Underrun occurred
-                snd_pcm_prepare(s->pcmHandle);
-            }
-            else if (err < 0)
-            {
-                SetLastErrorAlsa("Write error", err);
+            if (!AlsaRecover(s, static_cast<int>(avail)))
                 break;
-            }
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
             continue;
         }
-
-        size_t bytesToRead = s->periodSize * s->bytesPerFrame;
-        size_t bytesRead = 0;
-
-        // Lock-free SPSC read on audio/render thread
-        bytesRead = s->ring.read(tempBuffer.data(), bytesToRead);
-
-        if (bytesRead < bytesToRead)
+        if (static_cast<snd_pcm_uframes_t>(avail) < s->periodSize)
         {
-            // Fill remaining with silence
-            std::memset(tempBuffer.data() + bytesRead, 0, bytesToRead - bytesRead);
+            uint64_t waitStart = s->trace.stamp();
+            int err = AlsaWait(s, fds);
+            s->trace.span(RenderTrace::kStageWait, waitStart, s->trace.stamp(), avail);
+            if (err < 0 && !AlsaRecover(s, err))
+                break;
+            continue;
         }
 
-        snd_pcm_sframes_t framesToWrite = bytesToRead / s->bytesPerFrame;
-        snd_pcm_sframes_t framesWritten = snd_pcm_writei(s->pcmHandle, tempBuffer.data(), framesToWrite);
-
-        if (framesWritten == -EPIPE)
+        BeginRenderCycle(s);
+        snd_pcm_uframes_t frames = s->periodSize;
+        size_t content = 0;
+        snd_pcm_sframes_t done;
+        if (s->alsaMmap)
         {
-            // Underrun occurred
-            int err = snd_pcm_prepare(s->pcmHandle);
+            const snd_pcm_channel_area_t *areas;
+            snd_pcm_uframes_t offset;
+            int err = snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);
             if (err < 0)
             {
-                SetLastErrorAlsa("Cannot recover from underrun", err);
-                break;
+                if (!AlsaRecover(s, err))
+                    break;
+                continue;
+            }
+            // Interleaved access: every channel in one area, frames contiguous
+            uint8_t *dst = static_cast<uint8_t *>(areas[0].addr) + areas[0].first / 8 + offset * (areas[0].step / 8);
+            content = AlsaRender(s, dst, frames);
+            // A short commit is not an error: the rest of the block is still
+            // in the area, right after what the device took, so commit it
+            // once there is room. Only a negative return needs recovery.
+            snd_pcm_uframes_t committed = 0;
+            done = 0;
+            while (committed < frames)
+            {
+                uint64_t commitStart = s->trace.stamp();
+                snd_pcm_sframes_t n = snd_pcm_mmap_commit(pcm, offset + committed, frames - committed);
+                s->trace.span(RenderTrace::kStageDeviceWrite, commitStart, s->trace.stamp(), n);
+                if (n < 0)
+                {
+                    done = n;
+                    break;
+                }
+                committed += static_cast<snd_pcm_uframes_t>(n);
+                if (committed == frames)
+                    break;
+                s->telemetry.shortWrite();
+                uint64_t waitStart = s->trace.stamp();
+                int err = AlsaWait(s, fds);
+                s->trace.span(RenderTrace::kStageWait, waitStart, s->trace.stamp(), 0);
+                if (err < 0)
+                {
+                    done = err;
+                    break;
+                }
+                if (!s->running.load())
+                    break;
+            }
+            if (done >= 0)
+            {
+                done = static_cast<snd_pcm_sframes_t>(committed);
+                frames = committed;
             }
         }
-        else if (framesWritten < 0)
-        {
-            SetLastErrorAlsa("Write error", framesWritten);
-            break;
-        }
-        else if (framesWritten < framesToWrite)
+        else
         {
-            // Short write
-            // We'll handle this by trying again next iteration
+            if (stagedFrames == 0)
+            {
+                stagedContent = AlsaRender(s, staging.data(), s->periodSize);
+                stagedFrames = s->periodSize;
+                stagedOffset = 0;
+            }
+            uint64_t writeStart = s->trace.stamp();
+            done = snd_pcm_writei(pcm, staging.data() + stagedOffset * bpf, stagedFrames);
+            s->trace.span(RenderTrace::kStageDeviceWrite, writeStart, s->trace.stamp(), done);
+            if (done == -EAGAIN)
+            {
+                uint64_t waitStart = s->trace.stamp();
+                int err = AlsaWait(s, fds);
+                s->trace.span(RenderTrace::kStageWait, waitStart, s->trace.stamp(), 0);
+                if (err < 0 && !AlsaRecover(s, err))
+                    break;
+                continue;
+            }
+            if (done >= 0)
+            {
+                stagedOffset += static_cast<snd_pcm_uframes_t>(done);
+                stagedFrames -= static_cast<snd_pcm_uframes_t>(done);
+                // Counted once the whole block is in, short writes included
+                if (stagedFrames > 0)
+                {
+                    s->telemetry.shortWrite();
+                    continue;
+                }
+                frames = s->periodSize;
+                content = stagedContent;
+            }
         }
 
-        // Try to get ALSA delay (frames in hardware buffer) for stats
-        snd_pcm_sframes_t delayFrames = 0;
-        if (snd_pcm_delay(s->pcmHandle, &delayFrames) == 0 && delayFrames >= 0)
+        if (done < 0)
         {
-            s->lastHardwarePaddingFrames.store(static_cast<uint32_t>(delayFrames));
+            // The block is lost either way; its content counts as played
+            s->clock.advance(s->alsaMmap ? content : stagedContent, 0);
+            stagedFrames = 0;
+            if (!AlsaRecover(s, static_cast<int>(done)))
+                break;
+            continue;
         }
-        s->ringCv.notify_all();
+
+        s->clock.advance(content, frames);
+        AlsaPublishPosition(s, status);
+        SignalWriters(s);
+        EndRenderCycle(s, frames, content);
     }
 
+    // Left the loop because recovery failed rather than on close
+    if (s->running.load())
+        PostDeviceLost(s);
     s->running.store(false);
+    s->writerWake.wakeAll();
 }
 
 // Initialize ALSA
@@ -2053,9 +2789,9 @@ static bool InitAlsa(OutputStreamState *s,
     // Default ALSA device if none specified
     const char *device = deviceId.empty() ? "default" : deviceId.c_str();
 
-    // Open PCM device
+    // Open PCM device; the render thread never blocks in ALSA
     snd_pcm_t *pcm = nullptr;
-    int err = snd_pcm_open(&pcm, device, SND_PCM_STREAM_PLAYBACK, 0);
+    int err = snd_pcm_open(&pcm, device, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
     if (err < 0)
     {
         SetLastErrorAlsa("Cannot open audio device", err);
@@ -2069,24 +2805,9 @@ static bool InitAlsa(OutputStreamState *s,
         return false;
     }
 
-    // Configure ring buffer
-    if (bufferMs < 20.0)
-        bufferMs = 20.0;
-    if (bufferMs > 2000.0)
-        bufferMs = 2000.0;
-
-    double ringFramesD = (static_cast<double>(s->sampleRate) * bufferMs) / 1000.0;
-    // Ensure at least 4 periods
-    if (ringFramesD < static_cast<double>(s->periodSize) * 4)
-    {
-        ringFramesD = static_cast<double>(s->periodSize) * 4;
-    }
-
-    size_t ringFrames = static_cast<size_t>(ringFramesD);
-    size_t ringBytes = ringFrames * s->bytesPerFrame;
-
-    s->ring.init(ringBytes);
-    s->ringDurationMs = static_cast<double>(ringFrames) * 1000.0 / static_cast<double>(s->sampleRate);
+    // Configure ring buffer. No fixed floor: at low latency classes the
+    // ring may be a few milliseconds, bounded below by 4 periods
+    InitStreamRing(s, bufferMs, s->periodSize * 4);
 
     // Start playback
     err = snd_pcm_prepare(pcm);
@@ -2097,6 +2818,14 @@ static bool InitAlsa(OutputStreamState *s,
         return false;
     }
 
+    s->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (s->wakeFd < 0)
+    {
+        snd_pcm_close(pcm);
+        SetLastErrorAlsa("Cannot create wakeup eventfd", -errno);
+        return false;
+    }
+
     s->pcmHandle = pcm;
     s->open.store(true);
 
@@ -2128,7 +2857,15 @@ static void CloseAlsa(OutputStreamState *s)
 
     s->running.store(false);
     s->open.store(false);
-    s->ringCv.notify_all();
+    s->writerWake.wakeAll();
+
+    // Out of poll() at once, rather than at the next period
+    if (s->wakeFd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t r = write(s->wakeFd, &one, sizeof(one));
+        (void)r;
+    }
 
     if (s->renderThread.joinable())
     {
@@ -2137,12 +2874,22 @@ static void CloseAlsa(OutputStreamState *s)
 
     if (s->pcmHandle)
     {
-        snd_pcm_drain(s->pcmHandle); // Drain remaining samples
+        // Drain remaining samples; drain only waits in blocking mode
+        snd_pcm_nonblock(s->pcmHandle, 0);
+        snd_pcm_drain(s->pcmHandle);
         snd_pcm_close(s->pcmHandle);
         s->pcmHandle = nullptr;
     }
+
+    if (s->wakeFd >= 0)
+    {
+        close(s->wakeFd);
+        s->wakeFd = -1;
+    }
+    s->lockedMemory.unlockAll();
 }
 
+#if !defined(EXCLUSIVE_HEADLESS)
 static Napi::Array GetAlsaDevices(const Napi::Env &env)
 {
     Napi::Array arr = Napi::Array::New(env);
@@ -2208,628 +2955,3813 @@ static Napi::Array GetAlsaDevices(const Napi::Env &env)
 
     return arr;
 }
+#endif
 
 #endif // EXCLUSIVE_LINUX
 
+#if defined(EXCLUSIVE_PIPEWIRE)
 //
-// N-API exports
+// Native PipeWire backend (openOutput({ backend: 'pipewire' })): a pw_stream
+// on its own thread loop instead of the pipewire-alsa bridge.
+//
+//   - deviceId targets a node directly (node.name or object.serial); empty
+//     leaves the choice to the session manager
+//   - the requested period becomes node.latency; the graph may still run
+//     at a smaller quantum, and each cycle asks for what it runs at
+//   - node.rate asks the graph to switch to the stream's rate, so with a
+//     matching format the adapter passes samples through unconverted;
+//     exclusive mode also locks the rate and takes the device exclusively
+//
+// process() runs on PipeWire's real-time data thread and is the render
+// thread for this backend: ring, render stages, clock and writer wakeups
+// work as they do for ALSA.
 //
 
-static Napi::Value OpenOutput(const Napi::CallbackInfo &info)
+static spa_audio_format ToSpaFormat(SampleFormat f)
 {
-    Napi::Env env = info.Env();
-    if (info.Length() < 1 || !info[0].IsObject())
+    switch (f)
     {
-        ThrowTypeError(env, "openOutput(options) requires an options object");
-        return env.Null();
-    }
-
-    Napi::Object opts = info[0].As<Napi::Object>();
-
-    std::string deviceId;
-    if (opts.Has("deviceId") && opts.Get("deviceId").IsString())
-    {
-        deviceId = opts.Get("deviceId").As<Napi::String>().Utf8Value();
+    case SampleFormat::S16:
+        return SPA_AUDIO_FORMAT_S16_LE;
+    case SampleFormat::S24:
+        return SPA_AUDIO_FORMAT_S24_LE; // packed 3-byte
+    case SampleFormat::S24In32:
+        return SPA_AUDIO_FORMAT_S24_32_LE;
+    case SampleFormat::S32:
+        return SPA_AUDIO_FORMAT_S32_LE;
+    case SampleFormat::F32:
+        return SPA_AUDIO_FORMAT_F32_LE;
     }
+    return SPA_AUDIO_FORMAT_UNKNOWN;
+}
 
-    unsigned int sampleRate = 44100;
-    unsigned int channels = 2;
-    unsigned int bitDepth = 16;
-
-    if (opts.Has("sampleRate"))
-    {
-        sampleRate = opts.Get("sampleRate").As<Napi::Number>().Uint32Value();
-    }
-    if (opts.Has("channels"))
+// Conventional channel order for common layouts; anything else goes
+// unpositioned and the adapter maps channels by index
+static void SetSpaPositions(spa_audio_info_raw &info)
+{
+    static const std::vector<uint32_t> layouts[] = {
+        {},
+        {SPA_AUDIO_CHANNEL_MONO},
+        {SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR},
+        {SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, SPA_AUDIO_CHANNEL_FC},
+        {SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, SPA_AUDIO_CHANNEL_RL, SPA_AUDIO_CHANNEL_RR},
+        {SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_RL, SPA_AUDIO_CHANNEL_RR},
+        {SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE, SPA_AUDIO_CHANNEL_RL,
+         SPA_AUDIO_CHANNEL_RR},
+        {SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE, SPA_AUDIO_CHANNEL_RC,
+         SPA_AUDIO_CHANNEL_SL, SPA_AUDIO_CHANNEL_SR},
+        {SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE, SPA_AUDIO_CHANNEL_RL,
+         SPA_AUDIO_CHANNEL_RR, SPA_AUDIO_CHANNEL_SL, SPA_AUDIO_CHANNEL_SR},
+    };
+    if (info.channels < sizeof(layouts) / sizeof(layouts[0]) && !layouts[info.channels].empty())
     {
-        channels = opts.Get("channels").As<Napi::Number>().Uint32Value();
+        for (size_t i = 0; i < layouts[info.channels].size(); ++i)
+            info.position[i] = layouts[info.channels][i];
     }
-    if (opts.Has("bitDepth"))
+    else
     {
-        bitDepth = opts.Get("bitDepth").As<Napi::Number>().Uint32Value();
+        info.flags |= SPA_AUDIO_FLAG_UNPOSITIONED;
     }
+}
 
-    std::string mode = "exclusive";
-    if (opts.Has("mode") && opts.Get("mode").IsString())
+static void PwOnStateChanged(void *data, pw_stream_state old, pw_stream_state state, const char *error)
+{
+    (void)old;
+    auto *s = static_cast<OutputStreamState *>(data);
+    s->pwState = state;
+    if (error)
+        s->pwError = error;
+    if (state == PW_STREAM_STATE_ERROR)
     {
-        mode = opts.Get("mode").As<Napi::String>().Utf8Value();
+        // Node gone or daemon restarted: stop like a PCM that can't recover.
+        // Not the data thread, so a bus's members are not told from here.
+        if (s->running.load())
+            PostStreamEvent(s, StreamEventType::DeviceLost, s->clock.read().frames);
+        s->running.store(false);
+        s->writerWake.wakeAll();
     }
+    pw_thread_loop_signal(s->pwLoop, false);
+}
 
-    double bufferMs = 250.0;
+static void PwOnParamChanged(void *data, uint32_t id, const spa_pod *param)
+{
+    auto *s = static_cast<OutputStreamState *>(data);
+    if (!param || id != SPA_PARAM_Latency)
+        return;
+    // Input direction on our output port: the latency downstream, to the sink
+    spa_latency_info info;
+    if (spa_latency_parse(param, &info) < 0 || info.direction != SPA_DIRECTION_INPUT)
+        return;
+    s->pwLatency = info;
+    s->pwHaveLatency = true;
+}
+
+static void PwOnProcess(void *data)
+{
+    auto *s = static_cast<OutputStreamState *>(data);
+    pw_buffer *b = pw_stream_dequeue_buffer(s->pwStream);
+    if (!b)
+        return;
+    spa_data &d = b->buffer->datas[0];
+    if (!d.data)
+    {
+        pw_stream_queue_buffer(s->pwStream, b);
+        return;
+    }
+
+    const uint32_t stride = s->deviceBytesPerFrame;
+    uint32_t frames = d.maxsize / stride;
+    if (b->requested)
+        frames = std::min<uint32_t>(frames, static_cast<uint32_t>(b->requested));
+
+    BeginRenderCycle(s);
+    uint8_t *dst = static_cast<uint8_t *>(d.data);
+    size_t content = 0;
+    if (s->paused.load(std::memory_order_relaxed))
+        std::memset(dst, 0, static_cast<size_t>(frames) * stride);
+    else
+        content = RenderFromRing(s, dst, frames);
+
+    d.chunk->offset = 0;
+    d.chunk->stride = static_cast<int32_t>(stride);
+    d.chunk->size = frames * stride;
+    b->size = frames; // summed into pw_time.queued
+    pw_stream_queue_buffer(s->pwStream, b);
+    s->pwQuantum.store(frames, std::memory_order_relaxed);
+
+    // Graph delay is in ticks of t.rate; the data we have queued but the
+    // graph has not taken yet comes on top
+    int64_t delayFrames = 0;
+    uint64_t timestampNs = MonotonicNowNs();
+    pw_time t{};
+    if (pw_stream_get_time_n(s->pwStream, &t, sizeof(t)) == 0)
+    {
+        if (t.rate.denom)
+        {
+            uint32_t previous = s->pwGraphRate.exchange(t.rate.denom, std::memory_order_relaxed);
+            if (previous && previous != t.rate.denom)
+                PostStreamEvent(s, StreamEventType::FormatChanged, s->clock.audibleFrames(), t.rate.denom);
+            delayFrames = t.delay * static_cast<int64_t>(t.rate.num) * s->sampleRate / t.rate.denom;
+        }
+        delayFrames += static_cast<int64_t>(t.queued);
+        if (t.now > 0)
+            timestampNs = static_cast<uint64_t>(t.now);
+    }
+
+    if (delayFrames >= 0)
+        s->lastHardwarePaddingFrames.store(static_cast<uint32_t>(delayFrames));
+    s->clock.advance(content, frames);
+    s->clock.publish(delayFrames, timestampNs);
+    SignalWriters(s);
+    EndRenderCycle(s, frames, content);
+}
+
+static const pw_stream_events *PwStreamEvents()
+{
+    static const pw_stream_events events = []
+    {
+        pw_stream_events e{};
+        e.version = PW_VERSION_STREAM_EVENTS;
+        e.state_changed = PwOnStateChanged;
+        e.param_changed = PwOnParamChanged;
+        e.process = PwOnProcess;
+        return e;
+    }();
+    return &events;
+}
+
+// Stops the loop, then tears the stream down from this thread. Safe on a
+// partly initialized stream.
+static void DestroyPipeWire(OutputStreamState *s)
+{
+    if (s->pwLoop)
+        pw_thread_loop_stop(s->pwLoop);
+    if (s->pwStream)
+    {
+        pw_stream_destroy(s->pwStream);
+        s->pwStream = nullptr;
+    }
+    if (s->pwLoop)
+    {
+        pw_thread_loop_destroy(s->pwLoop);
+        s->pwLoop = nullptr;
+    }
+}
+
+// How long openOutput waits for the graph to link the stream. A target node
+// that doesn't exist never fails outright, it just stays unlinked.
+static constexpr int kPipeWireConnectTimeoutMs = 3000;
+
+static bool InitPipeWire(OutputStreamState *s,
+                         const std::string &deviceId,
+                         bool exclusive,
+                         double bufferMs)
+{
+    if (!s)
+        return false;
+
+    SetLastError("");
+
+    static std::once_flag pwInitOnce;
+    std::call_once(pwInitOnce, []
+                   { pw_init(nullptr, nullptr); });
+
+    s->pwQuantumRequest = RequestedPeriodFrames(s->hwRequest, s->sampleRate);
+    SetDeviceFormat(s, StreamSampleFormat(s));
+    InitStreamRing(s, bufferMs, static_cast<size_t>(s->pwQuantumRequest) * 4);
+
+    pw_properties *props = pw_properties_new(PW_KEY_MEDIA_TYPE, "Audio",
+                                             PW_KEY_MEDIA_CATEGORY, "Playback",
+                                             PW_KEY_MEDIA_ROLE, "Music",
+                                             PW_KEY_APP_NAME, "Spectra",
+                                             nullptr);
+    pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u", s->pwQuantumRequest, s->sampleRate);
+    pw_properties_setf(props, PW_KEY_NODE_RATE, "1/%u", s->sampleRate);
+    if (!deviceId.empty())
+    {
+#if defined(PW_KEY_TARGET_OBJECT)
+        pw_properties_set(props, PW_KEY_TARGET_OBJECT, deviceId.c_str());
+#else
+        pw_properties_set(props, PW_KEY_NODE_TARGET, deviceId.c_str());
+#endif
+    }
+    if (exclusive)
+    {
+        pw_properties_set(props, "node.lock-rate", "true");
+        pw_properties_set(props, "stream.dont-remix", "true");
+    }
+
+    s->pwLoop = pw_thread_loop_new("spectra-pw", nullptr);
+    if (!s->pwLoop)
+    {
+        pw_properties_free(props);
+        SetLastError("Cannot create PipeWire thread loop");
+        return false;
+    }
+    // Takes ownership of props
+    s->pwStream = pw_stream_new_simple(pw_thread_loop_get_loop(s->pwLoop), "Spectra", props, PwStreamEvents(), s);
+    if (!s->pwStream)
+    {
+        DestroyPipeWire(s);
+        SetLastError("Cannot create PipeWire stream (is the daemon running?)");
+        return false;
+    }
+
+    uint8_t podBuffer[1024];
+    spa_pod_builder builder;
+    spa_pod_builder_init(&builder, podBuffer, sizeof(podBuffer));
+    spa_audio_info_raw info{};
+    info.format = ToSpaFormat(s->deviceFormat);
+    info.rate = s->sampleRate;
+    info.channels = s->channels;
+    SetSpaPositions(info);
+    const spa_pod *params[1] = {spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info)};
+
+    int flags = PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS;
+    if (exclusive)
+        flags |= PW_STREAM_FLAG_EXCLUSIVE;
+
+    s->open.store(true);
+    s->running.store(true);
+    if (pw_thread_loop_start(s->pwLoop) < 0)
+    {
+        s->running.store(false);
+        s->open.store(false);
+        DestroyPipeWire(s);
+        SetLastError("Cannot start PipeWire thread loop");
+        return false;
+    }
+
+    // Linked once the format is negotiated (paused), or failed
+    pw_thread_loop_lock(s->pwLoop);
+    int err = pw_stream_connect(s->pwStream, PW_DIRECTION_OUTPUT, PW_ID_ANY,
+                                static_cast<pw_stream_flags>(flags), params, 1);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kPipeWireConnectTimeoutMs);
+    while (err >= 0 && s->pwState != PW_STREAM_STATE_PAUSED && s->pwState != PW_STREAM_STATE_STREAMING &&
+           s->pwState != PW_STREAM_STATE_ERROR && std::chrono::steady_clock::now() < deadline)
+    {
+        pw_thread_loop_timed_wait(s->pwLoop, 1);
+    }
+    pw_stream_state state = s->pwState;
+    std::string error = s->pwError;
+    pw_thread_loop_unlock(s->pwLoop);
+
+    if (err < 0 || (state != PW_STREAM_STATE_PAUSED && state != PW_STREAM_STATE_STREAMING))
+    {
+        s->running.store(false);
+        s->open.store(false);
+        DestroyPipeWire(s);
+        if (err < 0)
+            SetLastError(std::string("Cannot connect PipeWire stream: ") + std::strerror(-err));
+        else if (!error.empty())
+            SetLastError("PipeWire stream failed: " + error);
+        else
+            SetLastError(deviceId.empty() ? "PipeWire stream was not linked to a sink"
+                                           : "PipeWire node '" + deviceId + "' not found");
+        return false;
+    }
+
+    s->pipewire = true;
+    return true;
+}
+
+static void ClosePipeWire(OutputStreamState *s)
+{
+    if (!s)
+        return;
+
+    s->running.store(false);
+    s->open.store(false);
+    s->writerWake.wakeAll();
+
+    // No process() call runs once the stream is destroyed
+    DestroyPipeWire(s);
+    s->lockedMemory.unlockAll();
+}
+
+#endif // EXCLUSIVE_PIPEWIRE
+
+//
+// Null sink backend (openOutput({ mode: 'null' })), for machines without a
+// sound card. The render thread hands each period to a simulated hardware
+// buffer of hwRequest's size that drains at sampleRate against the monotonic
+// clock, so the ring, render stages, playback clock, writer wakeups, pause,
+// drain and close all run as they do against a device. With clock 'fast' it
+// instead takes whatever the ring holds as soon as it is there.
+//
+// Injected xruns stall the thread until the simulated buffer has run dry;
+// jitter delays each wakeup by a seeded pseudo-random amount, and is an
+// xrun too once it exceeds the buffer's headroom.
+//
+
+// Sleep that close cuts short. Returns false once the stream has stopped.
+static bool NullSinkSleep(OutputStreamState *s, uint64_t ns)
+{
+    std::unique_lock<std::mutex> lock(s->nullWakeMutex);
+    s->nullWakeCv.wait_for(lock, std::chrono::nanoseconds(ns), [s]
+                           { return !s->running.load(); });
+    return s->running.load();
+}
+
+static void NullSinkRenderThread(OutputStreamState *s)
+{
+    const NullSinkOptions &opt = s->nullOptions;
+    const uint64_t period = s->nullPeriodFrames;
+    const uint64_t buffer = s->nullBufferFrames;
+    const size_t bpf = s->deviceBytesPerFrame;
+    const double nsPerFrame = 1e9 / static_cast<double>(s->sampleRate);
+    const uint64_t jitterNs = static_cast<uint64_t>(opt.jitterMs * 1e6);
+
+    std::vector<uint8_t> block(period * bpf);
+#if defined(EXCLUSIVE_LINUX)
+    ApplyRenderThreadPolicy(s, block);
+#endif
+    NullSinkJitter jitter(opt.seed);
+
+    // Simulated device, realtime clock only. Like ALSA with a start
+    // threshold of the whole buffer, it starts playing once the buffer is
+    // full and stops again on an underrun.
+    bool started = false;
+    uint64_t startNs = 0;
+    uint64_t written = 0; // frames handed over since the last start
+    auto played = [&](uint64_t now)
+    {
+        return started ? std::min(written, static_cast<uint64_t>((now - startNs) / nsPerFrame)) : 0;
+    };
+
+    uint64_t periods = 0;
+    bool stall = false;
+
+    while (s->running.load())
+    {
+        size_t frames = period;
+        if (opt.realtime && started)
+        {
+            uint64_t now = MonotonicNowNs();
+            if (stall)
+            {
+                // Miss the deadline: wake only after the last frame has played
+                stall = false;
+                uint64_t dryAt = startNs + static_cast<uint64_t>((written + 1) * nsPerFrame);
+                if (!NullSinkSleep(s, dryAt > now ? dryAt - now : 0))
+                    break;
+                continue;
+            }
+            if (played(now) >= written)
+            {
+                // Underrun. Recover as snd_pcm_recover would: start over
+                // once the buffer has been refilled
+                s->telemetry.deviceXrun();
+                started = false;
+                written = 0;
+            }
+            else if (buffer - (written - played(now)) < period)
+            {
+                // No room for a period yet: sleep until there is
+                uint64_t roomAt = startNs + static_cast<uint64_t>((written + period - buffer) * nsPerFrame);
+                if (!NullSinkSleep(s, (roomAt > now ? roomAt - now : 0) + jitter.next(jitterNs)))
+                    break;
+                continue;
+            }
+        }
+        else if (!opt.realtime)
+        {
+            // Only what the ring holds: an empty ring or a pause waits for
+            // the producer instead of rendering silence
+            size_t ready = s->paused.load(std::memory_order_relaxed) ? 0 : s->ring.availableToRead() / s->bytesPerFrame;
+            frames = std::min<size_t>(period, ready);
+            if (frames == 0)
+            {
+                if (!NullSinkSleep(s, 500000))
+                    break;
+                continue;
+            }
+        }
+
+        BeginRenderCycle(s);
+        size_t content = 0;
+        if (s->paused.load(std::memory_order_relaxed))
+            std::memset(block.data(), 0, frames * bpf);
+        else
+            content = RenderFromRing(s, block.data(), frames);
+        if (s->nullWav.isOpen())
+            s->nullWav.write(block.data(), frames * bpf);
+
+        uint64_t now = MonotonicNowNs();
+        int64_t delay = 0;
+        if (opt.realtime)
+        {
+            written += frames;
+            if (!started && written >= buffer)
+            {
+                started = true;
+                startNs = now;
+            }
+            delay = static_cast<int64_t>(written - played(now));
+        }
+        s->lastHardwarePaddingFrames.store(static_cast<uint32_t>(delay));
+        s->clock.advance(content, frames);
+        s->clock.publish(delay, now);
+        s->nullFramesRendered.fetch_add(frames, std::memory_order_relaxed);
+        SignalWriters(s);
+        EndRenderCycle(s, frames, content);
+
+        if (opt.xrunEveryPeriods && ++periods % opt.xrunEveryPeriods == 0)
+        {
+            if (opt.realtime)
+            {
+                stall = started;
+            }
+            else
+            {
+                // No deadline to miss: the gap a late wakeup leaves on a
+                // real device goes into the capture as a buffer of silence
+                s->telemetry.deviceXrun();
+                std::memset(block.data(), 0, block.size());
+                for (uint64_t left = buffer; left > 0;)
+                {
+                    size_t n = static_cast<size_t>(std::min(left, period));
+                    if (s->nullWav.isOpen())
+                        s->nullWav.write(block.data(), n * bpf);
+                    left -= n;
+                }
+                s->clock.advance(0, buffer);
+                s->nullFramesRendered.fetch_add(buffer, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    s->running.store(false);
+    s->writerWake.wakeAll();
+}
+
+static bool InitNullSink(OutputStreamState *s, double bufferMs)
+{
+    SetLastError("");
+
+    // The simulated hardware buffer is exactly what was asked for
+    s->nullPeriodFrames = RequestedPeriodFrames(s->hwRequest, s->sampleRate);
+    s->nullBufferFrames = s->nullPeriodFrames * s->hwRequest.periods;
+
+    InitStreamRing(s, bufferMs, static_cast<size_t>(s->nullPeriodFrames) * 4);
+
+    const std::string &wavPath = s->nullOptions.wavPath;
+    if (!wavPath.empty() && !s->nullWav.open(wavPath, s->sampleRate, s->channels, s->deviceFormat))
+    {
+        SetLastError("Cannot create WAV file " + wavPath);
+        return false;
+    }
+
+    s->open.store(true);
+    // Set here rather than by the thread, so a close right after open
+    // cannot be missed
+    s->running.store(true);
+    s->nullThread = std::thread(NullSinkRenderThread, s);
+    return true;
+}
+
+static int WriteNullSink(OutputStreamState *s,
+                         const uint8_t *data,
+                         size_t len,
+                         bool blocking)
+{
+    if (!s || !s->open.load())
+        return -1;
+    if (!data || len == 0)
+        return 0;
+
+    uint32_t timeoutMs = blocking ? 2000u : 0u;
+    size_t written = WriteToRingBlocking(s, data, len, timeoutMs);
+    return static_cast<int>(written);
+}
+
+static void CloseNullSink(OutputStreamState *s)
+{
+    if (!s)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(s->nullWakeMutex);
+        s->running.store(false);
+        s->open.store(false);
+    }
+    s->nullWakeCv.notify_all();
+    s->writerWake.wakeAll();
+
+    if (s->nullThread.joinable())
+    {
+        s->nullThread.join();
+    }
+
+    s->nullWav.close();
+    s->lockedMemory.unlockAll();
+}
+//
+// Native file decoding (openFile). The decoder thread is an ordinary ring
+// producer: it takes writerMutex through WriteToRingBlocking and parks on
+// writerWake like any other writer, so pause/drain/close need no special
+// cases beyond stopping the thread first.
+//
+static constexpr size_t kDecodeChunkFrames = 4096;
+static constexpr uint32_t kDecodeWriteTimeoutMs = 100;
+static constexpr double kMaxCrossfadeMs = 10000.0;
+
+static void SetDecodeError(OutputStreamState *s, const std::string &msg)
+{
+    std::lock_guard<std::mutex> lock(s->decodeErrorMutex);
+    s->decodeError = msg;
+}
+
+// Copies the channels both layouts share; mono is duplicated to L/R and
+// extra output channels are silent.
+static void MapChannels(const int32_t *in, unsigned inCh, int32_t *out, unsigned outCh, size_t frames)
+{
+    for (size_t i = 0; i < frames; ++i)
+    {
+        const int32_t *src = in + i * inCh;
+        int32_t *dst = out + i * outCh;
+        for (unsigned c = 0; c < outCh; ++c)
+        {
+            if (c < inCh)
+                dst[c] = src[c];
+            else if (inCh == 1 && c < 2)
+                dst[c] = src[0];
+            else
+                dst[c] = 0;
+        }
+    }
+}
+
+// Reads up to `frames` file frames from job's decoder in the stream's
+// channel layout. Returns frames read, pointing src at them.
+static size_t DecodeMapped(OutputStreamState *s, DecodeJob &job, size_t frames, std::vector<int32_t> &decoded,
+                           std::vector<int32_t> &mapped, const int32_t *&src)
+{
+    FileDecoder *dec = job.decoder.get();
+    const unsigned inCh = dec->info.channels;
+    const unsigned outCh = s->channels;
+
+    decoded.resize(frames * inCh);
+    frames = dec->read(decoded.data(), frames);
+    job.inputFrame += frames;
+
+    src = decoded.data();
+    if (frames && inCh != outCh)
+    {
+        mapped.resize(frames * outCh);
+        MapChannels(src, inCh, mapped.data(), outCh, frames);
+        src = mapped.data();
+    }
+    return frames;
+}
+
+// Fills up to `want` stream frames from the job's resampler, feeding it
+// from the decoder as it runs dry and flushing it at the end of the file.
+static size_t ResampleInto(OutputStreamState *s, DecodeJob &job, size_t want, std::vector<int32_t> &decoded,
+                           std::vector<int32_t> &mapped, float *out)
+{
+    Resampler &rs = *job.resampler;
+    size_t got = 0;
+    while (got < want)
+    {
+        got += rs.read(out + got * s->channels, want - got);
+        if (got == want || rs.drained())
+            break;
+
+        uint64_t inputLeft = job.endFrame == UINT64_MAX ? UINT64_MAX : job.endFrame - std::min(job.endFrame, job.inputFrame);
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(kDecodeChunkFrames, inputLeft));
+        const int32_t *src = nullptr;
+        size_t frames = chunk ? DecodeMapped(s, job, chunk, decoded, mapped, src) : 0;
+        if (frames == 0)
+            rs.flush();
+        else
+            rs.write(src, frames);
+    }
+    return got;
+}
+
+// Produces up to `want` stream frames of job's file (resampled if need be)
+// packed in the stream's channel layout and format into out. Returns
+// frames produced.
+static size_t DecodePacked(OutputStreamState *s, DecodeJob &job, size_t want, std::vector<int32_t> &decoded,
+                           std::vector<int32_t> &mapped, uint8_t *out)
+{
+    size_t frames;
+    if (job.resampler)
+    {
+        job.resampled.resize(want * s->channels);
+        frames = ResampleInto(s, job, want, decoded, mapped, job.resampled.data());
+        PackFromFloat(job.resampled.data(), out, frames * s->channels, StreamSampleFormat(s));
+    }
+    else
+    {
+        const int32_t *src = nullptr;
+        frames = DecodeMapped(s, job, want, decoded, mapped, src);
+        PackFromS32(src, out, frames * s->channels, StreamSampleFormat(s));
+    }
+    job.outputDone += frames;
+    return frames;
+}
+
+// Stream frames the job has yet to produce
+static uint64_t JobFramesLeft(const DecodeJob &job)
+{
+    return job.outputFrames == UINT64_MAX ? UINT64_MAX : job.outputFrames - std::min(job.outputFrames, job.outputDone);
+}
+
+// Called as the outgoing file nears its end: takes the next queued file and
+// reserves fadeRing. Returns the fade length, or 0 to play the next file
+// gaplessly instead (in which case `next` may still have been taken).
+static uint64_t PlanCrossfade(OutputStreamState *s, uint64_t outgoingLeft, DecodeJob &next)
+{
+    uint64_t want = std::min<uint64_t>(s->crossfadeFrames.load(std::memory_order_relaxed), outgoingLeft);
+    if (want == 0)
+        return 0;
+
+    {
+        std::lock_guard<std::mutex> lock(s->decodeQueueMutex);
+        if (s->decodeQueue.empty())
+            return 0;
+        next = std::move(s->decodeQueue.front());
+        s->decodeQueue.pop_front();
+    }
+
+    int idle = kFadeIdle;
+    if (!s->fadeState.compare_exchange_strong(idle, kFadeWriting, std::memory_order_acq_rel))
+        return 0;
+
+    uint64_t fade = std::min<uint64_t>({want, s->fadeRing.size() / s->bytesPerFrame, JobFramesLeft(next)});
+    if (fade == 0)
+    {
+        s->fadeState.store(kFadeIdle, std::memory_order_release);
+        return 0;
+    }
+    // The render thread is not reading it while we hold kFadeWriting
+    s->fadeRing.init(s->fadeRing.size());
+    return fade;
+}
+
+// Decodes the next file's first `fade` frames into fadeRing and arms the
+// fade at the current ring write position, where its segment starts too.
+static void StartCrossfade(OutputStreamState *s, DecodeJob &next, uint64_t fade, std::vector<int32_t> &decoded,
+                           std::vector<int32_t> &mapped, std::vector<uint8_t> &packed)
+{
+    const size_t bpf = s->bytesPerFrame;
+    uint64_t written = 0;
+    while (written < fade && !s->decodeStop.load(std::memory_order_relaxed))
+    {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(kDecodeChunkFrames, fade - written));
+        size_t frames = DecodePacked(s, next, want, decoded, mapped, packed.data());
+        if (frames == 0)
+            break;
+        s->fadeRing.write(packed.data(), frames * bpf);
+        written += frames;
+    }
+    next.started = true;
+    s->decodedFrames.fetch_add(written, std::memory_order_relaxed);
+
+    uint32_t pos = s->ring.writePos->load(std::memory_order_relaxed);
+    s->segments.push(next.segment, pos);
+    if (written == 0)
+    {
+        s->fadeState.store(kFadeIdle, std::memory_order_release);
+        return;
+    }
+    s->fadeStartPos = pos;
+    s->fadeFrames = written;
+    s->fadeState.store(kFadeArmed, std::memory_order_release);
+}
+
+// Decodes one job into the ring. If a crossfade is configured and another
+// file is queued, that file's head goes into fadeRing and it is returned in
+// `next`. Returns false if the stream stopped.
+static bool DecodeIntoRing(OutputStreamState *s, DecodeJob &job, DecodeJob &next)
+{
+    const size_t bpf = s->bytesPerFrame;
+    std::vector<int32_t> decoded;
+    std::vector<int32_t> mapped;
+    std::vector<uint8_t> packed(kDecodeChunkFrames * bpf);
+
+    // The decoder is the only producer, so the write position is ours to read
+    if (!job.started)
+        s->segments.push(job.segment, s->ring.writePos->load(std::memory_order_relaxed));
+
+    uint64_t remaining = JobFramesLeft(job);
+    bool planned = false;
+    uint64_t fade = 0;
+    while (remaining && !s->decodeStop.load(std::memory_order_relaxed))
+    {
+        // Plan a chunk ahead, then stop exactly `fade` frames before the end
+        if (!planned && remaining != UINT64_MAX && remaining <= s->crossfadeFrames.load(std::memory_order_relaxed) + kDecodeChunkFrames)
+        {
+            planned = true;
+            fade = PlanCrossfade(s, remaining, next);
+        }
+        if (fade && remaining == fade)
+        {
+            StartCrossfade(s, next, fade, decoded, mapped, packed);
+            fade = 0;
+        }
+
+        uint64_t limit = fade ? remaining - fade : remaining;
+        size_t want = static_cast<size_t>(std::min<uint64_t>(kDecodeChunkFrames, limit));
+        size_t frames = DecodePacked(s, job, want, decoded, mapped, packed.data());
+        if (frames == 0)
+            break;
+        if (remaining != UINT64_MAX)
+            remaining -= frames;
+
+        // Short timeouts so a stop request is noticed while the ring is full
+        // (paused, or simply far ahead of the device).
+        size_t len = frames * bpf;
+        size_t off = 0;
+        while (off < len && !s->decodeStop.load(std::memory_order_relaxed))
+        {
+            off += WriteToRingBlocking(s, packed.data() + off, len - off, kDecodeWriteTimeoutMs);
+            if (off < len && (!s->open.load() || !s->running.load()))
+            {
+                s->decodedFrames.fetch_add(off / bpf, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        s->decodedFrames.fetch_add(off / bpf, std::memory_order_relaxed);
+    }
+
+    // Reserved fadeRing but the file ended early (bad length, read error)
+    if (fade)
+    {
+        int writing = kFadeWriting;
+        s->fadeState.compare_exchange_strong(writing, kFadeIdle, std::memory_order_acq_rel);
+    }
+
+    if (!job.decoder->error.empty())
+    {
+        SetDecodeError(s, job.decoder->error);
+        return false;
+    }
+    return true;
+}
+
+static void FileDecodeThread(OutputStreamState *s, DecodeJob job)
+{
+    for (;;)
+    {
+        DecodeJob next;
+        bool ok = DecodeIntoRing(s, job, next);
+
+        // Decided under the queue lock, so queueFile() either sees us still
+        // running or knows it has to start a new thread
+        std::lock_guard<std::mutex> lock(s->decodeQueueMutex);
+        if (!ok || s->decodeStop.load(std::memory_order_relaxed) || (!next.decoder && s->decodeQueue.empty()))
+        {
+            s->decodeFinished.store(true);
+            return;
+        }
+        if (next.decoder)
+        {
+            job = std::move(next);
+        }
+        else
+        {
+            job = std::move(s->decodeQueue.front());
+            s->decodeQueue.pop_front();
+        }
+    }
+}
+
+// Stops and joins the decoder thread, if any. Safe to call repeatedly.
+static void StopFileDecoder(OutputStreamState *s)
+{
+    if (!s->decodeThread.joinable())
+        return;
+    s->decodeStop.store(true);
+    s->writerWake.wakeAll();
+    s->decodeThread.join();
+    // A fade armed for the old queue must not mix into whatever plays next,
+    // and a reservation the decoder left behind is void. A fade already
+    // mixing is the render thread's to finish: it still reads fadeRing.
+    int writing = kFadeWriting;
+    s->fadeState.compare_exchange_strong(writing, kFadeIdle, std::memory_order_acq_rel);
+    int armed = kFadeArmed;
+    s->fadeState.compare_exchange_strong(armed, kFadeIdle, std::memory_order_acq_rel);
+
+    std::lock_guard<std::mutex> lock(s->decodeQueueMutex);
+    s->decodeQueue.clear();
+}
+
+//
+// N-API exports
+//
+
+static void CloseBackend(OutputStreamState *s);
+
+// A bus member only has its ring; the bus device's render thread drains it.
+static int WriteBusMember(OutputStreamState *s,
+                          const uint8_t *data,
+                          size_t len,
+                          bool blocking)
+{
+    if (!s->open.load() || !s->bus->device->running.load())
+        return -1;
+    if (!data || len == 0)
+        return 0;
+
+    uint32_t timeoutMs = blocking ? 2000u : 0u;
+    size_t written = WriteToRingBlocking(s, data, len, timeoutMs);
+    return static_cast<int>(written);
+}
+
+// Stops a member taking writes and wakes writers parked on its ring. It
+// stays on the bus (and the bus stays up) until DetachFromBus().
+static void StopBusMember(OutputStreamState *s)
+{
+    s->running.store(false);
+    s->open.store(false);
+    s->writerWake.wakeAll();
+}
+
+// Takes a member off its bus. Once the render thread has let go of it the
+// member may be freed; the last member out closes the device.
+static void DetachFromBus(OutputStreamState *s)
+{
+    MixBus *bus = s->bus;
+    StopBusMember(s);
+
+    std::lock_guard<std::mutex> lock(g_busesMutex);
+    bus->attached.erase(std::remove(bus->attached.begin(), bus->attached.end(), s), bus->attached.end());
+    bus->members.replace(bus->attached);
+    s->bus = nullptr;
+    if (!bus->attached.empty())
+        return;
+
+    g_buses.erase(bus->name);
+    CloseBackend(bus->device);
+    delete bus->device;
+    delete bus;
+}
+
+// Writes a single span to whichever backend is compiled in.
+static int WriteBackend(OutputStreamState *s, const uint8_t *data, size_t len, bool blocking)
+{
+    if (s && (s->sharedRing || s->fileDecoding.load()))
+        return -1;
+    if (s && s->bus)
+        return WriteBusMember(s, data, len, blocking);
+    if (s && s->nullSink)
+        return WriteNullSink(s, data, len, blocking);
+
+#if defined(EXCLUSIVE_WIN32)
+    return WriteWasapi(s, data, len, blocking);
+#elif defined(EXCLUSIVE_MACOS)
+    return WriteCoreAudio(s, data, len, blocking);
+#elif defined(EXCLUSIVE_LINUX)
+    // Only fills the ring, so it serves the PipeWire stream as well
+    return WriteAlsa(s, data, len, blocking);
+#else
+    (void)s;
+    (void)data;
+    (void)len;
+    (void)blocking;
+    return -1;
+#endif
+}
+
+// Stops whichever backend is compiled in.
+static void CloseBackend(OutputStreamState *s)
+{
+    if (s && s->bus)
+    {
+        DetachFromBus(s);
+        return;
+    }
+    if (s && s->nullSink)
+    {
+        CloseNullSink(s);
+        return;
+    }
+
+#if defined(EXCLUSIVE_WIN32)
+    CloseWasapi(s);
+#elif defined(EXCLUSIVE_MACOS)
+    CloseCoreAudio(s);
+#elif defined(EXCLUSIVE_LINUX)
+#if defined(EXCLUSIVE_PIPEWIRE)
+    if (s && s->pipewire)
+    {
+        ClosePipeWire(s);
+        return;
+    }
+#endif
+    CloseAlsa(s);
+#else
+    (void)s;
+#endif
+}
+
+// Name of the backend a stream was opened on, as reported to JS.
+static const char *BackendName(const OutputStreamState *s)
+{
+    if (s->nullSink)
+        return "null";
+#if defined(EXCLUSIVE_WIN32)
+    return "wasapi";
+#elif defined(EXCLUSIVE_MACOS)
+    return "coreaudio";
+#elif defined(EXCLUSIVE_LINUX)
+#if defined(EXCLUSIVE_PIPEWIRE)
+    if (s->pipewire)
+        return "pipewire";
+#endif
+    return "alsa";
+#else
+    return "none";
+#endif
+}
+
+#if !defined(EXCLUSIVE_HEADLESS)
+class CloseAsyncWorker;
+
+// A lifecycle call running on a worker (openOutputAsync, drainAsync) that
+// cancelAsync(id) can cut short. A drain parks on its stream's writer wakeup,
+// so cancelling kicks that too; `draining` is only set while the worker
+// holds a reference to the stream.
+struct LifecycleOp
+{
+    std::atomic<bool> cancelled{false};
+    std::mutex mutex;
+    OutputStreamState *draining{nullptr};
+
+    void cancel()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled.store(true);
+        if (draining)
+            draining->writerWake.wakeAll();
+    }
+};
+
+// Per-environment addon state. Only touched from the JS thread.
+struct AddonData
+{
+    // Segment lists of finished writeAsync/writev calls, reused so
+    // steady-state playback does not grow a fresh vector per write.
+    std::vector<std::vector<std::pair<const uint8_t *, size_t>>> writeSegments;
+
+    // Keeps each sharedRing stream's SharedArrayBuffer alive until close().
+    std::map<uint32_t, Napi::ObjectReference> sharedRings;
+
+    // Pending *Async lifecycle calls by the id the caller gave them
+    std::map<uint32_t, std::shared_ptr<LifecycleOp>> operations;
+
+    // Handles this environment opened and has not closed, and closeAsync()
+    // calls still stopping theirs. The env cleanup hook shuts both down, so
+    // no render thread outlives the SharedArrayBuffers in sharedRings.
+    std::set<uint32_t> streams;
+    std::map<uint32_t, CloseAsyncWorker *> closing;
+
+    napi_env env{nullptr};
+};
+
+//
+// Shared ring (openOutput({ sharedRing: true }))
+//
+// The ring lives in a SharedArrayBuffer allocated through the JS constructor,
+// so it sits inside the V8 heap cage (external buffers are not allowed under
+// Electron) and can be posted to a worker. Layout, all words little-endian
+// int32 read/written with Atomics on the JS side:
+//
+//   bytes   0..63   header
+//                   word 0  magic 0x53505242 ('SPRB')
+//                   word 1  layout version (1)
+//                   word 2  capacity in bytes (power of two)
+//                   word 3  bytesPerFrame
+//                   word 4  sampleRate
+//                   word 5  channels
+//                   word 6  bitDepth
+//                   word 7  state: 0 = open, 1 = closed by the native side
+//                   word 8  limit: most bytes the ring may hold (whole
+//                           frames, <= capacity)
+//   bytes  64..127  word 16 writePos, free-running uint32 (JS producer)
+//   bytes 128..191  word 32 readPos,  free-running uint32 (render thread)
+//   bytes 192..     PCM data, `capacity` bytes; byte i of the stream lives at
+//                   data[i & (capacity - 1)]
+//
+// See sharedRing.js for the reference producer.
+//
+static constexpr int32_t kSharedRingMagic = 0x53505242;
+static constexpr int32_t kSharedRingVersion = 1;
+static constexpr size_t kSharedRingHeaderBytes = 192;
+enum SharedRingWord
+{
+    kSharedRingWordMagic = 0,
+    kSharedRingWordVersion = 1,
+    kSharedRingWordCapacity = 2,
+    kSharedRingWordBytesPerFrame = 3,
+    kSharedRingWordSampleRate = 4,
+    kSharedRingWordChannels = 5,
+    kSharedRingWordBitDepth = 6,
+    kSharedRingWordState = 7,
+    kSharedRingWordLimit = 8,
+    kSharedRingWordWritePos = 16,
+    kSharedRingWordReadPos = 32,
+};
+
+// Allocates the SharedArrayBuffer, moves the stream's ring into it and
+// returns { buffer, control, data } for JS. The stream must still be paused
+// so the render thread is not reading the ring while it is swapped.
+static Napi::Value AttachSharedRing(Napi::Env env, uint32_t handle, OutputStreamState *s)
+{
+    size_t capacity = s->ring.capacity;
+    size_t limit = s->ring.size();
+    Napi::Value sabCtor = env.Global().Get("SharedArrayBuffer");
+    if (!sabCtor.IsFunction())
+    {
+        SetLastError("SharedArrayBuffer is not available in this context");
+        return env.Null();
+    }
+
+    Napi::Object sab = sabCtor.As<Napi::Function>().New(
+        {Napi::Number::New(env, static_cast<double>(kSharedRingHeaderBytes + capacity))});
+    if (env.IsExceptionPending())
+        return env.Null();
+
+    Napi::Object control = env.Global().Get("Int32Array").As<Napi::Function>().New(
+        {sab, Napi::Number::New(env, 0), Napi::Number::New(env, kSharedRingHeaderBytes / 4)});
+    Napi::Object pcm = env.Global().Get("Uint8Array").As<Napi::Function>().New(
+        {sab, Napi::Number::New(env, kSharedRingHeaderBytes), Napi::Number::New(env, static_cast<double>(capacity))});
+    if (env.IsExceptionPending())
+        return env.Null();
+
+    int32_t *words = control.As<Napi::Int32Array>().Data();
+    uint8_t *data = pcm.As<Napi::Uint8Array>().Data();
+
+    words[kSharedRingWordMagic] = kSharedRingMagic;
+    words[kSharedRingWordVersion] = kSharedRingVersion;
+    words[kSharedRingWordCapacity] = static_cast<int32_t>(capacity);
+    words[kSharedRingWordBytesPerFrame] = static_cast<int32_t>(s->bytesPerFrame);
+    words[kSharedRingWordSampleRate] = static_cast<int32_t>(s->sampleRate);
+    words[kSharedRingWordChannels] = static_cast<int32_t>(s->channels);
+    words[kSharedRingWordBitDepth] = static_cast<int32_t>(s->bitDepth);
+    words[kSharedRingWordState] = 0;
+    words[kSharedRingWordLimit] = static_cast<int32_t>(limit);
+
+    s->sharedControl = words;
+    s->ring.attach(data, capacity, limit,
+                   reinterpret_cast<RingBuffer::Index *>(&words[kSharedRingWordReadPos]),
+                   reinterpret_cast<RingBuffer::Index *>(&words[kSharedRingWordWritePos]));
+
+    AddonData *addon = env.GetInstanceData<AddonData>();
+    if (addon)
+        addon->sharedRings[handle].Reset(sab, 1);
+
+    Napi::Object out = Napi::Object::New(env);
+    out.Set("buffer", sab);
+    out.Set("control", control);
+    out.Set("data", pcm);
+    out.Set("headerBytes", Napi::Number::New(env, kSharedRingHeaderBytes));
+    out.Set("capacity", Napi::Number::New(env, static_cast<double>(capacity)));
+    out.Set("limit", Napi::Number::New(env, static_cast<double>(limit)));
+    return out;
+}
+
+// Marks the shared ring closed for the JS producer and drops our reference.
+static void ReleaseSharedRing(Napi::Env env, uint32_t handle, OutputStreamState *s)
+{
+    AddonData *addon = env.GetInstanceData<AddonData>();
+    if (!addon)
+        return;
+    auto it = addon->sharedRings.find(handle);
+    if (it == addon->sharedRings.end())
+        return;
+    if (s && s->sharedControl)
+    {
+        reinterpret_cast<std::atomic<int32_t> *>(&s->sharedControl[kSharedRingWordState])->store(1);
+        s->sharedControl = nullptr;
+    }
+    addon->sharedRings.erase(it);
+}
+#endif // !EXCLUSIVE_HEADLESS
+
+
+// Everything openOutput() needs to bring up a device backend
+struct BackendOptions
+{
+    std::string deviceId;
+    std::string mode;
+    std::string backend;
+    double bufferMs{250.0};
+    bool bitPerfect{false};
+    bool strictBitPerfect{false};
+    NullSinkOptions nullOptions;
+};
+
+// Opens the device for s, with the fallbacks its mode allows. Returns false
+// with `error` set on failure; s is left for the caller to delete.
+static bool OpenBackend(OutputStreamState *s, const BackendOptions &o, std::string &error)
+{
+    bool ok = false;
+
+    if (o.mode == "null")
+    {
+        s->nullSink = true;
+        s->nullOptions = o.nullOptions;
+        ok = InitNullSink(s, o.bufferMs);
+        if (!ok)
+        {
+            error = "Failed to open null sink";
+            return false;
+        }
+    }
+    else
+    {
+#if defined(EXCLUSIVE_WIN32)
+
+        if (o.mode == "shared")
+        {
+            ok = InitWasapi(s, o.deviceId, false, o.bufferMs, o.bitPerfect);
+            if (!ok)
+            {
+                error = "Failed to open shared WASAPI output";
+                return false;
+            }
+        }
+        else if (o.mode == "exclusive")
+        {
+            ok = InitWasapi(s, o.deviceId, true, o.bufferMs, o.bitPerfect);
+            if (!ok)
+            {
+                if (o.strictBitPerfect)
+                {
+                    error = "Exclusive format not supported in strict bitPerfect mode";
+                    return false;
+                }
+
+                // Try shared fallback
+                ok = InitWasapi(s, o.deviceId, false, o.bufferMs, o.bitPerfect);
+                if (!ok)
+                {
+                    error = "Failed to open exclusive output; shared fallback also failed";
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            error = "Unknown mode; expected 'exclusive', 'shared' or 'null'";
+            return false;
+        }
+
+#elif defined(EXCLUSIVE_MACOS)
+
+        bool exclusive = (o.mode == "exclusive");
+
+        ok = InitCoreAudio(s, o.deviceId, exclusive, o.bufferMs, o.bitPerfect);
+        if (!ok)
+        {
+            if (o.strictBitPerfect && exclusive)
+            {
+                error = "Exclusive format not supported in strict bitPerfect mode";
+                return false;
+            }
+
+            // Try without exclusive mode as fallback
+            ok = InitCoreAudio(s, o.deviceId, false, o.bufferMs, false);
+            if (!ok)
+            {
+                error = "Failed to open CoreAudio output";
+                return false;
+            }
+        }
+
+#elif defined(EXCLUSIVE_LINUX)
+
+        bool exclusive = (o.mode == "exclusive");
+
+#if defined(EXCLUSIVE_PIPEWIRE)
+        if (o.backend != "alsa")
+        {
+            ok = InitPipeWire(s, o.deviceId, exclusive, o.bufferMs);
+            if (!ok && o.backend == "pipewire")
+            {
+                error = "Failed to open PipeWire output";
+                return false;
+            }
+        }
+#else
+        if (o.backend == "pipewire")
+        {
+            SetLastError("");
+            error = "PipeWire support was not compiled in";
+            return false;
+        }
+#endif
+
+        if (!ok)
+            ok = InitAlsa(s, o.deviceId, exclusive, o.bufferMs, o.bitPerfect);
+        if (!ok)
+        {
+            if (o.strictBitPerfect && exclusive)
+            {
+                error = "Exclusive format not supported in strict bitPerfect mode";
+                return false;
+            }
+
+            // Try without exclusive mode as fallback
+            ok = InitAlsa(s, o.deviceId, false, o.bufferMs, false);
+            if (!ok)
+            {
+                error = "Failed to open ALSA output";
+                return false;
+            }
+        }
+
+#else
+        (void)o;
+        error = "exclusive_audio is not supported on this platform";
+        return false;
+#endif
+    }
+
+    return ok;
+}
+
+//
+// Puts s on the named bus, bringing the bus up on first use with the
+// device options of its first member. Members take the bus's rate and
+// channel count, which openOutput() reports back like any negotiated format.
+//
+static bool AttachToBus(OutputStreamState *s, const std::string &name,
+                        const BackendOptions &o, double bufferMs, std::string &error)
+{
+    std::lock_guard<std::mutex> lock(g_busesMutex);
+
+    MixBus *bus = nullptr;
+    auto it = g_buses.find(name);
+    if (it != g_buses.end())
+    {
+        bus = it->second;
+    }
+    else
+    {
+        bus = new MixBus();
+        bus->name = name;
+
+        auto *d = new OutputStreamState();
+        d->sampleRate = s->sampleRate;
+        d->channels = s->channels;
+        d->bitDepth = 32;
+        d->floatSamples = true;
+        d->bytesPerFrame = 4 * s->channels;
+        SetDeviceFormat(d, SampleFormat::F32);
+        d->realtime = s->realtime;
+        d->hwRequest = s->hwRequest;
+        // Before the backend starts rendering: the device only ever plays
+        // the mix
+        d->busDevice = bus;
+        bus->device = d;
+
+        // The device ring is never written; keep it minimal
+        BackendOptions deviceOptions = o;
+        deviceOptions.bufferMs = 1.0;
+        if (!OpenBackend(d, deviceOptions, error))
+        {
+            delete d;
+            delete bus;
+            return false;
+        }
+
+        // Sized for what the device negotiated. The render thread touches
+        // them only once a member is published below.
+        bus->mixed.assign(kBusChunkFrames * d->channels, 0.0f);
+        bus->block.assign(kBusChunkFrames * d->channels, 0.0f);
+        g_buses[name] = bus;
+    }
+
+    const OutputStreamState *d = bus->device;
+    s->sampleRate = d->sampleRate;
+    s->channels = d->channels;
+    s->bytesPerFrame = (s->bitDepth / 8) * s->channels;
+    SetDeviceFormat(s, SampleFormat::F32);
+    InitStreamRing(s, bufferMs, kBusChunkFrames * 4);
+    s->bus = bus;
+    s->open.store(true);
+    s->running.store(true);
+
+    bus->attached.push_back(s);
+    bus->members.replace(bus->attached);
+    return true;
+}
+
+// Everything openOutput() needs to create a stream
+struct StreamOptions
+{
+    unsigned int sampleRate{44100};
+    unsigned int channels{2};
+    unsigned int bitDepth{16};
+    bool floatSamples{false};
+    double wakeThresholdMs{20.0};
+    RealtimeRequest realtime;
+    HwBufferRequest hwRequest;
+    bool sharedRing{false};
+    size_t traceRecords{0};
+    std::string busName;
+    BackendOptions backend;
+};
+
+// Creates a stream and brings up its device, or joins it to its bus. Returns
+// nullptr with `error` set on failure. The caller registers the handle.
+static OutputStreamState *OpenStream(const StreamOptions &o, std::string &error)
+{
+    auto *s = new OutputStreamState();
+    s->sampleRate = o.sampleRate;
+    s->channels = o.channels;
+    s->bitDepth = o.bitDepth;
+    s->floatSamples = o.floatSamples;
+    s->bytesPerFrame = (o.bitDepth / 8) * o.channels;
+    // Backends replace this with what the device negotiated
+    SetDeviceFormat(s, StreamSampleFormat(s));
+    s->sharedRing = o.sharedRing;
+    s->realtime = o.realtime;
+    s->hwRequest = o.hwRequest;
+    s->trace.enable(o.traceRecords);
+    // Keep the render thread off the ring until the shared storage is attached
+    if (o.sharedRing)
+        s->paused.store(true);
+
+    bool ok = o.busName.empty() ? OpenBackend(s, o.backend, error)
+                                : AttachToBus(s, o.busName, o.backend, o.backend.bufferMs, error);
+    if (!ok)
+    {
+        delete s;
+        return nullptr;
+    }
+
+    ConfigureWriterWakeup(s, o.wakeThresholdMs);
+    return s;
+}
+
+// Stops a stream whose handle has been retired: the decoder and backend are
+// shut down, and references already taken (writes parked on the ring, polls)
+// are waited out. The stream is the caller's to release afterwards.
+static void StopRetiredStream(uint32_t handle, OutputStreamState *s)
+{
+    // The decoder thread writes into the ring; stop it before the backend
+    StopFileDecoder(s);
+
+    // Stop backend; this also wakes writers parked on the ring. A bus
+    // member only stops taking writes here: a write still in flight reads
+    // its bus (and the bus device), so it leaves the bus after they are done.
+    if (s->bus)
+        StopBusMember(s);
+    else
+        CloseBackend(s);
+
+    // Wait for in-flight async writes and polls to let go
+    g_streams.reclaim(handle);
+    if (s->bus)
+        DetachFromBus(s);
+}
+
+// Retires the handle and stops the stream; new lookups fail at once. Returns
+// the stream for the caller to release, or nullptr if the handle was not open.
+static OutputStreamState *ShutdownStream(uint32_t handle)
+{
+    OutputStreamState *s = g_streams.retire(handle);
+    if (!s)
+        return nullptr;
+    StopRetiredStream(handle, s);
+    return s;
+}
+
+enum class DrainResult
+{
+    Drained,   // the ring played out
+    Stopped,   // the stream stopped first (closed, device lost)
+    TimedOut,
+    Cancelled,
+};
+
+// Blocks until the ring has played out or the stream stops. Parks on the
+// writer wakeup: an empty ring always satisfies the wake threshold, and the
+// render thread wakes everyone when it stops. timeoutMs 0 waits for as long
+// as it takes; whoever sets *cancel must also wake writerWake.
+static DrainResult DrainStream(OutputStreamState *s, uint32_t timeoutMs = 0,
+                               const std::atomic<bool> *cancel = nullptr)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;)
+    {
+        if (s->ring.availableToRead() == 0)
+            return DrainResult::Drained;
+        if (!s->running.load())
+            return DrainResult::Stopped;
+        if (cancel && cancel->load())
+            return DrainResult::Cancelled;
+
+        uint32_t waitMs = 1000;
+        if (timeoutMs != 0)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                return DrainResult::TimedOut;
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+            waitMs = static_cast<uint32_t>(std::max<long long>(1, std::min<long long>(waitMs, left)));
+        }
+
+        uint32_t seen = s->writerWake.prepareWait();
+        if (s->ring.availableToRead() == 0 || !s->running.load() || (cancel && cancel->load()))
+        {
+            s->writerWake.cancelWait();
+            continue;
+        }
+        s->writerWake.wait(seen, waitMs);
+    }
+}
+
+// openFile() / queueFile() options
+struct DecodeOptions
+{
+    double startTime{0.0};
+    uint64_t trimStart{0};
+    uint64_t trimEnd{0};
+    Resampler::Quality resampleQuality{Resampler::Quality::High};
+};
+
+static bool PrepareDecodeJob(OutputStreamState *s, const std::string &path, const DecodeOptions &opts, DecodeJob &job)
+{
+    std::string err;
+    job.decoder = FileDecoder::Open(path, err);
+    if (!job.decoder)
+    {
+        SetLastError(err);
+        return false;
+    }
+    FileDecoder *dec = job.decoder.get();
+
+    // Encoder delay and padding bound the playable range; startTime is
+    // relative to the first playable frame
+    uint64_t first = opts.trimStart;
+    uint64_t last = UINT64_MAX;
+    if (dec->info.totalFrames)
+    {
+        last = dec->info.totalFrames - std::min(dec->info.totalFrames, opts.trimEnd);
+        first = std::min(first, last);
+    }
+    uint64_t startFrame = first + static_cast<uint64_t>(opts.startTime * static_cast<double>(dec->info.sampleRate));
+    startFrame = std::min(startFrame, last);
+
+    if (startFrame > 0 && !dec->seek(startFrame))
+    {
+        SetLastError(dec->error);
+        return false;
+    }
+    job.startFrame = startFrame;
+    job.endFrame = last;
+    job.inputFrame = startFrame;
+    job.outputFrames = last == UINT64_MAX ? UINT64_MAX : last - startFrame;
+
+    // The device got a different rate than the file (set_rate_near, shared
+    // mode mix format) or the caller upsamples on purpose: resample on the
+    // decoder thread so the ring only ever holds the stream rate
+    if (dec->info.sampleRate != s->sampleRate)
+    {
+        if (s->channels > Resampler::kMaxChannels)
+        {
+            SetLastError("cannot resample " + std::to_string(dec->info.sampleRate) + " Hz to " +
+                         std::to_string(s->sampleRate) + " Hz: more than " +
+                         std::to_string(Resampler::kMaxChannels) + " channels");
+            return false;
+        }
+        job.resampler = std::make_unique<Resampler>();
+        if (!job.resampler->configure(dec->info.sampleRate, s->sampleRate, s->channels, opts.resampleQuality))
+        {
+            SetLastError("cannot resample " + std::to_string(dec->info.sampleRate) + " Hz to " +
+                         std::to_string(s->sampleRate) + " Hz");
+            return false;
+        }
+        if (job.outputFrames != UINT64_MAX)
+            job.outputFrames = job.resampler->outputFramesFor(job.outputFrames);
+    }
+    job.segment = s->nextSegmentId++;
+    return true;
+}
+
+// Replaces any decoder (and queue) already feeding s with job
+static void StartFileDecoder(OutputStreamState *s, DecodeJob job)
+{
+    StopFileDecoder(s);
+    s->decodeStop.store(false);
+    s->decodeFinished.store(false);
+    s->inputEnded.store(false);
+    s->decodedFrames.store(0);
+    s->decodeStartFrame = job.startFrame;
+    SetDecodeError(s, std::string());
+    s->fileDecoding.store(true);
+    s->decodeThread = std::thread(FileDecodeThread, s, std::move(job));
+}
+
+#if !defined(EXCLUSIVE_HEADLESS)
+
+// Reads openOutput() options into `out`. Throws and returns false if they
+// do not make sense; nothing is opened yet.
+static bool ParseStreamOptions(Napi::Env env, const Napi::Object &opts, StreamOptions &out)
+{
+    std::string deviceId;
+    if (opts.Has("deviceId") && opts.Get("deviceId").IsString())
+    {
+        deviceId = opts.Get("deviceId").As<Napi::String>().Utf8Value();
+    }
+
+    unsigned int sampleRate = 44100;
+    unsigned int channels = 2;
+    unsigned int bitDepth = 16;
+
+    if (opts.Has("sampleRate"))
+    {
+        sampleRate = opts.Get("sampleRate").As<Napi::Number>().Uint32Value();
+    }
+    if (opts.Has("channels"))
+    {
+        channels = opts.Get("channels").As<Napi::Number>().Uint32Value();
+    }
+    if (opts.Has("bitDepth"))
+    {
+        bitDepth = opts.Get("bitDepth").As<Napi::Number>().Uint32Value();
+    }
+    if (bitDepth != 16 && bitDepth != 24 && bitDepth != 32)
+    {
+        ThrowTypeError(env, "bitDepth must be 16, 24 or 32");
+        return false;
+    }
+
+    // 32-bit writes are float (f32le) unless the caller says otherwise
+    bool floatSamples = bitDepth == 32;
+    if (bitDepth == 32 && opts.Has("floatSamples") && opts.Get("floatSamples").IsBoolean())
+    {
+        floatSamples = opts.Get("floatSamples").As<Napi::Boolean>().Value();
+    }
+
+    std::string mode = "exclusive";
+    if (opts.Has("mode") && opts.Get("mode").IsString())
+    {
+        mode = opts.Get("mode").As<Napi::String>().Utf8Value();
+    }
+
+    double bufferMs = 250.0;
     if (opts.Has("bufferMs") && opts.Get("bufferMs").IsNumber())
     {
-        bufferMs = opts.Get("bufferMs").As<Napi::Number>().DoubleValue();
+        bufferMs = opts.Get("bufferMs").As<Napi::Number>().DoubleValue();
+    }
+
+    bool bitPerfect = false;
+    if (opts.Has("bitPerfect") && opts.Get("bitPerfect").IsBoolean())
+    {
+        bitPerfect = opts.Get("bitPerfect").As<Napi::Boolean>().Value();
+    }
+
+    bool strictBitPerfect = false;
+    if (opts.Has("strictBitPerfect") && opts.Get("strictBitPerfect").IsBoolean())
+    {
+        strictBitPerfect = opts.Get("strictBitPerfect").As<Napi::Boolean>().Value();
+    }
+
+    // Free space (ms of audio) the render thread waits for before waking a
+    // writer that is parked on a full ring.
+    double wakeThresholdMs = 20.0;
+    if (opts.Has("wakeThresholdMs") && opts.Get("wakeThresholdMs").IsNumber())
+    {
+        wakeThresholdMs = opts.Get("wakeThresholdMs").As<Napi::Number>().DoubleValue();
+    }
+
+    // Render thread scheduling: realtime true | 'fifo' | 'rr', with
+    // realtimePriority, cpuAffinity [cpu, ...] and lockMemory (Linux).
+    // raiseRealtimeLimits lets it raise the process's RLIMIT_RTPRIO/RTTIME.
+    RealtimeRequest realtime;
+    if (opts.Has("realtime"))
+    {
+        Napi::Value v = opts.Get("realtime");
+        std::string name = v.IsString() ? v.As<Napi::String>().Utf8Value() : "";
+        if (v.IsBoolean())
+            realtime.policy = v.As<Napi::Boolean>().Value() ? RealtimeRequest::Policy::Fifo : RealtimeRequest::Policy::None;
+        else if (name == "fifo")
+            realtime.policy = RealtimeRequest::Policy::Fifo;
+        else if (name == "rr")
+            realtime.policy = RealtimeRequest::Policy::RoundRobin;
+        else if (name != "none" && !v.IsUndefined())
+        {
+            ThrowTypeError(env, "realtime must be true, false, 'fifo', 'rr' or 'none'");
+            return false;
+        }
+    }
+    if (opts.Has("realtimePriority") && opts.Get("realtimePriority").IsNumber())
+    {
+        realtime.priority = opts.Get("realtimePriority").As<Napi::Number>().Int32Value();
+    }
+    if (opts.Has("cpuAffinity") && opts.Get("cpuAffinity").IsArray())
+    {
+        Napi::Array cpus = opts.Get("cpuAffinity").As<Napi::Array>();
+        for (uint32_t i = 0; i < cpus.Length(); ++i)
+        {
+            Napi::Value cpu = cpus.Get(i);
+            if (cpu.IsNumber())
+                realtime.cpus.push_back(cpu.As<Napi::Number>().Int32Value());
+        }
+    }
+    if (opts.Has("lockMemory") && opts.Get("lockMemory").IsBoolean())
+    {
+        realtime.lockMemory = opts.Get("lockMemory").As<Napi::Boolean>().Value();
+    }
+    if (opts.Has("raiseRealtimeLimits") && opts.Get("raiseRealtimeLimits").IsBoolean())
+    {
+        realtime.raiseLimits = opts.Get("raiseRealtimeLimits").As<Napi::Boolean>().Value();
+    }
+
+    // Hardware buffer: a latencyClass preset, refined by periodFrames,
+    // periods and hwBufferMs (the whole buffer, split into the periods)
+    HwBufferRequest hwRequest;
+    if (opts.Has("latencyClass") && opts.Get("latencyClass").IsString())
+    {
+        if (!LatencyClassPreset(opts.Get("latencyClass").As<Napi::String>().Utf8Value(), hwRequest))
+        {
+            ThrowTypeError(env, "latencyClass must be 'ultra-low', 'low', 'balanced' or 'power-save'");
+            return false;
+        }
+    }
+    bool periodsGiven = opts.Has("periods") && opts.Get("periods").IsNumber();
+    if (periodsGiven)
+    {
+        hwRequest.periods = std::max(2u, std::min(64u, opts.Get("periods").As<Napi::Number>().Uint32Value()));
+    }
+    if (opts.Has("periodFrames") && opts.Get("periodFrames").IsNumber())
+    {
+        hwRequest.periodFrames = opts.Get("periodFrames").As<Napi::Number>().Uint32Value();
+    }
+    if (opts.Has("hwBufferMs") && opts.Get("hwBufferMs").IsNumber())
+    {
+        double hwBufferMs = opts.Get("hwBufferMs").As<Napi::Number>().DoubleValue();
+        if (!(hwBufferMs > 0.0))
+        {
+            ThrowTypeError(env, "hwBufferMs must be positive");
+            return false;
+        }
+        if (hwRequest.periodFrames == 0)
+        {
+            hwRequest.periodMs = hwBufferMs / hwRequest.periods;
+        }
+        else if (!periodsGiven)
+        {
+            double bufferFrames = hwBufferMs * sampleRate / 1000.0;
+            hwRequest.periods = std::max(2u, std::min(64u, static_cast<unsigned>(bufferFrames / hwRequest.periodFrames + 0.5)));
+        }
+    }
+
+    // Linux output path: 'alsa' (default), 'pipewire', or 'auto' (PipeWire
+    // when the daemon is reachable, else ALSA)
+    std::string backend = "alsa";
+    if (opts.Has("backend") && opts.Get("backend").IsString())
+    {
+        backend = opts.Get("backend").As<Napi::String>().Utf8Value();
+        if (backend != "alsa" && backend != "pipewire" && backend != "auto")
+        {
+            ThrowTypeError(env, "backend must be 'alsa', 'pipewire' or 'auto'");
+            return false;
+        }
+    }
+
+    // mode 'null': nullSink { clock: 'realtime' | 'fast', wavPath,
+    // xrunEveryPeriods, jitterMs, seed }
+    NullSinkOptions nullOptions;
+    if (opts.Has("nullSink") && opts.Get("nullSink").IsObject())
+    {
+        Napi::Object ns = opts.Get("nullSink").As<Napi::Object>();
+        if (ns.Has("clock") && ns.Get("clock").IsString())
+        {
+            std::string clock = ns.Get("clock").As<Napi::String>().Utf8Value();
+            if (clock != "realtime" && clock != "fast")
+            {
+                ThrowTypeError(env, "nullSink.clock must be 'realtime' or 'fast'");
+                return false;
+            }
+            nullOptions.realtime = clock == "realtime";
+        }
+        if (ns.Has("wavPath") && ns.Get("wavPath").IsString())
+        {
+            nullOptions.wavPath = ns.Get("wavPath").As<Napi::String>().Utf8Value();
+        }
+        if (ns.Has("xrunEveryPeriods") && ns.Get("xrunEveryPeriods").IsNumber())
+        {
+            nullOptions.xrunEveryPeriods = ns.Get("xrunEveryPeriods").As<Napi::Number>().Uint32Value();
+        }
+        if (ns.Has("jitterMs") && ns.Get("jitterMs").IsNumber())
+        {
+            nullOptions.jitterMs = std::max(0.0, ns.Get("jitterMs").As<Napi::Number>().DoubleValue());
+        }
+        if (ns.Has("seed") && ns.Get("seed").IsNumber())
+        {
+            nullOptions.seed = ns.Get("seed").As<Napi::Number>().Uint32Value();
+        }
+    }
+
+    // Expose the ring to JS as a SharedArrayBuffer instead of accepting writes
+    bool sharedRing = false;
+    if (opts.Has("sharedRing") && opts.Get("sharedRing").IsBoolean())
+    {
+        sharedRing = opts.Get("sharedRing").As<Napi::Boolean>().Value();
+    }
+
+    // Render-loop trace for dumpTrace(): true, or the number of records to
+    // keep (rounded up to a power of two)
+    size_t traceRecords = 0;
+    if (opts.Has("trace"))
+    {
+        Napi::Value tv = opts.Get("trace");
+        if (tv.IsBoolean() && tv.As<Napi::Boolean>().Value())
+            traceRecords = RenderTrace::kDefaultRecords;
+        else if (tv.IsNumber())
+            traceRecords = static_cast<size_t>(std::max(0.0, tv.As<Napi::Number>().DoubleValue()));
+    }
+
+    // Share one device with every stream opened on the same bus name
+    std::string busName;
+    if (opts.Has("bus") && opts.Get("bus").IsString())
+    {
+        busName = opts.Get("bus").As<Napi::String>().Utf8Value();
+    }
+
+    out.sampleRate = sampleRate;
+    out.channels = channels;
+    out.bitDepth = bitDepth;
+    out.floatSamples = floatSamples;
+    out.wakeThresholdMs = wakeThresholdMs;
+    out.realtime = realtime;
+    out.hwRequest = hwRequest;
+    out.sharedRing = sharedRing;
+    out.traceRecords = traceRecords;
+    out.busName = busName;
+    out.backend.deviceId = deviceId;
+    out.backend.mode = mode;
+    out.backend.backend = backend;
+    out.backend.bufferMs = bufferMs;
+    out.backend.bitPerfect = bitPerfect;
+    out.backend.strictBitPerfect = strictBitPerfect;
+    out.backend.nullOptions = nullOptions;
+
+    return true;
+}
+
+// Registers a stream OpenStream() brought up and builds the openOutput()
+// result. On failure the stream is closed and freed, and the error is
+// pending on env.
+static Napi::Value PublishStream(Napi::Env env, OutputStreamState *s, const StreamOptions &o)
+{
+    uint32_t handle = g_streams.insert(s);
+    if (handle == 0)
+    {
+        CloseBackend(s);
+        delete s;
+        SetLastError("");
+        ThrowTypeError(env, "Too many open streams");
+        return env.Null();
+    }
+
+    Napi::Value shared = env.Undefined();
+    if (o.sharedRing)
+    {
+        shared = AttachSharedRing(env, handle, s);
+        if (shared.IsNull() || env.IsExceptionPending())
+        {
+            g_streams.retire(handle);
+            g_streams.reclaim(handle);
+            CloseBackend(s);
+            delete s;
+            if (!env.IsExceptionPending())
+                ThrowTypeError(env, "Failed to allocate shared ring");
+            return env.Null();
+        }
+        s->paused.store(false);
+    }
+
+    AddonData *addon = env.GetInstanceData<AddonData>();
+    if (addon)
+        addon->streams.insert(handle);
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("handle", Napi::Number::New(env, handle));
+    result.Set("sampleRate", Napi::Number::New(env, s->sampleRate));
+    result.Set("channels", Napi::Number::New(env, s->channels));
+    result.Set("bitDepth", Napi::Number::New(env, s->bitDepth));
+    result.Set("floatSamples", Napi::Boolean::New(env, s->floatSamples));
+    result.Set("deviceFormat", Napi::String::New(env, SampleFormatName(s->deviceFormat)));
+    result.Set("ringDurationMs", Napi::Number::New(env, s->ringDurationMs));
+    // A bus member reports the device the bus plays through
+    const OutputStreamState *dev = s->bus ? s->bus->device : s;
+    result.Set("backend", Napi::String::New(env, BackendName(dev)));
+    if (s->bus)
+        result.Set("bus", Napi::String::New(env, o.busName));
+    result.Set("latencyClass", Napi::String::New(env, s->hwRequest.latencyClass));
+    if (dev->nullSink)
+    {
+        result.Set("periodFrames", Napi::Number::New(env, dev->nullPeriodFrames));
+        result.Set("periods", Napi::Number::New(env, dev->hwRequest.periods));
+        result.Set("hwBufferFrames", Napi::Number::New(env, dev->nullBufferFrames));
+        result.Set("hwBufferMs", Napi::Number::New(env, dev->nullBufferFrames * 1000.0 / dev->sampleRate));
+    }
+#if defined(EXCLUSIVE_PIPEWIRE)
+    else if (dev->pipewire)
+    {
+        // node.latency asked for; the graph reports its quantum in getStats
+        result.Set("periodFrames", Napi::Number::New(env, dev->pwQuantumRequest));
+        pw_thread_loop_lock(dev->pwLoop);
+        result.Set("nodeId", Napi::Number::New(env, pw_stream_get_node_id(dev->pwStream)));
+        pw_thread_loop_unlock(dev->pwLoop);
+    }
+#endif
+#if defined(EXCLUSIVE_LINUX)
+    else
+    {
+        // Exactly what the device accepted, which may differ from the request
+        result.Set("periodFrames", Napi::Number::New(env, static_cast<double>(dev->periodSize)));
+        result.Set("periods", Napi::Number::New(env, dev->periodSize ? static_cast<double>(dev->bufferSize / dev->periodSize) : 0.0));
+        result.Set("hwBufferFrames", Napi::Number::New(env, static_cast<double>(dev->bufferSize)));
+        result.Set("hwBufferMs", Napi::Number::New(env, dev->bufferSize * 1000.0 / dev->sampleRate));
+    }
+#endif
+    if (o.sharedRing)
+        result.Set("sharedRing", shared);
+    return result;
+}
+
+static Napi::Value OpenOutput(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        ThrowTypeError(env, "openOutput(options) requires an options object");
+        return env.Null();
+    }
+
+    StreamOptions streamOptions;
+    if (!ParseStreamOptions(env, info[0].As<Napi::Object>(), streamOptions))
+        return env.Null();
+
+    std::string error;
+    OutputStreamState *s = OpenStream(streamOptions, error);
+    if (!s)
+    {
+        ThrowTypeError(env, error);
+        return env.Null();
+    }
+    return PublishStream(env, s, streamOptions);
+}
+
+static Napi::Value Write(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBuffer())
+    {
+        ThrowTypeError(env, "write(handle, buffer[, blocking]) requires a handle and Buffer");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    Napi::Buffer<uint8_t> buf = info[1].As<Napi::Buffer<uint8_t>>();
+
+    bool blocking = false;
+    if (info.Length() >= 3 && info[2].IsBoolean())
+    {
+        blocking = info[2].As<Napi::Boolean>().Value();
+    }
+
+    const uint8_t *data = buf.Data();
+    size_t len = buf.Length();
+
+    StreamRef ref = g_streams.acquire(handle);
+    if (!ref)
+    {
+        ThrowTypeError(env, "write() called with invalid handle");
+        return env.Null();
+    }
+    OutputStreamState *s = ref.get();
+
+    int written = WriteBackend(s, data, len, blocking);
+
+    return Napi::Number::New(env, written);
+}
+
+static constexpr size_t kMaxPooledWriteSegments = 8;
+static constexpr size_t kWriteSegmentsReserve = 16;
+
+using WriteSegments = std::vector<std::pair<const uint8_t *, size_t>>;
+
+// Async write worker: performs a (possibly blocking) write off the main thread.
+// The caller's Buffer (or the array handed to writev) is pinned with a
+// persistent reference instead of being copied; the reference is dropped once
+// the bytes are in the ring. Each write gets its own worker (an async work
+// item may only be queued once); the segment list it fills is recycled.
+class WriteAsyncWorker : public Napi::AsyncWorker
+{
+public:
+    WriteAsyncWorker(const Napi::Function &callback,
+                     const Napi::Object &pinnedValue,
+                     AddonData *owner,
+                     uint32_t handle,
+                     bool blocking)
+        : Napi::AsyncWorker(callback),
+          owner(owner),
+          pinned(Napi::Persistent(pinnedValue)),
+          handle(handle),
+          blocking(blocking)
+    {
+        if (owner && !owner->writeSegments.empty())
+        {
+            segments = std::move(owner->writeSegments.back());
+            owner->writeSegments.pop_back();
+        }
+        else
+        {
+            segments.reserve(kWriteSegmentsReserve);
+        }
+    }
+
+    void AddSegment(const uint8_t *data, size_t len)
+    {
+        if (data && len > 0)
+            segments.emplace_back(data, len);
+    }
+
+    void Execute() override
+    {
+        // Held for the whole write; close() waits for it before freeing
+        StreamRef ref = g_streams.acquire(handle);
+        if (!ref)
+        {
+            // Closed before the write ran: still answered, as an error
+            SetError("stream is not open");
+            return;
+        }
+        OutputStreamState *s = ref.get();
+
+        // Straight from the pinned JS memory.
+        // A short write on any segment ends the batch so ordering is kept.
+        int total = 0;
+        for (const auto &seg : segments)
+        {
+            int n = WriteBackend(s, seg.first, seg.second, blocking);
+            if (n < 0)
+            {
+                if (total == 0)
+                    total = n;
+                break;
+            }
+            total += n;
+            if (static_cast<size_t>(n) < seg.second)
+                break;
+        }
+        written = total;
+    }
+
+    void OnOK() override
+    {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Callback().Call({env.Null(),
+                         Napi::Number::New(env, static_cast<double>(written))});
+
+        // If JS threw, clear it so it can’t crash the process
+        if (env.IsExceptionPending())
+        {
+            env.GetAndClearPendingException();
+        }
+    }
+
+    void OnError(const Napi::Error &e) override
+    {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Callback().Call({Napi::String::New(env, e.Message()),
+                         env.Undefined()});
+
+        if (env.IsExceptionPending())
+        {
+            env.GetAndClearPendingException();
+        }
+    }
+
+protected:
+    // Called by node-addon-api once the completion callbacks have run, on
+    // the JS thread. Unpins the caller's memory and hands the segment list
+    // back for the next write.
+    void Destroy() override
+    {
+        pinned.Reset();
+        if (owner && owner->writeSegments.size() < kMaxPooledWriteSegments)
+        {
+            segments.clear();
+            owner->writeSegments.push_back(std::move(segments));
+        }
+        delete this;
+    }
+
+private:
+    AddonData *owner;
+    Napi::ObjectReference pinned;
+    WriteSegments segments;
+    uint32_t handle;
+    bool blocking;
+    int written{0};
+};
+
+static Napi::Value WriteAsync(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsBuffer() || !info[2].IsFunction())
+    {
+        ThrowTypeError(env, "writeAsync(handle, buffer, callback[, blocking]) requires handle, Buffer and callback");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    Napi::Buffer<uint8_t> buf = info[1].As<Napi::Buffer<uint8_t>>();
+    Napi::Function cb = info[2].As<Napi::Function>();
+
+    bool blocking = true;
+    if (info.Length() >= 4 && info[3].IsBoolean())
+        blocking = info[3].As<Napi::Boolean>().Value();
+
+    auto *w = new WriteAsyncWorker(cb, buf, env.GetInstanceData<AddonData>(), handle, blocking);
+    w->AddSegment(buf.Data(), buf.Length());
+    w->Queue();
+    return env.Undefined();
+}
+
+// writev(handle, [buf, ...], callback[, blocking])
+// Scatter-gather variant of writeAsync: all buffers are written in order by a
+// single worker. The array must not be mutated until the callback fires.
+static Napi::Value WriteV(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsArray() || !info[2].IsFunction())
+    {
+        ThrowTypeError(env, "writev(handle, buffers, callback[, blocking]) requires handle, Buffer[] and callback");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    Napi::Array bufs = info[1].As<Napi::Array>();
+    Napi::Function cb = info[2].As<Napi::Function>();
+
+    bool blocking = true;
+    if (info.Length() >= 4 && info[3].IsBoolean())
+        blocking = info[3].As<Napi::Boolean>().Value();
+
+    uint32_t count = bufs.Length();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!bufs.Get(i).IsBuffer())
+        {
+            ThrowTypeError(env, "writev() expects an array of Buffers");
+            return env.Null();
+        }
+    }
+
+    auto *w = new WriteAsyncWorker(cb, bufs, env.GetInstanceData<AddonData>(), handle, blocking);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Napi::Buffer<uint8_t> buf = bufs.Get(i).As<Napi::Buffer<uint8_t>>();
+        w->AddSegment(buf.Data(), buf.Length());
+    }
+    w->Queue();
+    return env.Undefined();
+}
+
+// Reads startTime / trimStartFrames / trimEndFrames / resampleQuality from
+// an openFile() or queueFile() options object.
+static DecodeOptions ParseDecodeOptions(const Napi::CallbackInfo &info, size_t index)
+{
+    DecodeOptions o;
+    if (info.Length() <= index || !info[index].IsObject())
+        return o;
+
+    Napi::Object opts = info[index].As<Napi::Object>();
+    if (opts.Has("startTime") && opts.Get("startTime").IsNumber())
+        o.startTime = std::max(0.0, opts.Get("startTime").As<Napi::Number>().DoubleValue());
+    if (opts.Has("trimStartFrames") && opts.Get("trimStartFrames").IsNumber())
+        o.trimStart = static_cast<uint64_t>(std::max(0.0, opts.Get("trimStartFrames").As<Napi::Number>().DoubleValue()));
+    if (opts.Has("trimEndFrames") && opts.Get("trimEndFrames").IsNumber())
+        o.trimEnd = static_cast<uint64_t>(std::max(0.0, opts.Get("trimEndFrames").As<Napi::Number>().DoubleValue()));
+    if (opts.Has("resampleQuality") && opts.Get("resampleQuality").IsString())
+        resample::ParseQuality(opts.Get("resampleQuality").As<Napi::String>().Utf8Value(), o.resampleQuality);
+    return o;
+}
+
+// Opens `path` for `s` and positions it past the encoder delay and startTime.
+// Sets the last error and returns false if the file can't be played natively.
+
+static Napi::Object DecodeJobInfo(const Napi::Env &env, const DecodeJob &job)
+{
+    const FileDecoder::Info &fi = job.decoder->info;
+    uint64_t playable = job.endFrame != UINT64_MAX ? job.endFrame : fi.totalFrames;
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("codec", Napi::String::New(env, fi.codec));
+    result.Set("sampleRate", Napi::Number::New(env, fi.sampleRate));
+    result.Set("channels", Napi::Number::New(env, fi.channels));
+    result.Set("bitDepth", Napi::Number::New(env, fi.bitsPerSample));
+    result.Set("totalFrames", Napi::Number::New(env, static_cast<double>(fi.totalFrames)));
+    result.Set("duration", Napi::Number::New(env, static_cast<double>(playable) / fi.sampleRate));
+    result.Set("startFrame", Napi::Number::New(env, static_cast<double>(job.startFrame)));
+    result.Set("segment", Napi::Number::New(env, job.segment));
+    if (job.resampler)
+    {
+        Napi::Object rs = Napi::Object::New(env);
+        rs.Set("outputRate", Napi::Number::New(env, job.resampler->outputRate()));
+        rs.Set("quality", Napi::String::New(env, job.resampler->qualityName()));
+        rs.Set("taps", Napi::Number::New(env, job.resampler->tapsPerPhase()));
+        rs.Set("phases", Napi::Number::New(env, job.resampler->phases()));
+        rs.Set("kernel", Napi::String::New(env, resample::Best().name));
+        result.Set("resample", rs);
+    }
+    return result;
+}
+
+static StreamRef FindStream(uint32_t handle)
+{
+    return g_streams.acquire(handle);
+}
+
+// Reads a file's format without a stream, so the caller can open the output
+// at the depth the native decoder will produce
+static Napi::Value ProbeFile(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        ThrowTypeError(env, "probeFile(path) requires a path");
+        return env.Null();
+    }
+
+    std::string err;
+    std::unique_ptr<FileDecoder> decoder = FileDecoder::Open(info[0].As<Napi::String>().Utf8Value(), err);
+    if (!decoder)
+    {
+        SetLastError(err);
+        ThrowTypeError(env, "probeFile() could not open file");
+        return env.Null();
+    }
+
+    const FileDecoder::Info &fi = decoder->info;
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("codec", Napi::String::New(env, fi.codec));
+    result.Set("sampleRate", Napi::Number::New(env, fi.sampleRate));
+    result.Set("channels", Napi::Number::New(env, fi.channels));
+    result.Set("bitDepth", Napi::Number::New(env, fi.bitsPerSample));
+    result.Set("totalFrames", Napi::Number::New(env, static_cast<double>(fi.totalFrames)));
+    return result;
+}
+
+static Napi::Value OpenFile(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsString())
+    {
+        ThrowTypeError(env, "openFile(handle, path[, options]) requires a handle and path");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    std::string path = info[1].As<Napi::String>().Utf8Value();
+    DecodeOptions opts = ParseDecodeOptions(info, 2);
+
+    StreamRef ref = FindStream(handle);
+    OutputStreamState *s = ref.get();
+    if (!s)
+    {
+        ThrowTypeError(env, "openFile() called with invalid handle");
+        return env.Null();
+    }
+
+    if (s->sharedRing)
+    {
+        ThrowTypeError(env, "openFile() is not available on sharedRing streams");
+        return env.Null();
+    }
+
+    DecodeJob job;
+    if (!PrepareDecodeJob(s, path, opts, job))
+    {
+        ThrowTypeError(env, "openFile() could not decode file");
+        return env.Null();
+    }
+    Napi::Object result = DecodeJobInfo(env, job);
+
+    StartFileDecoder(s, std::move(job));
+
+    return result;
+}
+
+// Appends a file behind the one openFile() started. The decoder thread moves
+// straight on to it, so the device sees one continuous stream; the boundary
+// is reported through pollSegments().
+static Napi::Value QueueFile(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsString())
+    {
+        ThrowTypeError(env, "queueFile(handle, path[, options]) requires a handle and path");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    std::string path = info[1].As<Napi::String>().Utf8Value();
+    DecodeOptions opts = ParseDecodeOptions(info, 2);
+    opts.startTime = 0.0;
+
+    StreamRef ref = FindStream(handle);
+    OutputStreamState *s = ref.get();
+    if (!s)
+    {
+        ThrowTypeError(env, "queueFile() called with invalid handle");
+        return env.Null();
+    }
+
+    if (!s->fileDecoding.load())
+    {
+        ThrowTypeError(env, "queueFile() requires a stream started with openFile()");
+        return env.Null();
+    }
+
+    DecodeJob job;
+    if (!PrepareDecodeJob(s, path, opts, job))
+    {
+        ThrowTypeError(env, "queueFile() could not decode file");
+        return env.Null();
+    }
+    Napi::Object result = DecodeJobInfo(env, job);
+
+    std::unique_lock<std::mutex> lock(s->decodeQueueMutex);
+    if (!s->decodeFinished.load())
+    {
+        s->decodeQueue.push_back(std::move(job));
+        return result;
+    }
+    lock.unlock();
+
+    // The previous file already finished decoding (the ring may still be
+    // playing it); start a fresh decoder thread behind it
+    {
+        std::lock_guard<std::mutex> errLock(s->decodeErrorMutex);
+        if (!s->decodeError.empty())
+        {
+            SetLastError(s->decodeError);
+            ThrowTypeError(env, "queueFile() decoder stopped with an error");
+            return env.Null();
+        }
+    }
+    if (s->decodeThread.joinable())
+        s->decodeThread.join();
+    s->decodeStop.store(false);
+    s->decodeFinished.store(false);
+    s->decodeThread = std::thread(FileDecodeThread, s, std::move(job));
+
+    return result;
+}
+
+// Marks the next byte written to the stream as the start of a new segment,
+// for producers that write PCM themselves. Call it once earlier writes have
+// completed; returns the segment id reported by pollSegments().
+static Napi::Value MarkSegment(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        ThrowTypeError(env, "markSegment(handle) requires a handle");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    StreamRef ref = FindStream(handle);
+    OutputStreamState *s = ref.get();
+    if (!s)
+    {
+        ThrowTypeError(env, "markSegment() called with invalid handle");
+        return env.Null();
+    }
+
+    if (s->fileDecoding.load())
+    {
+        ThrowTypeError(env, "markSegment() is not available while a file is decoding; use queueFile()");
+        return env.Null();
+    }
+
+    // Serialize with in-flight writes so the marker lands after them
+    std::lock_guard<std::mutex> lock(s->writerMutex);
+    uint32_t id = s->nextSegmentId++;
+    if (!s->segments.push(id, s->ring.writePos->load(std::memory_order_acquire)))
+    {
+        SetLastError("too many segments pending");
+        ThrowTypeError(env, "markSegment() failed");
+        return env.Null();
+    }
+    return Napi::Number::New(env, id);
+}
+
+// Returns the segment boundaries the render thread has crossed since the last
+// call: [{segment, frame, timestampNs}], oldest first. `frame` is in the
+// getPosition() domain, so the boundary is audible once position >= frame.
+static Napi::Value PollSegments(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        ThrowTypeError(env, "pollSegments(handle) requires a handle");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+
+    SegmentMarkers::Crossing crossings[SegmentMarkers::kCapacity];
+    size_t n = 0;
+    {
+        StreamRef ref = g_streams.acquire(handle);
+        if (!ref)
+        {
+            ThrowTypeError(env, "pollSegments() called with invalid handle");
+            return env.Null();
+        }
+        n = ref->segments.take(crossings, SegmentMarkers::kCapacity);
+    }
+
+    Napi::Array arr = Napi::Array::New(env, n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        Napi::Object o = Napi::Object::New(env);
+        o.Set("segment", Napi::Number::New(env, crossings[i].id));
+        o.Set("frame", Napi::Number::New(env, static_cast<double>(crossings[i].frame)));
+        o.Set("timestampNs", Napi::Number::New(env, static_cast<double>(crossings[i].timestampNs)));
+        arr.Set(static_cast<uint32_t>(i), o);
+    }
+    return arr;
+}
+
+static Napi::Value SetGain(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
+    {
+        ThrowTypeError(env, "setGain(handle, value[, rampMs[, curve]]) requires a handle and gain");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    double value = info[1].As<Napi::Number>().DoubleValue();
+    if (!std::isfinite(value) || value < 0.0)
+    {
+        ThrowTypeError(env, "setGain() gain must be a finite number >= 0");
+        return env.Null();
+    }
+
+    double rampMs = 0.0;
+    if (info.Length() >= 3 && info[2].IsNumber())
+    {
+        rampMs = info[2].As<Napi::Number>().DoubleValue();
+        if (!std::isfinite(rampMs) || rampMs < 0.0)
+            rampMs = 0.0;
+    }
+
+    GainStage::Curve curve = GainStage::Curve::Linear;
+    if (info.Length() >= 4 && info[3].IsString())
+    {
+        std::string name = info[3].As<Napi::String>().Utf8Value();
+        if (name == "exponential" || name == "exp")
+            curve = GainStage::Curve::Exponential;
+        else if (name != "linear")
+        {
+            ThrowTypeError(env, "setGain() curve must be 'linear' or 'exponential'");
+            return env.Null();
+        }
+    }
+
+    StreamRef ref = g_streams.acquire(handle);
+    if (!ref)
+    {
+        ThrowTypeError(env, "setGain() called with invalid handle");
+        return env.Null();
+    }
+    OutputStreamState *s = ref.get();
+
+    uint32_t rampFrames = static_cast<uint32_t>(std::min(rampMs, 60000.0) * s->sampleRate / 1000.0);
+    s->gain.set(static_cast<float>(value), rampFrames, curve);
+
+    return Napi::Number::New(env, s->gain.target());
+}
+
+// Center frequencies used when setEq() is given plain dB values
+static const double kGraphicEqFreqs[] = {32, 64, 125, 250, 500, 1000, 2000, 4000, 8000, 16000};
+
+static bool ParseEqBand(const Napi::Value &v, size_t index, size_t count, BiquadBand &band, std::string &err)
+{
+    if (v.IsNumber())
+    {
+        if (count != sizeof(kGraphicEqFreqs) / sizeof(kGraphicEqFreqs[0]))
+        {
+            err = "setEq() numeric bands must be a 10-band gain list (dB)";
+            return false;
+        }
+        band.freq = kGraphicEqFreqs[index];
+        band.gainDb = v.As<Napi::Number>().DoubleValue();
+    }
+    else if (v.IsObject())
+    {
+        Napi::Object o = v.As<Napi::Object>();
+        if (!o.Has("freq") || !o.Get("freq").IsNumber())
+        {
+            err = "setEq() band objects require a numeric freq";
+            return false;
+        }
+        band.freq = o.Get("freq").As<Napi::Number>().DoubleValue();
+        if (o.Has("gain") && o.Get("gain").IsNumber())
+            band.gainDb = o.Get("gain").As<Napi::Number>().DoubleValue();
+        if (o.Has("q") && o.Get("q").IsNumber())
+            band.q = o.Get("q").As<Napi::Number>().DoubleValue();
+        if (o.Has("type") && o.Get("type").IsString())
+        {
+            std::string type = o.Get("type").As<Napi::String>().Utf8Value();
+            if (type == "peaking")
+                band.type = BiquadBand::Type::Peaking;
+            else if (type == "lowshelf")
+                band.type = BiquadBand::Type::LowShelf;
+            else if (type == "highshelf")
+                band.type = BiquadBand::Type::HighShelf;
+            else if (type == "lowpass")
+                band.type = BiquadBand::Type::LowPass;
+            else if (type == "highpass")
+                band.type = BiquadBand::Type::HighPass;
+            else
+            {
+                err = "setEq() band type must be peaking, lowshelf, highshelf, lowpass or highpass";
+                return false;
+            }
+        }
+    }
+    else
+    {
+        err = "setEq() bands must be numbers (dB) or {freq, gain, q, type} objects";
+        return false;
+    }
+
+    if (!std::isfinite(band.freq) || band.freq <= 0.0 || !std::isfinite(band.gainDb) ||
+        !std::isfinite(band.q) || band.q <= 0.0)
+    {
+        err = "setEq() band values must be finite, with freq and q > 0";
+        return false;
+    }
+    band.gainDb = std::min(std::max(band.gainDb, -24.0), 24.0);
+    return true;
+}
+
+static Napi::Value SetEq(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        ThrowTypeError(env, "setEq(handle, bands) requires a handle");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+
+    // null / undefined / [] all switch the EQ off
+    std::vector<BiquadBand> bands;
+    if (info.Length() >= 2 && info[1].IsArray())
+    {
+        Napi::Array arr = info[1].As<Napi::Array>();
+        if (arr.Length() > EqStage::kMaxBands)
+        {
+            ThrowTypeError(env, "setEq() supports at most 32 bands");
+            return env.Null();
+        }
+        bands.resize(arr.Length());
+        for (uint32_t i = 0; i < arr.Length(); ++i)
+        {
+            std::string err;
+            if (!ParseEqBand(arr.Get(i), i, arr.Length(), bands[i], err))
+            {
+                ThrowTypeError(env, err.c_str());
+                return env.Null();
+            }
+        }
+    }
+    else if (info.Length() >= 2 && !info[1].IsNull() && !info[1].IsUndefined())
+    {
+        ThrowTypeError(env, "setEq() bands must be an array or null");
+        return env.Null();
+    }
+
+    StreamRef ref = g_streams.acquire(handle);
+    if (!ref)
+    {
+        ThrowTypeError(env, "setEq() called with invalid handle");
+        return env.Null();
+    }
+    OutputStreamState *s = ref.get();
+
+    if (s->channels > EqStage::kMaxChannels && !bands.empty())
+    {
+        ThrowTypeError(env, "setEq() supports at most 8 channels");
+        return env.Null();
+    }
+
+    s->eq.set(bands, static_cast<double>(s->sampleRate));
+    return Napi::Number::New(env, s->eq.bands());
+}
+
+// setCrossfade(handle, ms): crossfade length between files queued with
+// queueFile(). 0 plays them gaplessly. Returns the length in effect, in ms.
+static Napi::Value SetCrossfade(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
+    {
+        ThrowTypeError(env, "setCrossfade(handle, ms) requires a handle and a length");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    double ms = info[1].As<Napi::Number>().DoubleValue();
+    if (!(ms >= 0.0))
+        ms = 0.0;
+    ms = std::min(ms, kMaxCrossfadeMs);
+
+    StreamRef ref = FindStream(handle);
+    OutputStreamState *s = ref.get();
+    if (!s)
+    {
+        ThrowTypeError(env, "setCrossfade() called with invalid handle");
+        return env.Null();
+    }
+    if (ms > 0.0 && s->channels > CrossfadeMixer::kMaxChannels)
+    {
+        ThrowTypeError(env, "setCrossfade() supports at most 8 channels");
+        return env.Null();
+    }
+
+    uint32_t frames = static_cast<uint32_t>(ms * s->sampleRate / 1000.0);
+    size_t bytes = static_cast<size_t>(frames) * s->bytesPerFrame;
+    if (bytes > s->fadeRing.size())
+    {
+        // Resize only while no fade owns the ring; a fade in flight keeps its
+        // length and the next one gets the new ring
+        int idle = kFadeIdle;
+        if (s->fadeState.compare_exchange_strong(idle, kFadeResizing, std::memory_order_acq_rel))
+        {
+            s->lockedMemory.unlock(s->fadeRing.data);
+            s->fadeRing.init(bytes);
+            if (s->realtime.lockMemory)
+                s->lockedMemory.lock(s->fadeRing.data, s->fadeRing.capacity);
+            s->fadeState.store(kFadeIdle, std::memory_order_release);
+        }
+    }
+    s->crossfadeFrames.store(frames, std::memory_order_relaxed);
+    return Napi::Number::New(env, s->sampleRate ? frames * 1000.0 / s->sampleRate : 0.0);
+}
+
+static Napi::Value GetPosition(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        ThrowTypeError(env, "getPosition(handle) requires a handle");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+
+    StreamRef ref = g_streams.acquire(handle);
+    if (!ref)
+    {
+        ThrowTypeError(env, "getPosition() called with invalid handle");
+        return env.Null();
+    }
+
+    OutputStreamState *s = ref.get();
+    PlaybackClock::Position pos = s->clock.read();
+
+    Napi::Object res = Napi::Object::New(env);
+    res.Set("frames", Napi::Number::New(env, static_cast<double>(pos.frames)));
+    res.Set("seconds", Napi::Number::New(env, s->sampleRate ? static_cast<double>(pos.frames) / s->sampleRate : 0.0));
+    // Same clock as process.hrtime.bigint(); 0 until the first period plays
+    res.Set("timestampNs", Napi::Number::New(env, static_cast<double>(pos.timestampNs)));
+    return res;
+}
+
+static void DeliverEvents(Napi::Env env, Napi::Function callback, EventChannel *ch, void *)
+{
+    // Cleared first: an event posted while we drain schedules another call
+    ch->pending.store(false);
+    if (env == nullptr || callback == nullptr)
+        return; // tearing down
+
+    Napi::Array batch = Napi::Array::New(env);
+    uint32_t n = 0;
+    StreamEvent e;
+    uint32_t sticky = 0;
+    size_t nextSticky = 0;
+    for (;;)
+    {
+        if (!ch->queue.pop(e))
+        {
+            // The queue is empty; the reserved events go last, after what
+            // was already queued when they overflowed
+            if (nextSticky == 0)
+                sticky = ch->stickyPending.exchange(0, std::memory_order_acquire);
+            while (nextSticky < 2 && !(sticky & (1u << nextSticky)))
+                ++nextSticky;
+            if (nextSticky == 2)
+                break;
+            e = StreamEvent();
+            e.type = kStickyEvents[nextSticky];
+            e.frames = ch->stickyFrames[nextSticky].load(std::memory_order_relaxed);
+            e.timestampNs = ch->stickyTimestampNs[nextSticky].load(std::memory_order_relaxed);
+            ++nextSticky;
+        }
+        Napi::Object ev = Napi::Object::New(env);
+        ev.Set("type", Napi::String::New(env, StreamEventName(e.type)));
+        ev.Set("frames", Napi::Number::New(env, static_cast<double>(e.frames)));
+        ev.Set("timestampNs", Napi::Number::New(env, static_cast<double>(e.timestampNs)));
+        if (e.type == StreamEventType::LowWatermark)
+            ev.Set("buffered", Napi::Number::New(env, e.value));
+        else if (e.type == StreamEventType::FormatChanged)
+            ev.Set("sampleRate", Napi::Number::New(env, e.value));
+        batch.Set(n++, ev);
+    }
+    uint64_t dropped = ch->dropped.exchange(0, std::memory_order_relaxed);
+    if (n == 0 && dropped == 0)
+        return;
+    callback.Call({batch, Napi::Number::New(env, static_cast<double>(dropped))});
+}
+
+// Stops event delivery for s. Events already queued are still delivered;
+// the channel goes with the last of them.
+static void DetachEvents(OutputStreamState *s)
+{
+    EventChannel *ch = s->events.exchange(nullptr);
+    if (!ch)
+        return;
+    // A producer that loaded the channel before the exchange is done with it
+    // once eventUsers drops to zero; that is never longer than one push
+    while (s->eventUsers.load() != 0)
+        std::this_thread::yield();
+    ch->tsfn.Release();
+}
+
+// subscribe(handle, callback, options?) -> boolean
+// callback(events, dropped) runs on the JS thread with every event raised
+// since the last call, oldest first. Options: lowWatermarkMs (ring fill that
+// raises low-watermark, 0 = off) and positionIntervalMs (position ticks,
+// 0 = off). Replaces any earlier subscription on the stream.
+static Napi::Value Subscribe(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsFunction())
+    {
+        ThrowTypeError(env, "subscribe(handle, callback, options?) requires a handle and a callback");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    StreamRef ref = g_streams.acquire(handle);
+    if (!ref)
+    {
+        ThrowTypeError(env, "subscribe() called with invalid handle");
+        return env.Null();
+    }
+    OutputStreamState *s = ref.get();
+
+    double lowWatermarkMs = 0.0;
+    double positionIntervalMs = 0.0;
+    if (info.Length() >= 3 && info[2].IsObject())
+    {
+        Napi::Object opts = info[2].As<Napi::Object>();
+        if (opts.Has("lowWatermarkMs") && opts.Get("lowWatermarkMs").IsNumber())
+            lowWatermarkMs = std::max(0.0, opts.Get("lowWatermarkMs").As<Napi::Number>().DoubleValue());
+        if (opts.Has("positionIntervalMs") && opts.Get("positionIntervalMs").IsNumber())
+            positionIntervalMs = std::max(0.0, opts.Get("positionIntervalMs").As<Napi::Number>().DoubleValue());
+    }
+
+    auto *ch = new EventChannel();
+    ch->tsfn = EventTsfn::New(env, info[1].As<Napi::Function>(), "exclusiveAudioEvents", 0, 1, ch,
+                              [](Napi::Env, void *, EventChannel *c)
+                              { delete c; },
+                              static_cast<void *>(nullptr));
+    // An open stream with listeners should not keep the process alive
+    ch->tsfn.Unref(env);
+
+    DetachEvents(s);
+    size_t watermark = static_cast<size_t>(lowWatermarkMs * s->sampleRate / 1000.0) * s->bytesPerFrame;
+    s->lowWatermarkBytes.store(std::min(watermark, s->ring.size()));
+    s->positionIntervalFrames.store(static_cast<uint64_t>(positionIntervalMs * s->sampleRate / 1000.0));
+    s->events.store(ch);
+    return Napi::Boolean::New(env, true);
+}
+
+static Napi::Value Unsubscribe(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        ThrowTypeError(env, "unsubscribe(handle) requires a handle");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    StreamRef ref = g_streams.acquire(handle);
+    if (ref)
+        DetachEvents(ref.get());
+    return env.Undefined();
+}
+
+// markEnd(handle): no more input is coming. played-out follows once the ring
+// has drained and the device has played the last frame.
+static Napi::Value MarkEnd(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        ThrowTypeError(env, "markEnd(handle) requires a handle");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    StreamRef ref = g_streams.acquire(handle);
+    if (!ref)
+    {
+        ThrowTypeError(env, "markEnd() called with invalid handle");
+        return env.Null();
+    }
+    ref->inputEnded.store(true);
+    return env.Undefined();
+}
+
+static Napi::Value Close(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        ThrowTypeError(env, "close(handle) requires a handle");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+
+    OutputStreamState *s = ShutdownStream(handle);
+
+    if (s)
+    {
+        AddonData *addon = env.GetInstanceData<AddonData>();
+        if (addon)
+            addon->streams.erase(handle);
+
+        DetachEvents(s);
+
+        // Render thread is gone; the SharedArrayBuffer may be released now
+        ReleaseSharedRing(env, handle, s);
+
+        delete s;
     }
 
-    bool bitPerfect = false;
-    if (opts.Has("bitPerfect") && opts.Get("bitPerfect").IsBoolean())
-    {
-        bitPerfect = opts.Get("bitPerfect").As<Napi::Boolean>().Value();
-    }
+    return env.Undefined();
+}
+
+
+static Napi::Value GetDevices(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    (void)info;
+
+#if defined(EXCLUSIVE_WIN32)
+    return GetWasapiDevices(env);
+#elif defined(EXCLUSIVE_MACOS)
+    return GetCoreAudioDevices(env);
+#elif defined(EXCLUSIVE_LINUX)
+    return GetAlsaDevices(env);
+#else
+    return Napi::Array::New(env);
+#endif
+}
+
+static Napi::Value IsSupported(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    (void)info;
+
+#if defined(EXCLUSIVE_WIN32) || defined(EXCLUSIVE_MACOS) || defined(EXCLUSIVE_LINUX)
+    return Napi::Boolean::New(env, true);
+#else
+    return Napi::Boolean::New(env, false);
+#endif
+}
 
-    bool strictBitPerfect = false;
-    if (opts.Has("strictBitPerfect") && opts.Get("strictBitPerfect").IsBoolean())
+static Napi::Array TelemetryHistogram(Napi::Env env, const uint64_t *counts, size_t n)
+{
+    Napi::Array arr = Napi::Array::New(env, n);
+    for (size_t i = 0; i < n; ++i)
+        arr.Set(static_cast<uint32_t>(i), Napi::Number::New(env, static_cast<double>(counts[i])));
+    return arr;
+}
+
+static Napi::Value GetStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
     {
-        strictBitPerfect = opts.Get("strictBitPerfect").As<Napi::Boolean>().Value();
+        ThrowTypeError(env, "getStats(handle) requires a handle");
+        return env.Null();
     }
 
-    auto *s = new OutputStreamState();
-    s->sampleRate = sampleRate;
-    s->channels = channels;
-    s->bitDepth = bitDepth;
-    s->bytesPerFrame = (bitDepth / 8) * channels;
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
 
-    bool ok = false;
+    StreamRef ref = g_streams.acquire(handle);
+    OutputStreamState *s = ref.get();
 
-#if defined(EXCLUSIVE_WIN32)
+    if (!s)
+        return env.Null();
 
-    if (mode == "shared")
+    size_t buffered = s->ring.availableToRead();
+    size_t freeBytes = s->ring.availableToWrite();
+    size_t ringSizeBytes = s->ring.size();
+
+    // Compute latency: ring buffer latency + approximate hardware latency
+    double ringFrames = 0.0;
+    double ringLatencyMs = 0.0;
+    double hardwareLatencyMs = 0.0;
+    if (s->bytesPerFrame > 0)
     {
-        ok = InitWasapi(s, deviceId, false, bufferMs, bitPerfect);
-        if (!ok)
-        {
-            delete s;
-            ThrowTypeError(env, "Failed to open shared WASAPI output");
-            return env.Null();
-        }
+        ringFrames = static_cast<double>(buffered) / static_cast<double>(s->bytesPerFrame);
+        ringLatencyMs = (ringFrames * 1000.0) / static_cast<double>(s->sampleRate);
+        uint32_t hwPadding = s->lastHardwarePaddingFrames.load();
+        hardwareLatencyMs = (static_cast<double>(hwPadding) * 1000.0) / static_cast<double>(s->sampleRate);
     }
-    else if (mode == "exclusive")
-    {
-        ok = InitWasapi(s, deviceId, true, bufferMs, bitPerfect);
-        if (!ok)
-        {
-            if (strictBitPerfect)
-            {
-                delete s;
-                ThrowTypeError(env, "Exclusive format not supported in strict bitPerfect mode");
-                return env.Null();
-            }
 
-            // Try shared fallback
-            ok = InitWasapi(s, deviceId, false, bufferMs, bitPerfect);
-            if (!ok)
-            {
-                delete s;
-                ThrowTypeError(env, "Failed to open exclusive output; shared fallback also failed");
-                return env.Null();
-            }
-        }
-    }
-    else
+    Napi::Object res = Napi::Object::New(env);
+    res.Set("buffered", Napi::Number::New(env, buffered));
+    res.Set("free", Napi::Number::New(env, freeBytes));
+    res.Set("ringSize", Napi::Number::New(env, ringSizeBytes));
+    res.Set("sampleRate", Napi::Number::New(env, s->sampleRate));
+    res.Set("channels", Napi::Number::New(env, s->channels));
+    res.Set("bitDepth", Napi::Number::New(env, s->bitDepth));
+    res.Set("bytesPerFrame", Napi::Number::New(env, s->bytesPerFrame));
+    res.Set("ringDurationMs", Napi::Number::New(env, s->ringDurationMs));
+    res.Set("ringLatencyMs", Napi::Number::New(env, ringLatencyMs));
+    res.Set("hardwareLatencyMs", Napi::Number::New(env, hardwareLatencyMs));
+    res.Set("totalSystemLatencyMs", Napi::Number::New(env, ringLatencyMs + hardwareLatencyMs));
+    res.Set("wakeThresholdBytes", Napi::Number::New(env, static_cast<double>(s->wakeThresholdBytes.load())));
+    res.Set("writerParks", Napi::Number::New(env, static_cast<double>(s->writerParks.load())));
+    res.Set("writerWakeups", Napi::Number::New(env, static_cast<double>(s->writerWakeups.load())));
+    res.Set("writerSpuriousWakeups", Napi::Number::New(env, static_cast<double>(s->writerSpuriousWakeups.load())));
+    res.Set("running", Napi::Boolean::New(env, s->running.load()));
+    res.Set("paused", Napi::Boolean::New(env, s->paused.load()));
+    res.Set("floatSamples", Napi::Boolean::New(env, s->floatSamples));
+    res.Set("deviceFormat", Napi::String::New(env, SampleFormatName(s->deviceFormat)));
+    res.Set("backend", Napi::String::New(env, BackendName(s->bus ? s->bus->device : s)));
+    res.Set("formatConversion", Napi::Boolean::New(env, !s->converter.identity()));
+    res.Set("gain", Napi::Number::New(env, s->gain.target()));
+    res.Set("gainKernel", Napi::String::New(env, gain::Best().name));
+    res.Set("eqBands", Napi::Number::New(env, s->eq.bands()));
+    res.Set("crossfadeMs", Napi::Number::New(env, s->sampleRate ? s->crossfadeFrames.load() * 1000.0 / s->sampleRate : 0.0));
+    res.Set("crossfading", Napi::Boolean::New(env, s->fadeState.load() >= kFadeArmed));
+
     {
-        delete s;
-        ThrowTypeError(env, "Unknown mode; expected 'exclusive' or 'shared'");
-        return env.Null();
+        // Bus members report their own periods, timed across the bus mix
+        RenderTelemetry::Snapshot t = s->telemetry.read();
+        Napi::Object tel = Napi::Object::New(env);
+        tel.Set("periods", Napi::Number::New(env, static_cast<double>(t.periods)));
+        tel.Set("ringUnderruns", Napi::Number::New(env, static_cast<double>(t.ringUnderruns)));
+        tel.Set("underrunFrames", Napi::Number::New(env, static_cast<double>(t.underrunFrames)));
+        tel.Set("deviceXruns", Napi::Number::New(env, static_cast<double>(t.deviceXruns)));
+        tel.Set("shortWrites", Napi::Number::New(env, static_cast<double>(t.shortWrites)));
+        tel.Set("fillPercent", Napi::Number::New(env, t.lastFillPercent));
+        tel.Set("maxJitterUs", Napi::Number::New(env, t.maxJitterNs / 1000.0));
+        tel.Set("maxRenderUs", Napi::Number::New(env, t.maxRenderNs / 1000.0));
+        tel.Set("fillHistogram", TelemetryHistogram(env, t.fill, RenderTelemetry::kFillBuckets));
+        tel.Set("jitterHistogram", TelemetryHistogram(env, t.jitter, RenderTelemetry::kTimeBuckets));
+        tel.Set("renderHistogram", TelemetryHistogram(env, t.render, RenderTelemetry::kTimeBuckets));
+        res.Set("telemetry", tel);
     }
 
-#elif defined(EXCLUSIVE_MACOS)
-
-    bool exclusive = (mode == "exclusive");
+    if (s->trace.enabled())
+    {
+        Napi::Object tr = Napi::Object::New(env);
+        tr.Set("capacity", Napi::Number::New(env, static_cast<double>(s->trace.capacity())));
+        tr.Set("recorded", Napi::Number::New(env, static_cast<double>(s->trace.recorded())));
+        res.Set("trace", tr);
+    }
 
-    ok = InitCoreAudio(s, deviceId, exclusive, bufferMs, bitPerfect);
-    if (!ok)
+    if (s->fileDecoding.load())
     {
-        if (strictBitPerfect && exclusive)
+        Napi::Object dec = Napi::Object::New(env);
+        dec.Set("finished", Napi::Boolean::New(env, s->decodeFinished.load()));
+        dec.Set("startFrame", Napi::Number::New(env, static_cast<double>(s->decodeStartFrame)));
+        dec.Set("framesDecoded", Napi::Number::New(env, static_cast<double>(s->decodedFrames.load())));
         {
-            delete s;
-            ThrowTypeError(env, "Exclusive format not supported in strict bitPerfect mode");
-            return env.Null();
+            std::lock_guard<std::mutex> queueLock(s->decodeQueueMutex);
+            dec.Set("queued", Napi::Number::New(env, static_cast<double>(s->decodeQueue.size())));
+        }
+        {
+            std::lock_guard<std::mutex> lock(s->decodeErrorMutex);
+            if (!s->decodeError.empty())
+                dec.Set("error", Napi::String::New(env, s->decodeError));
         }
+        res.Set("decoder", dec);
+    }
 
-        // Try without exclusive mode as fallback
-        ok = InitCoreAudio(s, deviceId, false, bufferMs, false);
-        if (!ok)
+    {
+        std::lock_guard<std::mutex> lock(g_busesMutex);
+        if (s->bus)
         {
-            delete s;
-            ThrowTypeError(env, "Failed to open CoreAudio output");
-            return env.Null();
+            Napi::Object bus = Napi::Object::New(env);
+            bus.Set("name", Napi::String::New(env, s->bus->name));
+            bus.Set("members", Napi::Number::New(env, static_cast<double>(s->bus->attached.size())));
+            bus.Set("deviceFormat", Napi::String::New(env, SampleFormatName(s->bus->device->deviceFormat)));
+            // Same dispatch as the gain kernels
+            bus.Set("mixKernel", Napi::String::New(env, gain::Best().name));
+            res.Set("bus", bus);
         }
     }
 
-#elif defined(EXCLUSIVE_LINUX)
+    if (s->nullSink)
+    {
+        Napi::Object ns = Napi::Object::New(env);
+        ns.Set("clock", Napi::String::New(env, s->nullOptions.realtime ? "realtime" : "fast"));
+        ns.Set("framesRendered", Napi::Number::New(env, static_cast<double>(s->nullFramesRendered.load())));
+        if (!s->nullOptions.wavPath.empty())
+            ns.Set("wavPath", Napi::String::New(env, s->nullOptions.wavPath));
+        res.Set("nullSink", ns);
+        res.Set("bufferSize", Napi::Number::New(env, s->nullBufferFrames));
+        res.Set("periodSize", Napi::Number::New(env, s->nullPeriodFrames));
+        res.Set("xruns", Napi::Number::New(env, static_cast<double>(s->telemetry.read().deviceXruns)));
+    }
 
-    bool exclusive = (mode == "exclusive");
+#if defined(EXCLUSIVE_LINUX)
+    if (s->bufferSize > 0 && s->periodSize > 0)
+    {
+        res.Set("bufferSize", Napi::Number::New(env, s->bufferSize));
+        res.Set("periodSize", Napi::Number::New(env, s->periodSize));
+        res.Set("alsaAccess", Napi::String::New(env, s->alsaMmap ? "mmap" : "rw"));
+        res.Set("xruns", Napi::Number::New(env, static_cast<double>(s->telemetry.read().deviceXruns)));
+    }
 
-    ok = InitAlsa(s, deviceId, exclusive, bufferMs, bitPerfect);
-    if (!ok)
+#if defined(EXCLUSIVE_PIPEWIRE)
+    if (s->pipewire)
     {
-        if (strictBitPerfect && exclusive)
+        Napi::Object pw = Napi::Object::New(env);
+        uint32_t graphRate = s->pwGraphRate.load();
+        pw.Set("quantumRequested", Napi::Number::New(env, s->pwQuantumRequest));
+        pw.Set("quantum", Napi::Number::New(env, s->pwQuantum.load()));
+        pw.Set("graphRate", Napi::Number::New(env, graphRate));
+        // The adapter passes samples through only when the graph runs at our rate
+        pw.Set("rateMatched", Napi::Boolean::New(env, graphRate == s->sampleRate));
+
+        pw_thread_loop_lock(s->pwLoop);
+        pw.Set("nodeId", Napi::Number::New(env, pw_stream_get_node_id(s->pwStream)));
+        pw.Set("state", Napi::String::New(env, pw_stream_state_as_string(s->pwState)));
+        if (!s->pwError.empty())
+            pw.Set("error", Napi::String::New(env, s->pwError));
+        if (s->pwHaveLatency)
         {
-            delete s;
-            ThrowTypeError(env, "Exclusive format not supported in strict bitPerfect mode");
-            return env.Null();
+            // Downstream latency as the graph reports it: a number of quanta,
+            // plus samples at the graph rate, plus fixed nanoseconds
+            const spa_latency_info &l = s->pwLatency;
+            Napi::Object lat = Napi::Object::New(env);
+            lat.Set("minQuantum", Napi::Number::New(env, l.min_quantum));
+            lat.Set("maxQuantum", Napi::Number::New(env, l.max_quantum));
+            lat.Set("minRate", Napi::Number::New(env, l.min_rate));
+            lat.Set("maxRate", Napi::Number::New(env, l.max_rate));
+            lat.Set("minNs", Napi::Number::New(env, static_cast<double>(l.min_ns)));
+            lat.Set("maxNs", Napi::Number::New(env, static_cast<double>(l.max_ns)));
+            if (graphRate)
+            {
+                double quantum = s->pwQuantum.load();
+                lat.Set("minMs", Napi::Number::New(env, (l.min_quantum * quantum + l.min_rate) * 1000.0 / graphRate + l.min_ns / 1e6));
+                lat.Set("maxMs", Napi::Number::New(env, (l.max_quantum * quantum + l.max_rate) * 1000.0 / graphRate + l.max_ns / 1e6));
+            }
+            pw.Set("latency", lat);
         }
+        pw_thread_loop_unlock(s->pwLoop);
+        res.Set("pipewire", pw);
+    }
+#endif
 
-        // Try without exclusive mode as fallback
-        ok = InitAlsa(s, deviceId, false, bufferMs, false);
-        if (!ok)
+    {
+        std::lock_guard<std::mutex> lock(s->realtimeMutex);
+        if (s->realtimeApplied)
         {
-            delete s;
-            ThrowTypeError(env, "Failed to open ALSA output");
-            return env.Null();
+            const RealtimeReport &r = s->realtimeReport;
+            Napi::Object rt = Napi::Object::New(env);
+            rt.Set("policy", Napi::String::New(env, r.policy));
+            rt.Set("priority", Napi::Number::New(env, r.priority));
+            rt.Set("nice", Napi::Number::New(env, r.nice));
+            Napi::Array cpus = Napi::Array::New(env, r.cpus.size());
+            for (size_t i = 0; i < r.cpus.size(); ++i)
+                cpus.Set(static_cast<uint32_t>(i), Napi::Number::New(env, r.cpus[i]));
+            rt.Set("cpus", cpus);
+            rt.Set("memoryLocked", Napi::Boolean::New(env, r.memoryLocked));
+            rt.Set("lockedBytes", Napi::Number::New(env, static_cast<double>(s->lockedMemory.bytes())));
+            if (!r.note.empty())
+                rt.Set("note", Napi::String::New(env, r.note));
+            res.Set("realtime", rt);
         }
     }
-
-#else
-    (void)deviceId;
-    (void)mode;
-    (void)bufferMs;
-    delete s;
-    ThrowTypeError(env, "exclusive_audio is not supported on this platform");
-    return env.Null();
 #endif
 
-    uint32_t handle;
+    return res;
+}
+
+// readTelemetry(handle, Float64Array) -> boolean
+// Copies the telemetry snapshot into a caller-owned array laid out as
+// telemetryLayout describes, so a fast poller allocates nothing. False for a
+// closed handle.
+static Napi::Value ReadTelemetry(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsTypedArray() ||
+        info[1].As<Napi::TypedArray>().TypedArrayType() != napi_float64_array)
     {
-        std::lock_guard<std::mutex> lock(g_streamsMutex);
-        handle = g_nextId++;
-        g_streams[handle] = s;
+        ThrowTypeError(env, "readTelemetry(handle, Float64Array) requires a handle and a Float64Array");
+        return env.Null();
     }
 
-    Napi::Object result = Napi::Object::New(env);
-    result.Set("handle", Napi::Number::New(env, handle));
-    result.Set("sampleRate", Napi::Number::New(env, s->sampleRate));
-    result.Set("channels", Napi::Number::New(env, s->channels));
-    result.Set("bitDepth", Napi::Number::New(env, s->bitDepth));
-    result.Set("ringDurationMs", Napi::Number::New(env, s->ringDurationMs));
-    return result;
+    Napi::Float64Array out = info[1].As<Napi::Float64Array>();
+    if (out.ElementLength() < RenderTelemetry::kFieldCount)
+    {
+        ThrowTypeError(env, "readTelemetry() array is shorter than telemetryLayout.size");
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    StreamRef ref = g_streams.acquire(handle);
+    if (!ref)
+        return Napi::Boolean::New(env, false);
+
+    RenderTelemetry::flatten(ref->telemetry.read(), out.Data());
+    return Napi::Boolean::New(env, true);
 }
 
-static Napi::Value Write(const Napi::CallbackInfo &info)
+// dumpTrace(handle, path) -> number of events written
+// Writes the render trace held so far as Chrome trace JSON (open in
+// chrome://tracing or ui.perfetto.dev). Recording carries on.
+static Napi::Value DumpTrace(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
-    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBuffer())
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsString())
     {
-        ThrowTypeError(env, "write(handle, buffer[, blocking]) requires a handle and Buffer");
+        ThrowTypeError(env, "dumpTrace(handle, path) requires a handle and a path");
         return env.Null();
     }
 
     uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
-    Napi::Buffer<uint8_t> buf = info[1].As<Napi::Buffer<uint8_t>>();
-
-    bool blocking = false;
-    if (info.Length() >= 3 && info[2].IsBoolean())
+    StreamRef ref = g_streams.acquire(handle);
+    if (!ref)
     {
-        blocking = info[2].As<Napi::Boolean>().Value();
+        ThrowTypeError(env, "dumpTrace() called with invalid handle");
+        return env.Null();
     }
-
-    const uint8_t *data = buf.Data();
-    size_t len = buf.Length();
-
-    OutputStreamState *s = nullptr;
+    if (!ref->trace.enabled())
     {
-        std::lock_guard<std::mutex> lock(g_streamsMutex);
-        auto it = g_streams.find(handle);
-        if (it == g_streams.end())
-        {
-            ThrowTypeError(env, "write() called with invalid handle");
-            return env.Null();
-        }
-        s = it->second;
+        ThrowTypeError(env, "dumpTrace(): stream was opened without the trace option");
+        return env.Null();
     }
 
-    int written = -1;
-
-#if defined(EXCLUSIVE_WIN32)
-    written = WriteWasapi(s, data, len, blocking);
-#elif defined(EXCLUSIVE_MACOS)
-    written = WriteCoreAudio(s, data, len, blocking);
-#elif defined(EXCLUSIVE_LINUX)
-    written = WriteAlsa(s, data, len, blocking);
-#else
-    (void)s;
-    (void)data;
-    (void)blocking;
-    written = -1;
-#endif
-
-    return Napi::Number::New(env, written);
+    std::string path = info[1].As<Napi::String>().Utf8Value();
+    std::string name = "exclusive_audio stream " + std::to_string(handle) + " (" + BackendName(ref.get()) + ")";
+    long long written = ref->trace.writeChromeJson(path.c_str(), name.c_str());
+    if (written < 0)
+    {
+        SetLastError("Cannot write trace to " + path);
+        ThrowTypeError(env, "dumpTrace(): cannot write " + path);
+        return env.Null();
+    }
+    return Napi::Number::New(env, static_cast<double>(written));
 }
 
-// Async write worker: performs a (possibly blocking) write off the main thread
-class WriteAsyncWorker : public Napi::AsyncWorker
+static Napi::Object TelemetryLayout(Napi::Env env)
 {
-public:
-    WriteAsyncWorker(const Napi::Function &callback,
-                     uint32_t handle,
-                     std::vector<uint8_t> &&data,
-                     bool blocking)
-        : Napi::AsyncWorker(callback),
-          handle(handle),
-          data(std::move(data)),
-          blocking(blocking),
-          written(0),
-          cancelled(false) {}
+    Napi::Object layout = Napi::Object::New(env);
+    layout.Set("size", Napi::Number::New(env, RenderTelemetry::kFieldCount));
+    layout.Set("periods", Napi::Number::New(env, RenderTelemetry::kFieldPeriods));
+    layout.Set("ringUnderruns", Napi::Number::New(env, RenderTelemetry::kFieldRingUnderruns));
+    layout.Set("underrunFrames", Napi::Number::New(env, RenderTelemetry::kFieldUnderrunFrames));
+    layout.Set("deviceXruns", Napi::Number::New(env, RenderTelemetry::kFieldDeviceXruns));
+    layout.Set("shortWrites", Napi::Number::New(env, RenderTelemetry::kFieldShortWrites));
+    layout.Set("fillPercent", Napi::Number::New(env, RenderTelemetry::kFieldLastFillPercent));
+    layout.Set("maxJitterUs", Napi::Number::New(env, RenderTelemetry::kFieldMaxJitterUs));
+    layout.Set("maxRenderUs", Napi::Number::New(env, RenderTelemetry::kFieldMaxRenderUs));
+    layout.Set("fillHistogram", Napi::Number::New(env, RenderTelemetry::kFieldFillHistogram));
+    layout.Set("fillBuckets", Napi::Number::New(env, RenderTelemetry::kFillBuckets));
+    layout.Set("jitterHistogram", Napi::Number::New(env, RenderTelemetry::kFieldJitterHistogram));
+    layout.Set("renderHistogram", Napi::Number::New(env, RenderTelemetry::kFieldRenderHistogram));
+    layout.Set("timeBuckets", Napi::Number::New(env, RenderTelemetry::kTimeBuckets));
+    // Upper bound of each time bucket in microseconds; the last is open (0)
+    Napi::Array limits = Napi::Array::New(env, RenderTelemetry::kTimeBuckets);
+    for (size_t i = 0; i < RenderTelemetry::kTimeBuckets; ++i)
+        limits.Set(static_cast<uint32_t>(i), Napi::Number::New(env, static_cast<double>(RenderTelemetry::BucketLimitUs(i))));
+    layout.Set("timeBucketLimitsUs", limits);
+    return layout;
+}
 
-void Execute() override
+static Napi::Value Pause(const Napi::CallbackInfo &info)
 {
-    OutputStreamState* s = nullptr;
-
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
     {
-        std::lock_guard<std::mutex> lock(g_streamsMutex);
-        auto it = g_streams.find(handle);
-        if (it == g_streams.end()) {
-            cancelled.store(true);
-            return;
-        }
+        ThrowTypeError(env, "pause(handle) requires a handle");
+        return env.Null();
+    }
 
-        s = it->second;
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
 
-        if (!s || s->closing.load()) {
-            cancelled.store(true);
-            return;
-        }
+    StreamRef ref = g_streams.acquire(handle);
+    OutputStreamState *s = ref.get();
 
-        // IMPORTANT: increment while lock is held
-        s->inFlightWrites.fetch_add(1, std::memory_order_acq_rel);
+    if (s)
+    {
+        s->paused.store(true);
     }
 
-    // Do the write outside the lock
-#if defined(EXCLUSIVE_WIN32)
-    written = WriteWasapi(s, data.data(), data.size(), blocking);
-#elif defined(EXCLUSIVE_MACOS)
-    written = WriteCoreAudio(s, data.data(), data.size(), blocking);
-#elif defined(EXCLUSIVE_LINUX)
-    written = WriteAlsa(s, data.data(), data.size(), blocking);
-#else
-    written = -1;
-#endif
-
-    // Decrement at end
-    s->inFlightWrites.fetch_sub(1, std::memory_order_acq_rel);
+    return env.Null();
 }
 
-   void OnOK() override
+static Napi::Value Resume(const Napi::CallbackInfo &info)
 {
-    if (cancelled.load()) return;
-
-    Napi::Env env = Env();
-    if (!env) return;
-
-    Napi::HandleScope scope(env);
-
-    Callback().Call({
-        env.Null(),
-        Napi::Number::New(env, static_cast<double>(written))
-    });
-
-    // If JS threw, clear it so it can’t crash the process
-    if (env.IsExceptionPending())
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
     {
-        env.GetAndClearPendingException();
+        ThrowTypeError(env, "resume(handle) requires a handle");
+        return env.Null();
     }
-}
-
-void OnError(const Napi::Error &e) override
-{
-    if (cancelled.load()) return;
 
-    Napi::Env env = Env();
-    if (!env) return;
-
-    Napi::HandleScope scope(env);
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
 
-    Callback().Call({
-        Napi::String::New(env, e.Message()),
-        env.Undefined()
-    });
+    StreamRef ref = g_streams.acquire(handle);
+    OutputStreamState *s = ref.get();
 
-    if (env.IsExceptionPending())
+    if (s)
     {
-        env.GetAndClearPendingException();
+        s->paused.store(false);
     }
-}
-
-
-private:
-    uint32_t handle;
-    std::vector<uint8_t> data;
-    bool blocking;
-    int written;
-    std::atomic<bool> cancelled;
-};
 
+    return env.Null();
+}
 
-static Napi::Value WriteAsync(const Napi::CallbackInfo &info)
+static Napi::Value Drain(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
-    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsBuffer() || !info[2].IsFunction())
+    if (info.Length() < 1 || !info[0].IsNumber())
     {
-        ThrowTypeError(env, "writeAsync(handle, buffer, callback[, blocking]) requires handle, Buffer and callback");
+        ThrowTypeError(env, "drain(handle) requires a handle");
         return env.Null();
     }
 
     uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
-    Napi::Buffer<uint8_t> buf = info[1].As<Napi::Buffer<uint8_t>>();
-    Napi::Function cb = info[2].As<Napi::Function>();
-
-    bool blocking = true;
-    if (info.Length() >= 4 && info[3].IsBoolean())
-        blocking = info[3].As<Napi::Boolean>().Value();
+    StreamRef ref = g_streams.acquire(handle);
+    OutputStreamState *s = ref.get();
 
-    std::vector<uint8_t> copy(buf.Length());
-    std::memcpy(copy.data(), buf.Data(), buf.Length());
+    if (!s)
+        return env.Null();
 
-    WriteAsyncWorker *w = new WriteAsyncWorker(cb, handle, std::move(copy), blocking);
-    w->Queue();
+    DrainStream(s);
     return env.Undefined();
 }
 
-static Napi::Value Close(const Napi::CallbackInfo &info)
+//
+// Promise-returning lifecycle calls
+//
+// openOutputAsync, drainAsync and closeAsync do the work of openOutput, drain
+// and close (device open and format negotiation, waiting for the ring to play
+// out, stopping the render thread and the device) on a libuv worker, so a
+// track change never stalls the JS thread. Only registering the handle,
+// attaching a shared ring and releasing JS-side state stay on the JS thread.
+//
+// The last argument may be { id, timeoutMs }. A nonzero id lets
+// cancelAsync(id) cut the call short; timeoutMs bounds a drain.
+//
+
+static const char *DrainResultName(DrainResult r)
+{
+    switch (r)
+    {
+    case DrainResult::Drained:
+        return "drained";
+    case DrainResult::Stopped:
+        return "stopped";
+    case DrainResult::TimedOut:
+        return "timeout";
+    case DrainResult::Cancelled:
+        return "cancelled";
+    }
+    return "stopped";
+}
+
+struct LifecycleControl
+{
+    uint32_t id{0};
+    uint32_t timeoutMs{0}; // 0: no limit
+};
+
+static LifecycleControl ReadLifecycleControl(const Napi::CallbackInfo &info, size_t index)
+{
+    LifecycleControl c;
+    if (info.Length() <= index || !info[index].IsObject())
+        return c;
+    Napi::Object o = info[index].As<Napi::Object>();
+    if (o.Has("id") && o.Get("id").IsNumber())
+        c.id = o.Get("id").As<Napi::Number>().Uint32Value();
+    if (o.Has("timeoutMs") && o.Get("timeoutMs").IsNumber())
+        c.timeoutMs = static_cast<uint32_t>(std::max(0.0, std::min(4294967295.0, o.Get("timeoutMs").As<Napi::Number>().DoubleValue())));
+    return c;
+}
+
+// Settles a promise from a worker and keeps the operation cancellable by id
+// until then.
+class LifecycleWorker : public Napi::AsyncWorker
 {
-    Napi::Env env = info.Env();
-    if (info.Length() < 1 || !info[0].IsNumber())
+public:
+    LifecycleWorker(Napi::Env env, const char *name, uint32_t id)
+        : Napi::AsyncWorker(env, name),
+          deferred(Napi::Promise::Deferred::New(env)),
+          owner(env.GetInstanceData<AddonData>()),
+          id(id),
+          op(std::make_shared<LifecycleOp>())
     {
-        ThrowTypeError(env, "close(handle) requires a handle");
-        return env.Null();
+        if (id != 0 && owner)
+            owner->operations[id] = op;
     }
 
-    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    Napi::Promise Promise() const { return deferred.Promise(); }
 
-    OutputStreamState *s = nullptr;
+protected:
+    void OnError(const Napi::Error &e) override
     {
-        std::lock_guard<std::mutex> lock(g_streamsMutex);
-        auto it = g_streams.find(handle);
-        if (it != g_streams.end())
-        {
-            s = it->second;
-            g_streams.erase(it);
-        }
+        Forget();
+        deferred.Reject(e.Value());
     }
 
-    if (s)
+    // JS thread, before settling: cancelAsync(id) no longer reaches this call
+    void Forget()
     {
-        // Mark closing
-        s->closing.store(true);
+        if (id == 0 || !owner)
+            return;
+        auto it = owner->operations.find(id);
+        if (it != owner->operations.end() && it->second == op)
+            owner->operations.erase(it);
+    }
 
-        // Stop backend
-#if defined(EXCLUSIVE_WIN32)
-        CloseWasapi(s);
-#elif defined(EXCLUSIVE_MACOS)
-        CloseCoreAudio(s);
-#elif defined(EXCLUSIVE_LINUX)
-        CloseAlsa(s);
-#endif
+    void RejectCancelled(const char *what)
+    {
+        Napi::Env env = Env();
+        Napi::Error e = Napi::Error::New(env, std::string(what) + " cancelled");
+        e.Set("code", Napi::String::New(env, "ABORT_ERR"));
+        deferred.Reject(e.Value());
+    }
 
-        // WAIT for async workers
-        while (s->inFlightWrites.load(std::memory_order_acquire) > 0)
+    // With the op registered so a cancel can wake the drain
+    DrainResult DrainCancellable(OutputStreamState *s, uint32_t timeoutMs)
+    {
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            std::lock_guard<std::mutex> lock(op->mutex);
+            op->draining = s;
         }
-
-        delete s;
+        DrainResult r = DrainStream(s, timeoutMs, &op->cancelled);
+        std::lock_guard<std::mutex> lock(op->mutex);
+        op->draining = nullptr;
+        return r;
     }
 
-    return env.Undefined();
-}
-
+    Napi::Promise::Deferred deferred;
+    AddonData *owner;
+    uint32_t id;
+    std::shared_ptr<LifecycleOp> op;
+};
 
-static Napi::Value GetDevices(const Napi::CallbackInfo &info)
+// The handle is retired on the JS thread before this is queued, so every
+// later call with it fails at once, as after close(). Handle 0 is a stream
+// that was never published (an open cancelled once its device was up);
+// cancelledOpen then names the call whose promise is rejected once the
+// device is released, instead of resolving true.
+class CloseAsyncWorker : public LifecycleWorker
 {
-    Napi::Env env = info.Env();
-    (void)info;
+public:
+    CloseAsyncWorker(Napi::Env env, uint32_t handle, OutputStreamState *s, const char *cancelledOpen = nullptr)
+        : LifecycleWorker(env, "exclusiveAudioClose", 0),
+          handle(handle),
+          s(s),
+          cancelledOpen(cancelledOpen)
+    {
+    }
 
-#if defined(EXCLUSIVE_WIN32)
-    return GetWasapiDevices(env);
-#elif defined(EXCLUSIVE_MACOS)
-    return GetCoreAudioDevices(env);
-#elif defined(EXCLUSIVE_LINUX)
-    return GetAlsaDevices(env);
-#else
-    return Napi::Array::New(env);
-#endif
-}
+    void Execute() override
+    {
+        if (handle != 0)
+            StopRetiredStream(handle, s);
+        else
+            CloseBackend(s);
+        std::lock_guard<std::mutex> lock(stopMutex);
+        stopped = true;
+        stopCv.notify_all();
+    }
 
-static Napi::Value IsSupported(const Napi::CallbackInfo &info)
-{
-    Napi::Env env = info.Env();
-    (void)info;
+    void OnOK() override
+    {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        if (owner)
+            owner->closing.erase(handle);
+        DetachEvents(s);
+        // Render thread is gone; the SharedArrayBuffer may be released now
+        ReleaseSharedRing(env, handle, s);
+        delete s;
+        if (cancelledOpen)
+            RejectCancelled(cancelledOpen);
+        else
+            deferred.Resolve(Napi::Boolean::New(env, true));
+    }
 
-#if defined(EXCLUSIVE_WIN32) || defined(EXCLUSIVE_MACOS) || defined(EXCLUSIVE_LINUX)
-    return Napi::Boolean::New(env, true);
-#else
-    return Napi::Boolean::New(env, false);
-#endif
-}
+    // Env teardown: the stream must be stopped before its ring is released,
+    // whether or not OnOK still gets to run.
+    void WaitStopped()
+    {
+        std::unique_lock<std::mutex> lock(stopMutex);
+        stopCv.wait(lock, [this]
+                    { return stopped; });
+    }
 
-static Napi::Value GetStats(const Napi::CallbackInfo &info)
+    uint32_t Handle() const { return handle; }
+    OutputStreamState *Stream() const { return s; }
+
+private:
+    uint32_t handle;
+    OutputStreamState *s;
+    const char *cancelledOpen;
+    std::mutex stopMutex;
+    std::condition_variable stopCv;
+    bool stopped{false};
+};
+
+class OpenAsyncWorker : public LifecycleWorker
 {
-    Napi::Env env = info.Env();
-    if (info.Length() < 1 || !info[0].IsNumber())
+public:
+    OpenAsyncWorker(Napi::Env env, uint32_t id, StreamOptions options)
+        : LifecycleWorker(env, "exclusiveAudioOpen", id),
+          options(std::move(options))
     {
-        ThrowTypeError(env, "getStats(handle) requires a handle");
-        return env.Null();
     }
 
-    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
-
-    OutputStreamState *s = nullptr;
+    void Execute() override
     {
-        std::lock_guard<std::mutex> lock(g_streamsMutex);
-        auto it = g_streams.find(handle);
-        if (it != g_streams.end())
+        std::string error;
+        s = OpenStream(options, error);
+        if (!s)
+        {
+            SetError(WithLastError(error));
+            return;
+        }
+        // Cancelled while the device was opening: nobody wants it any more
+        if (op->cancelled.load())
         {
-            s = it->second;
+            CloseBackend(s);
+            delete s;
+            s = nullptr;
         }
     }
 
-    if (!s)
-        return env.Null();
-
-    size_t buffered = s->ring.availableToRead();
-    size_t freeBytes = s->ring.availableToWrite();
-    size_t ringSizeBytes = s->ring.size();
-
-    // Compute latency: ring buffer latency + approximate hardware latency
-    double ringFrames = 0.0;
-    double ringLatencyMs = 0.0;
-    double hardwareLatencyMs = 0.0;
-    if (s->bytesPerFrame > 0)
+    void OnOK() override
     {
-        ringFrames = static_cast<double>(buffered) / static_cast<double>(s->bytesPerFrame);
-        ringLatencyMs = (ringFrames * 1000.0) / static_cast<double>(s->sampleRate);
-        uint32_t hwPadding = s->lastHardwarePaddingFrames.load();
-        hardwareLatencyMs = (static_cast<double>(hwPadding) * 1000.0) / static_cast<double>(s->sampleRate);
-    }
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Forget();
 
-    Napi::Object res = Napi::Object::New(env);
-    res.Set("buffered", Napi::Number::New(env, buffered));
-    res.Set("free", Napi::Number::New(env, freeBytes));
-    res.Set("ringSize", Napi::Number::New(env, ringSizeBytes));
-    res.Set("sampleRate", Napi::Number::New(env, s->sampleRate));
-    res.Set("channels", Napi::Number::New(env, s->channels));
-    res.Set("bitDepth", Napi::Number::New(env, s->bitDepth));
-    res.Set("bytesPerFrame", Napi::Number::New(env, s->bytesPerFrame));
-    res.Set("ringDurationMs", Napi::Number::New(env, s->ringDurationMs));
-    res.Set("ringLatencyMs", Napi::Number::New(env, ringLatencyMs));
-    res.Set("hardwareLatencyMs", Napi::Number::New(env, hardwareLatencyMs));
-    res.Set("totalSystemLatencyMs", Napi::Number::New(env, ringLatencyMs + hardwareLatencyMs));
-    res.Set("running", Napi::Boolean::New(env, s->running.load()));
-    res.Set("paused", Napi::Boolean::New(env, s->paused.load()));
+        if (s && op->cancelled.load())
+        {
+            // Cancelled after the worker finished. Closing can block (ALSA
+            // drains), so the device is released on a worker and this
+            // promise rejects once it is, like a close that was waited for.
+            auto *w = new CloseAsyncWorker(env, 0, s, "openOutputAsync()");
+            s = nullptr;
+            deferred.Resolve(w->Promise());
+            w->Queue();
+            return;
+        }
+        if (!s)
+        {
+            RejectCancelled("openOutputAsync()");
+            return;
+        }
 
-#if defined(EXCLUSIVE_LINUX)
-    if (s->bufferSize > 0 && s->periodSize > 0)
-    {
-        res.Set("bufferSize", Napi::Number::New(env, s->bufferSize));
-        res.Set("periodSize", Napi::Number::New(env, s->periodSize));
+        Napi::Value result = PublishStream(env, s, options);
+        if (env.IsExceptionPending())
+        {
+            deferred.Reject(env.GetAndClearPendingException().Value());
+            return;
+        }
+        deferred.Resolve(result);
     }
-#endif
 
-    return res;
-}
+private:
+    StreamOptions options;
+    OutputStreamState *s{nullptr};
+};
 
-static Napi::Value Pause(const Napi::CallbackInfo &info)
+class DrainAsyncWorker : public LifecycleWorker
 {
-    Napi::Env env = info.Env();
-    if (info.Length() < 1 || !info[0].IsNumber())
+public:
+    DrainAsyncWorker(Napi::Env env, const LifecycleControl &control, uint32_t handle)
+        : LifecycleWorker(env, "exclusiveAudioDrain", control.id),
+          handle(handle),
+          timeoutMs(control.timeoutMs)
     {
-        ThrowTypeError(env, "pause(handle) requires a handle");
-        return env.Null();
     }
 
-    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
-
-    OutputStreamState *s = nullptr;
+    void Execute() override
     {
-        std::lock_guard<std::mutex> lock(g_streamsMutex);
-        auto it = g_streams.find(handle);
-        if (it != g_streams.end())
+        // Held for the whole drain; close() waits for it before freeing
+        StreamRef ref = g_streams.acquire(handle);
+        if (!ref)
         {
-            s = it->second;
+            result = DrainResult::Stopped;
+            return;
         }
+        result = DrainCancellable(ref.get(), timeoutMs);
     }
 
-    if (s)
+    void OnOK() override
     {
-        s->paused.store(true);
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Forget();
+        deferred.Resolve(Napi::String::New(env, DrainResultName(result)));
     }
 
-    return env.Null();
-}
+private:
+    uint32_t handle;
+    uint32_t timeoutMs;
+    DrainResult result{DrainResult::Stopped};
+};
 
-static Napi::Value Resume(const Napi::CallbackInfo &info)
+// openOutputAsync(options, { id }?) -> Promise<openOutput() result>
+// Options are checked here and throw as for openOutput(); a failed or
+// cancelled open rejects.
+static Napi::Value OpenOutputAsync(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
-    if (info.Length() < 1 || !info[0].IsNumber())
+    if (info.Length() < 1 || !info[0].IsObject())
     {
-        ThrowTypeError(env, "resume(handle) requires a handle");
+        ThrowTypeError(env, "openOutputAsync(options) requires an options object");
         return env.Null();
     }
 
-    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    StreamOptions streamOptions;
+    if (!ParseStreamOptions(env, info[0].As<Napi::Object>(), streamOptions))
+        return env.Null();
 
-    OutputStreamState *s = nullptr;
-    {
-        std::lock_guard<std::mutex> lock(g_streamsMutex);
-        auto it = g_streams.find(handle);
-        if (it != g_streams.end())
-        {
-            s = it->second;
-        }
-    }
+    auto *w = new OpenAsyncWorker(env, ReadLifecycleControl(info, 1).id, std::move(streamOptions));
+    Napi::Promise promise = w->Promise();
+    w->Queue();
+    return promise;
+}
 
-    if (s)
+// drainAsync(handle, { id, timeoutMs }?) -> Promise<'drained' | 'stopped' |
+// 'timeout' | 'cancelled'>; 'stopped' also covers a handle that is not open
+static Napi::Value DrainAsync(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
     {
-        s->paused.store(false);
+        ThrowTypeError(env, "drainAsync(handle) requires a handle");
+        return env.Null();
     }
 
-    return env.Null();
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    auto *w = new DrainAsyncWorker(env, ReadLifecycleControl(info, 1), handle);
+    Napi::Promise promise = w->Promise();
+    w->Queue();
+    return promise;
 }
 
-static Napi::Value Drain(const Napi::CallbackInfo &info)
+// closeAsync(handle) -> Promise<boolean>; false if the handle was not open
+static Napi::Value CloseAsync(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
     if (info.Length() < 1 || !info[0].IsNumber())
     {
-        ThrowTypeError(env, "drain(handle) requires a handle");
+        ThrowTypeError(env, "closeAsync(handle) requires a handle");
         return env.Null();
     }
 
     uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
-    OutputStreamState *s = nullptr;
-
+    OutputStreamState *s = g_streams.retire(handle);
+    if (!s)
     {
-        std::lock_guard<std::mutex> lock(g_streamsMutex);
-        auto it = g_streams.find(handle);
-        if (it != g_streams.end())
-        {
-            s = it->second;
-        }
+        Napi::Promise::Deferred done = Napi::Promise::Deferred::New(env);
+        done.Resolve(Napi::Boolean::New(env, false));
+        return done.Promise();
     }
 
-    if (!s)
-        return env.Null();
+    auto *w = new CloseAsyncWorker(env, handle, s);
+    AddonData *addon = env.GetInstanceData<AddonData>();
+    if (addon)
+    {
+        addon->streams.erase(handle);
+        addon->closing[handle] = w;
+    }
+    Napi::Promise promise = w->Promise();
+    w->Queue();
+    return promise;
+}
 
+// cancelAsync(id) -> boolean: whether a call with that id was still pending
+static Napi::Value CancelAsync(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
     {
-        std::unique_lock<std::mutex> lock(s->ringMutex);
-        s->ringCv.wait(lock, [s]()
-                       { return s->ring.availableToRead() == 0 || !s->running.load(); });
+        ThrowTypeError(env, "cancelAsync(id) requires an id");
+        return env.Null();
     }
 
-    return env.Undefined();
+    AddonData *addon = env.GetInstanceData<AddonData>();
+    if (!addon)
+        return Napi::Boolean::New(env, false);
+    auto it = addon->operations.find(info[0].As<Napi::Number>().Uint32Value());
+    if (it == addon->operations.end())
+        return Napi::Boolean::New(env, false);
+    it->second->cancel();
+    return Napi::Boolean::New(env, true);
 }
 
 static Napi::Value GetLastErrorJs(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
     (void)info;
-    return Napi::String::New(env, g_lastError);
+    return Napi::String::New(env, LastErrorText());
+}
+
+// Env cleanup hook (worker thread exit, process exit). Runs before the
+// instance data is deleted, which releases the SharedArrayBuffers in
+// sharedRings: every stream this env still has open is shut down first, and
+// closeAsync() calls in flight are waited out, so no render thread is left
+// reading a ring whose buffer is gone.
+static void ShutdownEnvStreams(void *arg)
+{
+    AddonData *addon = static_cast<AddonData *>(arg);
+    Napi::Env env(addon->env);
+
+    // Wake drains parked on streams about to be stopped
+    for (auto &op : addon->operations)
+        op.second->cancel();
+
+    for (auto &c : addon->closing)
+    {
+        c.second->WaitStopped();
+        ReleaseSharedRing(env, c.first, c.second->Stream());
+    }
+    addon->closing.clear();
+
+    std::set<uint32_t> open;
+    open.swap(addon->streams);
+    for (uint32_t handle : open)
+    {
+        OutputStreamState *s = ShutdownStream(handle);
+        if (!s)
+            continue;
+        DetachEvents(s);
+        ReleaseSharedRing(env, handle, s);
+        delete s;
+    }
+    addon->sharedRings.clear();
 }
 
 static Napi::Object InitAll(Napi::Env env, Napi::Object exports)
 {
+    AddonData *addon = new AddonData();
+    addon->env = env;
+    env.SetInstanceData(addon);
+    napi_add_env_cleanup_hook(env, ShutdownEnvStreams, addon);
+
     exports.Set("openOutput", Napi::Function::New(env, OpenOutput));
     exports.Set("write", Napi::Function::New(env, Write));
     exports.Set("writeAsync", Napi::Function::New(env, WriteAsync));
+    exports.Set("writev", Napi::Function::New(env, WriteV));
+    exports.Set("probeFile", Napi::Function::New(env, ProbeFile));
+    exports.Set("openFile", Napi::Function::New(env, OpenFile));
+    exports.Set("queueFile", Napi::Function::New(env, QueueFile));
+    exports.Set("markSegment", Napi::Function::New(env, MarkSegment));
+    exports.Set("pollSegments", Napi::Function::New(env, PollSegments));
+    exports.Set("setGain", Napi::Function::New(env, SetGain));
+    exports.Set("setEq", Napi::Function::New(env, SetEq));
+    exports.Set("setCrossfade", Napi::Function::New(env, SetCrossfade));
+    exports.Set("getPosition", Napi::Function::New(env, GetPosition));
+    exports.Set("subscribe", Napi::Function::New(env, Subscribe));
+    exports.Set("unsubscribe", Napi::Function::New(env, Unsubscribe));
+    exports.Set("markEnd", Napi::Function::New(env, MarkEnd));
     exports.Set("close", Napi::Function::New(env, Close));
     exports.Set("getDevices", Napi::Function::New(env, GetDevices));
     exports.Set("isSupported", Napi::Function::New(env, IsSupported));
     exports.Set("getStats", Napi::Function::New(env, GetStats));
+    exports.Set("readTelemetry", Napi::Function::New(env, ReadTelemetry));
+    exports.Set("telemetryLayout", TelemetryLayout(env));
+    exports.Set("dumpTrace", Napi::Function::New(env, DumpTrace));
     exports.Set("pause", Napi::Function::New(env, Pause));
     exports.Set("resume", Napi::Function::New(env, Resume));
     exports.Set("drain", Napi::Function::New(env, Drain));
+    exports.Set("openOutputAsync", Napi::Function::New(env, OpenOutputAsync));
+    exports.Set("drainAsync", Napi::Function::New(env, DrainAsync));
+    exports.Set("closeAsync", Napi::Function::New(env, CloseAsync));
+    exports.Set("cancelAsync", Napi::Function::New(env, CancelAsync));
     exports.Set("getLastError", Napi::Function::New(env, GetLastErrorJs));
     return exports;
 }
 
-NODE_API_MODULE(exclusive_audio, InitAll)
\ No newline at end of file
+NODE_API_MODULE(exclusive_audio, InitAll)
+
+#else // EXCLUSIVE_HEADLESS
+
+//
+// Headless entry points (headless_engine.h): the exports above minus the
+// argument parsing, on the same helpers.
+//
+namespace headless
+{
+    uint32_t Open(const OpenOptions &o, StreamInfo *info)
+    {
+        if (o.bitDepth != 16 && o.bitDepth != 24 && o.bitDepth != 32)
+        {
+            SetLastError("bitDepth must be 16, 24 or 32");
+            return 0;
+        }
+
+        StreamOptions so;
+        so.sampleRate = o.sampleRate;
+        so.channels = o.channels;
+        so.bitDepth = o.bitDepth;
+        so.floatSamples = o.bitDepth == 32 && o.floatSamples;
+        so.wakeThresholdMs = o.wakeThresholdMs;
+        so.realtime.policy = o.realtime ? RealtimeRequest::Policy::Fifo : RealtimeRequest::Policy::None;
+        if (!o.latencyClass.empty() && !LatencyClassPreset(o.latencyClass, so.hwRequest))
+        {
+            SetLastError("latencyClass must be 'ultra-low', 'low', 'balanced' or 'power-save'");
+            return 0;
+        }
+        so.traceRecords = o.traceRecords;
+        so.busName = o.bus;
+        so.backend.deviceId = o.deviceId;
+        so.backend.mode = o.mode;
+        so.backend.backend = o.backend;
+        so.backend.bufferMs = o.bufferMs;
+        so.backend.nullOptions = o.nullSink;
+
+        std::string error;
+        OutputStreamState *s = OpenStream(so, error);
+        if (!s)
+        {
+            SetLastError(WithLastError(error));
+            return 0;
+        }
+
+        uint32_t handle = g_streams.insert(s);
+        if (handle == 0)
+        {
+            CloseBackend(s);
+            delete s;
+            SetLastError("Too many open streams");
+            return 0;
+        }
+
+        if (info)
+        {
+            const OutputStreamState *dev = s->bus ? s->bus->device : s;
+            info->sampleRate = s->sampleRate;
+            info->channels = s->channels;
+            info->bytesPerFrame = static_cast<unsigned int>(s->bytesPerFrame);
+            info->backend = BackendName(dev);
+        }
+        return handle;
+    }
+
+    int Write(uint32_t handle, const uint8_t *data, size_t len, bool blocking)
+    {
+        StreamRef ref = g_streams.acquire(handle);
+        if (!ref)
+            return -1;
+        return WriteBackend(ref.get(), data, len, blocking);
+    }
+
+    bool PlayFile(uint32_t handle, const std::string &path)
+    {
+        StreamRef ref = g_streams.acquire(handle);
+        if (!ref)
+            return false;
+        DecodeJob job;
+        if (!PrepareDecodeJob(ref.get(), path, DecodeOptions(), job))
+            return false;
+        StartFileDecoder(ref.get(), std::move(job));
+        return true;
+    }
+
+    bool FilePlayedOut(uint32_t handle)
+    {
+        StreamRef ref = g_streams.acquire(handle);
+        if (!ref)
+            return true;
+        if (!ref->fileDecoding.load())
+            return true;
+        return ref->decodeFinished.load() && ref->ring.availableToRead() < ref->bytesPerFrame;
+    }
+
+    void Pause(uint32_t handle, bool paused)
+    {
+        StreamRef ref = g_streams.acquire(handle);
+        if (ref)
+            ref->paused.store(paused);
+    }
+
+    void Drain(uint32_t handle)
+    {
+        StreamRef ref = g_streams.acquire(handle);
+        if (ref)
+            DrainStream(ref.get());
+    }
+
+    bool ReadStats(uint32_t handle, StreamStats &out)
+    {
+        StreamRef ref = g_streams.acquire(handle);
+        if (!ref)
+            return false;
+        out.telemetry = ref->telemetry.read();
+        out.writerParks = ref->writerParks.load(std::memory_order_relaxed);
+        out.writerWakeups = ref->writerWakeups.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    long long DumpTrace(uint32_t handle, const std::string &path)
+    {
+        StreamRef ref = g_streams.acquire(handle);
+        if (!ref || !ref->trace.enabled())
+            return -1;
+        std::string name = "exclusive_audio stream " + std::to_string(handle) + " (" + BackendName(ref.get()) + ")";
+        return ref->trace.writeChromeJson(path.c_str(), name.c_str());
+    }
+
+    void Close(uint32_t handle)
+    {
+        // No event channel or shared ring can exist without JS
+        delete ShutdownStream(handle);
+    }
+
+    std::string LastError()
+    {
+        return LastErrorText();
+    }
+} // namespace headless
+
+#endif // EXCLUSIVE_HEADLESS
@@ -0,0 +1,1173 @@
+// src/file_decoder.cc
+#include "file_decoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// ----------------------------------------------------------------------------
+// File helpers
+// ----------------------------------------------------------------------------
+
+static FILE *OpenUtf8(const std::string &path)
+{
+#if defined(_WIN32)
+    int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    if (len <= 0)
+        return nullptr;
+    std::wstring wide(static_cast<size_t>(len), L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], len);
+    return _wfopen(wide.c_str(), L"rb");
+#else
+    return std::fopen(path.c_str(), "rb");
+#endif
+}
+
+static bool SeekFile(FILE *f, uint64_t off)
+{
+#if defined(_WIN32)
+    return _fseeki64(f, static_cast<__int64>(off), SEEK_SET) == 0;
+#else
+    return fseeko(f, static_cast<off_t>(off), SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t FileSize(FILE *f)
+{
+#if defined(_WIN32)
+    _fseeki64(f, 0, SEEK_END);
+    __int64 size = _ftelli64(f);
+#else
+    fseeko(f, 0, SEEK_END);
+    off_t size = ftello(f);
+#endif
+    SeekFile(f, 0);
+    return size > 0 ? static_cast<uint64_t>(size) : 0;
+}
+
+static uint16_t LE16(const uint8_t *p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+static uint32_t LE32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+static uint16_t BE16(const uint8_t *p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+static uint32_t BE32(const uint8_t *p) { return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+static bool ReadExact(FILE *f, void *dst, size_t len)
+{
+    return std::fread(dst, 1, len, f) == len;
+}
+
+struct FileCloser
+{
+    void operator()(FILE *f) const
+    {
+        if (f)
+            std::fclose(f);
+    }
+};
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+// ----------------------------------------------------------------------------
+// Uncompressed PCM (WAV / AIFF share this once the header is parsed)
+// ----------------------------------------------------------------------------
+
+class PcmDecoder : public FileDecoder
+{
+public:
+    FilePtr file;
+    uint64_t dataStart{0};
+    uint64_t position{0};
+    unsigned bytesPerSample{0};
+    unsigned blockAlign{0};
+    bool isFloat{false};
+    bool bigEndian{false};
+    bool unsigned8{false};
+    std::vector<uint8_t> scratch;
+
+    size_t read(int32_t *out, size_t maxFrames) override
+    {
+        if (info.totalFrames && position >= info.totalFrames)
+            return 0;
+        size_t frames = maxFrames;
+        if (info.totalFrames)
+            frames = static_cast<size_t>(std::min<uint64_t>(frames, info.totalFrames - position));
+
+        scratch.resize(frames * blockAlign);
+        size_t got = std::fread(scratch.data(), 1, scratch.size(), file.get()) / blockAlign;
+        if (got == 0 && std::ferror(file.get()))
+            error = "read error";
+
+        const unsigned channels = info.channels;
+        for (size_t i = 0; i < got; ++i)
+        {
+            const uint8_t *frame = scratch.data() + i * blockAlign;
+            for (unsigned c = 0; c < channels; ++c)
+                out[i * channels + c] = Sample(frame + c * bytesPerSample);
+        }
+        position += got;
+        return got;
+    }
+
+    bool seek(uint64_t frame) override
+    {
+        if (info.totalFrames && frame > info.totalFrames)
+            frame = info.totalFrames;
+        if (!SeekFile(file.get(), dataStart + frame * blockAlign))
+        {
+            error = "seek failed";
+            return false;
+        }
+        position = frame;
+        return true;
+    }
+
+private:
+    int32_t Sample(const uint8_t *p) const
+    {
+        uint8_t b[8];
+        if (bigEndian)
+        {
+            for (unsigned i = 0; i < bytesPerSample; ++i)
+                b[i] = p[bytesPerSample - 1 - i];
+        }
+        else
+        {
+            std::memcpy(b, p, bytesPerSample);
+        }
+
+        if (isFloat)
+        {
+            double v;
+            if (bytesPerSample == 4)
+            {
+                float f;
+                std::memcpy(&f, b, 4);
+                v = f;
+            }
+            else
+            {
+                std::memcpy(&v, b, 8);
+            }
+            if (!(v > -1.0))
+                return INT32_MIN;
+            if (v >= 1.0)
+                return INT32_MAX;
+            return static_cast<int32_t>(std::lrint(v * 2147483648.0));
+        }
+
+        switch (bytesPerSample)
+        {
+        case 1:
+            return static_cast<int32_t>(static_cast<uint32_t>(unsigned8 ? (b[0] ^ 0x80) : b[0]) << 24);
+        case 2:
+            return static_cast<int32_t>(static_cast<uint32_t>(LE16(b)) << 16);
+        case 3:
+            return static_cast<int32_t>((b[0] << 8) | (b[1] << 16) | (static_cast<uint32_t>(b[2]) << 24));
+        default:
+            return static_cast<int32_t>(LE32(b));
+        }
+    }
+};
+
+static std::unique_ptr<FileDecoder> OpenWav(FilePtr file, std::string &err)
+{
+    FILE *f = file.get();
+    uint64_t fileSize = FileSize(f);
+    uint8_t hdr[12];
+    if (!ReadExact(f, hdr, 12) || std::memcmp(hdr, "RIFF", 4) != 0 || std::memcmp(hdr + 8, "WAVE", 4) != 0)
+    {
+        err = "not a RIFF/WAVE file";
+        return nullptr;
+    }
+
+    uint16_t formatTag = 0, channels = 0, blockAlign = 0, bits = 0;
+    uint32_t sampleRate = 0;
+    bool haveFmt = false;
+    uint64_t pos = 12;
+
+    while (pos + 8 <= fileSize)
+    {
+        uint8_t ch[8];
+        if (!SeekFile(f, pos) || !ReadExact(f, ch, 8))
+            break;
+        uint64_t size = LE32(ch + 4);
+        uint64_t body = pos + 8;
+
+        if (std::memcmp(ch, "fmt ", 4) == 0)
+        {
+            uint8_t fmt[40] = {};
+            size_t n = static_cast<size_t>(std::min<uint64_t>(size, sizeof(fmt)));
+            if (n < 16 || !ReadExact(f, fmt, n))
+            {
+                err = "truncated fmt chunk";
+                return nullptr;
+            }
+            formatTag = LE16(fmt);
+            channels = LE16(fmt + 2);
+            sampleRate = LE32(fmt + 4);
+            blockAlign = LE16(fmt + 12);
+            bits = LE16(fmt + 14);
+            // WAVE_FORMAT_EXTENSIBLE: the real tag is the first word of the
+            // SubFormat GUID
+            if (formatTag == 0xFFFE && n >= 26)
+                formatTag = LE16(fmt + 24);
+            haveFmt = true;
+        }
+        else if (std::memcmp(ch, "data", 4) == 0)
+        {
+            if (!haveFmt)
+            {
+                err = "data chunk before fmt chunk";
+                return nullptr;
+            }
+            bool isFloat = formatTag == 3;
+            if (formatTag != 1 && !isFloat)
+            {
+                err = "unsupported WAV format tag " + std::to_string(formatTag);
+                return nullptr;
+            }
+            unsigned bytesPerSample = (bits + 7) / 8;
+            bool bitsOk = isFloat ? (bits == 32 || bits == 64) : (bytesPerSample >= 1 && bytesPerSample <= 4);
+            // One frame is one sample slot per channel, a slot no wider than
+            // 8 bytes however the container pads it
+            bool alignOk = channels != 0 && blockAlign % channels == 0 &&
+                           blockAlign / channels >= bytesPerSample && blockAlign / channels <= 8;
+            if (!bitsOk || channels == 0 || channels > FileDecoder::kMaxChannels || sampleRate == 0 || !alignOk)
+            {
+                err = "unsupported WAV sample layout";
+                return nullptr;
+            }
+
+            // Streaming writers leave 0 or 0xFFFFFFFF; trust the file size
+            if (size == 0 || size == 0xFFFFFFFFu || body + size > fileSize)
+                size = fileSize - body;
+
+            auto dec = std::make_unique<PcmDecoder>();
+            dec->file = std::move(file);
+            dec->dataStart = body;
+            dec->bytesPerSample = bytesPerSample;
+            dec->blockAlign = blockAlign;
+            dec->isFloat = isFloat;
+            dec->unsigned8 = bytesPerSample == 1;
+            dec->info.sampleRate = sampleRate;
+            dec->info.channels = channels;
+            dec->info.bitsPerSample = isFloat ? 32 : bits;
+            dec->info.totalFrames = size / blockAlign;
+            dec->info.codec = "wav";
+            if (!dec->seek(0))
+            {
+                err = dec->error;
+                return nullptr;
+            }
+            return dec;
+        }
+
+        pos = body + size + (size & 1);
+    }
+
+    err = "WAV file has no data chunk";
+    return nullptr;
+}
+
+// 80-bit IEEE 754 extended, big-endian (AIFF COMM sampleRate)
+static double Extended80(const uint8_t *p)
+{
+    int exponent = ((p[0] & 0x7F) << 8) | p[1];
+    uint64_t mantissa = 0;
+    for (int i = 0; i < 8; ++i)
+        mantissa = (mantissa << 8) | p[2 + i];
+    if (exponent == 0 && mantissa == 0)
+        return 0.0;
+    double v = std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+    return (p[0] & 0x80) ? -v : v;
+}
+
+static std::unique_ptr<FileDecoder> OpenAiff(FilePtr file, std::string &err)
+{
+    FILE *f = file.get();
+    uint64_t fileSize = FileSize(f);
+    uint8_t hdr[12];
+    if (!ReadExact(f, hdr, 12) || std::memcmp(hdr, "FORM", 4) != 0)
+    {
+        err = "not an IFF file";
+        return nullptr;
+    }
+    bool aifc = std::memcmp(hdr + 8, "AIFC", 4) == 0;
+    if (!aifc && std::memcmp(hdr + 8, "AIFF", 4) != 0)
+    {
+        err = "not an AIFF file";
+        return nullptr;
+    }
+
+    unsigned channels = 0, bits = 0;
+    uint32_t frames = 0;
+    double sampleRate = 0;
+    bool haveComm = false, littleEndian = false, isFloat = false;
+    uint64_t pos = 12;
+
+    while (pos + 8 <= fileSize)
+    {
+        uint8_t ch[8];
+        if (!SeekFile(f, pos) || !ReadExact(f, ch, 8))
+            break;
+        uint64_t size = BE32(ch + 4);
+        uint64_t body = pos + 8;
+
+        if (std::memcmp(ch, "COMM", 4) == 0)
+        {
+            uint8_t comm[22] = {};
+            size_t n = static_cast<size_t>(std::min<uint64_t>(size, sizeof(comm)));
+            if (n < 18 || !ReadExact(f, comm, n))
+            {
+                err = "truncated COMM chunk";
+                return nullptr;
+            }
+            channels = BE16(comm);
+            frames = BE32(comm + 2);
+            bits = BE16(comm + 6);
+            sampleRate = Extended80(comm + 8);
+            if (aifc)
+            {
+                if (n < 22)
+                {
+                    err = "truncated AIFC COMM chunk";
+                    return nullptr;
+                }
+                if (std::memcmp(comm + 18, "sowt", 4) == 0)
+                    littleEndian = true;
+                else if (std::memcmp(comm + 18, "fl32", 4) == 0 || std::memcmp(comm + 18, "FL32", 4) == 0)
+                    isFloat = true;
+                else if (std::memcmp(comm + 18, "NONE", 4) != 0)
+                {
+                    err = "unsupported AIFF-C compression " + std::string(reinterpret_cast<char *>(comm + 18), 4);
+                    return nullptr;
+                }
+            }
+            haveComm = true;
+        }
+        else if (std::memcmp(ch, "SSND", 4) == 0)
+        {
+            if (!haveComm)
+            {
+                err = "SSND chunk before COMM chunk";
+                return nullptr;
+            }
+            uint8_t ss[8];
+            if (!ReadExact(f, ss, 8))
+            {
+                err = "truncated SSND chunk";
+                return nullptr;
+            }
+            unsigned bytesPerSample = isFloat ? 4 : (bits + 7) / 8;
+            if (channels == 0 || channels > FileDecoder::kMaxChannels || sampleRate < 1.0 || bytesPerSample == 0 || bytesPerSample > 4 || (isFloat && bits != 32))
+            {
+                err = "unsupported AIFF sample layout";
+                return nullptr;
+            }
+            uint64_t dataStart = body + 8 + BE32(ss);
+            unsigned blockAlign = bytesPerSample * channels;
+            uint64_t avail = dataStart < fileSize ? (fileSize - dataStart) / blockAlign : 0;
+
+            auto dec = std::make_unique<PcmDecoder>();
+            dec->file = std::move(file);
+            dec->dataStart = dataStart;
+            dec->bytesPerSample = bytesPerSample;
+            dec->blockAlign = blockAlign;
+            dec->isFloat = isFloat;
+            dec->bigEndian = !littleEndian;
+            dec->info.sampleRate = static_cast<unsigned>(std::lround(sampleRate));
+            dec->info.channels = channels;
+            dec->info.bitsPerSample = bits;
+            dec->info.totalFrames = std::min<uint64_t>(frames, avail);
+            dec->info.codec = "aiff";
+            if (!dec->seek(0))
+            {
+                err = dec->error;
+                return nullptr;
+            }
+            return dec;
+        }
+
+        pos = body + size + (size & 1);
+    }
+
+    err = "AIFF file has no SSND chunk";
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// FLAC
+// ----------------------------------------------------------------------------
+
+static inline int CountLeadingZeros64(uint64_t v)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return 63 - static_cast<int>(idx);
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+// MSB-first bit reader over an in-memory span. Reads past the end yield zero
+// bits; callers check overrun() once per frame.
+struct BitReader
+{
+    const uint8_t *begin;
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t cache{0}; // valid bits are left-aligned, the rest are zero
+    int bits{0};
+
+    BitReader(const uint8_t *b, const uint8_t *e) : begin(b), p(b), end(e) {}
+
+    void refill()
+    {
+        while (bits <= 56)
+        {
+            uint64_t byte = p < end ? *p : 0;
+            ++p;
+            cache |= byte << (56 - bits);
+            bits += 8;
+        }
+    }
+
+    uint32_t read(int n) // n <= 32
+    {
+        if (n == 0)
+            return 0;
+        if (bits < n)
+            refill();
+        uint32_t v = static_cast<uint32_t>(cache >> (64 - n));
+        cache <<= n;
+        bits -= n;
+        return v;
+    }
+
+    int32_t readSigned(int n)
+    {
+        if (n == 0)
+            return 0;
+        int64_t v = read(n);
+        if (v & (int64_t(1) << (n - 1)))
+            v -= int64_t(1) << n;
+        return static_cast<int32_t>(v);
+    }
+
+    uint32_t readUnary()
+    {
+        uint32_t zeros = 0;
+        for (;;)
+        {
+            if (bits == 0 || cache == 0)
+            {
+                zeros += static_cast<uint32_t>(bits);
+                cache = 0;
+                bits = 0;
+                if (p > end)
+                    return zeros;
+                refill();
+                continue;
+            }
+            int lz = CountLeadingZeros64(cache);
+            zeros += static_cast<uint32_t>(lz);
+            cache <<= lz;
+            cache <<= 1;
+            bits -= lz + 1;
+            return zeros;
+        }
+    }
+
+    void alignToByte() { read(bits & 7); }
+
+    size_t bytesConsumed() const
+    {
+        return static_cast<size_t>(p - begin) - static_cast<size_t>(bits / 8);
+    }
+
+    // True once more bits were consumed than the span holds
+    bool overrun() const
+    {
+        return static_cast<size_t>(p - begin) * 8 - static_cast<size_t>(bits) >
+               static_cast<size_t>(end - begin) * 8;
+    }
+};
+
+static uint8_t Crc8(const uint8_t *p, size_t len)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= p[i];
+        for (int b = 0; b < 8; ++b)
+            crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1));
+    }
+    return crc;
+}
+
+// CRC-16 (polynomial 0x8005, MSB first) over a whole frame
+static uint16_t Crc16(const uint8_t *p, size_t len)
+{
+    static const auto table = [] {
+        std::array<uint16_t, 256> t{};
+        for (unsigned i = 0; i < 256; ++i)
+        {
+            uint16_t crc = static_cast<uint16_t>(i << 8);
+            for (int b = 0; b < 8; ++b)
+                crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : (crc << 1));
+            t[i] = crc;
+        }
+        return t;
+    }();
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; ++i)
+        crc = static_cast<uint16_t>((crc << 8) ^ table[(crc >> 8) ^ p[i]]);
+    return crc;
+}
+
+class FlacDecoder : public FileDecoder
+{
+public:
+    struct SeekPoint
+    {
+        uint64_t sample;
+        uint64_t offset; // from the first frame
+    };
+
+    struct FrameHeader
+    {
+        unsigned blockSize{0};
+        unsigned channelAssignment{0};
+        unsigned bitsPerSample{0};
+        uint64_t firstSample{0};
+        size_t headerBytes{0};
+    };
+
+    FilePtr file;
+    uint64_t fileSize{0};
+    uint64_t firstFrameOffset{0};
+    unsigned minBlockSize{0};
+    unsigned maxBlockSize{0};
+    unsigned maxFrameSize{0};
+    std::vector<SeekPoint> seekTable;
+
+    bool init(std::string &err)
+    {
+        FILE *f = file.get();
+        fileSize = FileSize(f);
+
+        // Skip an ID3v2 tag some taggers prepend
+        uint8_t hdr[10];
+        uint64_t pos = 0;
+        if (!ReadExact(f, hdr, 10))
+        {
+            err = "file too short";
+            return false;
+        }
+        if (std::memcmp(hdr, "ID3", 3) == 0)
+        {
+            uint32_t size = ((hdr[6] & 0x7F) << 21) | ((hdr[7] & 0x7F) << 14) | ((hdr[8] & 0x7F) << 7) | (hdr[9] & 0x7F);
+            pos = 10 + size + ((hdr[5] & 0x10) ? 10 : 0);
+        }
+
+        uint8_t magic[4];
+        if (!SeekFile(f, pos) || !ReadExact(f, magic, 4) || std::memcmp(magic, "fLaC", 4) != 0)
+        {
+            err = "not a FLAC file";
+            return false;
+        }
+        pos += 4;
+
+        bool haveStreamInfo = false;
+        for (;;)
+        {
+            uint8_t mh[4];
+            if (!ReadExact(f, mh, 4))
+            {
+                err = "truncated FLAC metadata";
+                return false;
+            }
+            bool last = (mh[0] & 0x80) != 0;
+            unsigned type = mh[0] & 0x7F;
+            uint32_t len = (mh[1] << 16) | (mh[2] << 8) | mh[3];
+            pos += 4;
+
+            if (type == 0 && len >= 34)
+            {
+                uint8_t si[34];
+                if (!ReadExact(f, si, 34))
+                {
+                    err = "truncated STREAMINFO";
+                    return false;
+                }
+                minBlockSize = BE16(si);
+                maxBlockSize = BE16(si + 2);
+                maxFrameSize = (si[7] << 16) | (si[8] << 8) | si[9];
+                info.sampleRate = (si[10] << 12) | (si[11] << 4) | (si[12] >> 4);
+                info.channels = ((si[12] >> 1) & 0x07) + 1;
+                info.bitsPerSample = (((si[12] & 0x01) << 4) | (si[13] >> 4)) + 1;
+                info.totalFrames = (static_cast<uint64_t>(si[13] & 0x0F) << 32) | BE32(si + 14);
+                haveStreamInfo = true;
+            }
+            else if (type == 3)
+            {
+                std::vector<uint8_t> st(len);
+                if (len && !ReadExact(f, st.data(), len))
+                {
+                    err = "truncated SEEKTABLE";
+                    return false;
+                }
+                for (size_t i = 0; i + 18 <= st.size(); i += 18)
+                {
+                    uint64_t sample = (static_cast<uint64_t>(BE32(&st[i])) << 32) | BE32(&st[i + 4]);
+                    uint64_t offset = (static_cast<uint64_t>(BE32(&st[i + 8])) << 32) | BE32(&st[i + 12]);
+                    if (sample != ~uint64_t(0)) // placeholder points
+                        seekTable.push_back({sample, offset});
+                }
+            }
+
+            pos += len;
+            if (!SeekFile(f, pos))
+            {
+                err = "truncated FLAC metadata";
+                return false;
+            }
+            if (last)
+                break;
+        }
+
+        if (!haveStreamInfo || info.sampleRate == 0 || maxBlockSize < 16)
+        {
+            err = "missing or invalid STREAMINFO";
+            return false;
+        }
+        if (info.bitsPerSample < 4 || info.bitsPerSample > 32)
+        {
+            err = "unsupported FLAC bit depth";
+            return false;
+        }
+
+        firstFrameOffset = pos;
+        info.codec = "flac";
+
+        // Worst case is a verbatim frame plus headers when the encoder did
+        // not record maxFrameSize
+        size_t worstFrame = static_cast<size_t>(maxBlockSize) * info.channels * 4 + 64;
+        frameLimit = maxFrameSize ? std::max<size_t>(maxFrameSize, 64) : worstFrame;
+        buffer.resize(std::max<size_t>(frameLimit * 2, 1 << 20));
+        for (auto &c : channelData)
+            c.clear();
+        for (unsigned c = 0; c < info.channels; ++c)
+            channelData[c].resize(maxBlockSize);
+        residual.resize(maxBlockSize);
+        return restartAt(firstFrameOffset);
+    }
+
+    size_t read(int32_t *out, size_t maxFrames) override
+    {
+        const unsigned channels = info.channels;
+        const int shift = 32 - static_cast<int>(info.bitsPerSample);
+        size_t produced = 0;
+
+        while (produced < maxFrames)
+        {
+            if (blockPos >= blockLen)
+            {
+                if (!decodeFrame())
+                    break;
+                // Frames before a seek target are decoded and dropped
+                if (skipFrames)
+                {
+                    size_t drop = static_cast<size_t>(std::min<uint64_t>(skipFrames, blockLen));
+                    blockPos = drop;
+                    skipFrames -= drop;
+                    continue;
+                }
+            }
+            size_t n = std::min(maxFrames - produced, blockLen - blockPos);
+            for (unsigned c = 0; c < channels; ++c)
+            {
+                const int32_t *src = channelData[c].data() + blockPos;
+                int32_t *dst = out + produced * channels + c;
+                for (size_t i = 0; i < n; ++i)
+                    dst[i * channels] = static_cast<int32_t>(static_cast<uint32_t>(src[i]) << shift);
+            }
+            blockPos += n;
+            produced += n;
+        }
+        return produced;
+    }
+
+    bool seek(uint64_t target) override
+    {
+        if (info.totalFrames && target >= info.totalFrames)
+            target = info.totalFrames;
+
+        uint64_t offset = 0, sample = 0;
+        for (const auto &pt : seekTable)
+        {
+            if (pt.sample > target)
+                break;
+            offset = pt.offset;
+            sample = pt.sample;
+        }
+        if (seekTable.empty())
+            bisect(target, offset, sample);
+
+        if (!restartAt(firstFrameOffset + offset))
+            return false;
+        skipFrames = target - sample;
+        return true;
+    }
+
+private:
+    std::vector<uint8_t> buffer;
+    size_t bufPos{0};
+    size_t bufLen{0};
+    uint64_t bufFileOffset{0}; // file offset of buffer[0]
+    bool eof{false};
+    size_t frameLimit{0};
+
+    std::vector<int32_t> channelData[8];
+    std::vector<int32_t> residual;
+    size_t blockPos{0};
+    size_t blockLen{0};
+    uint64_t skipFrames{0};
+
+    bool restartAt(uint64_t offset)
+    {
+        if (!SeekFile(file.get(), offset))
+        {
+            error = "seek failed";
+            return false;
+        }
+        bufPos = bufLen = 0;
+        bufFileOffset = offset;
+        eof = false;
+        blockPos = blockLen = 0;
+        skipFrames = 0;
+        return true;
+    }
+
+    // Makes at least `need` bytes available from bufPos (fewer at EOF)
+    void fill(size_t need)
+    {
+        if (bufLen - bufPos >= need || eof)
+            return;
+        if (bufPos)
+        {
+            std::memmove(buffer.data(), buffer.data() + bufPos, bufLen - bufPos);
+            bufFileOffset += bufPos;
+            bufLen -= bufPos;
+            bufPos = 0;
+        }
+        while (bufLen < buffer.size() && bufLen < need)
+        {
+            size_t got = std::fread(buffer.data() + bufLen, 1, buffer.size() - bufLen, file.get());
+            if (got == 0)
+            {
+                eof = true;
+                break;
+            }
+            bufLen += got;
+        }
+    }
+
+    // Parses a frame header at p. Returns false if it is not a valid header
+    // (bad sync, reserved values or CRC-8 mismatch).
+    bool parseHeader(const uint8_t *p, const uint8_t *end, FrameHeader &h) const
+    {
+        if (end - p < 6 || p[0] != 0xFF || (p[1] & 0xFE) != 0xF8)
+            return false;
+        BitReader br(p, end);
+        br.read(15);
+        bool variable = br.read(1) != 0;
+        unsigned bsCode = br.read(4);
+        unsigned srCode = br.read(4);
+        h.channelAssignment = br.read(4);
+        unsigned ssCode = br.read(3);
+        if (br.read(1) != 0 || bsCode == 0 || srCode == 15 || h.channelAssignment > 10 || ssCode == 3)
+            return false;
+
+        // UTF-8 style coded frame / sample number
+        uint32_t first = br.read(8);
+        int extra = 0;
+        uint64_t number;
+        if (!(first & 0x80))
+            number = first;
+        else
+        {
+            int ones = 0;
+            while (ones < 8 && (first & (0x80u >> ones)))
+                ++ones;
+            if (ones < 2 || ones > 7)
+                return false;
+            extra = ones - 1;
+            number = first & (0x7Fu >> ones);
+            for (int i = 0; i < extra; ++i)
+            {
+                uint32_t b = br.read(8);
+                if ((b & 0xC0) != 0x80)
+                    return false;
+                number = (number << 6) | (b & 0x3F);
+            }
+        }
+
+        if (bsCode == 1)
+            h.blockSize = 192;
+        else if (bsCode <= 5)
+            h.blockSize = 576u << (bsCode - 2);
+        else if (bsCode == 6)
+            h.blockSize = br.read(8) + 1;
+        else if (bsCode == 7)
+            h.blockSize = br.read(16) + 1;
+        else
+            h.blockSize = 256u << (bsCode - 8);
+
+        if (srCode == 12)
+            br.read(8);
+        else if (srCode == 13 || srCode == 14)
+            br.read(16);
+
+        static const unsigned kSampleSizes[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+        h.bitsPerSample = ssCode ? kSampleSizes[ssCode] : info.bitsPerSample;
+
+        size_t crcPos = br.bytesConsumed();
+        uint8_t crc = static_cast<uint8_t>(br.read(8));
+        if (br.overrun() || crc != Crc8(p, crcPos))
+            return false;
+        if (h.blockSize > maxBlockSize || h.bitsPerSample != info.bitsPerSample)
+            return false;
+        unsigned frameChannels = h.channelAssignment < 8 ? h.channelAssignment + 1 : 2;
+        if (frameChannels != info.channels)
+            return false;
+
+        h.firstSample = variable ? number : number * minBlockSize;
+        h.headerBytes = crcPos + 1;
+        return true;
+    }
+
+    // Finds the first valid frame header at or after `offset`
+    bool probe(uint64_t offset, uint64_t &frameOffset, uint64_t &sample)
+    {
+        std::vector<uint8_t> tmp(frameLimit + 4096);
+        if (!SeekFile(file.get(), offset))
+            return false;
+        size_t n = std::fread(tmp.data(), 1, tmp.size(), file.get());
+        for (size_t i = 0; i + 1 < n; ++i)
+        {
+            FrameHeader h;
+            if (tmp[i] == 0xFF && parseHeader(&tmp[i], tmp.data() + n, h))
+            {
+                frameOffset = offset + i;
+                sample = h.firstSample;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // No SEEKTABLE: binary search on byte offsets using frame headers, then
+    // decode forward from the closest frame at or before `target`.
+    void bisect(uint64_t target, uint64_t &offset, uint64_t &sample)
+    {
+        uint64_t lo = firstFrameOffset, hi = fileSize;
+        offset = 0;
+        sample = 0;
+        for (int iter = 0; iter < 48 && hi > lo + frameLimit; ++iter)
+        {
+            uint64_t mid = lo + (hi - lo) / 2;
+            uint64_t at, s;
+            if (!probe(mid, at, s) || s > target)
+            {
+                hi = mid;
+                continue;
+            }
+            offset = at - firstFrameOffset;
+            sample = s;
+            lo = at + 1;
+        }
+    }
+
+    bool decodeFrame()
+    {
+        for (;;)
+        {
+            fill(frameLimit + 16);
+            if (bufPos >= bufLen)
+                return false;
+
+            const uint8_t *start = buffer.data() + bufPos;
+            const uint8_t *end = buffer.data() + bufLen;
+            FrameHeader h;
+            if (!parseHeader(start, end, h))
+            {
+                // Lost sync (garbage or a corrupt frame): scan for the next header
+                const uint8_t *next = static_cast<const uint8_t *>(std::memchr(start + 1, 0xFF, static_cast<size_t>(end - start - 1)));
+                bufPos = next ? static_cast<size_t>(next - buffer.data()) : bufLen;
+                continue;
+            }
+
+            // The side channel of a decorrelated frame needs bitsPerSample + 1
+            // bits; at 32 that no longer fits the int32 sample path
+            if (h.bitsPerSample == 32 && h.channelAssignment >= 8)
+            {
+                error = "32-bit FLAC with stereo decorrelation is not supported";
+                return false;
+            }
+
+            BitReader br(start + h.headerBytes, end);
+            bool ok = true;
+            for (unsigned c = 0; c < info.channels && ok; ++c)
+            {
+                unsigned bps = h.bitsPerSample;
+                if ((h.channelAssignment == 8 && c == 1) || (h.channelAssignment == 9 && c == 0) ||
+                    (h.channelAssignment == 10 && c == 1))
+                    ++bps; // side channel carries one extra bit
+                ok = decodeSubframe(br, channelData[c].data(), bps, h.blockSize);
+            }
+            br.alignToByte();
+            size_t frameBytes = h.headerBytes + br.bytesConsumed();
+            uint16_t crc = static_cast<uint16_t>(br.read(16));
+
+            if (!ok || br.overrun() || crc != Crc16(start, frameBytes))
+            {
+                bufPos += 2; // skip this sync word and resync
+                continue;
+            }
+
+            decorrelate(h.channelAssignment, h.blockSize);
+            bufPos += h.headerBytes + br.bytesConsumed();
+            blockPos = 0;
+            blockLen = h.blockSize;
+            return true;
+        }
+    }
+
+    bool decodeSubframe(BitReader &br, int32_t *out, unsigned bps, unsigned blockSize)
+    {
+        if (br.read(1) != 0)
+            return false;
+        unsigned type = br.read(6);
+        unsigned wasted = 0;
+        if (br.read(1))
+            wasted = br.readUnary() + 1;
+        if (wasted >= bps || bps > 32)
+            return false;
+        bps -= wasted;
+
+        if (type == 0)
+        {
+            int32_t v = br.readSigned(static_cast<int>(bps));
+            std::fill(out, out + blockSize, v);
+        }
+        else if (type == 1)
+        {
+            for (unsigned i = 0; i < blockSize; ++i)
+                out[i] = br.readSigned(static_cast<int>(bps));
+        }
+        else if (type >= 8 && type <= 12)
+        {
+            unsigned order = type - 8;
+            if (order > blockSize)
+                return false;
+            for (unsigned i = 0; i < order; ++i)
+                out[i] = br.readSigned(static_cast<int>(bps));
+            if (!decodeResidual(br, out, order, blockSize))
+                return false;
+            if (!restoreFixed(out, order, blockSize, bps))
+                return false;
+        }
+        else if (type >= 32)
+        {
+            unsigned order = type - 31;
+            if (order > blockSize)
+                return false;
+            for (unsigned i = 0; i < order; ++i)
+                out[i] = br.readSigned(static_cast<int>(bps));
+            unsigned precision = br.read(4) + 1;
+            int shift = br.readSigned(5);
+            if (precision == 16 || shift < 0)
+                return false;
+            int32_t coefs[32];
+            for (unsigned i = 0; i < order; ++i)
+                coefs[i] = br.readSigned(static_cast<int>(precision));
+            if (!decodeResidual(br, out, order, blockSize))
+                return false;
+            // A corrupt frame can predict past the sample width; the whole
+            // add is done in int64 and such a frame is rejected
+            const int64_t lo = -(int64_t(1) << (bps - 1));
+            const int64_t hi = (int64_t(1) << (bps - 1)) - 1;
+            for (unsigned i = order; i < blockSize; ++i)
+            {
+                int64_t sum = 0;
+                for (unsigned j = 0; j < order; ++j)
+                    sum += static_cast<int64_t>(coefs[j]) * out[i - 1 - j];
+                int64_t v = int64_t(out[i]) + (sum >> shift);
+                if (v < lo || v > hi)
+                    return false;
+                out[i] = static_cast<int32_t>(v);
+            }
+        }
+        else
+        {
+            return false;
+        }
+
+        if (wasted)
+        {
+            for (unsigned i = 0; i < blockSize; ++i)
+                out[i] = static_cast<int32_t>(static_cast<uint32_t>(out[i]) << wasted);
+        }
+        return true;
+    }
+
+    // Rice-coded residual, written to out[order..blockSize)
+    bool decodeResidual(BitReader &br, int32_t *out, unsigned order, unsigned blockSize)
+    {
+        unsigned method = br.read(2);
+        if (method > 1)
+            return false;
+        int paramBits = method == 0 ? 4 : 5;
+        unsigned escape = method == 0 ? 15 : 31;
+        unsigned partitionOrder = br.read(4);
+        unsigned partitions = 1u << partitionOrder;
+        unsigned perPartition = blockSize >> partitionOrder;
+        if ((perPartition << partitionOrder) != blockSize || perPartition < order)
+            return false;
+
+        unsigned idx = order;
+        for (unsigned p = 0; p < partitions; ++p)
+        {
+            unsigned count = p == 0 ? perPartition - order : perPartition;
+            unsigned k = br.read(paramBits);
+            if (k == escape)
+            {
+                int raw = static_cast<int>(br.read(5));
+                for (unsigned i = 0; i < count; ++i)
+                    out[idx++] = br.readSigned(raw);
+            }
+            else
+            {
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    uint32_t q = br.readUnary();
+                    uint32_t v = (q << k) | br.read(static_cast<int>(k));
+                    out[idx++] = static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+                }
+            }
+            if (br.overrun())
+                return false;
+        }
+        return true;
+    }
+
+    // Intermediates in int64: at 32 bits the predictions overflow int32
+    // Fixed-predictor restore in int64; false if a sample leaves the
+    // subframe's bps-bit range, which only a corrupt frame produces
+    static bool restoreFixed(int32_t *s, unsigned order, unsigned n, unsigned bps)
+    {
+        const int64_t lo = -(int64_t(1) << (bps - 1));
+        const int64_t hi = (int64_t(1) << (bps - 1)) - 1;
+        for (unsigned i = order; i < n; ++i)
+        {
+            int64_t v = s[i];
+            switch (order)
+            {
+            case 1:
+                v += int64_t(s[i - 1]);
+                break;
+            case 2:
+                v += 2 * int64_t(s[i - 1]) - s[i - 2];
+                break;
+            case 3:
+                v += 3 * int64_t(s[i - 1]) - 3 * int64_t(s[i - 2]) + s[i - 3];
+                break;
+            case 4:
+                v += 4 * int64_t(s[i - 1]) - 6 * int64_t(s[i - 2]) + 4 * int64_t(s[i - 3]) - s[i - 4];
+                break;
+            default:
+                break;
+            }
+            if (v < lo || v > hi)
+                return false;
+            s[i] = static_cast<int32_t>(v);
+        }
+        return true;
+    }
+
+    void decorrelate(unsigned assignment, unsigned n)
+    {
+        int32_t *a = channelData[0].data();
+        int32_t *b = channelData[1].data();
+        switch (assignment)
+        {
+        case 8: // left/side
+            for (unsigned i = 0; i < n; ++i)
+                b[i] = a[i] - b[i];
+            break;
+        case 9: // side/right
+            for (unsigned i = 0; i < n; ++i)
+                a[i] += b[i];
+            break;
+        case 10: // mid/side
+            for (unsigned i = 0; i < n; ++i)
+            {
+                int32_t side = b[i];
+                int32_t mid = static_cast<int32_t>(static_cast<uint32_t>(a[i]) << 1) | (side & 1);
+                a[i] = (mid + side) >> 1;
+                b[i] = (mid - side) >> 1;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Factory
+// ----------------------------------------------------------------------------
+
+std::unique_ptr<FileDecoder> FileDecoder::Open(const std::string &path, std::string &err)
+{
+    FilePtr file(OpenUtf8(path));
+    if (!file)
+    {
+        err = "cannot open file: " + path;
+        return nullptr;
+    }
+
+    uint8_t magic[12] = {};
+    size_t n = std::fread(magic, 1, sizeof(magic), file.get());
+    SeekFile(file.get(), 0);
+
+    if (n >= 12 && std::memcmp(magic, "RIFF", 4) == 0 && std::memcmp(magic + 8, "WAVE", 4) == 0)
+        return OpenWav(std::move(file), err);
+    if (n >= 12 && std::memcmp(magic, "FORM", 4) == 0)
+        return OpenAiff(std::move(file), err);
+    if (n >= 4 && (std::memcmp(magic, "fLaC", 4) == 0 || std::memcmp(magic, "ID3", 3) == 0))
+    {
+        auto dec = std::make_unique<FlacDecoder>();
+        dec->file = std::move(file);
+        if (!dec->init(err))
+            return nullptr;
+        return dec;
+    }
+
+    err = "unsupported container (native decoding handles WAV, AIFF and FLAC)";
+    return nullptr;
+}
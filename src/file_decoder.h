@@ -0,0 +1,47 @@
+// src/file_decoder.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Native decoder for the lossless formats we can play without ffmpeg:
+// WAV (PCM / IEEE float / extensible), AIFF / AIFF-C (NONE, sowt, fl32) and
+// FLAC. Everything else is left to the ffmpeg pipeline in audioEngine.js.
+//
+// Decoders produce interleaved int32 samples, left-justified (a 16-bit sample
+// of 0x1234 comes out as 0x12340000), so callers only need one conversion
+// path regardless of the file's bit depth.
+class FileDecoder
+{
+public:
+    struct Info
+    {
+        unsigned sampleRate{0};
+        unsigned channels{0};
+        unsigned bitsPerSample{0};
+        uint64_t totalFrames{0}; // 0 if unknown
+        const char *codec{""};
+    };
+
+    // Most channels a file may have; the engine's mixers stop well below
+    // this, and anything wider is a corrupt header rather than a layout
+    static constexpr unsigned kMaxChannels = 32;
+
+    virtual ~FileDecoder() = default;
+
+    // Decodes up to maxFrames frames into out (maxFrames * channels samples).
+    // Returns frames decoded; 0 at end of stream or on error (see error).
+    virtual size_t read(int32_t *out, size_t maxFrames) = 0;
+
+    // Positions the decoder so the next read() starts at `frame`.
+    virtual bool seek(uint64_t frame) = 0;
+
+    // Opens `path` (UTF-8) and picks a decoder from the file's magic bytes.
+    // Returns nullptr and fills err if the file is missing or unsupported.
+    static std::unique_ptr<FileDecoder> Open(const std::string &path, std::string &err);
+
+    Info info;
+    std::string error;
+};
@@ -0,0 +1,546 @@
+// src/format_converter.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#include "sample_format.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONVERT_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+static inline const char *SampleFormatName(SampleFormat f)
+{
+    switch (f)
+    {
+    case SampleFormat::S16:
+        return "s16";
+    case SampleFormat::S24:
+        return "s24";
+    case SampleFormat::S32:
+        return "s32";
+    case SampleFormat::F32:
+        return "f32";
+    case SampleFormat::S24In32:
+        return "s24_32";
+    }
+    return "unknown";
+}
+
+//
+// Sample-format conversion kernels, one per (source, destination) pair,
+// resolved at compile time. Conversion is per sample, so the channel count
+// only scales the sample count and needs no kernels of its own.
+//
+// The generic kernel goes through a block of left-justified int32 (integer
+// endpoints, exact widening, truncating narrowing like PackFromS32) or of
+// float (either endpoint F32, rounded and saturated like PackFromFloat). The
+// pairs a device negotiation actually lands on have SSE2/NEON
+// specializations with the same results; they are memory bound, so wider
+// vectors would not buy anything.
+//
+namespace convert
+{
+    using ConvertFn = void (*)(const uint8_t *in, uint8_t *out, size_t samples);
+
+    static constexpr size_t kBlockSamples = 256;
+
+    template <SampleFormat Src, SampleFormat Dst>
+    struct Generic
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            if constexpr (Src == Dst)
+            {
+                std::memcpy(out, in, samples * SampleFormatBytes(Src));
+            }
+            else if constexpr (Src == SampleFormat::F32 || Dst == SampleFormat::F32)
+            {
+                alignas(16) float tmp[kBlockSamples];
+                while (samples)
+                {
+                    size_t n = samples < kBlockSamples ? samples : kBlockSamples;
+                    UnpackToFloat(in, tmp, n, Src);
+                    PackFromFloat(tmp, out, n, Dst);
+                    in += n * SampleFormatBytes(Src);
+                    out += n * SampleFormatBytes(Dst);
+                    samples -= n;
+                }
+            }
+            else
+            {
+                alignas(16) int32_t tmp[kBlockSamples];
+                while (samples)
+                {
+                    size_t n = samples < kBlockSamples ? samples : kBlockSamples;
+                    UnpackToS32(in, tmp, n, Src);
+                    PackFromS32(tmp, out, n, Dst);
+                    in += n * SampleFormatBytes(Src);
+                    out += n * SampleFormatBytes(Dst);
+                    samples -= n;
+                }
+            }
+        }
+    };
+
+    template <SampleFormat Src, SampleFormat Dst>
+    struct Kernel : Generic<Src, Dst>
+    {
+    };
+
+#if defined(CONVERT_SSE2)
+    template <>
+    struct Kernel<SampleFormat::S16, SampleFormat::F32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, v), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, v), 16);
+                _mm_storeu_ps(reinterpret_cast<float *>(out + i * 4), _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+                _mm_storeu_ps(reinterpret_cast<float *>(out + i * 4 + 16), _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+            }
+            Generic<SampleFormat::S16, SampleFormat::F32>::run(in + i * 2, out + i * 4, samples - i);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::F32, SampleFormat::S16>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            const __m128 scale = _mm_set1_ps(32768.0f);
+            const __m128 hi = _mm_set1_ps(32767.0f), lo = _mm_set1_ps(-32768.0f);
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8)
+            {
+                const float *p = reinterpret_cast<const float *>(in + i * 4);
+                __m128 a = _mm_max_ps(lo, _mm_min_ps(hi, _mm_mul_ps(_mm_loadu_ps(p), scale)));
+                __m128 b = _mm_max_ps(lo, _mm_min_ps(hi, _mm_mul_ps(_mm_loadu_ps(p + 4), scale)));
+                __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), packed);
+            }
+            Generic<SampleFormat::F32, SampleFormat::S16>::run(in + i * 4, out + i * 2, samples - i);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::S16, SampleFormat::S32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), _mm_unpacklo_epi16(zero, v));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4 + 16), _mm_unpackhi_epi16(zero, v));
+            }
+            Generic<SampleFormat::S16, SampleFormat::S32>::run(in + i * 2, out + i * 4, samples - i);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::S32, SampleFormat::S16>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 4));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 4 + 16));
+                __m128i packed = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), packed);
+            }
+            Generic<SampleFormat::S32, SampleFormat::S16>::run(in + i * 4, out + i * 2, samples - i);
+        }
+    };
+
+    // Integer <-> float with a 4-byte container on both sides: shift is how
+    // far the integer sits below left-justified (8 for S24In32)
+    template <int Shift>
+    static inline void IntToF32Sse2(const uint8_t *in, uint8_t *out, size_t n)
+    {
+        const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+        for (size_t i = 0; i < n; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 4));
+            if constexpr (Shift != 0)
+                v = _mm_slli_epi32(v, Shift);
+            _mm_storeu_ps(reinterpret_cast<float *>(out + i * 4), _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+    }
+
+    template <int Shift>
+    static inline void F32ToIntSse2(const uint8_t *in, uint8_t *out, size_t n)
+    {
+        const float full = static_cast<float>(1u << (31 - Shift));
+        const __m128 scale = _mm_set1_ps(full);
+        const __m128 lo = _mm_set1_ps(-full), hi = _mm_set1_ps(full - 1.0f), top = _mm_set1_ps(full);
+        for (size_t i = 0; i < n; i += 4)
+        {
+            __m128 v = _mm_mul_ps(_mm_loadu_ps(reinterpret_cast<const float *>(in + i * 4)), scale);
+            __m128i r;
+            if constexpr (Shift != 0)
+            {
+                r = _mm_cvtps_epi32(_mm_max_ps(lo, _mm_min_ps(hi, v)));
+            }
+            else
+            {
+                // 2^31 - 1 is not a float: cvtps turns >= 2^31 into INT32_MIN,
+                // which flipping every bit makes INT32_MAX
+                __m128i over = _mm_castps_si128(_mm_cmpge_ps(v, top));
+                r = _mm_xor_si128(_mm_cvtps_epi32(_mm_max_ps(lo, v)), over);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), r);
+        }
+    }
+
+    template <>
+    struct Kernel<SampleFormat::S32, SampleFormat::F32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t n = samples & ~size_t(3);
+            IntToF32Sse2<0>(in, out, n);
+            Generic<SampleFormat::S32, SampleFormat::F32>::run(in + n * 4, out + n * 4, samples - n);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::S24In32, SampleFormat::F32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t n = samples & ~size_t(3);
+            IntToF32Sse2<8>(in, out, n);
+            Generic<SampleFormat::S24In32, SampleFormat::F32>::run(in + n * 4, out + n * 4, samples - n);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::F32, SampleFormat::S32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t n = samples & ~size_t(3);
+            F32ToIntSse2<0>(in, out, n);
+            Generic<SampleFormat::F32, SampleFormat::S32>::run(in + n * 4, out + n * 4, samples - n);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::F32, SampleFormat::S24In32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t n = samples & ~size_t(3);
+            F32ToIntSse2<8>(in, out, n);
+            Generic<SampleFormat::F32, SampleFormat::S24In32>::run(in + n * 4, out + n * 4, samples - n);
+        }
+    };
+#elif defined(CONVERT_NEON)
+    template <>
+    struct Kernel<SampleFormat::S16, SampleFormat::F32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8)
+            {
+                int16x8_t v = vld1q_s16(reinterpret_cast<const int16_t *>(in + i * 2));
+                float *o = reinterpret_cast<float *>(out + i * 4);
+                vst1q_f32(o, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.0f / 32768.0f));
+                vst1q_f32(o + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.0f / 32768.0f));
+            }
+            Generic<SampleFormat::S16, SampleFormat::F32>::run(in + i * 2, out + i * 4, samples - i);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::F32, SampleFormat::S16>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8)
+            {
+                const float *p = reinterpret_cast<const float *>(in + i * 4);
+                int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(p), 32768.0f));
+                int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(p + 4), 32768.0f));
+                vst1q_s16(reinterpret_cast<int16_t *>(out + i * 2), vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+            }
+            Generic<SampleFormat::F32, SampleFormat::S16>::run(in + i * 4, out + i * 2, samples - i);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::S16, SampleFormat::S32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8)
+            {
+                int16x8_t v = vld1q_s16(reinterpret_cast<const int16_t *>(in + i * 2));
+                int32_t *o = reinterpret_cast<int32_t *>(out + i * 4);
+                vst1q_s32(o, vshll_n_s16(vget_low_s16(v), 16));
+                vst1q_s32(o + 4, vshll_n_s16(vget_high_s16(v), 16));
+            }
+            Generic<SampleFormat::S16, SampleFormat::S32>::run(in + i * 2, out + i * 4, samples - i);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::S32, SampleFormat::S16>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8)
+            {
+                const int32_t *p = reinterpret_cast<const int32_t *>(in + i * 4);
+                int16x8_t v = vcombine_s16(vshrn_n_s32(vld1q_s32(p), 16), vshrn_n_s32(vld1q_s32(p + 4), 16));
+                vst1q_s16(reinterpret_cast<int16_t *>(out + i * 2), v);
+            }
+            Generic<SampleFormat::S32, SampleFormat::S16>::run(in + i * 4, out + i * 2, samples - i);
+        }
+    };
+
+    template <int Shift>
+    static inline void IntToF32Neon(const uint8_t *in, uint8_t *out, size_t n)
+    {
+        for (size_t i = 0; i < n; i += 4)
+        {
+            int32x4_t v = vld1q_s32(reinterpret_cast<const int32_t *>(in + i * 4));
+            if constexpr (Shift != 0)
+                v = vshlq_n_s32(v, Shift);
+            vst1q_f32(reinterpret_cast<float *>(out + i * 4), vmulq_n_f32(vcvtq_f32_s32(v), 1.0f / 2147483648.0f));
+        }
+    }
+
+    template <int Shift>
+    static inline void F32ToIntNeon(const uint8_t *in, uint8_t *out, size_t n)
+    {
+        // vcvtnq saturates, so 2^31 lands on INT32_MAX like the scalar path
+        const float full = static_cast<float>(1u << (31 - Shift));
+        const float32x4_t hi = vdupq_n_f32(Shift ? full - 1.0f : full), lo = vdupq_n_f32(-full);
+        for (size_t i = 0; i < n; i += 4)
+        {
+            float32x4_t v = vmulq_n_f32(vld1q_f32(reinterpret_cast<const float *>(in + i * 4)), full);
+            v = vmaxq_f32(lo, vminq_f32(hi, v));
+            vst1q_s32(reinterpret_cast<int32_t *>(out + i * 4), vcvtnq_s32_f32(v));
+        }
+    }
+
+    template <>
+    struct Kernel<SampleFormat::S32, SampleFormat::F32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t n = samples & ~size_t(3);
+            IntToF32Neon<0>(in, out, n);
+            Generic<SampleFormat::S32, SampleFormat::F32>::run(in + n * 4, out + n * 4, samples - n);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::S24In32, SampleFormat::F32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t n = samples & ~size_t(3);
+            IntToF32Neon<8>(in, out, n);
+            Generic<SampleFormat::S24In32, SampleFormat::F32>::run(in + n * 4, out + n * 4, samples - n);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::F32, SampleFormat::S32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t n = samples & ~size_t(3);
+            F32ToIntNeon<0>(in, out, n);
+            Generic<SampleFormat::F32, SampleFormat::S32>::run(in + n * 4, out + n * 4, samples - n);
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::F32, SampleFormat::S24In32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            size_t n = samples & ~size_t(3);
+            F32ToIntNeon<8>(in, out, n);
+            Generic<SampleFormat::F32, SampleFormat::S24In32>::run(in + n * 4, out + n * 4, samples - n);
+        }
+    };
+#endif
+
+    // Packed 24-bit <-> 4-byte container: byte shuffles, bound by memory
+    template <>
+    struct Kernel<SampleFormat::S24, SampleFormat::S24In32>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            for (size_t i = 0; i < samples; ++i)
+            {
+                const uint8_t *p = in + i * 3;
+                int32_t v = static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+                std::memcpy(out + i * 4, &v, 4);
+            }
+        }
+    };
+
+    template <>
+    struct Kernel<SampleFormat::S24In32, SampleFormat::S24>
+    {
+        static void run(const uint8_t *in, uint8_t *out, size_t samples)
+        {
+            for (size_t i = 0; i < samples; ++i)
+            {
+                const uint8_t *p = in + i * 4;
+                out[i * 3 + 0] = p[0];
+                out[i * 3 + 1] = p[1];
+                out[i * 3 + 2] = p[2];
+            }
+        }
+    };
+
+    template <SampleFormat Src>
+    static inline ConvertFn ResolveTo(SampleFormat dst)
+    {
+        switch (dst)
+        {
+        case SampleFormat::S16:
+            return &Kernel<Src, SampleFormat::S16>::run;
+        case SampleFormat::S24:
+            return &Kernel<Src, SampleFormat::S24>::run;
+        case SampleFormat::S32:
+            return &Kernel<Src, SampleFormat::S32>::run;
+        case SampleFormat::F32:
+            return &Kernel<Src, SampleFormat::F32>::run;
+        case SampleFormat::S24In32:
+            return &Kernel<Src, SampleFormat::S24In32>::run;
+        }
+        return nullptr;
+    }
+
+    // Kernel for src -> dst, or nullptr when they match (no conversion).
+    static inline ConvertFn Resolve(SampleFormat src, SampleFormat dst)
+    {
+        if (src == dst)
+            return nullptr;
+        switch (src)
+        {
+        case SampleFormat::S16:
+            return ResolveTo<SampleFormat::S16>(dst);
+        case SampleFormat::S24:
+            return ResolveTo<SampleFormat::S24>(dst);
+        case SampleFormat::S32:
+            return ResolveTo<SampleFormat::S32>(dst);
+        case SampleFormat::F32:
+            return ResolveTo<SampleFormat::F32>(dst);
+        case SampleFormat::S24In32:
+            return ResolveTo<SampleFormat::S24In32>(dst);
+        }
+        return nullptr;
+    }
+} // namespace convert
+
+// Device formats to try for a stream whose ring holds `src`, cheapest
+// conversion first (the matching format itself heads the list). With
+// bitPerfect only formats that carry every source sample unchanged are
+// listed: the same format or a wider integer container. Returns the count.
+static inline size_t DeviceFormatCandidates(SampleFormat src, bool bitPerfect, SampleFormat out[5])
+{
+    using F = SampleFormat;
+    size_t n = 0;
+    switch (src)
+    {
+    case F::S16:
+        for (F f : {F::S16, F::S32, F::S24In32, F::S24})
+            out[n++] = f;
+        if (!bitPerfect)
+            out[n++] = F::F32;
+        break;
+    case F::S24:
+        for (F f : {F::S24, F::S24In32, F::S32})
+            out[n++] = f;
+        if (!bitPerfect)
+        {
+            out[n++] = F::F32;
+            out[n++] = F::S16;
+        }
+        break;
+    case F::S32:
+        out[n++] = F::S32;
+        if (!bitPerfect)
+        {
+            for (F f : {F::F32, F::S24In32, F::S24, F::S16})
+                out[n++] = f;
+        }
+        break;
+    case F::F32:
+        out[n++] = F::F32;
+        if (!bitPerfect)
+        {
+            for (F f : {F::S32, F::S24In32, F::S24, F::S16})
+                out[n++] = f;
+        }
+        break;
+    case F::S24In32:
+        out[n++] = F::S24In32;
+        break;
+    }
+    return n;
+}
+
+//
+// Producer-to-device conversion for one stream: the ring keeps the format
+// the producer asked for, whatever the device negotiated. Configured before
+// the render thread starts; run() is render-thread only.
+//
+class FormatConverter
+{
+public:
+    void configure(SampleFormat from, SampleFormat to)
+    {
+        src = from;
+        dst = to;
+        fn = convert::Resolve(from, to);
+    }
+
+    // True when the device takes the ring's format as is.
+    bool identity() const { return fn == nullptr; }
+    SampleFormat source() const { return src; }
+    SampleFormat target() const { return dst; }
+
+    void run(const uint8_t *in, uint8_t *out, size_t samples) const
+    {
+        if (fn)
+            fn(in, out, samples);
+        else
+            std::memcpy(out, in, samples * SampleFormatBytes(src));
+    }
+
+private:
+    SampleFormat src{SampleFormat::S16};
+    SampleFormat dst{SampleFormat::S16};
+    convert::ConvertFn fn{nullptr};
+};
@@ -0,0 +1,612 @@
+// src/gain_stage.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "sample_format.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GAIN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define GAIN_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC/Clang compile the AVX2 kernels for that target only and we pick them at
+// runtime; MSVC accepts the intrinsics without a flag.
+#if defined(GAIN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GAIN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define GAIN_TARGET_AVX2
+#endif
+
+//
+// Gain kernels, one per sample format: Scale* apply one gain, Ramp* a gain
+// per sample (a ramp, expanded across channels by GainStage). Integer
+// formats saturate rather than wrap; s32 goes through double so no integer
+// bits are lost. Float is left unclamped: conversion to an integer device
+// saturates anyway, and a float device keeps the headroom.
+//
+namespace gain
+{
+    static inline void ScaleF32Scalar(float *p, size_t n, float g)
+    {
+        for (size_t i = 0; i < n; ++i)
+            p[i] *= g;
+    }
+
+    static inline void ScaleS16Scalar(int16_t *p, size_t n, float g)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            float v = std::nearbyint(static_cast<float>(p[i]) * g);
+            p[i] = static_cast<int16_t>(std::min(32767.0f, std::max(-32768.0f, v)));
+        }
+    }
+
+    static inline void ScaleS32Scalar(int32_t *p, size_t n, float g)
+    {
+        const double gd = g;
+        for (size_t i = 0; i < n; ++i)
+        {
+            double v = std::nearbyint(static_cast<double>(p[i]) * gd);
+            p[i] = static_cast<int32_t>(std::min(2147483647.0, std::max(-2147483648.0, v)));
+        }
+    }
+
+    static inline void RampF32Scalar(float *p, size_t n, const float *g)
+    {
+        for (size_t i = 0; i < n; ++i)
+            p[i] *= g[i];
+    }
+
+    static inline void RampS16Scalar(int16_t *p, size_t n, const float *g)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            float v = std::nearbyint(static_cast<float>(p[i]) * g[i]);
+            p[i] = static_cast<int16_t>(std::min(32767.0f, std::max(-32768.0f, v)));
+        }
+    }
+
+    static inline void RampS32Scalar(int32_t *p, size_t n, const float *g)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            double v = std::nearbyint(static_cast<double>(p[i]) * static_cast<double>(g[i]));
+            p[i] = static_cast<int32_t>(std::min(2147483647.0, std::max(-2147483648.0, v)));
+        }
+    }
+
+#if defined(GAIN_X86)
+    static inline void ScaleF32Sse2(float *p, size_t n, float g)
+    {
+        const __m128 vg = _mm_set1_ps(g);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(p + i, _mm_mul_ps(_mm_loadu_ps(p + i), vg));
+        ScaleF32Scalar(p + i, n - i, g);
+    }
+
+    static inline void ScaleS16Sse2(int16_t *p, size_t n, float g)
+    {
+        const __m128 vg = _mm_set1_ps(g);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            // Sign-extend by placing each int16 in the high half, then shifting
+            __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            a = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(a), vg));
+            b = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(b), vg));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), _mm_packs_epi32(a, b));
+        }
+        ScaleS16Scalar(p + i, n - i, g);
+    }
+
+    static inline void ScaleS32Sse2(int32_t *p, size_t n, float g)
+    {
+        const __m128d vg = _mm_set1_pd(g);
+        const __m128d hi = _mm_set1_pd(2147483647.0), lo = _mm_set1_pd(-2147483648.0);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            __m128d a = _mm_mul_pd(_mm_cvtepi32_pd(v), vg);
+            __m128d b = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))), vg);
+            __m128i ra = _mm_cvtpd_epi32(_mm_max_pd(lo, _mm_min_pd(hi, a)));
+            __m128i rb = _mm_cvtpd_epi32(_mm_max_pd(lo, _mm_min_pd(hi, b)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), _mm_unpacklo_epi64(ra, rb));
+        }
+        ScaleS32Scalar(p + i, n - i, g);
+    }
+
+    static inline void RampF32Sse2(float *p, size_t n, const float *g)
+    {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(p + i, _mm_mul_ps(_mm_loadu_ps(p + i), _mm_loadu_ps(g + i)));
+        RampF32Scalar(p + i, n - i, g + i);
+    }
+
+    static inline void RampS16Sse2(int16_t *p, size_t n, const float *g)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            a = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(a), _mm_loadu_ps(g + i)));
+            b = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(b), _mm_loadu_ps(g + i + 4)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), _mm_packs_epi32(a, b));
+        }
+        RampS16Scalar(p + i, n - i, g + i);
+    }
+
+    static inline void RampS32Sse2(int32_t *p, size_t n, const float *g)
+    {
+        const __m128d hi = _mm_set1_pd(2147483647.0), lo = _mm_set1_pd(-2147483648.0);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            __m128 gv = _mm_loadu_ps(g + i);
+            __m128d a = _mm_mul_pd(_mm_cvtepi32_pd(v), _mm_cvtps_pd(gv));
+            __m128d b = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))),
+                                   _mm_cvtps_pd(_mm_movehl_ps(gv, gv)));
+            __m128i ra = _mm_cvtpd_epi32(_mm_max_pd(lo, _mm_min_pd(hi, a)));
+            __m128i rb = _mm_cvtpd_epi32(_mm_max_pd(lo, _mm_min_pd(hi, b)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), _mm_unpacklo_epi64(ra, rb));
+        }
+        RampS32Scalar(p + i, n - i, g + i);
+    }
+
+    GAIN_TARGET_AVX2 static inline void ScaleF32Avx2(float *p, size_t n, float g)
+    {
+        const __m256 vg = _mm256_set1_ps(g);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(p + i, _mm256_mul_ps(_mm256_loadu_ps(p + i), vg));
+        ScaleF32Scalar(p + i, n - i, g);
+    }
+
+    GAIN_TARGET_AVX2 static inline void ScaleS16Avx2(int16_t *p, size_t n, float g)
+    {
+        const __m256 vg = _mm256_set1_ps(g);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 8));
+            __m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x0)), vg));
+            __m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x1)), vg));
+            // packs works per 128-bit lane; permute restores sample order
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + i), packed);
+        }
+        ScaleS16Sse2(p + i, n - i, g);
+    }
+
+    GAIN_TARGET_AVX2 static inline void ScaleS32Avx2(int32_t *p, size_t n, float g)
+    {
+        const __m256d vg = _mm256_set1_pd(g);
+        const __m256d hi = _mm256_set1_pd(2147483647.0), lo = _mm256_set1_pd(-2147483648.0);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            __m256d d = _mm256_mul_pd(_mm256_cvtepi32_pd(v), vg);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i),
+                             _mm256_cvtpd_epi32(_mm256_max_pd(lo, _mm256_min_pd(hi, d))));
+        }
+        ScaleS32Scalar(p + i, n - i, g);
+    }
+
+    GAIN_TARGET_AVX2 static inline void RampF32Avx2(float *p, size_t n, const float *g)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(p + i, _mm256_mul_ps(_mm256_loadu_ps(p + i), _mm256_loadu_ps(g + i)));
+        RampF32Scalar(p + i, n - i, g + i);
+    }
+
+    GAIN_TARGET_AVX2 static inline void RampS16Avx2(int16_t *p, size_t n, const float *g)
+    {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 8));
+            __m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x0)), _mm256_loadu_ps(g + i)));
+            __m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x1)), _mm256_loadu_ps(g + i + 8)));
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + i), packed);
+        }
+        RampS16Sse2(p + i, n - i, g + i);
+    }
+
+    GAIN_TARGET_AVX2 static inline void RampS32Avx2(int32_t *p, size_t n, const float *g)
+    {
+        const __m256d hi = _mm256_set1_pd(2147483647.0), lo = _mm256_set1_pd(-2147483648.0);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            __m256d d = _mm256_mul_pd(_mm256_cvtepi32_pd(v), _mm256_cvtps_pd(_mm_loadu_ps(g + i)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i),
+                             _mm256_cvtpd_epi32(_mm256_max_pd(lo, _mm256_min_pd(hi, d))));
+        }
+        RampS32Scalar(p + i, n - i, g + i);
+    }
+
+    static inline bool CpuHasAvx2()
+    {
+#if defined(_MSC_VER)
+        int r[4];
+        __cpuid(r, 1);
+        bool osxsave = (r[2] & (1 << 27)) != 0;
+        bool avx = (r[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+        __cpuidex(r, 7, 0);
+        return (r[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif // GAIN_X86
+
+#if defined(GAIN_NEON)
+    static inline void ScaleF32Neon(float *p, size_t n, float g)
+    {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32(p + i, vmulq_n_f32(vld1q_f32(p + i), g));
+        ScaleF32Scalar(p + i, n - i, g);
+    }
+
+    static inline void ScaleS16Neon(int16_t *p, size_t n, float g)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            int16x8_t v = vld1q_s16(p + i);
+            float32x4_t a = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), g);
+            float32x4_t b = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), g);
+            vst1q_s16(p + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+        }
+        ScaleS16Scalar(p + i, n - i, g);
+    }
+
+    static inline void ScaleS32Neon(int32_t *p, size_t n, float g)
+    {
+        const float64x2_t hi = vdupq_n_f64(2147483647.0), lo = vdupq_n_f64(-2147483648.0);
+        const double gd = g;
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            int32x4_t v = vld1q_s32(p + i);
+            float64x2_t a = vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(v))), gd);
+            float64x2_t b = vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(v))), gd);
+            a = vmaxq_f64(lo, vminq_f64(hi, a));
+            b = vmaxq_f64(lo, vminq_f64(hi, b));
+            vst1q_s32(p + i, vcombine_s32(vmovn_s64(vcvtnq_s64_f64(a)), vmovn_s64(vcvtnq_s64_f64(b))));
+        }
+        ScaleS32Scalar(p + i, n - i, g);
+    }
+
+    static inline void RampF32Neon(float *p, size_t n, const float *g)
+    {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32(p + i, vmulq_f32(vld1q_f32(p + i), vld1q_f32(g + i)));
+        RampF32Scalar(p + i, n - i, g + i);
+    }
+
+    static inline void RampS16Neon(int16_t *p, size_t n, const float *g)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            int16x8_t v = vld1q_s16(p + i);
+            float32x4_t a = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), vld1q_f32(g + i));
+            float32x4_t b = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), vld1q_f32(g + i + 4));
+            vst1q_s16(p + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+        }
+        RampS16Scalar(p + i, n - i, g + i);
+    }
+
+    static inline void RampS32Neon(int32_t *p, size_t n, const float *g)
+    {
+        const float64x2_t hi = vdupq_n_f64(2147483647.0), lo = vdupq_n_f64(-2147483648.0);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            int32x4_t v = vld1q_s32(p + i);
+            float32x4_t gv = vld1q_f32(g + i);
+            float64x2_t a = vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(v))), vcvt_f64_f32(vget_low_f32(gv)));
+            float64x2_t b = vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(v))), vcvt_high_f64_f32(gv));
+            a = vmaxq_f64(lo, vminq_f64(hi, a));
+            b = vmaxq_f64(lo, vminq_f64(hi, b));
+            vst1q_s32(p + i, vcombine_s32(vmovn_s64(vcvtnq_s64_f64(a)), vmovn_s64(vcvtnq_s64_f64(b))));
+        }
+        RampS32Scalar(p + i, n - i, g + i);
+    }
+#endif // GAIN_NEON
+
+    struct Kernels
+    {
+        void (*f32)(float *, size_t, float);
+        void (*s16)(int16_t *, size_t, float);
+        void (*s32)(int32_t *, size_t, float);
+        void (*f32Ramp)(float *, size_t, const float *);
+        void (*s16Ramp)(int16_t *, size_t, const float *);
+        void (*s32Ramp)(int32_t *, size_t, const float *);
+        const char *name;
+    };
+
+    static inline Kernels ScalarKernels()
+    {
+        return {ScaleF32Scalar, ScaleS16Scalar, ScaleS32Scalar, RampF32Scalar, RampS16Scalar, RampS32Scalar, "scalar"};
+    }
+
+    // Best kernels for this CPU, resolved once.
+    static inline const Kernels &Best()
+    {
+        static const Kernels k = []
+        {
+#if defined(GAIN_X86)
+            if (CpuHasAvx2())
+                return Kernels{ScaleF32Avx2, ScaleS16Avx2, ScaleS32Avx2, RampF32Avx2, RampS16Avx2, RampS32Avx2, "avx2"};
+            return Kernels{ScaleF32Sse2, ScaleS16Sse2, ScaleS32Sse2, RampF32Sse2, RampS16Sse2, RampS32Sse2, "sse2"};
+#elif defined(GAIN_NEON)
+            return Kernels{ScaleF32Neon, ScaleS16Neon, ScaleS32Neon, RampF32Neon, RampS16Neon, RampS32Neon, "neon"};
+#else
+            return ScalarKernels();
+#endif
+        }();
+        return k;
+    }
+
+    // Packed 24-bit: widen a block to left-justified int32, scale it with
+    // scale(tmp, count, offset of the block), repack.
+    template <typename Fn>
+    static inline void ScaleS24Blocks(uint8_t *p, size_t n, Fn scale)
+    {
+        int32_t tmp[256];
+        for (size_t done = 0; n;)
+        {
+            size_t m = std::min<size_t>(n, 256);
+            for (size_t i = 0; i < m; ++i)
+                tmp[i] = static_cast<int32_t>((p[i * 3] << 8) | (p[i * 3 + 1] << 16) | (static_cast<uint32_t>(p[i * 3 + 2]) << 24));
+            scale(tmp, m, done);
+            for (size_t i = 0; i < m; ++i)
+            {
+                // Round back to 24 bits, saturating at the top
+                int64_t v = (static_cast<int64_t>(tmp[i]) + 0x80) >> 8;
+                if (v > 0x7FFFFF)
+                    v = 0x7FFFFF;
+                uint32_t u = static_cast<uint32_t>(v);
+                p[i * 3] = static_cast<uint8_t>(u);
+                p[i * 3 + 1] = static_cast<uint8_t>(u >> 8);
+                p[i * 3 + 2] = static_cast<uint8_t>(u >> 16);
+            }
+            p += m * 3;
+            n -= m;
+            done += m;
+        }
+    }
+
+    static inline void ScaleS24(uint8_t *p, size_t n, float g, const Kernels &k)
+    {
+        ScaleS24Blocks(p, n, [&](int32_t *tmp, size_t m, size_t)
+                       { k.s32(tmp, m, g); });
+    }
+
+    static inline void RampS24(uint8_t *p, size_t n, const float *g, const Kernels &k)
+    {
+        ScaleS24Blocks(p, n, [&](int32_t *tmp, size_t m, size_t off)
+                       { k.s32Ramp(tmp, m, g + off); });
+    }
+
+    // Scales `samples` interleaved samples of format f by a constant gain.
+    static inline void Scale(uint8_t *p, size_t samples, SampleFormat f, float g, const Kernels &k)
+    {
+        switch (f)
+        {
+        case SampleFormat::F32:
+            k.f32(reinterpret_cast<float *>(p), samples, g);
+            break;
+        case SampleFormat::S16:
+            k.s16(reinterpret_cast<int16_t *>(p), samples, g);
+            break;
+        case SampleFormat::S24:
+            ScaleS24(p, samples, g, k);
+            break;
+        case SampleFormat::S32:
+            k.s32(reinterpret_cast<int32_t *>(p), samples, g);
+            break;
+        case SampleFormat::S24In32:
+            // Device-side container; never in the ring
+            break;
+        }
+    }
+
+    // Scales `samples` interleaved samples of format f by gains[i] each.
+    static inline void Ramp(uint8_t *p, size_t samples, SampleFormat f, const float *gains, const Kernels &k)
+    {
+        switch (f)
+        {
+        case SampleFormat::F32:
+            k.f32Ramp(reinterpret_cast<float *>(p), samples, gains);
+            break;
+        case SampleFormat::S16:
+            k.s16Ramp(reinterpret_cast<int16_t *>(p), samples, gains);
+            break;
+        case SampleFormat::S24:
+            RampS24(p, samples, gains, k);
+            break;
+        case SampleFormat::S32:
+            k.s32Ramp(reinterpret_cast<int32_t *>(p), samples, gains);
+            break;
+        case SampleFormat::S24In32:
+            break;
+        }
+    }
+} // namespace gain
+
+//
+// Volume stage applied by the render thread to each block it takes from the
+// ring. The JS thread publishes a target with set(); the render thread picks
+// it up at the start of the next block and ramps per frame towards it, so a
+// change never causes a step (zipper noise) and never touches the ring.
+// At exactly unity with no ramp the block is left untouched (bit-perfect).
+//
+class GainStage
+{
+public:
+    enum class Curve : uint32_t
+    {
+        Linear = 0,
+        Exponential = 1
+    };
+
+    // Upper bound accepted by set(); +12 dB
+    static constexpr float kMaxGain = 4.0f;
+
+    // JS thread. rampFrames == 0 jumps immediately.
+    void set(float target, uint32_t rampFrames, Curve curve)
+    {
+        target = std::min(kMaxGain, std::max(0.0f, target));
+        uint32_t bits;
+        std::memcpy(&bits, &target, 4);
+        uint64_t ramp = std::min<uint32_t>(rampFrames, 0x7FFFFFFFu);
+        uint64_t word = bits | (ramp << 32) | (static_cast<uint64_t>(curve) << 63);
+        request.store(word, std::memory_order_release);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+
+    float target() const
+    {
+        uint64_t word = request.load(std::memory_order_relaxed);
+        uint32_t bits = static_cast<uint32_t>(word);
+        float f;
+        std::memcpy(&f, &bits, 4);
+        return f;
+    }
+
+    // Render thread only; last level applied
+    float current() const { return level; }
+
+    // Render thread: applies the level in place to `frames` frames.
+    void process(uint8_t *data, size_t frames, unsigned channels, SampleFormat fmt)
+    {
+        uint32_t gen = generation.load(std::memory_order_acquire);
+        if (gen != seenGeneration)
+        {
+            seenGeneration = gen;
+            begin(request.load(std::memory_order_acquire));
+        }
+
+        const size_t frameBytes = static_cast<size_t>(SampleFormatBytes(fmt)) * channels;
+        while (frames)
+        {
+            if (remaining == 0)
+            {
+                if (level != 1.0f)
+                    gain::Scale(data, frames * channels, fmt, level, gain::Best());
+                return;
+            }
+
+            // Ramps step per frame: expand the levels across channels into a
+            // block of per-sample gains and apply each block in one pass
+            size_t n = std::min<size_t>(frames, remaining);
+            if (channels > kRampBlockSamples)
+            {
+                for (size_t i = 0; i < n; ++i, data += frameBytes)
+                {
+                    level = nextLevel();
+                    gain::Scale(data, channels, fmt, level, gain::Best());
+                }
+            }
+            else
+            {
+                const size_t perBlock = kRampBlockSamples / channels;
+                float gains[kRampBlockSamples];
+                for (size_t i = 0; i < n;)
+                {
+                    size_t m = std::min(n - i, perBlock);
+                    float *g = gains;
+                    for (size_t f = 0; f < m; ++f, g += channels)
+                    {
+                        level = nextLevel();
+                        std::fill_n(g, channels, level);
+                    }
+                    gain::Ramp(data, m * channels, fmt, gains, gain::Best());
+                    data += m * frameBytes;
+                    i += m;
+                }
+            }
+            frames -= n;
+            remaining -= static_cast<uint32_t>(n);
+            if (remaining == 0)
+                level = rampTarget; // land exactly, no accumulated drift
+        }
+    }
+
+private:
+    // Exponential ramps cannot start or end at 0; they use -80 dB instead.
+    static constexpr float kExpFloor = 1e-4f;
+    static constexpr size_t kRampBlockSamples = 256;
+
+    float nextLevel() const { return curve == Curve::Exponential ? level * step : level + step; }
+
+    void begin(uint64_t word)
+    {
+        uint32_t bits = static_cast<uint32_t>(word);
+        std::memcpy(&rampTarget, &bits, 4);
+        uint32_t ramp = static_cast<uint32_t>(word >> 32) & 0x7FFFFFFFu;
+        curve = (word >> 63) ? Curve::Exponential : Curve::Linear;
+
+        if (ramp == 0 || rampTarget == level)
+        {
+            level = rampTarget;
+            remaining = 0;
+            return;
+        }
+
+        remaining = ramp;
+        if (curve == Curve::Exponential)
+        {
+            level = std::max(level, kExpFloor);
+            float to = std::max(rampTarget, kExpFloor);
+            step = static_cast<float>(std::pow(static_cast<double>(to) / level, 1.0 / ramp));
+        }
+        else
+        {
+            step = (rampTarget - level) / static_cast<float>(ramp);
+        }
+    }
+
+    std::atomic<uint64_t> request{0x3F800000u}; // 1.0f, no ramp
+    std::atomic<uint32_t> generation{0};
+
+    // Render thread state
+    uint32_t seenGeneration{0};
+    float level{1.0f};
+    float rampTarget{1.0f};
+    float step{0.0f};
+    uint32_t remaining{0};
+    Curve curve{Curve::Linear};
+};
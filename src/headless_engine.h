@@ -0,0 +1,84 @@
+// src/headless_engine.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "null_sink.h"
+#include "render_telemetry.h"
+
+//
+// The engine without Node: src/exclusive_audio.cc compiled with
+// EXCLUSIVE_HEADLESS exports these calls instead of the N-API module. They
+// run the same code as the JS exports of the same name (backends, rings,
+// writer path, file decoder, render loops, handle table), so a native driver
+// can load the real engine under perf, valgrind or TSan (bench/engine_load.cc).
+//
+// Write, Drain, Pause, ReadStats and DumpTrace may come from any thread; as
+// under JS, Close waits out the ones still in flight before the stream is
+// freed. PlayFile and Close on one handle must not overlap (the JS thread
+// never runs them at once). Shared rings and event subscriptions are JS-only
+// and not available here.
+//
+namespace headless
+{
+    // openOutput() options
+    struct OpenOptions
+    {
+        std::string mode{"null"}; // 'exclusive' | 'shared' | 'null'
+        std::string deviceId;
+        std::string backend{"alsa"}; // Linux: 'alsa' | 'pipewire' | 'auto'
+        std::string latencyClass;    // empty: backend default
+        std::string bus;             // empty: own device
+        unsigned int sampleRate{48000};
+        unsigned int channels{2};
+        unsigned int bitDepth{32};
+        bool floatSamples{true};
+        double bufferMs{250.0};
+        double wakeThresholdMs{20.0};
+        bool realtime{false};
+        size_t traceRecords{0};
+        NullSinkOptions nullSink;
+    };
+
+    // What the stream was opened with (the device may differ from the request)
+    struct StreamInfo
+    {
+        unsigned int sampleRate{0};
+        unsigned int channels{0};
+        unsigned int bytesPerFrame{0};
+        const char *backend{""};
+    };
+
+    struct StreamStats
+    {
+        RenderTelemetry::Snapshot telemetry;
+        uint64_t writerParks{0};
+        uint64_t writerWakeups{0};
+    };
+
+    // Returns the handle, or 0 with the reason in LastError().
+    uint32_t Open(const OpenOptions &o, StreamInfo *info = nullptr);
+
+    // As write(handle, buffer, blocking): bytes taken, or -1 if the handle is
+    // not open or the stream does not take writes (file playback).
+    int Write(uint32_t handle, const uint8_t *data, size_t len, bool blocking);
+
+    // As openFile(handle, path): the decoder thread feeds the ring from here.
+    bool PlayFile(uint32_t handle, const std::string &path);
+
+    // The file has been decoded and its ring has played out (or none plays).
+    bool FilePlayedOut(uint32_t handle);
+
+    void Pause(uint32_t handle, bool paused);
+    void Drain(uint32_t handle);
+    bool ReadStats(uint32_t handle, StreamStats &out);
+
+    // Chrome trace of a stream opened with traceRecords; events written or -1
+    long long DumpTrace(uint32_t handle, const std::string &path);
+
+    void Close(uint32_t handle);
+
+    std::string LastError();
+} // namespace headless
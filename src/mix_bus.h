@@ -0,0 +1,125 @@
+// src/mix_bus.h
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gain_stage.h"
+
+//
+// Summing kernels for the mixing bus: acc[i] += in[i] over float samples,
+// alongside the crossfade kernels in namespace mix. No clamping here; the
+// bus clamps (or the device conversion saturates) once every member is in.
+//
+namespace mix
+{
+    static inline void AddScalar(float *acc, const float *in, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+            acc[i] += in[i];
+    }
+
+#if defined(GAIN_X86)
+    static inline void AddSse2(float *acc, const float *in, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_loadu_ps(in + i)));
+        AddScalar(acc + i, in + i, n - i);
+    }
+
+    GAIN_TARGET_AVX2 static inline void AddAvx2(float *acc, const float *in, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m256 a = _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_loadu_ps(in + i));
+            __m256 b = _mm256_add_ps(_mm256_loadu_ps(acc + i + 8), _mm256_loadu_ps(in + i + 8));
+            _mm256_storeu_ps(acc + i, a);
+            _mm256_storeu_ps(acc + i + 8, b);
+        }
+        AddSse2(acc + i, in + i, n - i);
+    }
+#endif
+
+#if defined(GAIN_NEON)
+    static inline void AddNeon(float *acc, const float *in, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4)
+            vst1q_f32(acc + i, vaddq_f32(vld1q_f32(acc + i), vld1q_f32(in + i)));
+        AddScalar(acc + i, in + i, n - i);
+    }
+#endif
+
+    using AddFn = void (*)(float *, const float *, size_t);
+
+    // Best kernel for this CPU, resolved once.
+    static inline AddFn BestAdd()
+    {
+        static const AddFn fn = []
+        {
+#if defined(GAIN_X86)
+            return gain::CpuHasAvx2() ? AddFn(AddAvx2) : AddFn(AddSse2);
+#elif defined(GAIN_NEON)
+            return AddFn(AddNeon);
+#else
+            return AddFn(AddScalar);
+#endif
+        }();
+        return fn;
+    }
+} // namespace mix
+
+//
+// Member list read by one render thread on every cycle and replaced, rarely,
+// from another thread. The reader never locks or allocates: it brackets its
+// use with enter()/exit() and works on an immutable snapshot. replace()
+// publishes a new snapshot and frees the old one once the reader is
+// provably not inside a bracket that could have seen it.
+//
+template <typename T>
+class SnapshotList
+{
+public:
+    using Items = std::vector<T *>;
+
+    SnapshotList() : current(new Items()) {}
+    SnapshotList(const SnapshotList &) = delete;
+    SnapshotList &operator=(const SnapshotList &) = delete;
+    ~SnapshotList() { delete current.load(); }
+
+    // Reader thread only. The snapshot stays valid until exit().
+    const Items &enter()
+    {
+        readerSeq.fetch_add(1);
+        return *current.load();
+    }
+
+    void exit() { readerSeq.fetch_add(1); }
+
+    // Writers must be serialized by the caller. Returns once the previous
+    // snapshot is no longer referenced, so anything dropped from the list
+    // may be freed straight after.
+    void replace(const Items &items)
+    {
+        Items *old = current.exchange(new Items(items));
+        // Odd: the reader is inside a bracket that may have loaded `old`.
+        // Any bracket entered after the exchange sees the new list.
+        uint64_t seq = readerSeq.load();
+        if (seq & 1u)
+        {
+            while (readerSeq.load() == seq)
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        delete old;
+    }
+
+private:
+    std::atomic<Items *> current;
+    std::atomic<uint64_t> readerSeq{0};
+};
@@ -0,0 +1,159 @@
+// src/null_sink.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "sample_format.h"
+
+//
+// Pieces of the null sink backend (openOutput({ mode: 'null' })), which
+// renders into a simulated device instead of real hardware so the pipeline
+// can be driven on machines without a sound card.
+//
+struct NullSinkOptions
+{
+    // Drain the simulated buffer at sampleRate in real time, or consume the
+    // ring as fast as it is filled (clock: 'fast')
+    bool realtime{true};
+    // Capture of everything the device would have played; empty: none
+    std::string wavPath;
+    // Every Nth period the render thread misses its deadline; 0: never
+    uint32_t xrunEveryPeriods{0};
+    // Extra delay added to each wakeup, uniform in [0, jitterMs]
+    double jitterMs{0.0};
+    uint32_t seed{1};
+};
+
+//
+// Deterministic wakeup jitter: xorshift32, so a given seed reproduces the
+// same schedule run after run.
+//
+class NullSinkJitter
+{
+public:
+    explicit NullSinkJitter(uint32_t seed) : state(seed ? seed : 1) {}
+
+    // Next delay in [0, maxNs]
+    uint64_t next(uint64_t maxNs)
+    {
+        if (maxNs == 0)
+            return 0;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return static_cast<uint64_t>(static_cast<double>(state) / 4294967295.0 * static_cast<double>(maxNs));
+    }
+
+private:
+    uint32_t state;
+};
+
+//
+// Streaming RIFF/WAVE writer. The header goes out first with zero sizes,
+// which are patched on close.
+//
+class WavWriter
+{
+public:
+    WavWriter() = default;
+    WavWriter(const WavWriter &) = delete;
+    WavWriter &operator=(const WavWriter &) = delete;
+    ~WavWriter() { close(); }
+
+    bool open(const std::string &path, unsigned sampleRate, unsigned channels, SampleFormat format)
+    {
+        close();
+        failed = false;
+        file = std::fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+
+        const unsigned bytesPerSample = SampleFormatBytes(format);
+        const uint16_t tag = format == SampleFormat::F32 ? 3 : 1; // IEEE float : PCM
+        const uint16_t bits = static_cast<uint16_t>(bytesPerSample * 8);
+        frameBytes = bytesPerSample * channels;
+
+        uint8_t header[kHeaderBytes] = {};
+        std::memcpy(header + 0, "RIFF", 4);
+        std::memcpy(header + 8, "WAVE", 4);
+        std::memcpy(header + 12, "fmt ", 4);
+        put32(header + 16, 16);
+        put16(header + 20, tag);
+        put16(header + 22, static_cast<uint16_t>(channels));
+        put32(header + 24, sampleRate);
+        put32(header + 28, sampleRate * frameBytes);
+        put16(header + 32, static_cast<uint16_t>(frameBytes));
+        put16(header + 34, bits);
+        std::memcpy(header + 36, "data", 4);
+        if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header))
+        {
+            close();
+            return false;
+        }
+        dataBytes = 0;
+        return true;
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    // Appends PCM in the format given to open(). Stops recording (and
+    // returns false) on the first failed write.
+    bool write(const uint8_t *data, size_t bytes)
+    {
+        if (!file)
+            return false;
+        if (std::fwrite(data, 1, bytes, file) != bytes)
+        {
+            failed = true;
+            close();
+            return false;
+        }
+        dataBytes += bytes;
+        return true;
+    }
+
+    uint64_t framesWritten() const { return frameBytes ? dataBytes / frameBytes : 0; }
+    bool writeFailed() const { return failed; }
+
+    void close()
+    {
+        if (!file)
+            return;
+        // RIFF sizes are 32-bit; anything past 4 GiB is left unsized
+        uint32_t data = dataBytes > 0xFFFFFFFFull - kHeaderBytes ? 0xFFFFFFFFu - kHeaderBytes
+                                                                 : static_cast<uint32_t>(dataBytes);
+        uint8_t size[4];
+        put32(size, data + kHeaderBytes - 8);
+        if (std::fseek(file, 4, SEEK_SET) == 0)
+            std::fwrite(size, 1, 4, file);
+        put32(size, data);
+        if (std::fseek(file, 40, SEEK_SET) == 0)
+            std::fwrite(size, 1, 4, file);
+        std::fclose(file);
+        file = nullptr;
+    }
+
+private:
+    static constexpr uint32_t kHeaderBytes = 44;
+
+    static void put16(uint8_t *p, uint16_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    static void put32(uint8_t *p, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    std::FILE *file{nullptr};
+    uint64_t dataBytes{0};
+    unsigned frameBytes{0};
+    bool failed{false};
+};
@@ -0,0 +1,152 @@
+// src/playback_clock.h
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__APPLE__)
+// mach_absolute_time() / AudioTimeStamp::mHostTime units to nanoseconds.
+static inline uint64_t HostTimeToNs(uint64_t hostTime)
+{
+    static const mach_timebase_info_data_t tb = []
+    {
+        mach_timebase_info_data_t info;
+        mach_timebase_info(&info);
+        return info;
+    }();
+    return static_cast<uint64_t>(static_cast<__uint128_t>(hostTime) * tb.numer / tb.denom);
+}
+#endif
+
+// Monotonic nanoseconds on the same clock process.hrtime.bigint() reads
+// (CLOCK_MONOTONIC / mach_absolute_time / QueryPerformanceCounter), so JS can
+// compare against timestamps published by the render thread directly.
+static inline uint64_t MonotonicNowNs()
+{
+#if defined(_WIN32)
+    static const uint64_t freq = []
+    {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return static_cast<uint64_t>(f.QuadPart);
+    }();
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    uint64_t ticks = static_cast<uint64_t>(now.QuadPart);
+    return (ticks / freq) * 1000000000ull + (ticks % freq) * 1000000000ull / freq;
+#elif defined(__APPLE__)
+    return HostTimeToNs(mach_absolute_time());
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+//
+// Per-stream playback position, in frames of stream content that have
+// actually reached the DAC.
+//
+// The render thread reports every block it hands to the device (how many
+// frames came from the ring and how many were silence padding) and, right
+// after, the device's own delay at a monotonic timestamp. The audible
+// position is then the content handed over minus whatever part of the delay
+// is content; silence queued behind the last real frame (ring underrun,
+// pause) does not hold the position back. Positions never go backwards.
+//
+// Snapshots are published through a seqlock, so readers on any thread get a
+// consistent {frames, timestampNs} pair without blocking the render thread.
+//
+class PlaybackClock
+{
+public:
+    struct Position
+    {
+        uint64_t frames{0};
+        uint64_t timestampNs{0};
+    };
+
+    // Render thread: a block of deviceFrames frames was handed to the device,
+    // the first contentFrames of which came from the ring. contentFrames may
+    // exceed deviceFrames when the device rejected part of the block (xrun);
+    // that content is gone but still counts as played.
+    void advance(uint64_t contentFrames, uint64_t deviceFrames)
+    {
+        contentTotal += contentFrames;
+        if (contentFrames > 0)
+            trailingSilence = deviceFrames > contentFrames ? deviceFrames - contentFrames : 0;
+        else
+            trailingSilence += deviceFrames;
+    }
+
+    // Render thread: the device reported delayFrames frames queued ahead of
+    // the DAC at timestampNs (MonotonicNowNs() clock).
+    void publish(int64_t delayFrames, uint64_t timestampNs)
+    {
+        uint64_t delay = delayFrames > 0 ? static_cast<uint64_t>(delayFrames) : 0;
+        lastDelay = delay;
+        lastTimestamp = timestampNs;
+        uint64_t queuedContent = delay > trailingSilence ? delay - trailingSilence : 0;
+        uint64_t audible = contentTotal > queuedContent ? contentTotal - queuedContent : 0;
+        if (audible < lastAudible)
+            audible = lastAudible;
+        lastAudible = audible;
+
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        publishedFrames.store(audible, std::memory_order_relaxed);
+        publishedTimestamp.store(timestampNs, std::memory_order_relaxed);
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Render thread: the device delay and timestamp given to the last
+    // publish(), for clocks that ride on this device (mixing bus members)
+    uint64_t lastDelayFrames() const { return lastDelay; }
+    uint64_t lastTimestampNs() const { return lastTimestamp; }
+
+    // Render thread: the position last published, and whether every frame
+    // of content handed over so far has reached the DAC
+    uint64_t audibleFrames() const { return lastAudible; }
+    bool allAudible() const { return lastAudible >= contentTotal; }
+
+    // Any thread.
+    Position read() const
+    {
+        Position p;
+        for (;;)
+        {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1u)
+                continue;
+            p.frames = publishedFrames.load(std::memory_order_relaxed);
+            p.timestampNs = publishedTimestamp.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+                return p;
+        }
+    }
+
+private:
+    // Render thread state
+    uint64_t contentTotal{0};
+    uint64_t trailingSilence{0};
+    uint64_t lastAudible{0};
+    uint64_t lastDelay{0};
+    uint64_t lastTimestamp{0};
+
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint64_t> publishedFrames{0};
+    std::atomic<uint64_t> publishedTimestamp{0};
+};
@@ -0,0 +1,336 @@
+// src/realtime_policy.h
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//
+// Scheduling and memory policy for a render thread: real-time class, CPU
+// pinning and locked pages, requested per stream at open and applied by the
+// render thread to itself when it starts.
+//
+// Real-time is best effort. An unprivileged process gets SCHED_FIFO/RR only
+// within RLIMIT_RTPRIO, which is also what rtkit hands out, so the request
+// is clamped to that limit. The limits are process-wide, so they are only
+// changed when the caller opts in (raiseLimits): then the soft RTPRIO limit
+// is raised to the hard one and an RLIMIT_RTTIME watchdog is set the way
+// rtkit requires, so a runaway render loop gets killed instead of freezing
+// the machine. Without any real-time allowance the thread falls back to a
+// raised nice level. The report says what was actually applied.
+//
+struct RealtimeRequest
+{
+    enum class Policy
+    {
+        None,
+        Fifo,
+        RoundRobin
+    };
+
+    Policy policy{Policy::None};
+    int priority{0}; // 0: kDefaultPriority
+    std::vector<int> cpus;
+    bool lockMemory{false};
+    bool raiseLimits{false}; // may change the process's RLIMIT_RTPRIO/RTTIME
+
+    static constexpr int kDefaultPriority = 70;
+};
+
+struct RealtimeReport
+{
+    std::string policy{"other"}; // fifo | rr | other
+    int priority{0};
+    int nice{0};
+    std::vector<int> cpus; // empty: not pinned
+    bool memoryLocked{false};
+    size_t lockedBytes{0};
+    std::string note; // why something requested was not applied
+};
+
+//
+// Pages pinned with mlock for one stream. Memory the render thread touches
+// is allocated (and zero-filled, so already faulted in) before it starts;
+// locking keeps it from being paged out again. Regions are unlocked before
+// they are freed, since freed heap pages otherwise stay locked.
+//
+// mlock does not nest: one munlock unlocks a page however many regions
+// (of this stream or another) sit on it. Locked pages are therefore counted
+// process-wide, and a page is only munlocked when its last region goes.
+//
+class LockedMemory
+{
+public:
+    ~LockedMemory() { unlockAll(); }
+
+    // Returns false (and leaves the region unlocked) past RLIMIT_MEMLOCK.
+    bool lock(const void *ptr, size_t len)
+    {
+        if (!ptr || len == 0)
+            return true;
+#if defined(__linux__)
+        if (mlock(ptr, len) != 0)
+            return false;
+        retainPages(ptr, len);
+        std::lock_guard<std::mutex> guard(mutex);
+        regions.push_back({ptr, len});
+        total += len;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void unlock(const void *ptr)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        for (size_t i = 0; i < regions.size(); ++i)
+        {
+            if (regions[i].ptr != ptr)
+                continue;
+#if defined(__linux__)
+            releasePages(regions[i].ptr, regions[i].len);
+#endif
+            total -= regions[i].len;
+            regions.erase(regions.begin() + static_cast<std::ptrdiff_t>(i));
+            return;
+        }
+    }
+
+    void unlockAll()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+#if defined(__linux__)
+        for (const auto &r : regions)
+            releasePages(r.ptr, r.len);
+#endif
+        regions.clear();
+        total = 0;
+    }
+
+    size_t bytes() const
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        return total;
+    }
+
+private:
+    struct Region
+    {
+        const void *ptr;
+        size_t len;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Region> regions;
+    size_t total{0};
+
+#if defined(__linux__)
+    // Lock count per page address, shared by every LockedMemory
+    struct PageCounts
+    {
+        std::mutex mutex;
+        std::map<uintptr_t, uint32_t> counts;
+        uintptr_t pageSize{static_cast<uintptr_t>(sysconf(_SC_PAGESIZE))};
+    };
+
+    static PageCounts &pages()
+    {
+        static PageCounts table;
+        return table;
+    }
+
+    static void retainPages(const void *ptr, size_t len)
+    {
+        PageCounts &t = pages();
+        uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & ~(t.pageSize - 1);
+        uintptr_t end = reinterpret_cast<uintptr_t>(ptr) + len;
+        std::lock_guard<std::mutex> guard(t.mutex);
+        for (uintptr_t page = begin; page < end; page += t.pageSize)
+            ++t.counts[page];
+    }
+
+    // munlocks the pages no other region holds, a contiguous run at a time
+    static void releasePages(const void *ptr, size_t len)
+    {
+        PageCounts &t = pages();
+        uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & ~(t.pageSize - 1);
+        uintptr_t end = reinterpret_cast<uintptr_t>(ptr) + len;
+        uintptr_t run = 0;
+        size_t runPages = 0;
+        std::lock_guard<std::mutex> guard(t.mutex);
+        for (uintptr_t page = begin; page < end; page += t.pageSize)
+        {
+            auto it = t.counts.find(page);
+            bool last = it == t.counts.end() || --it->second == 0;
+            if (last && it != t.counts.end())
+                t.counts.erase(it);
+            if (last)
+            {
+                if (runPages == 0)
+                    run = page;
+                ++runPages;
+                continue;
+            }
+            if (runPages > 0)
+                munlock(reinterpret_cast<const void *>(run), runPages * t.pageSize);
+            runPages = 0;
+        }
+        if (runPages > 0)
+            munlock(reinterpret_cast<const void *>(run), runPages * t.pageSize);
+    }
+#endif
+};
+
+#if defined(__linux__)
+
+namespace realtime
+{
+    // Touches (and locks) this much of the calling thread's stack
+    static constexpr size_t kStackPrefaultBytes = 64 * 1024;
+
+    static inline void AppendNote(RealtimeReport &report, const std::string &text)
+    {
+        if (!report.note.empty())
+            report.note += "; ";
+        report.note += text;
+    }
+
+    // rtkit-style grant: what RLIMIT_RTPRIO allows. With raise (the caller
+    // opted in) the soft limits are changed for the whole process: RTPRIO up
+    // to the hard limit, plus a CPU-time watchdog. Returns the highest
+    // priority the limits allow (0: none).
+    static inline int RaiseRealtimeLimits(int wanted, bool raise)
+    {
+        struct rlimit prio;
+        if (getrlimit(RLIMIT_RTPRIO, &prio) != 0)
+            return 0;
+        if (raise && prio.rlim_cur < prio.rlim_max)
+        {
+            prio.rlim_cur = prio.rlim_max;
+            setrlimit(RLIMIT_RTPRIO, &prio);
+            getrlimit(RLIMIT_RTPRIO, &prio);
+        }
+
+        // 200 ms of CPU without blocking gets the thread a SIGXCPU
+        struct rlimit rttime;
+        if (raise && getrlimit(RLIMIT_RTTIME, &rttime) == 0 && rttime.rlim_cur == RLIM_INFINITY)
+        {
+            rttime.rlim_cur = rttime.rlim_max == RLIM_INFINITY ? 200000 : std::min<rlim_t>(rttime.rlim_max, 200000);
+            setrlimit(RLIMIT_RTTIME, &rttime);
+        }
+
+        if (prio.rlim_cur == RLIM_INFINITY)
+            return wanted;
+        return static_cast<int>(std::min<rlim_t>(prio.rlim_cur, static_cast<rlim_t>(wanted)));
+    }
+
+    static inline void ApplyScheduling(const RealtimeRequest &req, RealtimeReport &report)
+    {
+        const int policy = req.policy == RealtimeRequest::Policy::RoundRobin ? SCHED_RR : SCHED_FIFO;
+        int priority = req.priority > 0 ? req.priority : RealtimeRequest::kDefaultPriority;
+        priority = std::max(sched_get_priority_min(policy), std::min(sched_get_priority_max(policy), priority));
+
+        // sched_setscheduler(0) is the calling thread; helpers it forks
+        // (none today) would not inherit the class
+        struct sched_param param;
+        param.sched_priority = priority;
+        int err = sched_setscheduler(0, policy | SCHED_RESET_ON_FORK, &param) == 0 ? 0 : errno;
+        if (err == EPERM)
+        {
+            int allowed = RaiseRealtimeLimits(priority, req.raiseLimits);
+            if (allowed > 0)
+            {
+                param.sched_priority = std::max(sched_get_priority_min(policy), allowed);
+                err = sched_setscheduler(0, policy | SCHED_RESET_ON_FORK, &param) == 0 ? 0 : errno;
+                if (err == 0 && param.sched_priority < priority)
+                    AppendNote(report, "priority clamped to RLIMIT_RTPRIO " + std::to_string(allowed));
+            }
+        }
+
+        if (err == 0)
+        {
+            report.policy = policy == SCHED_RR ? "rr" : "fifo";
+            report.priority = param.sched_priority;
+            return;
+        }
+
+        // No real-time allowance: the best a normal thread can get
+        AppendNote(report, std::string("real-time scheduling refused (") + std::strerror(err) + ")");
+        pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        for (int nice = -11; nice < 0; nice += 5)
+        {
+            if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), nice) == 0)
+                break;
+        }
+    }
+
+    static inline void ApplyAffinity(const RealtimeRequest &req, RealtimeReport &report)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        size_t usable = 0;
+        for (int cpu : req.cpus)
+        {
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+            {
+                CPU_SET(cpu, &set);
+                ++usable;
+            }
+        }
+        if (usable == 0 || pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        {
+            AppendNote(report, "CPU affinity not applied");
+            return;
+        }
+        if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &set))
+                    report.cpus.push_back(cpu);
+            }
+        }
+    }
+
+    // Faults in and locks the top of the calling thread's stack, so the
+    // render loop's frames below it never page-fault.
+    static inline bool LockStack(LockedMemory &locked)
+    {
+        volatile uint8_t stack[kStackPrefaultBytes];
+        for (size_t i = 0; i < sizeof(stack); i += 256)
+            stack[i] = 0;
+        return locked.lock(const_cast<uint8_t *>(stack), sizeof(stack));
+    }
+
+    // Render thread, at start: applies everything req asks for to the
+    // calling thread. Memory regions are locked by the caller.
+    static inline void ApplyToCurrentThread(const RealtimeRequest &req, RealtimeReport &report)
+    {
+        if (req.policy != RealtimeRequest::Policy::None)
+            ApplyScheduling(req, report);
+        if (!req.cpus.empty())
+            ApplyAffinity(req, report);
+
+        errno = 0;
+        int nice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+        report.nice = errno == 0 ? nice : 0;
+    }
+} // namespace realtime
+
+#endif // __linux__
@@ -0,0 +1,237 @@
+// src/render_telemetry.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//
+// Per-stream render loop telemetry, kept by the render thread and read from
+// any thread (getStats / readTelemetry):
+//
+//   - ring underruns: periods the ring could not fill, counted once per
+//     episode (the first short period after one that was not), plus the
+//     frames of silence padded in while the stream was not paused
+//   - device xruns: the backend reports the device ran dry or was late
+//   - short writes: the device took only part of a period
+//   - ring fill at the top of each period, in 10% buckets
+//   - wakeup jitter: how far the interval since the previous wakeup is from
+//     the previous period's length, log2 microsecond buckets
+//   - time from wakeup to the period being handed over, same buckets
+//
+// The render thread folds each period into private totals and publishes
+// them under a seqlock once per period, so a reader gets a consistent
+// snapshot and never stalls the render thread.
+//
+class RenderTelemetry
+{
+public:
+    static constexpr size_t kFillBuckets = 10;
+    // Bucket 0 is < 1 us, bucket i covers [2^(i-1), 2^i) us, the last is open
+    static constexpr size_t kTimeBuckets = 20;
+
+    struct Snapshot
+    {
+        uint64_t periods{0};
+        uint64_t ringUnderruns{0};
+        uint64_t underrunFrames{0};
+        uint64_t deviceXruns{0};
+        uint64_t shortWrites{0};
+        uint32_t lastFillPercent{0};
+        uint64_t maxJitterNs{0};
+        uint64_t maxRenderNs{0};
+        uint64_t fill[kFillBuckets]{};
+        uint64_t jitter[kTimeBuckets]{};
+        uint64_t render[kTimeBuckets]{};
+    };
+
+    // Flat layout used by readTelemetry() for a Float64Array
+    enum Field : size_t
+    {
+        kFieldPeriods,
+        kFieldRingUnderruns,
+        kFieldUnderrunFrames,
+        kFieldDeviceXruns,
+        kFieldShortWrites,
+        kFieldLastFillPercent,
+        kFieldMaxJitterUs,
+        kFieldMaxRenderUs,
+        kFieldFillHistogram,
+        kFieldJitterHistogram = kFieldFillHistogram + kFillBuckets,
+        kFieldRenderHistogram = kFieldJitterHistogram + kTimeBuckets,
+        kFieldCount = kFieldRenderHistogram + kTimeBuckets
+    };
+
+    // Render thread: woken for a period, before the ring is read. A second
+    // call before end() (a retried or partial period) is ignored.
+    void begin(uint64_t nowNs, size_t ringFill, size_t ringSize, unsigned int sampleRate)
+    {
+        if (inPeriod)
+            return;
+        inPeriod = true;
+
+        if (lastWakeNs && lastFrames && sampleRate)
+        {
+            uint64_t interval = nowNs > lastWakeNs ? nowNs - lastWakeNs : 0;
+            uint64_t expected = lastFrames * 1000000000ull / sampleRate;
+            uint64_t jitter = interval > expected ? interval - expected : expected - interval;
+            ++local.jitter[TimeBucket(jitter)];
+            if (jitter > local.maxJitterNs)
+                local.maxJitterNs = jitter;
+        }
+        lastWakeNs = nowNs;
+        wakeNs = nowNs;
+
+        uint32_t percent = ringSize ? static_cast<uint32_t>(static_cast<uint64_t>(ringFill) * 100 / ringSize) : 0;
+        local.lastFillPercent = percent;
+        ++local.fill[percent >= 100 ? kFillBuckets - 1 : percent / 10];
+    }
+
+    // Render thread: `frames` were handed to the device, `content` of them
+    // from the ring.
+    void end(uint64_t nowNs, size_t frames, size_t content, bool paused)
+    {
+        if (!inPeriod)
+            return;
+        inPeriod = false;
+
+        uint64_t took = nowNs > wakeNs ? nowNs - wakeNs : 0;
+        ++local.render[TimeBucket(took)];
+        if (took > local.maxRenderNs)
+            local.maxRenderNs = took;
+
+        bool starved = !paused && content < frames;
+        if (starved)
+        {
+            if (!wasStarved)
+                ++local.ringUnderruns;
+            local.underrunFrames += frames - content;
+        }
+        wasStarved = starved;
+        lastFrames = frames;
+        ++local.periods;
+        publish();
+    }
+
+    // Render thread, anywhere in the loop; published with the next period.
+    void deviceXrun() { ++local.deviceXruns; }
+    void shortWrite() { ++local.shortWrites; }
+
+    // Render thread: ring underrun episodes so far, and when the period
+    // now open began
+    uint64_t underrunEpisodes() const { return local.ringUnderruns; }
+    uint64_t periodStartNs() const { return wakeNs; }
+
+    // Any thread.
+    Snapshot read() const
+    {
+        Snapshot s;
+        for (;;)
+        {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1u)
+                continue;
+            s.periods = shared.periods.load(std::memory_order_relaxed);
+            s.ringUnderruns = shared.ringUnderruns.load(std::memory_order_relaxed);
+            s.underrunFrames = shared.underrunFrames.load(std::memory_order_relaxed);
+            s.deviceXruns = shared.deviceXruns.load(std::memory_order_relaxed);
+            s.shortWrites = shared.shortWrites.load(std::memory_order_relaxed);
+            s.lastFillPercent = shared.lastFillPercent.load(std::memory_order_relaxed);
+            s.maxJitterNs = shared.maxJitterNs.load(std::memory_order_relaxed);
+            s.maxRenderNs = shared.maxRenderNs.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < kFillBuckets; ++i)
+                s.fill[i] = shared.fill[i].load(std::memory_order_relaxed);
+            for (size_t i = 0; i < kTimeBuckets; ++i)
+            {
+                s.jitter[i] = shared.jitter[i].load(std::memory_order_relaxed);
+                s.render[i] = shared.render[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+                return s;
+        }
+    }
+
+    // Writes a snapshot in the Field layout; out holds kFieldCount doubles.
+    static void flatten(const Snapshot &s, double *out)
+    {
+        out[kFieldPeriods] = static_cast<double>(s.periods);
+        out[kFieldRingUnderruns] = static_cast<double>(s.ringUnderruns);
+        out[kFieldUnderrunFrames] = static_cast<double>(s.underrunFrames);
+        out[kFieldDeviceXruns] = static_cast<double>(s.deviceXruns);
+        out[kFieldShortWrites] = static_cast<double>(s.shortWrites);
+        out[kFieldLastFillPercent] = s.lastFillPercent;
+        out[kFieldMaxJitterUs] = s.maxJitterNs / 1000.0;
+        out[kFieldMaxRenderUs] = s.maxRenderNs / 1000.0;
+        for (size_t i = 0; i < kFillBuckets; ++i)
+            out[kFieldFillHistogram + i] = static_cast<double>(s.fill[i]);
+        for (size_t i = 0; i < kTimeBuckets; ++i)
+        {
+            out[kFieldJitterHistogram + i] = static_cast<double>(s.jitter[i]);
+            out[kFieldRenderHistogram + i] = static_cast<double>(s.render[i]);
+        }
+    }
+
+    // Upper bound of a time bucket in microseconds (0: open-ended)
+    static uint64_t BucketLimitUs(size_t i) { return i + 1 < kTimeBuckets ? 1ull << i : 0; }
+
+private:
+    static size_t TimeBucket(uint64_t ns)
+    {
+        uint64_t us = ns / 1000;
+        size_t b = 0;
+        while (us && b + 1 < kTimeBuckets)
+        {
+            us >>= 1;
+            ++b;
+        }
+        return b;
+    }
+
+    void publish()
+    {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        shared.periods.store(local.periods, std::memory_order_relaxed);
+        shared.ringUnderruns.store(local.ringUnderruns, std::memory_order_relaxed);
+        shared.underrunFrames.store(local.underrunFrames, std::memory_order_relaxed);
+        shared.deviceXruns.store(local.deviceXruns, std::memory_order_relaxed);
+        shared.shortWrites.store(local.shortWrites, std::memory_order_relaxed);
+        shared.lastFillPercent.store(local.lastFillPercent, std::memory_order_relaxed);
+        shared.maxJitterNs.store(local.maxJitterNs, std::memory_order_relaxed);
+        shared.maxRenderNs.store(local.maxRenderNs, std::memory_order_relaxed);
+        for (size_t i = 0; i < kFillBuckets; ++i)
+            shared.fill[i].store(local.fill[i], std::memory_order_relaxed);
+        for (size_t i = 0; i < kTimeBuckets; ++i)
+        {
+            shared.jitter[i].store(local.jitter[i], std::memory_order_relaxed);
+            shared.render[i].store(local.render[i], std::memory_order_relaxed);
+        }
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Render thread state
+    Snapshot local;
+    bool inPeriod{false};
+    bool wasStarved{false};
+    uint64_t wakeNs{0};
+    uint64_t lastWakeNs{0};
+    uint64_t lastFrames{0};
+
+    std::atomic<uint32_t> sequence{0};
+    struct
+    {
+        std::atomic<uint64_t> periods{0};
+        std::atomic<uint64_t> ringUnderruns{0};
+        std::atomic<uint64_t> underrunFrames{0};
+        std::atomic<uint64_t> deviceXruns{0};
+        std::atomic<uint64_t> shortWrites{0};
+        std::atomic<uint32_t> lastFillPercent{0};
+        std::atomic<uint64_t> maxJitterNs{0};
+        std::atomic<uint64_t> maxRenderNs{0};
+        std::atomic<uint64_t> fill[kFillBuckets]{};
+        std::atomic<uint64_t> jitter[kTimeBuckets]{};
+        std::atomic<uint64_t> render[kTimeBuckets]{};
+    } shared;
+};
@@ -0,0 +1,231 @@
+// src/render_trace.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "playback_clock.h"
+
+//
+// Opt-in flight recorder for the render path (openOutput({ trace })): each
+// stage of a period and each blocking ring write leaves a timestamped record
+// in a fixed ring of records, allocated at open. Recording never allocates,
+// locks or blocks; once the ring wraps, the oldest records are overwritten.
+// dumpTrace() exports whatever is held as Chrome trace JSON (chrome://tracing,
+// ui.perfetto.dev), so a dropout can be pinned on the stage that blew its
+// deadline without attaching a profiler.
+//
+// Each record carries a sequence number written last, so a dump that races
+// the writers skips records caught half-written instead of reporting junk.
+//
+class RenderTrace
+{
+public:
+    enum Stage : uint32_t
+    {
+        kStagePeriod,      // render: wake to handoff
+        kStageWait,        // render: parked in poll() for the device
+        kStageRingRead,    // render: ring to device block (stages, conversion)
+        kStageDeviceWrite, // render: writei / mmap commit
+        kStageHwDelay,     // render: device delay sample (counter)
+        kStageXrun,        // render: xrun recovery (instant)
+        kStageRingWrite,   // writer: one blocking ring write
+        kStageWriterPark,  // writer: parked on a full ring
+        kStageCount
+    };
+
+    static constexpr size_t kDefaultRecords = size_t(1) << 16;
+    static constexpr size_t kMaxRecords = size_t(1) << 22;
+
+    // Before any thread records. Rounded up to a power of two; 0 leaves
+    // tracing off.
+    void enable(size_t records)
+    {
+        if (records == 0)
+            return;
+        size_t cap = 1024;
+        while (cap < records && cap < kMaxRecords)
+            cap <<= 1;
+        ring.reset(new Record[cap]);
+        mask = cap - 1;
+    }
+
+    bool enabled() const { return mask != 0; }
+    size_t capacity() const { return enabled() ? mask + 1 : 0; }
+    uint64_t recorded() const { return next.load(std::memory_order_relaxed); }
+
+    // Start time for a span; 0 (and no clock read) while tracing is off.
+    uint64_t stamp() const { return enabled() ? MonotonicNowNs() : 0; }
+
+    // Any thread. arg is per stage: frames, bytes, delay frames, error code.
+    void span(Stage stage, uint64_t startNs, uint64_t endNs, int64_t arg = 0)
+    {
+        if (!enabled())
+            return;
+        uint64_t idx = next.fetch_add(1, std::memory_order_relaxed);
+        Record &r = ring[idx & mask];
+        r.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        r.startNs.store(startNs, std::memory_order_relaxed);
+        r.durNs.store(endNs > startNs ? endNs - startNs : 0, std::memory_order_relaxed);
+        r.arg.store(arg, std::memory_order_relaxed);
+        r.info.store((static_cast<uint64_t>(ThreadTag()) << 32) | stage, std::memory_order_relaxed);
+        r.seq.store(idx + 1, std::memory_order_release);
+    }
+
+    void mark(Stage stage, int64_t arg = 0)
+    {
+        if (!enabled())
+            return;
+        uint64_t now = MonotonicNowNs();
+        span(stage, now, now, arg);
+    }
+
+    // Writes the records held now as Chrome trace JSON. Returns the number of
+    // events written, or -1 if the file could not be written.
+    long long writeChromeJson(const char *path, const char *processName) const
+    {
+        std::vector<Entry> entries = snapshot();
+        std::FILE *f = std::fopen(path, "wb");
+        if (!f)
+            return -1;
+
+        std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"capacity\":%zu,\"recorded\":%llu},\"traceEvents\":[\n",
+                     capacity(), static_cast<unsigned long long>(recorded()));
+        std::fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"%s\"}}", processName);
+
+        // Name each thread after the side of the ring it was seen on
+        std::vector<uint32_t> named;
+        for (const Entry &e : entries)
+        {
+            if (std::find(named.begin(), named.end(), e.tid) != named.end())
+                continue;
+            named.push_back(e.tid);
+            std::fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+                         e.tid, e.stage >= kStageRingWrite ? "writer" : "render", e.tid);
+        }
+
+        for (const Entry &e : entries)
+        {
+            double ts = e.startNs / 1000.0;
+            if (e.stage == kStageHwDelay)
+                std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"frames\":%lld}}",
+                             StageName(e.stage), ts, e.tid, static_cast<long long>(e.arg));
+            else if (e.stage == kStageXrun)
+                std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"error\":%lld}}",
+                             StageName(e.stage), ts, e.tid, static_cast<long long>(e.arg));
+            else
+                std::fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"%s\":%lld}}",
+                             StageName(e.stage), e.stage >= kStageRingWrite ? "writer" : "render", ts, e.durNs / 1000.0, e.tid,
+                             ArgName(e.stage), static_cast<long long>(e.arg));
+        }
+        std::fprintf(f, "\n]}\n");
+        bool ok = std::ferror(f) == 0;
+        ok = std::fclose(f) == 0 && ok;
+        return ok ? static_cast<long long>(entries.size()) : -1;
+    }
+
+    static const char *StageName(uint32_t stage)
+    {
+        switch (stage)
+        {
+        case kStagePeriod:
+            return "period";
+        case kStageWait:
+            return "wait";
+        case kStageRingRead:
+            return "ringRead";
+        case kStageDeviceWrite:
+            return "deviceWrite";
+        case kStageHwDelay:
+            return "hwDelay";
+        case kStageXrun:
+            return "xrun";
+        case kStageRingWrite:
+            return "ringWrite";
+        case kStageWriterPark:
+            return "writerPark";
+        }
+        return "unknown";
+    }
+
+private:
+    struct Record
+    {
+        std::atomic<uint64_t> seq{0}; // index + 1 once complete; 0 while written
+        std::atomic<uint64_t> startNs{0};
+        std::atomic<uint64_t> durNs{0};
+        std::atomic<int64_t> arg{0};
+        std::atomic<uint64_t> info{0}; // thread tag << 32 | stage
+    };
+
+    struct Entry
+    {
+        uint64_t seq;
+        uint64_t startNs;
+        uint64_t durNs;
+        int64_t arg;
+        uint32_t tid;
+        uint32_t stage;
+    };
+
+    static const char *ArgName(uint32_t stage)
+    {
+        switch (stage)
+        {
+        case kStageRingWrite:
+        case kStageWriterPark:
+            return "bytes";
+        default:
+            return "frames";
+        }
+    }
+
+    // Small per-thread number for the trace's tid
+    static uint32_t ThreadTag()
+    {
+        static std::atomic<uint32_t> counter{0};
+        thread_local uint32_t tag = counter.fetch_add(1, std::memory_order_relaxed) + 1;
+        return tag;
+    }
+
+    // Complete records, oldest first
+    std::vector<Entry> snapshot() const
+    {
+        std::vector<Entry> out;
+        if (!enabled())
+            return out;
+        out.reserve(mask + 1);
+        for (size_t i = 0; i <= mask; ++i)
+        {
+            const Record &r = ring[i];
+            uint64_t seq = r.seq.load(std::memory_order_acquire);
+            if (seq == 0)
+                continue;
+            Entry e;
+            e.startNs = r.startNs.load(std::memory_order_relaxed);
+            e.durNs = r.durNs.load(std::memory_order_relaxed);
+            e.arg = r.arg.load(std::memory_order_relaxed);
+            uint64_t info = r.info.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (r.seq.load(std::memory_order_relaxed) != seq)
+                continue;
+            e.seq = seq;
+            e.tid = static_cast<uint32_t>(info >> 32);
+            e.stage = static_cast<uint32_t>(info & 0xffffffffu);
+            out.push_back(e);
+        }
+        std::sort(out.begin(), out.end(), [](const Entry &a, const Entry &b)
+                  { return a.seq < b.seq; });
+        return out;
+    }
+
+    std::unique_ptr<Record[]> ring;
+    size_t mask{0};
+    std::atomic<uint64_t> next{0};
+};
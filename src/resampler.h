@@ -0,0 +1,475 @@
+// src/resampler.h
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gain_stage.h"
+
+//
+// Dot-product kernels for the resampler's inner loop: sum(a[i] * b[i]) over
+// n floats, n a multiple of 8.
+//
+namespace resample
+{
+    static inline float DotScalar(const float *a, const float *b, size_t n)
+    {
+        float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+        for (size_t i = 0; i < n; i += 4)
+        {
+            s0 += a[i] * b[i];
+            s1 += a[i + 1] * b[i + 1];
+            s2 += a[i + 2] * b[i + 2];
+            s3 += a[i + 3] * b[i + 3];
+        }
+        return (s0 + s1) + (s2 + s3);
+    }
+
+#if defined(GAIN_X86)
+    static inline float DotSse(const float *a, const float *b, size_t n)
+    {
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (size_t i = 0; i < n; i += 8)
+        {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        __m128 acc = _mm_add_ps(acc0, acc1);
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        return _mm_cvtss_f32(acc);
+    }
+
+    static inline bool CpuHasFma()
+    {
+#if defined(_MSC_VER)
+        int r[4];
+        __cpuid(r, 1);
+        return (r[2] & (1 << 12)) != 0;
+#else
+        return __builtin_cpu_supports("fma");
+#endif
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RESAMPLE_TARGET_FMA __attribute__((target("avx2,fma")))
+#else
+#define RESAMPLE_TARGET_FMA
+#endif
+
+    RESAMPLE_TARGET_FMA static inline float DotAvx2(const float *a, const float *b, size_t n)
+    {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        }
+        if (i < n)
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        __m256 acc = _mm256_add_ps(acc0, acc1);
+        __m128 v = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+        return _mm_cvtss_f32(v);
+    }
+#endif
+
+#if defined(GAIN_NEON)
+    static inline float DotNeon(const float *a, const float *b, size_t n)
+    {
+        float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+        for (size_t i = 0; i < n; i += 8)
+        {
+            acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+            acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+        return vaddvq_f32(vaddq_f32(acc0, acc1));
+    }
+#endif
+
+    using DotFn = float (*)(const float *, const float *, size_t);
+
+    struct Dot
+    {
+        DotFn fn;
+        const char *name;
+    };
+
+    // Best kernel for this CPU, resolved once.
+    static inline Dot Best()
+    {
+        static const Dot dot = []
+        {
+#if defined(GAIN_X86)
+            if (gain::CpuHasAvx2() && CpuHasFma())
+                return Dot{DotAvx2, "avx2"};
+            return Dot{DotSse, "sse"};
+#elif defined(GAIN_NEON)
+            return Dot{DotNeon, "neon"};
+#else
+            return Dot{DotScalar, "scalar"};
+#endif
+        }();
+        return dot;
+    }
+
+    enum class Quality
+    {
+        Fast,
+        Good,
+        High,
+        Mastering
+    };
+
+    // Taps per phase at unity ratio, Kaiser beta and sinc cutoff (fraction
+    // of the lower Nyquist). Each cutoff sits half a transition band below
+    // Nyquist, so the stopband starts right at it.
+    struct Tier
+    {
+        const char *name;
+        unsigned taps;
+        double beta;
+        double cutoff;
+    };
+
+    static inline Tier TierFor(Quality q)
+    {
+        switch (q)
+        {
+        case Quality::Fast:
+            return {"fast", 16, 5.0, 0.78};
+        case Quality::High:
+            return {"high", 64, 10.0, 0.90};
+        case Quality::Mastering:
+            return {"mastering", 256, 14.0, 0.96};
+        case Quality::Good:
+        default:
+            return {"good", 32, 8.0, 0.84};
+        }
+    }
+
+    static inline bool ParseQuality(const std::string &name, Quality &out)
+    {
+        static const std::pair<const char *, Quality> names[] = {
+            {"fast", Quality::Fast},
+            {"good", Quality::Good},
+            {"high", Quality::High},
+            {"mastering", Quality::Mastering},
+        };
+        for (const auto &n : names)
+        {
+            if (name == n.first)
+            {
+                out = n.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Modified Bessel function of the first kind, order 0 (Kaiser window)
+    static inline double BesselI0(double x)
+    {
+        double sum = 1.0, term = 1.0, q = x * x / 4.0;
+        for (int k = 1; k < 64; ++k)
+        {
+            term *= q / (static_cast<double>(k) * k);
+            sum += term;
+            if (term < sum * 1e-17)
+                break;
+        }
+        return sum;
+    }
+
+    // out/in as up/down with up <= maxUp: exact when it fits, otherwise the
+    // closest continued-fraction convergent (a pitch error of a few ppm).
+    static inline void RationalRatio(uint32_t inRate, uint32_t outRate, uint32_t maxUp, uint32_t &up, uint32_t &down)
+    {
+        uint32_t a = outRate, b = inRate;
+        while (b)
+        {
+            uint32_t t = a % b;
+            a = b;
+            b = t;
+        }
+        up = outRate / a;
+        down = inRate / a;
+        if (up <= maxUp)
+            return;
+
+        // Convergents h/k of outRate/inRate
+        uint64_t h0 = 0, h1 = 1, k0 = 1, k1 = 0;
+        uint64_t num = outRate, den = inRate;
+        while (den)
+        {
+            uint64_t q = num / den;
+            uint64_t h2 = q * h1 + h0, k2 = q * k1 + k0;
+            if (h2 > maxUp)
+                break;
+            h0 = h1;
+            h1 = h2;
+            k0 = k1;
+            k1 = k2;
+            uint64_t r = num % den;
+            num = den;
+            den = r;
+        }
+        up = static_cast<uint32_t>(std::max<uint64_t>(h1, 1));
+        down = static_cast<uint32_t>(std::max<uint64_t>(k1, 1));
+    }
+} // namespace resample
+
+//
+// Band-limited polyphase sinc resampler for interleaved audio.
+//
+// The ratio is reduced to up/down (at most kMaxPhases phases) and output
+// frame k is the dot product of one Kaiser-windowed sinc phase with the
+// input around k * down / up. The filter is centred, so output and input
+// start at the same instant and there is no delay to compensate; flush()
+// lets the tail out and the output ends at ceil(inputFrames * up / down).
+//
+// Input is kept planar in float; phases are padded to a multiple of 8 taps
+// so the SIMD kernels need no tail handling. When downsampling the taps
+// grow with the ratio to keep the transition band the same width in Hz.
+//
+// Not thread-safe; owned by one producer (the decoder thread).
+//
+class Resampler
+{
+public:
+    using Quality = resample::Quality;
+    static constexpr uint32_t kMaxPhases = 4096;
+    // Planes write() and flush() fill; configure() refuses more channels
+    static constexpr unsigned kMaxChannels = 32;
+
+    bool configure(uint32_t inputRate, uint32_t outputRate, unsigned channelCount, Quality q)
+    {
+        if (inputRate == 0 || outputRate == 0 || channelCount == 0 || channelCount > kMaxChannels)
+            return false;
+
+        inRate = inputRate;
+        outRate = outputRate;
+        channels = channelCount;
+        quality = q;
+        resample::RationalRatio(inRate, outRate, kMaxPhases, up, down);
+
+        const resample::Tier tier = resample::TierFor(q);
+        const double scale = std::min(1.0, static_cast<double>(up) / down);
+        const double cutoff = tier.cutoff * scale;
+        taps = static_cast<unsigned>(std::ceil(tier.taps / scale));
+        taps = (taps + 7) & ~7u;
+        half = taps / 2;
+
+        // coef[p][j] weights input (base - half + 1 + j) for output phase p
+        coefs.assign(static_cast<size_t>(up) * taps, 0.0f);
+        const double i0Beta = resample::BesselI0(tier.beta);
+        const double pi = 3.14159265358979323846;
+        for (uint32_t p = 0; p < up; ++p)
+        {
+            double sum = 0.0;
+            std::vector<double> row(taps);
+            for (unsigned j = 0; j < taps; ++j)
+            {
+                double t = static_cast<double>(p) / up + (half - 1.0) - j;
+                double x = t / half;
+                double w = std::fabs(x) >= 1.0 ? 0.0 : resample::BesselI0(tier.beta * std::sqrt(1.0 - x * x)) / i0Beta;
+                double arg = pi * cutoff * t;
+                double sinc = t == 0.0 ? 1.0 : std::sin(arg) / arg;
+                row[j] = cutoff * sinc * w;
+                sum += row[j];
+            }
+            // Unity DC gain on every phase
+            for (unsigned j = 0; j < taps; ++j)
+                coefs[static_cast<size_t>(p) * taps + j] = static_cast<float>(row[j] / sum);
+        }
+
+        dot = resample::Best().fn;
+        reset();
+        return true;
+    }
+
+    // Drops all buffered input and starts over at output frame 0.
+    void reset()
+    {
+        history.assign(channels, std::vector<float>());
+        for (auto &h : history)
+            h.assign(half - 1, 0.0f);
+        histStart = -static_cast<int64_t>(half - 1);
+        histLen = half - 1;
+        nextOut = 0;
+        inputTotal = 0;
+        flushed = false;
+    }
+
+    bool active() const { return inRate != outRate; }
+    uint32_t inputRate() const { return inRate; }
+    uint32_t outputRate() const { return outRate; }
+    unsigned tapsPerPhase() const { return taps; }
+    uint32_t phases() const { return up; }
+    uint32_t decimation() const { return down; }
+    const float *coefficients() const { return coefs.data(); }
+    const char *qualityName() const { return resample::TierFor(quality).name; }
+
+    // Overrides the CPU-selected dot-product kernel (benchmarks).
+    void setKernel(resample::DotFn fn) { dot = fn; }
+
+    // Output frames `inputFrames` input frames turn into.
+    uint64_t outputFramesFor(uint64_t inputFrames) const
+    {
+        return (inputFrames * up + down - 1) / down;
+    }
+
+    // Appends interleaved left-justified int32 input (FileDecoder samples).
+    void write(const int32_t *in, size_t frames)
+    {
+        float *dst[kMaxChannels];
+        prepareWrite(frames, dst);
+        const float scale = 1.0f / 2147483648.0f;
+        for (size_t f = 0; f < frames; ++f)
+        {
+            for (unsigned c = 0; c < channels; ++c)
+                dst[c][f] = static_cast<float>(in[f * channels + c]) * scale;
+        }
+        commitWrite(frames);
+    }
+
+    // Appends interleaved float input.
+    void write(const float *in, size_t frames)
+    {
+        float *dst[kMaxChannels];
+        prepareWrite(frames, dst);
+        for (size_t f = 0; f < frames; ++f)
+        {
+            for (unsigned c = 0; c < channels; ++c)
+                dst[c][f] = in[f * channels + c];
+        }
+        commitWrite(frames);
+    }
+
+    // No more input: pads with silence so the last frames come out.
+    void flush()
+    {
+        if (flushed)
+            return;
+        float *dst[kMaxChannels];
+        prepareWrite(half + 8, dst);
+        for (unsigned c = 0; c < channels; ++c)
+            std::fill(dst[c], dst[c] + half + 8, 0.0f);
+        histLen += half + 8;
+        flushed = true;
+    }
+
+    // True once flushed and every output frame has been read.
+    bool drained() const { return flushed && nextOut >= outputFramesFor(inputTotal); }
+
+    // Output frames ready without more input.
+    size_t available() const
+    {
+        // Frame k needs input up to base(k) + half, i.e. k * down < (end - half) * up
+        int64_t end = histStart + static_cast<int64_t>(histLen);
+        int64_t limit = end - static_cast<int64_t>(half);
+        if (limit <= 0)
+            return 0;
+        uint64_t ready = (static_cast<uint64_t>(limit) * up + down - 1) / down;
+        if (flushed)
+            ready = std::min(ready, outputFramesFor(inputTotal));
+        return ready > nextOut ? static_cast<size_t>(ready - nextOut) : 0;
+    }
+
+    // Writes up to maxFrames interleaved float frames; returns how many.
+    size_t read(float *out, size_t maxFrames)
+    {
+        size_t n = std::min(maxFrames, available());
+        if (n == 0)
+            return 0;
+
+        render(nextOut, n, out);
+        nextOut += n;
+        discardConsumed();
+        return n;
+    }
+
+private:
+    void render(uint64_t k, size_t frames, float *out) const
+    {
+        uint64_t t = k * down;
+        uint64_t base = t / up;
+        uint32_t phase = static_cast<uint32_t>(t % up);
+        const uint32_t stepBase = down / up, stepPhase = down % up;
+        for (size_t f = 0; f < frames; ++f)
+        {
+            const float *c = coefs.data() + static_cast<size_t>(phase) * taps;
+            size_t offset = static_cast<size_t>(static_cast<int64_t>(base) - half + 1 - histStart);
+            for (unsigned ch = 0; ch < channels; ++ch)
+                out[f * channels + ch] = dot(c, history[ch].data() + offset, taps);
+            base += stepBase;
+            phase += stepPhase;
+            if (phase >= up)
+            {
+                phase -= up;
+                ++base;
+            }
+        }
+    }
+
+    void prepareWrite(size_t frames, float **dst)
+    {
+        for (unsigned c = 0; c < channels; ++c)
+        {
+            // Room for `taps` samples past the end too: padded phases read
+            // that far and must see zeros, not garbage
+            history[c].resize(histLen + frames + taps, 0.0f);
+            dst[c] = history[c].data() + histLen;
+        }
+    }
+
+    void commitWrite(size_t frames)
+    {
+        histLen += frames;
+        inputTotal += frames;
+        for (auto &h : history)
+            std::fill(h.begin() + histLen, h.end(), 0.0f);
+    }
+
+    // Drops input no future output frame reaches back to.
+    void discardConsumed()
+    {
+        int64_t keepFrom = static_cast<int64_t>(nextOut * down / up) - static_cast<int64_t>(half) + 1;
+        int64_t drop = keepFrom - histStart;
+        if (drop < 4096 || static_cast<size_t>(drop) > histLen)
+            return;
+        for (auto &h : history)
+        {
+            std::memmove(h.data(), h.data() + drop, (histLen - drop) * sizeof(float));
+            h.resize(histLen - drop + taps);
+            std::fill(h.begin() + (histLen - drop), h.end(), 0.0f);
+        }
+        histStart += drop;
+        histLen -= static_cast<size_t>(drop);
+    }
+
+    uint32_t inRate{0}, outRate{0};
+    unsigned channels{0};
+    Quality quality{Quality::Good};
+    uint32_t up{1}, down{1};
+    unsigned taps{8}, half{4};
+    std::vector<float> coefs;
+    resample::DotFn dot{resample::DotScalar};
+
+    // Planar input; history[c][0] is input frame histStart (negative at
+    // first: the zeros the centred filter reaches back into)
+    std::vector<std::vector<float>> history;
+    int64_t histStart{0};
+    size_t histLen{0};
+    uint64_t nextOut{0};
+    uint64_t inputTotal{0};
+    bool flushed{false};
+};
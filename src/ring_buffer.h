@@ -0,0 +1,235 @@
+// src/ring_buffer.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Single-Producer Single-Consumer lock-free ring buffer.
+// Writer: JS / Node thread (producer). Reader: audio render thread (consumer).
+//
+// - Storage is rounded up to a power of two so positions wrap with a mask,
+//   but the fill level is capped at the size asked for (limit), so a ring
+//   sized for 250 ms of whole frames holds 250 ms, not up to twice that.
+// - Positions are free-running counters; (write - read) is the fill level, so
+//   the whole capacity is usable and no slot is wasted to tell full from empty.
+// - Producer and consumer state live on separate cache lines. Each side keeps
+//   a cached copy of the other side's index and only re-loads the shared
+//   atomic when the cached value says there is not enough room/data.
+// - peekWrite/commitWrite and peekRead/commitRead expose the (up to two)
+//   contiguous regions directly, so the render thread can convert straight
+//   out of the ring without a bounce buffer.
+// - Storage and the two indices can be owned (init) or borrowed (attach), so
+//   the ring can sit inside memory shared with another runtime, e.g. a JS
+//   SharedArrayBuffer driven with Atomics. Indices are 32-bit for that reason;
+//   capacity is limited to 2^31 bytes.
+struct RingBuffer
+{
+    static constexpr size_t kCacheLine = 64;
+
+    using Index = std::atomic<uint32_t>;
+    static_assert(sizeof(Index) == sizeof(uint32_t), "ring indices must be plain 32-bit words");
+    static_assert(Index::is_always_lock_free, "ring indices must be lock-free");
+
+    // A window into the ring: [first, first + firstLen) followed by
+    // [second, second + secondLen) once the window wraps.
+    struct Region
+    {
+        uint8_t *first{nullptr};
+        size_t firstLen{0};
+        uint8_t *second{nullptr};
+        size_t secondLen{0};
+
+        size_t size() const { return firstLen + secondLen; }
+    };
+
+    // Shared, read-mostly after init()/attach()
+    uint8_t *data{nullptr};
+    size_t capacity{0}; // storage bytes, a power of two
+    size_t limit{0};    // most bytes the ring holds at once, <= capacity
+    uint32_t mask{0};
+    Index *writePos{&ownWritePos}; // tail (producer)
+    Index *readPos{&ownReadPos};   // head (consumer)
+    std::vector<uint8_t> storage;
+
+    // Producer line
+    alignas(kCacheLine) Index ownWritePos{0};
+    uint32_t cachedReadPos{0}; // producer's view of readPos
+
+    // Consumer line
+    alignas(kCacheLine) Index ownReadPos{0};
+    uint32_t cachedWritePos{0}; // consumer's view of writePos
+
+    RingBuffer() = default;
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    static size_t RoundUpPow2(size_t v)
+    {
+        size_t p = 64;
+        while (p < v)
+            p <<= 1;
+        return p;
+    }
+
+    // Not thread-safe: call before the producer/consumer threads start.
+    void init(size_t size)
+    {
+        capacity = RoundUpPow2(size);
+        limit = size ? size : capacity;
+        mask = static_cast<uint32_t>(capacity - 1);
+        storage.assign(capacity, 0);
+        data = storage.data();
+        writePos = &ownWritePos;
+        readPos = &ownReadPos;
+        reset();
+    }
+
+    // Borrows external storage and index words (capacity must be a power of
+    // two, fillLimit at most capacity). The memory must outlive every reader
+    // and writer of the ring.
+    // Not thread-safe: the consumer must not be touching the ring.
+    void attach(uint8_t *mem, size_t cap, size_t fillLimit, Index *readIdx, Index *writeIdx)
+    {
+        capacity = cap;
+        limit = fillLimit;
+        mask = static_cast<uint32_t>(capacity - 1);
+        data = mem;
+        readPos = readIdx;
+        writePos = writeIdx;
+        std::vector<uint8_t>().swap(storage);
+        reset();
+    }
+
+    // Usable size (what init() was asked for); see capacity for the storage.
+    size_t size() const { return limit; }
+
+    // Number of bytes available to read. Safe from any thread (stats).
+    size_t availableToRead() const
+    {
+        uint32_t r = readPos->load(std::memory_order_acquire);
+        uint32_t w = writePos->load(std::memory_order_acquire);
+        return static_cast<uint32_t>(w - r);
+    }
+
+    // Number of bytes available to write. Safe from any thread (stats).
+    size_t availableToWrite() const
+    {
+        return freeBytes(availableToRead());
+    }
+
+    //
+    // Producer side
+    //
+
+    // Returns up to maxLen bytes of writable space without publishing it.
+    Region peekWrite(size_t maxLen)
+    {
+        uint32_t w = writePos->load(std::memory_order_relaxed);
+        size_t avail = freeBytes(static_cast<uint32_t>(w - cachedReadPos));
+        if (avail < maxLen)
+        {
+            cachedReadPos = readPos->load(std::memory_order_acquire);
+            avail = freeBytes(static_cast<uint32_t>(w - cachedReadPos));
+        }
+        return makeRegion(w, std::min(avail, maxLen));
+    }
+
+    // Publishes len bytes previously filled through peekWrite().
+    void commitWrite(size_t len)
+    {
+        uint32_t w = writePos->load(std::memory_order_relaxed);
+        writePos->store(w + static_cast<uint32_t>(len), std::memory_order_release);
+    }
+
+    // Producer writes up to len bytes. Returns actual written.
+    size_t write(const uint8_t *src, size_t len)
+    {
+        if (!src || len == 0)
+            return 0;
+
+        Region reg = peekWrite(len);
+        if (reg.size() == 0)
+            return 0;
+
+        std::memcpy(reg.first, src, reg.firstLen);
+        if (reg.secondLen)
+            std::memcpy(reg.second, src + reg.firstLen, reg.secondLen);
+
+        commitWrite(reg.size());
+        return reg.size();
+    }
+
+    //
+    // Consumer side
+    //
+
+    // Returns up to maxLen readable bytes without releasing them.
+    Region peekRead(size_t maxLen)
+    {
+        uint32_t r = readPos->load(std::memory_order_relaxed);
+        size_t avail = static_cast<uint32_t>(cachedWritePos - r);
+        if (avail < maxLen)
+        {
+            cachedWritePos = writePos->load(std::memory_order_acquire);
+            avail = static_cast<uint32_t>(cachedWritePos - r);
+        }
+        return makeRegion(r, std::min(avail, maxLen));
+    }
+
+    // Releases len bytes previously consumed through peekRead().
+    void commitRead(size_t len)
+    {
+        uint32_t r = readPos->load(std::memory_order_relaxed);
+        readPos->store(r + static_cast<uint32_t>(len), std::memory_order_release);
+    }
+
+    // Consumer reads up to len bytes. Returns actual read.
+    size_t read(uint8_t *dst, size_t len)
+    {
+        if (!dst || len == 0)
+            return 0;
+
+        Region reg = peekRead(len);
+        if (reg.size() == 0)
+            return 0;
+
+        std::memcpy(dst, reg.first, reg.firstLen);
+        if (reg.secondLen)
+            std::memcpy(dst + reg.firstLen, reg.second, reg.secondLen);
+
+        commitRead(reg.size());
+        return reg.size();
+    }
+
+private:
+    // A shared-memory producer that ignores the limit may fill past it
+    size_t freeBytes(size_t fill) const { return fill < limit ? limit - fill : 0; }
+
+    void reset()
+    {
+        readPos->store(0);
+        writePos->store(0);
+        cachedReadPos = 0;
+        cachedWritePos = 0;
+    }
+
+    Region makeRegion(uint32_t pos, size_t len)
+    {
+        Region reg;
+        if (len == 0)
+            return reg;
+        size_t off = pos & mask;
+        reg.first = &data[off];
+        reg.firstLen = std::min(len, capacity - off);
+        if (len > reg.firstLen)
+        {
+            reg.second = &data[0];
+            reg.secondLen = len - reg.firstLen;
+        }
+        return reg;
+    }
+};
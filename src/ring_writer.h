@@ -0,0 +1,74 @@
+// src/ring_writer.h
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "render_trace.h"
+#include "ring_buffer.h"
+#include "writer_wakeup.h"
+
+//
+// Producer side of a stream's ring: copies as much as fits and, while the
+// ring is full, parks on the writer wakeup until the render thread has freed
+// enough space (or the timeout passes, or the stream stops). Free of N-API so
+// the writer path can be benchmarked on its own (bench/kernel_bench.cc).
+//
+// One writer at a time; the caller serializes (writerMutex).
+//
+struct RingWriter
+{
+    RingBuffer &ring;
+    WriterWakeup &wake;
+    std::atomic<uint64_t> &parks;
+    std::atomic<uint64_t> &spuriousWakeups;
+    RenderTrace &trace;
+
+    // live() is checked before every attempt and around every park; the
+    // write stops as soon as it turns false. timeoutMs 0: write what fits.
+    template <typename Live>
+    size_t write(const uint8_t *src, size_t len, uint32_t timeoutMs, Live &&live) const
+    {
+        const uint64_t traceStart = trace.stamp();
+        size_t totalWritten = 0;
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(timeoutMs);
+
+        while (totalWritten < len && live())
+        {
+            totalWritten += ring.write(src + totalWritten, len - totalWritten);
+
+            if (totalWritten == len || timeoutMs == 0)
+            {
+                // Done, or non-blocking: write whatever fits and exit
+                break;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                break;
+
+            // Ring is full: park until the render thread has freed enough space
+            uint32_t seen = wake.prepareWait();
+            if (ring.availableToWrite() > 0 || !live())
+            {
+                wake.cancelWait();
+                continue;
+            }
+
+            parks.fetch_add(1, std::memory_order_relaxed);
+            uint32_t waitMs = static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count());
+            uint64_t parkStart = trace.stamp();
+            bool woken = wake.wait(seen, waitMs > 0 ? waitMs : 1);
+            trace.span(RenderTrace::kStageWriterPark, parkStart, trace.stamp(), static_cast<int64_t>(len - totalWritten));
+            if (woken && ring.availableToWrite() == 0 && live())
+                spuriousWakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        trace.span(RenderTrace::kStageRingWrite, traceStart, trace.stamp(), static_cast<int64_t>(totalWritten));
+        return totalWritten;
+    }
+};
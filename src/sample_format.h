@@ -0,0 +1,331 @@
+// src/sample_format.h
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Sample encodings of a stream's ring and of its device.
+// S24 is packed little-endian 3-byte; S24In32 is 24-bit in the low bytes of a
+// 4-byte container (ALSA S24_LE), device side only; everything else is
+// native width.
+enum class SampleFormat
+{
+    S16,
+    S24,
+    S32,
+    F32,
+    S24In32
+};
+
+static inline unsigned SampleFormatBytes(SampleFormat f)
+{
+    switch (f)
+    {
+    case SampleFormat::S16:
+        return 2;
+    case SampleFormat::S24:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+static inline SampleFormat SampleFormatFor(unsigned bitDepth, bool isFloat)
+{
+    switch (bitDepth)
+    {
+    case 24:
+        return SampleFormat::S24;
+    case 32:
+        return isFloat ? SampleFormat::F32 : SampleFormat::S32;
+    default:
+        return SampleFormat::S16;
+    }
+}
+
+// Packs left-justified int32 samples (see FileDecoder) into `f`.
+// Narrowing truncates; the decoders never produce more bits than the device
+// asked for in the common case of matching bit depths.
+static inline void PackFromS32(const int32_t *in, uint8_t *out, size_t samples, SampleFormat f)
+{
+    switch (f)
+    {
+    case SampleFormat::S16:
+    {
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int16_t v = static_cast<int16_t>(in[i] >> 16);
+            std::memcpy(out + i * 2, &v, 2);
+        }
+        break;
+    }
+    case SampleFormat::S24:
+    {
+        for (size_t i = 0; i < samples; ++i)
+        {
+            uint32_t v = static_cast<uint32_t>(in[i]) >> 8;
+            out[i * 3 + 0] = static_cast<uint8_t>(v);
+            out[i * 3 + 1] = static_cast<uint8_t>(v >> 8);
+            out[i * 3 + 2] = static_cast<uint8_t>(v >> 16);
+        }
+        break;
+    }
+    case SampleFormat::S24In32:
+    {
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v = in[i] >> 8;
+            std::memcpy(out + i * 4, &v, 4);
+        }
+        break;
+    }
+    case SampleFormat::S32:
+        std::memcpy(out, in, samples * 4);
+        break;
+    case SampleFormat::F32:
+    {
+        const float scale = 1.0f / 2147483648.0f;
+        for (size_t i = 0; i < samples; ++i)
+        {
+            float v = static_cast<float>(in[i]) * scale;
+            std::memcpy(out + i * 4, &v, 4);
+        }
+        break;
+    }
+    }
+}
+
+// Unpacks `samples` samples of `f` to doubles in [-1, 1).
+static inline void UnpackToDouble(const uint8_t *in, double *out, size_t samples, SampleFormat f)
+{
+    switch (f)
+    {
+    case SampleFormat::S16:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int16_t v;
+            std::memcpy(&v, in + i * 2, 2);
+            out[i] = v * (1.0 / 32768.0);
+        }
+        break;
+    case SampleFormat::S24:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            const uint8_t *p = in + i * 3;
+            int32_t v = static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24));
+            out[i] = v * (1.0 / 2147483648.0);
+        }
+        break;
+    case SampleFormat::S24In32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v;
+            std::memcpy(&v, in + i * 4, 4);
+            out[i] = static_cast<int32_t>(static_cast<uint32_t>(v) << 8) * (1.0 / 2147483648.0);
+        }
+        break;
+    case SampleFormat::S32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v;
+            std::memcpy(&v, in + i * 4, 4);
+            out[i] = v * (1.0 / 2147483648.0);
+        }
+        break;
+    case SampleFormat::F32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            float v;
+            std::memcpy(&v, in + i * 4, 4);
+            out[i] = v;
+        }
+        break;
+    }
+}
+
+// Packs doubles back into `f`, rounding and saturating integer formats.
+static inline void PackFromDouble(const double *in, uint8_t *out, size_t samples, SampleFormat f)
+{
+    auto clamp = [](double v, double lo, double hi)
+    { return v < lo ? lo : (v > hi ? hi : v); };
+
+    switch (f)
+    {
+    case SampleFormat::S16:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int16_t v = static_cast<int16_t>(std::lrint(clamp(in[i] * 32768.0, -32768.0, 32767.0)));
+            std::memcpy(out + i * 2, &v, 2);
+        }
+        break;
+    case SampleFormat::S24:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v = static_cast<int32_t>(std::lrint(clamp(in[i] * 8388608.0, -8388608.0, 8388607.0)));
+            uint32_t u = static_cast<uint32_t>(v);
+            out[i * 3 + 0] = static_cast<uint8_t>(u);
+            out[i * 3 + 1] = static_cast<uint8_t>(u >> 8);
+            out[i * 3 + 2] = static_cast<uint8_t>(u >> 16);
+        }
+        break;
+    case SampleFormat::S24In32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v = static_cast<int32_t>(std::lrint(clamp(in[i] * 8388608.0, -8388608.0, 8388607.0)));
+            std::memcpy(out + i * 4, &v, 4);
+        }
+        break;
+    case SampleFormat::S32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v = static_cast<int32_t>(std::llrint(clamp(in[i] * 2147483648.0, -2147483648.0, 2147483647.0)));
+            std::memcpy(out + i * 4, &v, 4);
+        }
+        break;
+    case SampleFormat::F32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            float v = static_cast<float>(clamp(in[i], -1.0, 1.0));
+            std::memcpy(out + i * 4, &v, 4);
+        }
+        break;
+    }
+}
+
+// Float counterparts of UnpackToDouble / PackFromDouble, for stages that
+// don't need double precision.
+static inline void UnpackToFloat(const uint8_t *in, float *out, size_t samples, SampleFormat f)
+{
+    switch (f)
+    {
+    case SampleFormat::S16:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int16_t v;
+            std::memcpy(&v, in + i * 2, 2);
+            out[i] = v * (1.0f / 32768.0f);
+        }
+        break;
+    case SampleFormat::S24:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            const uint8_t *p = in + i * 3;
+            int32_t v = static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24));
+            out[i] = static_cast<float>(v) * (1.0f / 2147483648.0f);
+        }
+        break;
+    case SampleFormat::S24In32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v;
+            std::memcpy(&v, in + i * 4, 4);
+            out[i] = static_cast<float>(static_cast<int32_t>(static_cast<uint32_t>(v) << 8)) * (1.0f / 2147483648.0f);
+        }
+        break;
+    case SampleFormat::S32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v;
+            std::memcpy(&v, in + i * 4, 4);
+            out[i] = static_cast<float>(v) * (1.0f / 2147483648.0f);
+        }
+        break;
+    case SampleFormat::F32:
+        std::memcpy(out, in, samples * 4);
+        break;
+    }
+}
+
+static inline void PackFromFloat(const float *in, uint8_t *out, size_t samples, SampleFormat f)
+{
+    auto clamp = [](float v, float lo, float hi)
+    { return v < lo ? lo : (v > hi ? hi : v); };
+
+    switch (f)
+    {
+    case SampleFormat::S16:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int16_t v = static_cast<int16_t>(std::lrint(clamp(in[i] * 32768.0f, -32768.0f, 32767.0f)));
+            std::memcpy(out + i * 2, &v, 2);
+        }
+        break;
+    case SampleFormat::S24:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v = static_cast<int32_t>(std::lrint(clamp(in[i] * 8388608.0f, -8388608.0f, 8388607.0f)));
+            uint32_t u = static_cast<uint32_t>(v);
+            out[i * 3 + 0] = static_cast<uint8_t>(u);
+            out[i * 3 + 1] = static_cast<uint8_t>(u >> 8);
+            out[i * 3 + 2] = static_cast<uint8_t>(u >> 16);
+        }
+        break;
+    case SampleFormat::S24In32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int32_t v = static_cast<int32_t>(std::lrint(clamp(in[i] * 8388608.0f, -8388608.0f, 8388607.0f)));
+            std::memcpy(out + i * 4, &v, 4);
+        }
+        break;
+    case SampleFormat::S32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            // 2^31 is not representable as int32; clamp in double
+            double d = static_cast<double>(in[i]) * 2147483648.0;
+            d = d < -2147483648.0 ? -2147483648.0 : (d > 2147483647.0 ? 2147483647.0 : d);
+            int32_t v = static_cast<int32_t>(std::llrint(d));
+            std::memcpy(out + i * 4, &v, 4);
+        }
+        break;
+    case SampleFormat::F32:
+        std::memcpy(out, in, samples * 4);
+        break;
+    }
+}
+
+// Unpacks `f` to left-justified int32 samples, the inverse of PackFromS32.
+// F32 is rounded and saturated.
+static inline void UnpackToS32(const uint8_t *in, int32_t *out, size_t samples, SampleFormat f)
+{
+    switch (f)
+    {
+    case SampleFormat::S16:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            int16_t v;
+            std::memcpy(&v, in + i * 2, 2);
+            out[i] = static_cast<int32_t>(static_cast<uint32_t>(static_cast<int32_t>(v)) << 16);
+        }
+        break;
+    case SampleFormat::S24:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            const uint8_t *p = in + i * 3;
+            out[i] = static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24));
+        }
+        break;
+    case SampleFormat::S24In32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            uint32_t v;
+            std::memcpy(&v, in + i * 4, 4);
+            out[i] = static_cast<int32_t>(v << 8);
+        }
+        break;
+    case SampleFormat::S32:
+        std::memcpy(out, in, samples * 4);
+        break;
+    case SampleFormat::F32:
+        for (size_t i = 0; i < samples; ++i)
+        {
+            float v;
+            std::memcpy(&v, in + i * 4, 4);
+            double d = static_cast<double>(v) * 2147483648.0;
+            d = d < -2147483648.0 ? -2147483648.0 : (d > 2147483647.0 ? 2147483647.0 : d);
+            out[i] = static_cast<int32_t>(std::llrint(d));
+        }
+        break;
+    }
+}
@@ -0,0 +1,123 @@
+// src/segment_markers.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "playback_clock.h"
+
+//
+// Track-boundary markers laid over a stream's ring.
+//
+// A producer records a marker at the ring's write position just before the
+// first byte of a new segment (track). The render thread, after each ring
+// read, checks whether it has consumed past the oldest pending marker and, if
+// so, stamps it with the stream frame it started at (same frame domain as
+// PlaybackClock) and a MonotonicNowNs() timestamp. The JS thread then
+// collects crossed markers with take().
+//
+// Three single-writer indices, one per party, keep this lock-free:
+//
+//     reported <= crossed <= tail
+//     [reported, crossed)  crossed, waiting for take()     (JS thread)
+//     [crossed, tail)      pending, waiting for the render thread
+//     tail                 next slot for push()            (producer)
+//
+// Producers must be serialized with each other and with their own ring
+// writes, so the recorded position lines up with the data.
+//
+class SegmentMarkers
+{
+public:
+    static constexpr uint32_t kCapacity = 64;
+
+    struct Crossing
+    {
+        uint32_t id{0};
+        uint64_t frame{0};
+        uint64_t timestampNs{0};
+    };
+
+    // Producer: the next byte written at ringWritePos starts segment `id`.
+    // Returns false if too many markers are outstanding.
+    bool push(uint32_t id, uint32_t ringWritePos)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - reported.load(std::memory_order_acquire) >= kCapacity)
+            return false;
+        Slot &slot = slots[t % kCapacity];
+        slot.id = id;
+        slot.ringPos = ringWritePos;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Render thread: `bytes` were just read, leaving the ring's read position
+    // at ringReadPos. Cheap when nothing is pending.
+    void onConsumed(uint32_t ringReadPos, size_t bytes, size_t bytesPerFrame)
+    {
+        uint64_t before = consumedBytes;
+        consumedBytes += bytes;
+
+        uint32_t c = crossed.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if (c == t || bytes == 0)
+            return;
+
+        uint32_t blockStart = ringReadPos - static_cast<uint32_t>(bytes);
+        uint64_t nowNs = 0;
+        while (c != t)
+        {
+            Slot &slot = slots[c % kCapacity];
+            // Crossed once the segment's first byte has been read
+            if (static_cast<int32_t>(ringReadPos - slot.ringPos) <= 0)
+                break;
+            uint32_t into = slot.ringPos - blockStart;
+            if (static_cast<int32_t>(into) < 0)
+                into = 0;
+            if (nowNs == 0)
+                nowNs = MonotonicNowNs();
+            slot.frame = (before + into) / bytesPerFrame;
+            slot.timestampNs = nowNs;
+            ++c;
+        }
+        crossed.store(c, std::memory_order_release);
+    }
+
+    // JS thread: copies up to max crossed markers into out, oldest first.
+    size_t take(Crossing *out, size_t max)
+    {
+        uint32_t r = reported.load(std::memory_order_relaxed);
+        uint32_t c = crossed.load(std::memory_order_acquire);
+        size_t n = 0;
+        while (r != c && n < max)
+        {
+            const Slot &slot = slots[r % kCapacity];
+            out[n].id = slot.id;
+            out[n].frame = slot.frame;
+            out[n].timestampNs = slot.timestampNs;
+            ++n;
+            ++r;
+        }
+        reported.store(r, std::memory_order_release);
+        return n;
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t id{0};
+        uint32_t ringPos{0};
+        uint64_t frame{0};
+        uint64_t timestampNs{0};
+    };
+
+    Slot slots[kCapacity];
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> crossed{0};
+    std::atomic<uint32_t> reported{0};
+
+    // Render thread: bytes read from the ring since open
+    uint64_t consumedBytes{0};
+};
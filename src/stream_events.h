@@ -0,0 +1,132 @@
+// src/stream_events.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//
+// Playback events pushed from the render thread (and the backend's own
+// callbacks) to JS, in place of polling getStats():
+//
+//   low-watermark   the ring fell below the subscriber's threshold while
+//                   input is still expected; re-armed once it refills
+//   underrun        the ring ran dry mid-playback (once per episode)
+//   played-out      input has ended and its last frame reached the DAC
+//   device-lost     the backend stopped on an error it can't recover from
+//   format-changed  the device or graph now runs at another rate
+//   position        audible position, every positionIntervalMs of playback
+//
+enum class StreamEventType : uint8_t
+{
+    LowWatermark,
+    Underrun,
+    PlayedOut,
+    DeviceLost,
+    FormatChanged,
+    Position,
+};
+
+static inline const char *StreamEventName(StreamEventType t)
+{
+    switch (t)
+    {
+    case StreamEventType::LowWatermark:
+        return "low-watermark";
+    case StreamEventType::Underrun:
+        return "underrun";
+    case StreamEventType::PlayedOut:
+        return "played-out";
+    case StreamEventType::DeviceLost:
+        return "device-lost";
+    case StreamEventType::FormatChanged:
+        return "format-changed";
+    case StreamEventType::Position:
+        return "position";
+    }
+    return "unknown";
+}
+
+struct StreamEvent
+{
+    StreamEventType type{StreamEventType::Position};
+    // Type specific: ring bytes (low-watermark), rate (format-changed)
+    uint32_t value{0};
+    // Audible position when the event was raised
+    uint64_t frames{0};
+    uint64_t timestampNs{0};
+};
+
+//
+// Bounded multi-producer, single-consumer event queue (Vyukov's sequenced
+// cells). push() never blocks or allocates, so it is safe on the render
+// thread; a full queue drops the event and push() returns false. pop() is
+// for the one JS thread that drains it.
+//
+class StreamEventQueue
+{
+public:
+    static constexpr size_t kCapacity = 256;
+
+    StreamEventQueue()
+    {
+        for (size_t i = 0; i < kCapacity; ++i)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    StreamEventQueue(const StreamEventQueue &) = delete;
+    StreamEventQueue &operator=(const StreamEventQueue &) = delete;
+
+    bool push(const StreamEvent &e)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &c = cells[pos & (kCapacity - 1)];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    c.event = e;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(StreamEvent &e)
+    {
+        Cell &c = cells[head & (kCapacity - 1)];
+        size_t seq = c.seq.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(head + 1) < 0)
+            return false;
+        e = c.event;
+        c.seq.store(head + kCapacity, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+private:
+    static_assert((kCapacity & (kCapacity - 1)) == 0, "capacity must be a power of two");
+
+    struct Cell
+    {
+        std::atomic<size_t> seq{0};
+        StreamEvent event;
+    };
+
+    Cell cells[kCapacity];
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) size_t head{0}; // consumer only
+};
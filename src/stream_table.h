@@ -0,0 +1,198 @@
+// src/stream_table.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "writer_wakeup.h"
+
+//
+// Handle -> object table for the open streams, looked up on every write,
+// stats poll and control call from any thread.
+//
+// A handle packs a slot index (low kIndexBits) and the slot's generation,
+// so a stale handle never resolves to whatever reuses its slot. Each slot
+// holds one 64-bit word, {generation:24 | live:1 | references:31}, and
+// acquire() is a single fetch_add on it: no lock, no retry loop. If the
+// word shows a different generation or a retired slot, the reference is
+// given straight back.
+//
+// Removal is two-phase. retire() clears the live bit so new lookups fail.
+// reclaim() then parks until the last outstanding reference is dropped, after
+// which the object may be freed and the slot reused. Only insert, retire and
+// reclaim take the table mutex.
+//
+// Generations wrap after 2^24 reuses of one slot; a handle kept that long
+// across that many open/close cycles could alias.
+//
+template <typename T>
+class HandleTable
+{
+public:
+    static constexpr unsigned kIndexBits = 8;
+    static constexpr size_t kSlots = size_t(1) << kIndexBits;
+
+    // Counted reference to a live entry. Empty if the lookup failed.
+    class Ref
+    {
+    public:
+        Ref() = default;
+        Ref(const Ref &) = delete;
+        Ref &operator=(const Ref &) = delete;
+        Ref(Ref &&o) noexcept : table(o.table), slot(o.slot), ptr(o.ptr)
+        {
+            o.ptr = nullptr;
+        }
+        Ref &operator=(Ref &&o) noexcept
+        {
+            if (this != &o)
+            {
+                reset();
+                table = o.table;
+                slot = o.slot;
+                ptr = o.ptr;
+                o.ptr = nullptr;
+            }
+            return *this;
+        }
+        ~Ref() { reset(); }
+
+        T *get() const { return ptr; }
+        T *operator->() const { return ptr; }
+        explicit operator bool() const { return ptr != nullptr; }
+
+        void reset()
+        {
+            if (ptr)
+                table->release(slot);
+            ptr = nullptr;
+        }
+
+    private:
+        friend class HandleTable;
+        Ref(HandleTable *t, size_t s, T *p) : table(t), slot(s), ptr(p) {}
+
+        HandleTable *table{nullptr};
+        size_t slot{0};
+        T *ptr{nullptr};
+    };
+
+    HandleTable()
+    {
+        free.reserve(kSlots);
+        for (size_t i = kSlots; i-- > 0;)
+            free.push_back(i);
+    }
+
+    HandleTable(const HandleTable &) = delete;
+    HandleTable &operator=(const HandleTable &) = delete;
+
+    // Publishes p and returns its handle, or 0 if every slot is taken.
+    uint32_t insert(T *p)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free.empty())
+            return 0;
+        size_t i = free.back();
+        free.pop_back();
+
+        Slot &s = slots[i];
+        uint32_t gen = s.nextGeneration;
+        s.nextGeneration = gen == kGenMask ? 1 : gen + 1;
+        s.ptr.store(p, std::memory_order_relaxed);
+        // A stale acquire() may hold a transient reference on the free slot;
+        // keep its count so the matching release balances
+        uint64_t w = s.word.load(std::memory_order_relaxed);
+        uint64_t next;
+        do
+        {
+            next = (static_cast<uint64_t>(gen) << kGenShift) | kLive | (w & kRefMask);
+        } while (!s.word.compare_exchange_weak(w, next, std::memory_order_release, std::memory_order_relaxed));
+        return (gen << kIndexBits) | static_cast<uint32_t>(i);
+    }
+
+    // Any thread. Never blocks.
+    Ref acquire(uint32_t handle)
+    {
+        size_t i = handle & (kSlots - 1);
+        uint32_t gen = handle >> kIndexBits;
+        Slot &s = slots[i];
+        uint64_t w = s.word.fetch_add(1, std::memory_order_acquire);
+        if ((w & kLive) && static_cast<uint32_t>(w >> kGenShift) == gen)
+            return Ref(this, i, s.ptr.load(std::memory_order_relaxed));
+        release(i);
+        return Ref();
+    }
+
+    // Makes the handle unresolvable and returns its object (nullptr if it was
+    // not live). References taken before this stay valid until reclaim().
+    T *retire(uint32_t handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t i = handle & (kSlots - 1);
+        uint32_t gen = handle >> kIndexBits;
+        Slot &s = slots[i];
+        uint64_t w = s.word.load(std::memory_order_relaxed);
+        do
+        {
+            if (!(w & kLive) || static_cast<uint32_t>(w >> kGenShift) != gen)
+                return nullptr;
+        } while (!s.word.compare_exchange_weak(w, w & ~kLive, std::memory_order_acq_rel, std::memory_order_relaxed));
+        return s.ptr.load(std::memory_order_relaxed);
+    }
+
+    // Waits for every reference to a retired handle to be dropped, then
+    // frees its slot. The object is the caller's to delete afterwards.
+    void reclaim(uint32_t handle)
+    {
+        size_t i = handle & (kSlots - 1);
+        Slot &s = slots[i];
+        while (s.word.load(std::memory_order_acquire) & kRefMask)
+        {
+            uint32_t seen = drained.prepareWait();
+            if ((s.word.load(std::memory_order_acquire) & kRefMask) == 0)
+            {
+                drained.cancelWait();
+                break;
+            }
+            drained.wait(seen, 10);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        s.ptr.store(nullptr, std::memory_order_relaxed);
+        free.push_back(i);
+    }
+
+private:
+    static constexpr unsigned kGenShift = 32;
+    static constexpr uint32_t kGenMask = (1u << (32 - kIndexBits)) - 1;
+    static constexpr uint64_t kLive = 1ull << 31;
+    static constexpr uint64_t kRefMask = kLive - 1;
+
+    struct Slot
+    {
+        std::atomic<uint64_t> word{0};
+        std::atomic<T *> ptr{nullptr};
+        uint32_t nextGeneration{1}; // guarded by mutex; 0 is never issued
+    };
+
+    void release(size_t i)
+    {
+        uint64_t prev = slots[i].word.fetch_sub(1, std::memory_order_acq_rel);
+        // Last reference to a retired slot: let reclaim() go
+        if (!(prev & kLive) && (prev & kRefMask) == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (drained.hasWaiters())
+                drained.wakeAll();
+        }
+    }
+
+    Slot slots[kSlots];
+    std::mutex mutex;
+    std::vector<size_t> free;
+    WriterWakeup drained;
+};
@@ -0,0 +1,123 @@
+// src/writer_wakeup.h
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#if defined(_MSC_VER)
+#pragma comment(lib, "synchronization.lib") // WaitOnAddress
+#endif
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// Wakeup channel from the render thread to writers parked on a full ring.
+//
+// The render thread never pays for a wakeup unless somebody is parked: it
+// checks hasWaiters() (a plain load) and only then bumps the sequence word and
+// issues the kernel wake. Writers use the usual prepare/re-check/wait pattern
+// so a wake that lands between the space check and the sleep is not lost:
+//
+//     uint32_t seen = wake.prepareWait();
+//     if (condition) { wake.cancelWait(); ... }
+//     wake.wait(seen, timeoutMs);
+//
+// Linux uses a private futex on the sequence word and Windows its
+// equivalent, WaitOnAddress (Windows 8+); either only sleeps while the word
+// still holds `seen`, so no wake can slip in between the check and the
+// sleep. Other platforms use a mutex/condvar pair that is only touched when a
+// waiter is present.
+class WriterWakeup
+{
+public:
+    WriterWakeup() = default;
+    WriterWakeup(const WriterWakeup &) = delete;
+    WriterWakeup &operator=(const WriterWakeup &) = delete;
+
+    // Render side: cheap check done once per period.
+    bool hasWaiters() const
+    {
+        return waiters.load(std::memory_order_relaxed) != 0;
+    }
+
+    // Render side (or close): wakes every parked waiter.
+    void wakeAll()
+    {
+#if defined(__linux__)
+        seq.fetch_add(1, std::memory_order_release);
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq), FUTEX_WAKE_PRIVATE,
+                INT32_MAX, nullptr, nullptr, 0);
+#elif defined(_WIN32)
+        seq.fetch_add(1, std::memory_order_release);
+        WakeByAddressAll(reinterpret_cast<void *>(&seq));
+#else
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            seq.fetch_add(1, std::memory_order_release);
+        }
+        cv.notify_all();
+#endif
+    }
+
+    // Waiter side: announce intent to park and snapshot the sequence.
+    // The caller must re-check its condition after this and before wait().
+    uint32_t prepareWait()
+    {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return seq.load(std::memory_order_acquire);
+    }
+
+    // Waiter side: condition already satisfied, do not park.
+    void cancelWait()
+    {
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Waiter side: sleeps until wakeAll() moves the sequence past `seen` or
+    // the timeout expires. Returns true if woken by wakeAll().
+    bool wait(uint32_t seen, uint32_t timeoutMs)
+    {
+#if defined(__linux__)
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(timeoutMs / 1000);
+        ts.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000L;
+        if (seq.load(std::memory_order_acquire) == seen)
+        {
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq), FUTEX_WAIT_PRIVATE,
+                    seen, &ts, nullptr, 0);
+        }
+#elif defined(_WIN32)
+        if (seq.load(std::memory_order_acquire) == seen)
+            WaitOnAddress(reinterpret_cast<volatile void *>(&seq), &seen, sizeof(seen), timeoutMs);
+#else
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]
+                        { return seq.load(std::memory_order_acquire) != seen; });
+        }
+#endif
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return seq.load(std::memory_order_acquire) != seen;
+    }
+
+private:
+    std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> waiters{0};
+#if !defined(__linux__) && !defined(_WIN32)
+    std::mutex mutex;
+    std::condition_variable cv;
+#endif
+};